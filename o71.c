@@ -1,6 +1,11 @@
 /* Internal config options */
-#define O71_METHOD_ARRAY_LIMIT 0x80
+#define O71_METHOD_ARRAY_LIMIT 0x10
 #define O71_REG_OBJ_FIELD_ARRAY_LIMIT 0x40
+/* representation for bags that outgrow their array limit:
+ * O71_BAG_BTREE or O71_BAG_RBTREE */
+#ifndef O71_BAG_LARGE_MODE
+#define O71_BAG_LARGE_MODE O71_BAG_BTREE
+#endif
 
 #include "o71.h"
 
@@ -25,16 +30,55 @@
 #define M2(...) ((void) 0)
 #endif
 
+/* SIMD kernels are picked at run time based on cpuid; build with
+ * -DO71_SIMD=0 to keep only the portable ones */
+#if !defined(O71_SIMD) && defined(__GNUC__) \
+    && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define O71_SIMD 1
+#endif
+#if O71_SIMD
+#include <immintrin.h>
+#include <cpuid.h>
+#endif
+
+/* a slice gets its own copy when frozen or interned if it keeps alive a
+ * parent more than 4 times its size */
+#define STR_SLICE_IS_SMALL(_world_p, _str_p) \
+    (((o71_string_t *) o71_obj_ptr((_world_p), (_str_p)->inl.parent_r))->n \
+     / 4 > (_str_p)->n)
+
+/* home slot for a key in a hash bag: Fibonacci hashing folds the high
+ * bits of the ref into the low ones */
+#define KVHASH_HOME(_key_r, _mask) \
+    ((size_t) (((uint64_t) (_key_r) * UINT64_C(0x9E3779B97F4A7C15)) >> 32) \
+     & (_mask))
+/* slots needed to keep a hash bag with _n items at most 3/4 full */
+#define KVHASH_FITS(_n, _slot_n) ((_n) * 4 <= (_slot_n) * 3)
+
+/* key comparators for KVBAG_SEARCH_DEF: the generic one calls the cmp
+ * argument of the search; the ref one is inlined */
+#define KVBAG_CMP_ANY(_w, _a, _b, _ctx) (cmp((_w), (_a), (_b), (_ctx)))
+#define KVBAG_CMP_REF(_w, _a, _b, _ctx) \
+    ((_a) == (_b) ? O71_EQUAL : ((_a) > (_b) ? O71_MORE : O71_LESS))
+
+/* kvbag_merge() puts the items one by one when the batch is smaller than
+ * this fraction of the bag, instead of rebuilding the bag */
+#define KVBAG_MERGE_PUT_RATIO 8
+
 #define FIELD_OFS(_type, _field) ((uintptr_t) &((_type *) NULL)->_field)
 #define ITEM_COUNT(_array) (sizeof(_array) / sizeof(_array[0]))
-#define IS_DIGIT(_ch) ((_ch) >= '0' && (_ch) <= '9')
-#define IS_HEX_DIGIT(_ch) \
-    (((_ch) >= '0' && (_ch) <= '9') || \
-     (((_ch) | 0x20) >= 'a' && ((_ch) | 0x20) <= 'f'))
-#define IS_ALPHA(_ch) (((_ch) >= 'a' && (_ch) <= 'z') || \
-                       ((_ch) >= 'A' && (_ch) <= 'Z'))
-#define IS_ID_START_CHAR(_ch) (IS_ALPHA((_ch)) || (_ch) == '_')
-#define IS_ID_BODY_CHAR(_ch) (IS_ID_START_CHAR((_ch)) || IS_DIGIT((_ch)))
+/* character classes for source bytes; see char_class_a */
+#define CC_ID_START 0x01 // letters and '_'
+#define CC_DIGIT 0x02
+#define CC_HEX 0x04
+#define CC_SPACE 0x08
+#define CC_EOL 0x10
+#define CC_ID_BODY (CC_ID_START | CC_DIGIT)
+#define CHAR_CLASS(_ch) (char_class_a[(uint8_t) (_ch)])
+#define IS_DIGIT(_ch) (CHAR_CLASS(_ch) & CC_DIGIT)
+#define IS_HEX_DIGIT(_ch) (CHAR_CLASS(_ch) & CC_HEX)
+#define IS_ID_START_CHAR(_ch) (CHAR_CLASS(_ch) & CC_ID_START)
+#define IS_ID_BODY_CHAR(_ch) (CHAR_CLASS(_ch) & CC_ID_BODY)
 #define ALPHANUM_TO_DIGIT(_ch) ((_ch) <= '9' ? (_ch) - '0' : 9 + ((_ch) & 31))
 
 #define FREE_ARRAY(_allocator_p, _array, _length) \
@@ -45,12 +89,16 @@
     (_os) = redim((_allocator_p), (void * *) &(_ptr), &_n, 1, sizeof(*(_ptr))); \
 } while (0)
 
+#define ARENA_ALLOC(_os, _arena_p, _ptr) \
+    ((_os) = arena_alloc((_arena_p), (void * *) &(_ptr), sizeof(*(_ptr))))
+
 #define FREE(_allocator_p, _ptr) do { size_t _n = 1; o71_status_t _os; \
     _os = redim((_allocator_p), (void * *) &(_ptr), &_n, 0, sizeof(*(_ptr))); \
     AOS(_os); \
 } while (0)
 
 #if O71_CHECKED
+#define LOC_STATUS(_loc_p, _status) ((_loc_p)->status = (_status))
 #define A(_cond) \
     if ((_cond)) ; \
     else do { M("assert failed: %s", #_cond); return O71_BUG; } while (0)
@@ -59,14 +107,27 @@
     else do { M("assert status failed: %s", N(_os)); return (_os); } while (0)
 #define redim(_a, _d, _c, _n, _i) (redim_func((_a), (_d), (_c), (_n), (_i), __FUNCTION__, __LINE__))
 #else
+#define LOC_STATUS(_loc_p, _status) ((void) 0)
 #define A(_cond) ((void) 0)
 #define AOS(_os) ((void) (_os))
 #define redim(_a, _d, _c, _n, _i) (redim_func((_a), (_d), (_c), (_n), (_i)))
 #endif
 
-#define ENCODE_FREE_OBJECT_SLOT(_x) (((_x) << 1) | 1)
-#define DECODE_FREE_OBJECT_SLOT(_v) ((_v) >> 1)
+#define MEM_OBJ_PTR(_world_p, _x) \
+    ((o71_mem_obj_t *) O71_OBJ_SLOT((_world_p), (_x)))
+#define FREE_OBJECT_SLOT ((void *) (uintptr_t) 1)
+#define BMP_BITS (sizeof(uintptr_t) * CHAR_BIT)
+#define BMP_TEST(_a, _x) (((_a)[(_x) / BMP_BITS] >> ((_x) % BMP_BITS)) & 1)
+#define BMP_SET(_a, _x) \
+    ((_a)[(_x) / BMP_BITS] |= (uintptr_t) 1 << ((_x) % BMP_BITS))
+#define BMP_CLR(_a, _x) \
+    ((_a)[(_x) / BMP_BITS] &= ~((uintptr_t) 1 << ((_x) % BMP_BITS)))
+#define OBJ_PAGE_ITEM_N (O71_OBJ_PAGE_SIZE + O71_OBJ_PAGE_BMP_N)
+#define OBJ_PAGE_BMP(_world_p, _page_x) \
+    ((uintptr_t *) ((_world_p)->obj_page_pa[(_page_x)] + O71_OBJ_PAGE_SIZE))
 #define IS_FREE_OBJECT_SLOT(_v) ((uintptr_t) (_v) & 1)
+#define GC_IGNORED ((o71_ref_count_t) -1)
+#define GC_LIVE ((o71_ref_count_t) -2)
 #define IS_OBJ_PTR_ALIGNED(_p) (!((_p) & (sizeof(void *) - 1)))
 
 #define N(_x) (o71_status_name(_x))
@@ -93,6 +154,15 @@ struct grammar_rule_s
 #endif
 };
 
+/*  lowest_bit_index  */
+/**
+ *  Returns the index of the lowest set bit in a non-zero word.
+ */
+static unsigned int lowest_bit_index
+(
+    uintptr_t w
+);
+
 /*  log2_rounded_up  */
 /**
  *  Returns the smallest non-negative power of 2 greater or equal to n.
@@ -163,6 +233,77 @@ static o71_status_t extend_array
     size_t item_size
 );
 
+/*  slab_alloc  */
+/**
+ *  Allocates memory for an object body of the given size.
+ *  Small sizes are served from the size class slab pools of the allocator;
+ *  only whole slabs are obtained through redim().
+ *  Larger sizes are allocated directly with redim().
+ *  @retval O71_OK
+ *  @retval O71_NO_MEM
+ *  @retval O71_MEM_LIMIT
+ *  @retval O71_MEM_CORRUPTED
+ *  @retval O71_BUG
+ *  @retval O71_TODO
+ */
+static o71_status_t slab_alloc
+(
+    o71_allocator_t * allocator_p,
+    void * * body_pp,
+    size_t size
+);
+
+/*  slab_alloc_run  */
+/**
+ *  Allocates a run of adjacent object bodies of the given size.
+ *  Chunks are bumped from the never used area of one slab, so consecutive
+ *  bodies are @a *stride_p bytes apart; each of them can still be released
+ *  individually with slab_free().
+ *  @param n_p [in, out]
+ *      on input the maximum number of bodies wanted; on output the number
+ *      of bodies allocated (at least 1)
+ *  @retval O71_OK
+ *  @retval O71_NO_MEM
+ *  @retval O71_MEM_LIMIT
+ *  @retval O71_MEM_CORRUPTED
+ *  @retval O71_BUG
+ *  @retval O71_TODO
+ */
+static o71_status_t slab_alloc_run
+(
+    o71_allocator_t * allocator_p,
+    void * * body_pp,
+    size_t * stride_p,
+    size_t * n_p,
+    size_t size
+);
+
+/*  slab_free  */
+/**
+ *  Releases an object body allocated with slab_alloc().
+ *  A slab that becomes empty is cached for reuse if its pool has no cached
+ *  slab, otherwise it is released.
+ *  @retval O71_OK
+ *  @retval O71_MEM_CORRUPTED
+ *  @retval O71_BUG
+ *  @retval O71_TODO
+ */
+static o71_status_t slab_free
+(
+    o71_allocator_t * allocator_p,
+    void * body_p,
+    size_t size
+);
+
+/*  slab_trim  */
+/**
+ *  Releases the cached empty slabs from all pools of the allocator.
+ */
+static o71_status_t slab_trim
+(
+    o71_allocator_t * allocator_p
+);
+
 /* flow_init */
 static void flow_init
 (
@@ -187,7 +328,7 @@ static o71_status_t extend_object_table
 
 /*  alloc_object_index  */
 /**
- *  Allocates an index in the object table.
+ *  Allocates the lowest free index in the object table.
  *  @retval O71_OK
  *  @retval O71_NO_MEM.
  *  @retval O71_MEM_LIMIT,
@@ -202,9 +343,29 @@ static o71_status_t alloc_object_index
     o71_obj_index_t * obj_xp
 );
 
+/*  alloc_object_index_n  */
+/**
+ *  Allocates the @a n lowest free indices in the object table, in ascending
+ *  order, consuming whole bitmap words at a time.
+ *  On failure no index is left allocated.
+ *  @retval O71_OK
+ *  @retval O71_NO_MEM.
+ *  @retval O71_MEM_LIMIT,
+ *  @retval O71_ARRAY_LIMIT,
+ *  @retval O71_MEM_CORRUPTED
+ *  @retval O71_BUG
+ *  @retval O71_TODO
+ */
+static o71_status_t alloc_object_index_n
+(
+    o71_world_t * world_p,
+    o71_obj_index_t * obj_xa,
+    size_t n
+);
+
 /*  free_object_index  */
 /**
- *  Adds the given index to the list of free object indexes.
+ *  Marks the given index as free in the object table bitmap.
  *  @retval O71_OK
  *  @retval O71_MEM_CORRUPTED
  *  @retval O71_BUG
@@ -239,6 +400,32 @@ static o71_status_t alloc_object
     o71_obj_index_t * obj_xp
 );
 
+/*  alloc_object_n  */
+/**
+ *  Batch version of alloc_object(): allocates @a n objects of the same class.
+ *  The indices are reserved in one pass over the object table bitmap, the
+ *  bodies are carved from adjacent slab chunks and the class gets its
+ *  reference count raised once by @a n.
+ *  On failure nothing is left allocated.
+ *  @retval O71_OK
+ *  @retval O71_NO_MEM
+ *  @retval O71_MEM_LIMIT
+ *  @retval O71_ARRAY_LIMIT
+ *  @retval O71_REF_COUNT_OVERFLOW
+ *      too many references to the object's class
+ *      this code can be returned only in checked or debug builds
+ *  @retval O71_MEM_CORRUPTED
+ *  @retval O71_BUG
+ *  @retval O71_TODO
+ */
+static o71_status_t alloc_object_n
+(
+    o71_world_t * world_p,
+    o71_ref_t class_r,
+    size_t n,
+    o71_obj_index_t * obj_xa
+);
+
 /*  free_object  */
 /**
  *  Reverts alloc_object().
@@ -250,6 +437,37 @@ static o71_status_t free_object
     o71_ref_t obj_x
 );
 
+/*  gc_release_scratch  */
+/**
+ *  Frees the cycle collector scratch arrays.
+ */
+static o71_status_t gc_release_scratch
+(
+    o71_world_t * world_p
+);
+
+/*  cleanup_slice  */
+/**
+ *  Destroys at most @a budget objects from the head of the destroy chain.
+ *  Each object is finished, its memory and table slot are released and only
+ *  then its class is dereferenced.
+ *  Nested calls made while finishing objects do nothing.
+ *  @param done_np [out]
+ *      number of objects destroyed
+ *  @retval O71_OK
+ *      the destroy chain is empty
+ *  @retval O71_PENDING
+ *      there are objects left in the destroy chain
+ *  @retval other
+ *      error from some finish callback or from the allocator
+ */
+static o71_status_t cleanup_slice
+(
+    o71_world_t * world_p,
+    size_t budget,
+    size_t * done_np
+);
+
 /*  alloc_exc  */
 /**
  *  Allocates and initializes basic fields in an exception object of given
@@ -332,2953 +550,3228 @@ static o71_status_t set_reg_obj_field
     o71_ref_t value
 );
 
-/* null_func_run */
+/*  release_ref_visit  */
 /**
- *  Run function that returns null.
+ *  Ref visitor that clears the slot and drops the reference it held.
  */
-static o71_status_t null_func_run
+static o71_status_t release_ref_visit
 (
-    o71_flow_t * flow_p
+    o71_world_t * world_p,
+    o71_ref_t * ref_p,
+    void * ctx
 );
 
-/*  int_add_call  */
+/*  noop_visit_refs  */
 /**
- *  The handler for a call to the function to add ints.
+ *  visit_refs() for objects that own no references.
  */
-static o71_status_t int_add_call
+static o71_status_t noop_visit_refs
 (
-    o71_flow_t * flow_p,
-    o71_ref_t func_r,
-    o71_ref_t * arg_ra,
-    size_t arg_n
+    o71_world_t * world_p,
+    o71_ref_t obj_r,
+    o71_ref_visit_f visit,
+    void * ctx
 );
 
-/*  str_intern_cmp  */
+/*  reg_obj_visit_refs  */
 /**
- *  Compares two strings as ordered in the intern bag.
+ *  Visits the fixed fields and the values in the dynamic field bag.
  */
-static o71_status_t str_intern_cmp
+static o71_status_t reg_obj_visit_refs
 (
     o71_world_t * world_p,
-    o71_ref_t a_r,
-    o71_ref_t b_r,
+    o71_ref_t obj_r,
+    o71_ref_visit_f visit,
     void * ctx
 );
 
-/*  str_finish  */
+/*  reg_obj_finish  */
 /**
- *  Uninitializer for strings.
+ *  Releases the field values and the dynamic field bag.
  */
-static o71_status_t str_finish
+static o71_status_t reg_obj_finish
 (
     o71_world_t * world_p,
     o71_ref_t obj_r
 );
 
-/*  sfunc_call  */
+/*  exc_visit_refs  */
 /**
- *  Handler for calls to scripted functions.
+ *  Visits the fields of the exception and the execution context where it
+ *  occured.
  */
-static o71_status_t sfunc_call
+static o71_status_t exc_visit_refs
 (
-    o71_flow_t * flow_p,
-    o71_ref_t func_r,
-    o71_ref_t * arg_ra,
-    size_t arg_n
+    o71_world_t * world_p,
+    o71_ref_t obj_r,
+    o71_ref_visit_f visit,
+    void * ctx
 );
 
-/*  sfunc_run  */
+/*  exc_finish  */
 /**
- *  Handler for the run stage of a scripted function.
+ *  Releases the references owned by the exception.
  */
-static o71_status_t sfunc_run
+static o71_status_t exc_finish
 (
-    o71_flow_t * flow_p
+    o71_world_t * world_p,
+    o71_ref_t obj_r
 );
 
-/*  sfunc_alloc_code  */
+/*  sec_visit_refs  */
 /**
- *  Allocates code structures.
+ *  Visits the variables of a script function execution context.
  */
-static o71_status_t sfunc_alloc_code
+static o71_status_t sec_visit_refs
 (
     o71_world_t * world_p,
-    o71_script_function_t * sfunc_p,
-    o71_insn_t * * insn_ap,
-    uint32_t * * opnd_ap,
-    size_t insn_n,
-    size_t opnd_n
+    o71_ref_t obj_r,
+    o71_ref_visit_f visit,
+    void * ctx
 );
 
-/*  sfunc_add_const  */
+/*  sec_finish  */
 /**
- *  Adds a constant to the function.
+ *  Releases the variables still held by a script function execution context
+ *  (when the function did not reach return).
  */
-static o71_status_t sfunc_add_const
+static o71_status_t sec_finish
 (
     o71_world_t * world_p,
-    o71_script_function_t * sfunc_p,
-    uint32_t * const_xp,
     o71_ref_t obj_r
 );
 
-/* sfunc_append_opc_val_obj_name */
+/*  gc_count_visit  */
 /**
- *  @retval O71_OK alles gut
+ *  Subtracts the visited reference from the trial count of its target.
  */
-static o71_status_t sfunc_append_opc_val_obj_name
+static o71_status_t gc_count_visit
 (
     o71_world_t * world_p,
-    o71_script_function_t * sfunc_p,
-    uint8_t opcode,
-    uint32_t value_vx,
-    uint32_t obj_vx,
-    uint32_t name_istr_vx
+    o71_ref_t * ref_p,
+    void * ctx
 );
 
-/*  ref_cmp  */
+/*  gc_mark_visit  */
 /**
- *  Compares 2 references by their value as integers not by the content
- *  referenced.
+ *  Marks the target of the visited reference as live and queues it for
+ *  scanning.
  */
-static o71_status_t ref_cmp
+static o71_status_t gc_mark_visit
 (
     o71_world_t * world_p,
-    o71_ref_t a_r,
-    o71_ref_t b_r,
+    o71_ref_t * ref_p,
     void * ctx
 );
 
-/*  kvbag_init  */
+/* null_func_run */
 /**
- *  Inits a key value bag.
+ *  Run function that returns null.
  */
-static void kvbag_init
+static o71_status_t null_func_run
 (
-    o71_kvbag_t * kvbag_p,
-    uint8_t array_limit
+    o71_flow_t * flow_p
 );
 
-/*  kvbag_free  */
+/*  int_add_call  */
 /**
- *  Frees kvbag.
+ *  The handler for a call to the function to add ints.
  */
-static o71_status_t kvbag_free
+static o71_status_t int_add_call
 (
-    o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_kv_free_f kv_free
+    o71_flow_t * flow_p,
+    o71_ref_t func_r,
+    o71_ref_t * arg_ra,
+    size_t arg_n
 );
 
-/*  kvbag_array_search  */
+/*  str_hash  */
 /**
- *
+ *  FNV-1a hash of a byte array; cached in read-only strings.
  */
-static o71_status_t kvbag_array_search
+static uint32_t str_hash
 (
-    o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_ref_t key_r,
-    o71_cmp_f cmp,
-    void * ctx,
-    o71_kvbag_loc_t * loc_p
+    uint8_t const * a,
+    size_t n
 );
 
-/*  kvbag_array_delete  */
+/*  bytes_mismatch_scalar  */
 /**
- *  Deletes a single item
+ *  @returns the index of the first byte that differs between the two
+ *  arrays or n if they have the same content
  */
-static o71_status_t kvbag_array_delete
+static size_t bytes_mismatch_scalar
 (
-    o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_kvbag_loc_t * loc_p
+    uint8_t const * a,
+    uint8_t const * b,
+    size_t n
 );
 
-/*  kvbag_array_free  */
+#if O71_SIMD
+/*  bytes_mismatch_sse2  */
 /**
- *  Finishes kvbag array.
+ *  SSE2 version of bytes_mismatch_scalar(); compares 16 bytes at a time.
  */
-static o71_status_t kvbag_array_free
+static size_t bytes_mismatch_sse2
 (
-    o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_kv_free_f kv_free
+    uint8_t const * a,
+    uint8_t const * b,
+    size_t n
 );
 
-/*  kvbag_rbtree_search  */
+/*  bytes_mismatch_avx2  */
 /**
- *
+ *  AVX2 version of bytes_mismatch_scalar(); compares 32 bytes at a time.
+ *  Only called when cpu_has_avx2() says so.
  */
-static o71_status_t kvbag_rbtree_search
+static size_t bytes_mismatch_avx2
 (
-    o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_ref_t key_r,
-    o71_cmp_f cmp,
-    void * ctx,
-    o71_kvbag_loc_t * loc_p
+    uint8_t const * a,
+    uint8_t const * b,
+    size_t n
 );
 
-/*  kvbag_rbtree_add  */
+/*  cpu_has_avx2  */
 /**
- *
+ *  @returns non-zero if the cpu supports AVX2 and the OS saves ymm state
+ */
+static int cpu_has_avx2 (void);
+#endif
+
+/*  ascii_span_scalar  */
+/**
+ *  @returns the number of leading bytes that are printable ASCII chars
+ *  (0x20 - 0x7F)
  */
-static o71_status_t kvbag_rbtree_add
+static size_t ascii_span_scalar
 (
-    o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_ref_t key_r,
-    o71_ref_t value_r
+    uint8_t const * a,
+    size_t n
 );
 
-/* kvbag_rbtree_multi_add */
+#if O71_SIMD
+/*  ascii_span_sse2  */
 /**
- *  Adds multiple key-value items.
- *  @note this function is intended for switching a bag from the array form
- *  to red/black tree.
+ *  SSE2 version of ascii_span_scalar(); checks 16 bytes at a time.
  */
-static o71_status_t kvbag_rbtree_multi_add
+static size_t ascii_span_sse2
 (
-    o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_kv_t * kv_a,
-    size_t kv_n
+    uint8_t const * a,
+    size_t n
 );
 
-/* kvbag_rbtree_free */
+/*  ascii_span_avx2  */
 /**
- * Deletes all nodes in the tree.
+ *  AVX2 version of ascii_span_scalar(); checks 32 bytes at a time.
+ *  Only called when cpu_has_avx2() says so.
  */
-static o71_status_t kvbag_rbtree_free
+static size_t ascii_span_avx2
 (
-    o71_world_t * world_p,
-    o71_kvnode_t * kvnode_p,
-    o71_kv_free_f kv_free
+    uint8_t const * a,
+    size_t n
 );
+#endif
 
-/*  kvbag_rbtree_node_alloc  */
+/* ascii_span: the kernel used to skip printable ASCII; set by simd_init() */
+static size_t (* ascii_span) (uint8_t const * a, size_t n) = ascii_span_scalar;
+
+/*  utf8_char_check  */
 /**
- *
+ *  Validates the UTF-8 encoded char at the start of the buffer.
+ *  @returns the length of the char or 0 if it is not valid, in which case
+ *      *ce_p is set to the O71_CE_PARSE_xxx code describing the problem
  */
-static o71_status_t kvbag_rbtree_node_alloc
+static size_t utf8_char_check
 (
-    o71_world_t * world_p,
-    o71_kvnode_t * * kvnode_pp
+    uint8_t const * a,
+    size_t n,
+    int * ce_p
 );
 
-/*  kvbag_rbtree_node_free  */
+/*  utf8_span  */
 /**
- *
+ *  Skips printable text: ASCII from 0x20 up and valid UTF-8 encoded chars.
+ *  @returns the length of the text; scanning stops at a control char, at
+ *      the end of the buffer (*ce_p is left untouched) or at an invalid
+ *      UTF-8 sequence (*ce_p gets the error code)
  */
-static o71_status_t kvbag_rbtree_node_free
+static size_t utf8_span
 (
-    o71_world_t * world_p,
-    o71_kvnode_t * kvnode_p,
-    o71_kv_free_f kv_free
+    uint8_t const * a,
+    size_t n,
+    int * ce_p
 );
 
-/*  kvbag_search  */
+/* bytes_mismatch: the kernel used to compare byte arrays; set by
+ * simd_init() */
+static size_t (* bytes_mismatch)
+    (uint8_t const * a, uint8_t const * b, size_t n) = bytes_mismatch_scalar;
+
+#if O71_SIMD
+/*  simd_init  */
 /**
- *
+ *  Points bytes_mismatch and ascii_span to the best kernels for the cpu.
+ *  Runs once at load time, before any world exists, so the pointers are
+ *  never written while worlds use them.
  */
-static o71_status_t kvbag_search
+static void simd_init (void) __attribute__((constructor));
+#endif
+
+/*  bytes_eq  */
+/**
+ *  @returns non-zero if the two byte arrays have the same content
+ */
+static int bytes_eq
 (
-    o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_ref_t key_r,
-    o71_cmp_f cmp,
-    void * ctx,
-    o71_kvbag_loc_t * loc_p
+    uint8_t const * a,
+    uint8_t const * b,
+    size_t n
 );
 
-/*  kvbag_rbtree_insert  */
+/*  istr_lookup  */
 /**
- *
+ *  Searches the intern table for a string with the given content.
+ *  @returns the intern string or O71R_NULL if missing
  */
-static o71_status_t kvbag_rbtree_insert
+static o71_ref_t istr_lookup
 (
     o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_ref_t key_r,
-    o71_ref_t value_r,
-    o71_kvbag_loc_t * loc_p
+    uint8_t const * a,
+    size_t n,
+    uint32_t hash
 );
 
-/*  kvbag_rbtree_delete  */
+/*  istr_grow  */
 /**
- *
+ *  Resizes the intern table so that it can hold min_n strings while staying
+ *  at most 3/4 full.
  */
-static o71_status_t kvbag_rbtree_delete
+static o71_status_t istr_grow
 (
     o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_kvbag_loc_t * loc_p
+    size_t min_n
 );
 
-/*  kvbag_rbtree_np  */
+/*  istr_add  */
 /**
- *
+ *  Adds a read-only string, not present already, to the intern table.
+ *  Grows the table to keep it at most 3/4 full.
  */
-static o71_kvnode_t * kvbag_rbtree_np
+static o71_status_t istr_add
 (
-    o71_kvbag_loc_t * loc_p,
-    unsigned int side
+    o71_world_t * world_p,
+    o71_ref_t str_r,
+    uint32_t hash
 );
 
-static o71_status_t kvbag_rbtree_finish
+/*  istr_remove  */
+/**
+ *  Removes an intern string from the table; the slots that follow in the
+ *  same cluster are shifted back so lookups need no tombstones.
+ *  @retval O71_OK string removed
+ *  @retval O71_BUG string not found; only in checked builds
+ */
+static o71_status_t istr_remove
 (
     o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_kv_free_f kv_free
+    o71_ref_t str_r,
+    uint32_t hash
 );
 
-/* kvbag_insert */
+/*  str_intern_cmp  */
 /**
- *  Inserts a new key-value at the given location.
- *  @param key_r [in]
- *      key to insert; this will get its ref count incremented
- *  @oaram value_r [in]
- *      value to insert; this will not get its ref count incremented
- *  @param loc_p [in]
- *      location from a previous kvbag_search() that returned O71_MISSING
+ *  Compares two strings as ordered in the intern bag.
  */
-static o71_status_t kvbag_insert
+static o71_status_t str_intern_cmp
 (
     o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_ref_t key_r,
-    o71_ref_t value_r,
-    o71_kvbag_loc_t * loc_p
+    o71_ref_t a_r,
+    o71_ref_t b_r,
+    void * ctx
 );
 
-/* kvbag_delete */
+/*  str_finish  */
 /**
- *  Deletes the item located.
- *  Ref counts are not affected - this just deletes the item from the bag.
- *  @retval O71_OK
- *  @returns error only in checked builds when discovering a bug
+ *  Uninitializer for strings.
  */
-static o71_status_t kvbag_delete
+static o71_status_t str_finish
 (
     o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_kvbag_loc_t * loc_p
+    o71_ref_t obj_r
 );
 
-/*  kvbag_get_loc_value  */
+/*  str_visit_refs  */
 /**
- *
+ *  visit_refs() for strings; only slices own a reference (to their parent).
  */
-static o71_ref_t kvbag_get_loc_value
+static o71_status_t str_visit_refs
 (
     o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_kvbag_loc_t * loc_p
+    o71_ref_t obj_r,
+    o71_ref_visit_f visit,
+    void * ctx
 );
 
-/*  kvbag_set_loc_value  */
+/*  str_unslice  */
 /**
- *
+ *  Copies the content of a slice in a buffer of its own and releases the
+ *  parent string.
  */
-static void kvbag_set_loc_value
+static o71_status_t str_unslice
 (
     o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_kvbag_loc_t * loc_p,
-    o71_ref_t value_r
+    o71_string_t * str_p
 );
 
-/* kvbag_put */
+/*  sfunc_finish  */
 /**
- *  Adds/replaces a value in the bag for the given key.
- *  @param key_r [in]
- *      key for which to associate @a value_r;
- *      the key gets its ref count incremented only if the bag did not contain
- *      the key
- *  @param value_r [in]
- *      value to associate with @a key_r;
- *      the reference is borrowed (value's ref count is not incremented)
- *  @retval O71_OK
- *  @retval O71_NO_MEM
- *  @retval O71_MEM_LIMIT
- *  @retval O71_ARRAY_LIMIT
- *  @retval O71_MEM_CORRUPTED
- *  @retval O71_BUG
- *  @retval O71_TODO
+ *  Uninitializer for script functions.
  */
-static o71_status_t kvbag_put
+static o71_status_t sfunc_finish
 (
     o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_ref_t key_r,
-    o71_ref_t value_r,
-    o71_cmp_f cmp,
-    void * ctx
+    o71_ref_t obj_r
 );
 
-static o71_status_t kv_nop_free (o71_world_t * world_p, o71_kv_t * kv_p);
-static o71_status_t kv_free_key_deref (o71_world_t * world_p, o71_kv_t * kv_p);
-static o71_status_t deref_key_and_value (o71_world_t * world_p, o71_kv_t * kv_p);
-
-/*  merge_sorted_refs  */
+/*  sfunc_visit_refs  */
 /**
- *  Reallocates the destination array of sorted refs and inserts source
- *  elements keeping the sort order.
- *  @note dest and src must be sorted
- *  @note this will keep duplicates
+ *  visit_refs() for script functions; visits the constants.
  */
-static o71_status_t merge_sorted_refs
+static o71_status_t sfunc_visit_refs
 (
     o71_world_t * world_p,
-    o71_ref_t * * dest_rap,
-    size_t * dest_rnp,
-    o71_ref_t * src_ra,
-    size_t src_n
+    o71_ref_t obj_r,
+    o71_ref_visit_f visit,
+    void * ctx
 );
 
-/*  ref_qsort  */
+/*  sfunc_call  */
 /**
- *  Sorts an array of references.
+ *  Handler for calls to scripted functions.
  */
-static void ref_qsort
+static o71_status_t sfunc_call
 (
-    o71_ref_t * ref_a,
-    size_t ref_n
+    o71_flow_t * flow_p,
+    o71_ref_t func_r,
+    o71_ref_t * arg_ra,
+    size_t arg_n
 );
 
-/*  refkv_qsort  */
+/*  sfunc_run  */
 /**
- *  Sorts an array of kv pairs by comparing the key reference.
+ *  Handler for the run stage of a scripted function.
  */
-static void refkv_qsort
+static o71_status_t sfunc_run
 (
-    o71_kv_t * kv_a,
-    size_t n
+    o71_flow_t * flow_p
 );
 
-/*  ref_search  */
+/*  sfunc_alloc_code  */
 /**
- *  Binary search for refs
+ *  Allocates code structures.
  */
-static ptrdiff_t ref_search
+static o71_status_t sfunc_alloc_code
 (
-    o71_ref_t * ra,
-    size_t rn,
-    o71_ref_t kr
+    o71_world_t * world_p,
+    o71_script_function_t * sfunc_p,
+    o71_insn_t * * insn_ap,
+    uint32_t * * opnd_ap,
+    size_t insn_n,
+    size_t opnd_n
 );
 
-/*  class_super_extend  */
+/*  sfunc_add_const  */
 /**
- *  Extends the array of superclasses.
- *  @param world_p [in]
- *  @param class_p [in, out]
- *  @param super_ra [in, out]
- *      has the list of classes to add (references are borrowed);
- *      clobbered on exit
- *  @param super_n
+ *  Adds a constant to the function.
  */
-static o71_status_t class_super_extend
+static o71_status_t sfunc_add_const
 (
     o71_world_t * world_p,
-    o71_class_t * class_p,
-    o71_ref_t * super_ra,
-    size_t super_n
+    o71_script_function_t * sfunc_p,
+    uint32_t * const_xp,
+    o71_ref_t obj_r
 );
 
-/*  set_var  */
+/*  sfunc_optimize  */
 /**
- *  Dereferences old value stored in destination and references the source
- *  value and stores it in destination.
- *  @retval O71_OK only value for release builds
- *  @retval O71_REF_COUNT_OVERFLOW
- *      adding a reference causes int overflow;
- *      this should only happen due to a bug from some component;
- *      this code can be returned only in checked or debug builds
- *  @retval O71_OBJ_DESTRUCTING
- *      attempt to increase the ref count of an object from the destroy chain;
- *      this code can be returned only in checked or debug builds
- *  @retval O71_UNUSED_MEM_OBJ_SLOT
- *      bad reference to unused memory object slot;
- *      this code can be returned only in checked or debug builds
-  * @retval O71_MEM_CORRUPTED
-  *     allocator detects some corruption while freeing memory for destroyed
-  *     objects
-  * @retval O71_BUG
-  *     some assertion failed
-  *     this code can be returned only in checked or debug builds
- *
+ *  Liveness pass run on validated code: marks call arguments used for the
+ *  last time to be moved into the callee (O71O_CALL_MOVE) and inits into
+ *  vars known to be null (O71O_INIT_NULL).
+ *  @retval O71_OK code rewritten
+ *  @retval O71_NO_MEM not enough memory for the var sets; the code is left
+ *      with plain CALL/INIT instructions
  */
-O71_INLINE o71_status_t set_var
+static o71_status_t sfunc_optimize
 (
     o71_world_t * world_p,
-    o71_ref_t * dest_rp,
-    o71_ref_t src_r
+    o71_script_function_t * sfunc_p
 );
 
-/*  free_token  */
+/* sfunc_append_opc_val_obj_name */
 /**
- *  Frees one token
+ *  @retval O71_OK alles gut
  */
-static o71_status_t free_token
+static o71_status_t sfunc_append_opc_val_obj_name
 (
-    o71_code_t * code_p,
-    o71_token_t * token_p,
-    unsigned int min_tt
+    o71_world_t * world_p,
+    o71_script_function_t * sfunc_p,
+    uint8_t opcode,
+    uint32_t value_vx,
+    uint32_t obj_vx,
+    uint32_t name_istr_vx
 );
 
-/*  tokenize_source  */
+/*  ref_cmp  */
 /**
- *  Tokenizes source.
+ *  Compares 2 references by their value as integers not by the content
+ *  referenced.
  */
-static o71_status_t tokenize_source
+static o71_status_t ref_cmp
 (
-    o71_code_t * code_p
+    o71_world_t * world_p,
+    o71_ref_t a_r,
+    o71_ref_t b_r,
+    void * ctx
 );
 
-/*  init_empty_block_stmt  */
+/*  kvbag_init  */
 /**
- *  Initializes an empty block statement.
+ *  Inits a key value bag.
+ *  @param array_limit [in]
+ *      number of items kept in a sorted array before switching to
+ *      @a large_mode
+ *  @param large_mode [in]
+ *      O71_BAG_LARGE_MODE for bags that need key order, or O71_BAG_HASH for
+ *      bags keyed by ref identity (searched only with ref_cmp)
  */
-static void init_empty_block_stmt
+static void kvbag_init
 (
-    o71_block_stmt_token_t * block_stmt_p,
-    o71_block_stmt_token_t * parent_block_stmt_p
+    o71_kvbag_t * kvbag_p,
+    uint8_t array_limit,
+    uint8_t large_mode
 );
 
-/*  match_stmt_seq  */
+/*  kvbag_free  */
 /**
- *  @param code_p [in]
- *  @param block_stmt_p [in, out]
- *      initialized block statement whose stmt list is extended with parsed
- *      statements
- *  @param src_p [in]
- *      source token where to start matching
- *  @param src_pp [out]
- *      source token when matching stopped; for syntactically valid code this
- *      should point on return to EOF or '}'
+ *  Frees kvbag.
  */
-static o71_status_t match_stmt_seq
+static o71_status_t kvbag_free
 (
-    o71_code_t * code_p,
-    o71_block_stmt_token_t * block_stmt_p,
-    o71_token_t * src_p,
-    o71_token_t * * src_pp,
-    o71_token_type_t end_type
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kv_free_f kv_free
 );
 
-#if O71_DEBUG
-/*  obj_dump  */
+/*  kvbag_visit_values  */
 /**
- *
+ *  Calls @a visit for the value of each item in the bag.
  */
-static void obj_dump
+static o71_status_t kvbag_visit_values
 (
     o71_world_t * world_p,
-    o71_ref_t obj_r
+    o71_kvbag_t * kvbag_p,
+    o71_ref_visit_f visit,
+    void * ctx
 );
 
-/*  kvbag_dump  */
+/*  kvbag_rbtree_visit_values  */
 /**
- *
+ *  Calls @a visit for the value of each node in the tree.
  */
-static void kvbag_dump
+static o71_status_t kvbag_rbtree_visit_values
 (
     o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p
+    o71_kvnode_t * kvnode_p,
+    o71_ref_visit_f visit,
+    void * ctx
 );
 
-/*  kvbag_array_dump  */
+/*  kvbag_array_search  */
 /**
  *
  */
-static void kvbag_array_dump
+static o71_status_t kvbag_array_search
 (
     o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p
+    o71_kvbag_t * kvbag_p,
+    o71_ref_t key_r,
+    o71_cmp_f cmp,
+    void * ctx,
+    o71_kvbag_loc_t * loc_p
 );
 
-/*  kvbag_rbtree_dump  */
+/*  kvbag_array_delete  */
 /**
- *  Dumps to stdout the tree
+ *  Deletes a single item
  */
-static void kvbag_rbtree_dump
+static o71_status_t kvbag_array_delete
 (
     o71_world_t * world_p,
-    o71_kvnode_t * kvnode_p,
-    unsigned int depth
+    o71_kvbag_t * kvbag_p,
+    o71_kvbag_loc_t * loc_p
 );
 
-/*  dump_token_list  */
+/*  kvbag_array_free  */
 /**
- *  Prints a list token types
+ *  Finishes kvbag array.
  */
-static void dump_token_list
+static o71_status_t kvbag_array_free
 (
-    o71_token_t * token_p,
-    size_t n
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kv_free_f kv_free
 );
 
-#else
-#define kvbag_dump(_w, _k) ((void) 0)
-#define dump_token_list(_tp, _n) ((void) 0)
-#endif
-
-static o71_status_t rule_nop (o71_code_t * code_p);
-
-static uint32_t init_exc_chain_start_xa[2] = { 0, 0 };
+/*  kvbag_rbtree_search  */
+/**
+ *
+ */
+static o71_status_t kvbag_rbtree_search
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_ref_t key_r,
+    o71_cmp_f cmp,
+    void * ctx,
+    o71_kvbag_loc_t * loc_p
+);
 
+/*  kvbag_rbtree_build  */
+/**
+ *  Builds a balanced red/black tree from sorted items in linear time.
+ *  The middle item goes to the root and the halves to the subtrees; nodes
+ *  on the last, incomplete level are red.
+ *  Ref counts are not affected.
+ *  @param red_depth [in]
+ *      depth of the red level relative to the subtree root;
+ *      floor(log2(kv_n + 1)) for the whole tree
+ *  @param node_pp [out]
+ *      receives the subtree root; NULL when kv_n is 0
+ */
+static o71_status_t kvbag_rbtree_build
+(
+    o71_world_t * world_p,
+    o71_kv_t const * kv_a,
+    size_t kv_n,
+    unsigned int red_depth,
+    o71_kvnode_t * * node_pp
+);
 
-/* grammar ******************************************************************/
-#if _DEBUG
-#define R(_h, _t, ...) { _h, (_t), { __VA_ARGS__ }, #_h ": " #_t " := " #__VA_ARGS__ }
-#else
-#define R(_h, _t, ...) { _h, (_t), { __VA_ARGS__ } }
-#endif
+/* kvbag_rbtree_free */
+/**
+ * Deletes all nodes in the tree.
+ */
+static o71_status_t kvbag_rbtree_free
+(
+    o71_world_t * world_p,
+    o71_kvnode_t * kvnode_p,
+    o71_kv_free_f kv_free
+);
 
-static char const * ttname_a[O71_TT__COUNT] =
-{
-    "<rule_end>",
-    "END",
-    "'~'",
-    "'!'",
-    "'?'",
-    "'%'",
-    "'^'",
-    "'&'",
-    "'|'",
-    "'*'",
-    "'/'",
-    "'('",
-    "')'",
-    "'['",
-    "']'",
-    "'{'",
-    "'}'",
-    "'='",
-    "'+'",
-    "'-'",
-    "'<'",
-    "'>'",
-    "'.'",
-    "','",
-    "';'",
-    "':'",
-    "'++'",
-    "'--'",
-    "'**'",
-    "'<<'",
-    "'>>'",
-    "'&&'",
-    "'^^'",
-    "'||'",
-    "'=='",
-    "'!='",
-    "'+='",
-    "'-='",
-    "'*='",
-    "'/='",
-    "'%='",
-    "'<='",
-    "'>='",
-    "'<<='",
-    "'>>='",
-    "'&='",
-    "'|='",
-    "'^='",
-    "'**='",
-    "'&&='",
-    "'^^='",
-    "'||='",
-    "'return'",
-    "'break'",
-    "'goto'",
-    "'if'",
-    "'else'",
-    "'while'",
-    "'do'",
-    "'for'",
-    "'switch'",
-    "'case'",
-    "integer",
-    "string",
-    "identifier",
-    "source",
-    "stmt_seq",
-    "stmt",
-    "expr_stmt",
-    "decl_start",
-    "block_stmt",
-    "if_stmt_start",
-    "do_stmt_start",
-    "while_cond",
-    "unary_operator",
-    "exp_operator",
-    "mul_operator",
-    "add_operator",
-    "cmp_operator",
-    "equ_operator",
-    "asg_operator",
-    "var_init",
-    "var_init_list",
-    "arg_decl",
-    "arg_decl_list",
-    "expr_list",
-    "atom_expr",
-    "postfix_expr",
-    "prefix_expr",
-    "exp_expr",
-    "and_expr",
-    "or_expr",
-    "xor_expr",
-    "mul_expr",
-    "add_expr",
-    "cmp_expr",
-    "equ_expr",
-    "logic_and_expr",
-    "logic_xor_expr",
-    "logic_or_expr",
-    "cond_expr",
-    "expr",
-};
+/*  kvbag_rbtree_node_alloc  */
+/**
+ *
+ */
+static o71_status_t kvbag_rbtree_node_alloc
+(
+    o71_world_t * world_p,
+    o71_kvnode_t * * kvnode_pp
+);
 
-/* utf8_codepoint_length ****************************************************/
-static unsigned int utf8_codepoint_length
+/*  kvbag_rbtree_node_free  */
+/**
+ *
+ */
+static o71_status_t kvbag_rbtree_node_free
 (
-    uint32_t codepoint
-)
-{
-    if (codepoint < 0x80) return 1;
-    if (codepoint < 0x800) return 2;
-    if (codepoint < 0x10000) return 3;
-    return 4;
-}
+    o71_world_t * world_p,
+    o71_kvnode_t * kvnode_p,
+    o71_kv_free_f kv_free
+);
 
-/* utf8_codepoint_encode ****************************************************/
-static unsigned int utf8_codepoint_encode
+/*  kvbag_btree_node_alloc  */
+/**
+ *  Allocates an empty B-tree node.
+ *  @param leaf [in]
+ *      non-zero to allocate a leaf; leaves are allocated without the
+ *      child pointer array
+ */
+static o71_status_t kvbag_btree_node_alloc
 (
-    uint8_t * out,
-    uint32_t codepoint
-)
-{
-    if (codepoint < 0x80)
-    {
-        out[0] = (uint8_t) codepoint;
-        return 1;
-    }
-    if (codepoint < 0x800)
-    {
-        out[0] = 0xC0 | (uint8_t) (codepoint >> 6);
-        out[1] = 0x80 | (uint8_t) (codepoint & 0x3F);
-        return 2;
-    }
-    if (codepoint < 0x10000)
-    {
-        out[0] = 0xE0 | (uint8_t) (codepoint >> 12);
-        out[1] = 0x80 | (uint8_t) ((codepoint >> 6) & 0x3F);
-        out[2] = 0x80 | (uint8_t) (codepoint & 0x3F);
-        return 3;
-    }
-    out[0] = 0xF0 | (uint8_t) (codepoint >> 16);
-    out[1] = 0x80 | (uint8_t) ((codepoint >> 12) & 0x3F);
-    out[2] = 0x80 | (uint8_t) ((codepoint >> 6) & 0x3F);
-    out[3] = 0x80 | (uint8_t) (codepoint & 0x3F);
-    return 4;
-}
+    o71_world_t * world_p,
+    unsigned int leaf,
+    o71_kvbtnode_t * * node_pp
+);
 
-/* o71_status_name **********************************************************/
-O71_API char const * o71_status_name
+/*  kvbag_btree_node_free  */
+/**
+ *  Frees a single B-tree node without touching its items.
+ */
+static o71_status_t kvbag_btree_node_free
 (
-    o71_status_t status
-)
-{
-#define X(_x) case _x: return #_x
-    switch (status)
-    {
-        X(O71_OK);
-        X(O71_PENDING);
-        X(O71_EXC);
-
-        X(O71_MISSING);
+    o71_world_t * world_p,
+    o71_kvbtnode_t * node_p
+);
 
-        X(O71_NO_MEM);
-        X(O71_MEM_LIMIT);
-        X(O71_ARRAY_LIMIT);
+/*  kvbag_btree_search  */
+/**
+ *  Searches the B-tree recording in @a loc_p the path of nodes and positions.
+ *  On O71_MISSING the last position is the insertion point in a leaf.
+ */
+static o71_status_t kvbag_btree_search
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_ref_t key_r,
+    o71_cmp_f cmp,
+    void * ctx,
+    o71_kvbag_loc_t * loc_p
+);
 
-        X(O71_NOT_MEM_OBJ_REF);
-        X(O71_UNUSED_MEM_OBJ_SLOT);
-        X(O71_MODEL_MISMATCH);
-        X(O71_OBJ_DESTRUCTING);
-        X(O71_BAD_FUNC_REF);
-        X(O71_BAD_OPCODE);
-        X(O71_BAD_OPERAND_INDEX);
-        X(O71_BAD_CONST_INDEX);
-        X(O71_BAD_VAR_INDEX);
-        X(O71_BAD_INSN_INDEX);
-        X(O71_BAD_EXC_HANDLER_INDEX);
-        X(O71_BAD_EXC_CHAIN_INDEX);
-        X(O71_BAD_ARG_COUNT);
-        X(O71_CMP_ERROR);
-        X(O71_BAD_STRING_REF);
-        X(O71_BAD_RO_STRING_REF);
-        X(O71_BAD_INTERN_STRING_REF);
-        X(O71_COMPILE_ERROR);
-        X(O71_NO_MATCH);
+/*  kvbag_btree_insert  */
+/**
+ *  Inserts key-value at the location from a failed kvbag_btree_search(),
+ *  splitting full nodes on the path.
+ *  Ref counts are not affected.
+ *  All nodes needed for splits are allocated before changing the tree so
+ *  on error the bag is left as it was.
+ */
+static o71_status_t kvbag_btree_insert
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_ref_t key_r,
+    o71_ref_t value_r,
+    o71_kvbag_loc_t * loc_p
+);
 
-        X(O71_MEM_CORRUPTED);
-        X(O71_REF_COUNT_OVERFLOW);
-        X(O71_BUG);
-        X(O71_TODO);
-    default:
-        return "O71_unknown";
-    }
-#undef X
-}
+/*  kvbag_btree_delete  */
+/**
+ *  Deletes the item located by kvbag_btree_search(), rebalancing nodes
+ *  that fall under O71_BTREE_KV_MIN items.
+ *  Ref counts are not affected.
+ */
+static o71_status_t kvbag_btree_delete
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kvbag_loc_t * loc_p
+);
 
-/* o71_allocator_init *******************************************************/
-O71_API o71_allocator_t * o71_allocator_init
+/*  kvbag_btree_build  */
+/**
+ *  Builds a B-tree from sorted items in linear time.
+ *  Ref counts are not affected.
+ *  On error nothing is left allocated.
+ */
+static o71_status_t kvbag_btree_build
 (
-    o71_allocator_t * allocator_p,
-    o71_realloc_f realloc,
-    void * context,
-    size_t mem_limit
-)
-{
-    allocator_p->realloc = realloc;
-    allocator_p->context = context;
-    allocator_p->mem_usage = 0;
-    allocator_p->mem_peak = 0;
-    allocator_p->mem_limit = mem_limit;
-#if O71_CHECKED
-    allocator_p->list.next_p = &allocator_p->list;
-    allocator_p->list.prev_p = &allocator_p->list;
-#endif
-    return allocator_p;
-}
+    o71_world_t * world_p,
+    o71_kv_t const * kv_a,
+    size_t kv_n,
+    o71_kvbtnode_t * * root_pp
+);
 
-/* o71_allocator_finish *****************************************************/
-O71_API void o71_allocator_finish
+/*  kvbag_btree_build_node  */
+/**
+ *  Builds the subtree of the given height holding the sorted items.
+ *  The items are spread evenly over the fewest children that can hold them
+ *  but at least @a child_min, which keeps every node of the subtree within
+ *  O71_BTREE_KV_MIN..O71_BTREE_KV_MAX items.
+ *  @param child_min [in]
+ *      2 for the root, O71_BTREE_KV_MIN + 1 for the other nodes
+ */
+static o71_status_t kvbag_btree_build_node
 (
-    o71_allocator_t * allocator_p
-)
-{
-#if O71_DEBUG
-    o71_alloc_header_t * ah;
-    if (!allocator_p->mem_usage) return;
-    M("leaked mem: %zu bytes", allocator_p->mem_usage);
-    for (ah = allocator_p->list.next_p;
-         ah != &allocator_p->list;
-         ah = ah->next_p)
-    {
-        P("p=%p s=0x%04zX %s():%u %02X %02X %02X %02X\n",
-          ah + 1, ah->size, ah->func, ah->line,
-          ((uint8_t *) (ah + 1))[0],
-          ((uint8_t *) (ah + 1))[1],
-          ((uint8_t *) (ah + 1))[2],
-          ((uint8_t *) (ah + 1))[3]);
-    }
+    o71_world_t * world_p,
+    o71_kv_t const * kv_a,
+    size_t kv_n,
+    unsigned int height,
+    size_t child_min,
+    o71_kvbtnode_t * * node_pp
+);
 
-#endif
-}
+/*  kvbag_btree_free  */
+/**
+ *  Frees the subtree calling @a kv_free for each item.
+ */
+static o71_status_t kvbag_btree_free
+(
+    o71_world_t * world_p,
+    o71_kvbtnode_t * node_p,
+    o71_kv_free_f kv_free
+);
 
-/* o71_world_init ***********************************************************/
-O71_API o71_status_t o71_world_init
+/*  kvbag_btree_visit_values  */
+/**
+ *  Calls @a visit for the value of each item in the subtree.
+ */
+static o71_status_t kvbag_btree_visit_values
 (
     o71_world_t * world_p,
-    o71_allocator_t * allocator_p
-)
-{
-    o71_status_t os;
+    o71_kvbtnode_t * node_p,
+    o71_ref_visit_f visit,
+    void * ctx
+);
 
-    world_p->allocator_p = allocator_p;
-    world_p->flow_id_seed = 0;
-    world_p->cleaning = 0;
-    world_p->free_list_head_ex = ~0;
-    world_p->free_list_tail_xp = &world_p->free_list_head_ex;
-    world_p->destroy_list_head_x = 0;
-    world_p->obj_pa = NULL;
-    world_p->obj_n = 0;
+/*  kvbag_hash_alloc  */
+/**
+ *  Allocates a hash bag table with all slots free.
+ *  @param slot_n [in]
+ *      number of slots; must be a power of two
+ */
+static o71_status_t kvbag_hash_alloc
+(
+    o71_world_t * world_p,
+    size_t slot_n,
+    o71_kvhash_t * * hash_pp
+);
 
-    os = extend_object_table(world_p);
-    if (os) return os;
+/*  kvbag_hash_table_free  */
+/**
+ *  Frees a hash bag table without touching its items.
+ */
+static o71_status_t kvbag_hash_table_free
+(
+    o71_world_t * world_p,
+    o71_kvhash_t * hash_p
+);
 
-    kvbag_init(&world_p->istr_bag, 0x10);
+/*  kvbag_hash_probe  */
+/**
+ *  Looks for a key in the table.
+ *  @param index_p [out]
+ *      slot holding the key, or slot where the key should be inserted
+ *  @retval O71_OK
+ *  @retval O71_MISSING
+ */
+static o71_status_t kvbag_hash_probe
+(
+    o71_kvhash_t * hash_p,
+    o71_ref_t key_r,
+    size_t * index_p
+);
 
-    world_p->obj_pa[O71X_NULL] = &world_p->null_object;
-    world_p->obj_pa[O71X_OBJECT_CLASS] = &world_p->object_class;
-    world_p->obj_pa[O71X_NULL_CLASS] = &world_p->null_class;
-    world_p->obj_pa[O71X_CLASS_CLASS] = &world_p->class_class;
-    world_p->obj_pa[O71X_STRING_CLASS] = &world_p->string_class;
-    world_p->obj_pa[O71X_SMALL_INT_CLASS] = &world_p->small_int_class;
-    world_p->obj_pa[O71X_REG_OBJ_CLASS] = &world_p->reg_obj_class;
-    world_p->obj_pa[O71X_FUNCTION_CLASS] =
-        &world_p->function_class;
-    world_p->obj_pa[O71X_SCRIPT_FUNCTION_CLASS] =
-        &world_p->script_function_class;
-    world_p->obj_pa[O71X_EXCEPTION_CLASS] = &world_p->exception_class;
-    world_p->obj_pa[O71X_TYPE_EXC_CLASS] = &world_p->type_exc_class;
-    world_p->obj_pa[O71X_ARITY_EXC_CLASS] = &world_p->arity_exc_class;
-    world_p->obj_pa[O71X_INT_ADD_FUNC] = &world_p->int_add_func;
+/*  kvbag_hash_place  */
+/**
+ *  Stores key-value at the given slot shifting the rest of the run one slot
+ *  forward. The table must have a free slot.
+ */
+static void kvbag_hash_place
+(
+    o71_kvhash_t * hash_p,
+    size_t index,
+    o71_ref_t key_r,
+    o71_ref_t value_r
+);
 
-    world_p->null_object.class_r = O71R_NULL_CLASS;
-    world_p->null_object.ref_n = 1; // permanent object
+/*  kvbag_hash_build  */
+/**
+ *  Allocates a table with @a slot_n slots holding the given items.
+ *  Ref counts are not affected.
+ */
+static o71_status_t kvbag_hash_build
+(
+    o71_world_t * world_p,
+    o71_kv_t const * kv_a,
+    size_t kv_n,
+    size_t slot_n,
+    o71_kvhash_t * * hash_pp
+);
 
-    world_p->object_class.hdr.class_r = O71R_CLASS_CLASS;
-    world_p->object_class.hdr.ref_n = 1;
-    world_p->object_class.finish = noop_object_finish;
-    world_p->object_class.get_field = get_missing_field;
-    world_p->object_class.set_field = set_missing_field;
-    world_p->object_class.object_size = sizeof(o71_mem_obj_t);
-    world_p->object_class.model = O71MI_MEM_OBJ;
-    world_p->object_class.rank = 1;
-    world_p->object_class.super_ra = NULL;
-    world_p->object_class.super_n = 0;
-    world_p->object_class.dyn_field_ofs = 0;
-    world_p->object_class.fix_field_n = 0;
-    kvbag_init(&world_p->object_class.method_bag, O71_METHOD_ARRAY_LIMIT);
+/*  kvbag_hash_insert  */
+/**
+ *  Inserts key-value at the location from a failed kvbag_search(),
+ *  doubling the table when it would get more than 3/4 full.
+ *  Ref counts are not affected.
+ */
+static o71_status_t kvbag_hash_insert
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_ref_t key_r,
+    o71_ref_t value_r,
+    o71_kvbag_loc_t * loc_p
+);
 
-    world_p->null_class.hdr.class_r = O71R_CLASS_CLASS;
-    world_p->null_class.hdr.ref_n = 1;
-    world_p->null_class.finish = noop_object_finish;
-    world_p->null_class.get_field = get_missing_field;
-    world_p->null_class.set_field = set_missing_field;
-    world_p->null_class.object_size = sizeof(o71_mem_obj_t);
-    world_p->null_class.model = O71MI_MEM_OBJ;
-    world_p->null_class.rank = 1;
-    world_p->null_class.super_ra = NULL;
-    world_p->null_class.super_n = 0;
-    world_p->null_class.dyn_field_ofs = 0;
-    world_p->null_class.fix_field_n = 0;
-    kvbag_init(&world_p->null_class.method_bag, O71_METHOD_ARRAY_LIMIT);
+/*  kvbag_hash_delete  */
+/**
+ *  Deletes the item located, shifting back the rest of its run.
+ *  Ref counts are not affected.
+ */
+static o71_status_t kvbag_hash_delete
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kvbag_loc_t * loc_p
+);
 
-    world_p->class_class.hdr.class_r = O71R_CLASS_CLASS;
-    world_p->class_class.hdr.ref_n = 1;
-    world_p->class_class.finish = class_finish;
-    world_p->class_class.get_field = get_missing_field;
-    world_p->class_class.set_field = set_missing_field;
-    world_p->class_class.object_size = sizeof(o71_class_t);
-    world_p->class_class.model = O71MI_CLASS;
-    world_p->class_class.rank = 0;
-    world_p->class_class.super_ra = NULL;
-    world_p->class_class.super_n = 0;
-    world_p->class_class.dyn_field_ofs = 0;
-    world_p->class_class.fix_field_n = 0;
-    kvbag_init(&world_p->class_class.method_bag, O71_METHOD_ARRAY_LIMIT);
+/*  kvbag_hash_free  */
+/**
+ *  Frees the table calling @a kv_free for each item.
+ */
+static o71_status_t kvbag_hash_free
+(
+    o71_world_t * world_p,
+    o71_kvhash_t * hash_p,
+    o71_kv_free_f kv_free
+);
 
-    world_p->string_class.hdr.class_r = O71R_CLASS_CLASS;
-    world_p->string_class.hdr.ref_n = 1;
-    world_p->string_class.finish = str_finish;
-    world_p->string_class.get_field = get_missing_field;
-    world_p->string_class.set_field = set_missing_field;
-    world_p->string_class.object_size = sizeof(o71_string_t);
-    world_p->string_class.model = O71MI_STRING;
-    world_p->string_class.rank = 1;
-    world_p->string_class.super_ra = NULL;
-    world_p->string_class.super_n = 0;
-    world_p->string_class.dyn_field_ofs = 0;
-    world_p->string_class.fix_field_n = 0;
-    kvbag_init(&world_p->string_class.method_bag, O71_METHOD_ARRAY_LIMIT);
+/*  kvbag_search  */
+/**
+ *  Searches the bag for the given key.
+ *  Bags searched with ref_cmp go to the search functions specialized for
+ *  that comparator.
+ */
+static o71_status_t kvbag_search
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_ref_t key_r,
+    o71_cmp_f cmp,
+    void * ctx,
+    o71_kvbag_loc_t * loc_p
+);
 
-    world_p->small_int_class.hdr.class_r = O71R_CLASS_CLASS;
-    world_p->small_int_class.hdr.ref_n = 1;
-    world_p->small_int_class.finish = noop_object_finish;
-    world_p->small_int_class.get_field = get_missing_field;
-    world_p->small_int_class.set_field = set_missing_field;
-    world_p->small_int_class.object_size = 0; // not a memory object
-    world_p->small_int_class.model = O71MI_SMALL_INT;
-    world_p->small_int_class.rank = 1;
-    world_p->small_int_class.super_ra = NULL;
-    world_p->small_int_class.super_n = 0;
-    world_p->small_int_class.dyn_field_ofs = 0;
-    world_p->small_int_class.fix_field_n = 0;
-    kvbag_init(&world_p->small_int_class.method_bag, O71_METHOD_ARRAY_LIMIT);
-
-    world_p->reg_obj_class.hdr.class_r = O71R_CLASS_CLASS;
-    world_p->reg_obj_class.hdr.ref_n = 1;
-    world_p->reg_obj_class.finish = noop_object_finish;
-    world_p->reg_obj_class.get_field = get_reg_obj_field;
-    world_p->reg_obj_class.set_field = set_reg_obj_field;
-    world_p->reg_obj_class.object_size = sizeof(o71_reg_obj_t);
-    world_p->reg_obj_class.model = O71MI_MEM_OBJ;
-    world_p->reg_obj_class.rank = 1;
-    world_p->reg_obj_class.super_ra = NULL;
-    world_p->reg_obj_class.super_n = 0;
-    world_p->reg_obj_class.dyn_field_ofs =
-        FIELD_OFS(o71_reg_obj_t, dyn_field_bag);
-    world_p->reg_obj_class.fix_field_n = 0;
-    kvbag_init(&world_p->reg_obj_class.method_bag, O71_METHOD_ARRAY_LIMIT);
-
-    world_p->function_class.hdr.class_r = O71R_CLASS_CLASS;
-    world_p->function_class.hdr.ref_n = 1;
-    world_p->function_class.finish = noop_object_finish;
-    world_p->function_class.get_field = get_missing_field;
-    world_p->function_class.set_field = set_missing_field;
-    world_p->function_class.object_size = sizeof(o71_function_t);
-    world_p->function_class.model = O71MI_FUNCTION;
-    world_p->function_class.rank = 1;
-    world_p->function_class.super_ra = NULL;
-    world_p->function_class.super_n = 0;
-    world_p->function_class.dyn_field_ofs = 0;
-    world_p->function_class.fix_field_n = 0;
-    kvbag_init(&world_p->function_class.method_bag, O71_METHOD_ARRAY_LIMIT);
-
-    world_p->script_function_class.hdr.class_r = O71R_CLASS_CLASS;
-    world_p->script_function_class.hdr.ref_n = 1;
-    world_p->script_function_class.finish = noop_object_finish;
-    world_p->script_function_class.get_field = get_missing_field;
-    world_p->script_function_class.set_field = set_missing_field;
-    world_p->script_function_class.object_size = sizeof(o71_script_function_t);
-    world_p->script_function_class.model = O71MI_SCRIPT_FUNCTION;
-    world_p->script_function_class.rank = 1;
-    world_p->script_function_class.super_ra = NULL;
-    world_p->script_function_class.super_n = 0;
-    world_p->script_function_class.dyn_field_ofs = 0;
-    world_p->script_function_class.fix_field_n = 0;
-    kvbag_init(&world_p->script_function_class.method_bag,
-               O71_METHOD_ARRAY_LIMIT);
+/*  kvbag_get  */
+/**
+ *  Looks up the value for a key without recording the path like
+ *  kvbag_search() does; use this for reads that don't need a location for
+ *  kvbag_insert() or kvbag_delete().
+ *  @param value_rp [out]
+ *      value for the key; the reference is borrowed
+ *  @retval O71_OK
+ *  @retval O71_MISSING
+ *  @returns the error status from @a cmp
+ */
+static o71_status_t kvbag_get
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_ref_t key_r,
+    o71_cmp_f cmp,
+    void * ctx,
+    o71_ref_t * value_rp
+);
 
-    world_p->exception_class.hdr.class_r = O71R_CLASS_CLASS;
-    world_p->exception_class.hdr.ref_n = 1;
-    world_p->exception_class.finish = noop_object_finish;
-    world_p->exception_class.get_field = get_reg_obj_field;
-    world_p->exception_class.set_field = set_reg_obj_field;
-    world_p->exception_class.object_size = sizeof(o71_exception_t);
-    world_p->exception_class.model = O71MI_EXCEPTION;
-    world_p->exception_class.rank = 1;
-    world_p->exception_class.super_ra = NULL;
-    world_p->exception_class.super_n = 0;
-    world_p->exception_class.dyn_field_ofs =
-        FIELD_OFS(o71_reg_obj_t, dyn_field_bag);
-    world_p->exception_class.fix_field_n = 0;
-    kvbag_init(&world_p->exception_class.method_bag,
-               O71_METHOD_ARRAY_LIMIT);
+/*  kvbag_lookup  */
+/**
+ *  kvbag_get() for non-hash bags; the _ref variant is specialized for
+ *  ref_cmp.
+ */
+static o71_status_t kvbag_lookup
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_ref_t key_r,
+    o71_cmp_f cmp,
+    void * ctx,
+    o71_ref_t * value_rp
+);
 
-    world_p->type_exc_class.hdr.class_r = O71R_CLASS_CLASS;
-    world_p->type_exc_class.hdr.ref_n = 1;
-    world_p->type_exc_class.finish = noop_object_finish;
-    world_p->type_exc_class.get_field = get_missing_field;
-    world_p->type_exc_class.set_field = set_missing_field;
-    world_p->type_exc_class.object_size = sizeof(o71_exception_t);
-    world_p->type_exc_class.model = O71MI_EXCEPTION;
-    world_p->type_exc_class.rank = 1;
-    world_p->type_exc_class.super_ra = NULL;
-    world_p->type_exc_class.super_n = 0;
-    world_p->type_exc_class.dyn_field_ofs = 0;
-    world_p->type_exc_class.fix_field_n = 0;
-    kvbag_init(&world_p->type_exc_class.method_bag, O71_METHOD_ARRAY_LIMIT);
+static o71_status_t kvbag_lookup_ref
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_ref_t key_r,
+    o71_cmp_f cmp,
+    void * ctx,
+    o71_ref_t * value_rp
+);
 
-    world_p->arity_exc_class.hdr.class_r = O71R_CLASS_CLASS;
-    world_p->arity_exc_class.hdr.ref_n = 1;
-    world_p->arity_exc_class.finish = noop_object_finish;
-    world_p->arity_exc_class.get_field = get_missing_field;
-    world_p->arity_exc_class.set_field = set_missing_field;
-    world_p->arity_exc_class.object_size = sizeof(o71_exception_t);
-    world_p->arity_exc_class.model = O71MI_EXCEPTION;
-    world_p->arity_exc_class.rank = 1;
-    world_p->arity_exc_class.super_ra = NULL;
-    world_p->arity_exc_class.super_n = 0;
-    world_p->arity_exc_class.dyn_field_ofs = 0;
-    world_p->arity_exc_class.fix_field_n = 0;
-    kvbag_init(&world_p->arity_exc_class.method_bag, O71_METHOD_ARRAY_LIMIT);
+/*  kvbag_xxx_search_ref  */
+/**
+ *  Searches specialized for ref_cmp.
+ */
+static o71_status_t kvbag_array_search_ref
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_ref_t key_r,
+    o71_cmp_f cmp,
+    void * ctx,
+    o71_kvbag_loc_t * loc_p
+);
 
-    world_p->int_add_func.cls.hdr.class_r = O71R_FUNCTION_CLASS;
-    world_p->int_add_func.cls.hdr.ref_n = 1;
-    world_p->int_add_func.cls.finish = noop_object_finish;
-    world_p->int_add_func.cls.get_field = get_missing_field;
-    world_p->int_add_func.cls.set_field = set_missing_field;
-    world_p->int_add_func.cls.object_size = 0; // instances are not created
-    world_p->int_add_func.cls.model = O71MI_FUNCTION;
-    world_p->int_add_func.cls.rank = 1;
-    world_p->int_add_func.cls.super_ra = NULL;
-    world_p->int_add_func.cls.super_n = 0;
-    kvbag_init(&world_p->int_add_func.cls.method_bag, O71_METHOD_ARRAY_LIMIT);
-    world_p->int_add_func.call = int_add_call;
-    world_p->int_add_func.run = null_func_run;
+static o71_status_t kvbag_rbtree_search_ref
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_ref_t key_r,
+    o71_cmp_f cmp,
+    void * ctx,
+    o71_kvbag_loc_t * loc_p
+);
 
-    flow_init(world_p, &world_p->root_flow);
+static o71_status_t kvbag_btree_search_ref
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_ref_t key_r,
+    o71_cmp_f cmp,
+    void * ctx,
+    o71_kvbag_loc_t * loc_p
+);
 
-    do
-    {
-        o71_ref_t int_add_str_r;
-        o71_ref_t exe_ctx_isr;
+/*  kvbag_rbtree_insert  */
+/**
+ *
+ */
+static o71_status_t kvbag_rbtree_insert
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_ref_t key_r,
+    o71_ref_t value_r,
+    o71_kvbag_loc_t * loc_p
+);
 
-        o71_ref_t super_ra[3];
-        os = o71_ics(world_p, &int_add_str_r, "add");
-        if (os) { M("fail: %s", N(os)); break; }
-        A(o71_obj_ptr(world_p, int_add_str_r));
+/*  kvbag_rbtree_delete  */
+/**
+ *
+ */
+static o71_status_t kvbag_rbtree_delete
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kvbag_loc_t * loc_p
+);
 
-        os = kvbag_put(world_p, &world_p->small_int_class.method_bag,
-                       int_add_str_r, O71R_INT_ADD_FUNC, ref_cmp, NULL);
-        if (os) { M("fail: %s", N(os)); break; }
-        os = o71_deref(world_p, int_add_str_r);
-        AOS(os);
-        A(((o71_mem_obj_t *) o71_obj_ptr(world_p, int_add_str_r))->ref_n == 1);
+/*  kvbag_rbtree_np  */
+/**
+ *
+ */
+static o71_kvnode_t * kvbag_rbtree_np
+(
+    o71_kvbag_loc_t * loc_p,
+    unsigned int side
+);
 
-        super_ra[0] = O71R_OBJECT_CLASS;
-        os = class_super_extend(world_p, &world_p->null_class, super_ra, 1);
-        if (os) { M("fail: %s", N(os)); break; }
+static o71_status_t kvbag_rbtree_finish
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kv_free_f kv_free
+);
 
-        super_ra[0] = O71R_OBJECT_CLASS;
-        os = class_super_extend(world_p, &world_p->class_class, super_ra, 1);
-        if (os) { M("fail: %s", N(os)); break; }
+/* kvbag_insert */
+/**
+ *  Inserts a new key-value at the given location.
+ *  @param key_r [in]
+ *      key to insert; this will get its ref count incremented
+ *  @oaram value_r [in]
+ *      value to insert; this will not get its ref count incremented
+ *  @param cmp [in]
+ *      comparator used by the bag; needed when the bag changes its
+ *      representation
+ *  @param loc_p [in]
+ *      location from a previous kvbag_search() that returned O71_MISSING
+ */
+static o71_status_t kvbag_insert
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_ref_t key_r,
+    o71_ref_t value_r,
+    o71_cmp_f cmp,
+    void * ctx,
+    o71_kvbag_loc_t * loc_p
+);
 
-        super_ra[0] = O71R_OBJECT_CLASS;
-        os = class_super_extend(world_p, &world_p->string_class, super_ra, 1);
-        if (os) { M("fail: %s", N(os)); break; }
+/* kvbag_delete */
+/**
+ *  Deletes the item located.
+ *  Ref counts are not affected - this just deletes the item from the bag.
+ *  @retval O71_OK
+ *  @returns error only in checked builds when discovering a bug
+ */
+static o71_status_t kvbag_delete
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kvbag_loc_t * loc_p
+);
 
-        super_ra[0] = O71R_OBJECT_CLASS;
-        os = class_super_extend(world_p, &world_p->small_int_class,
-                                super_ra, 1);
-        if (os) { M("fail: %s", N(os)); break; }
+/*  kvbag_get_loc_value  */
+/**
+ *
+ */
+static o71_ref_t kvbag_get_loc_value
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kvbag_loc_t * loc_p
+);
 
-        super_ra[0] = O71R_OBJECT_CLASS;
-        os = class_super_extend(world_p, &world_p->reg_obj_class, super_ra, 1);
-        if (os) { M("fail: %s", N(os)); break; }
+/*  kvbag_set_loc_value  */
+/**
+ *
+ */
+static void kvbag_set_loc_value
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kvbag_loc_t * loc_p,
+    o71_ref_t value_r
+);
 
-        super_ra[0] = O71R_OBJECT_CLASS;
-        super_ra[1] = O71R_CLASS_CLASS;
-        os = class_super_extend(world_p, &world_p->function_class, super_ra, 2);
-        if (os) { M("fail: %s", N(os)); break; }
-
-        /* add function class as superclass of script_function class */
-        super_ra[0] = O71R_OBJECT_CLASS;
-        super_ra[1] = O71R_CLASS_CLASS;
-        super_ra[2] = O71R_FUNCTION_CLASS;
-        os = class_super_extend(world_p, &world_p->script_function_class,
-                                super_ra, 3);
-        if (os) { M("fail: %s", N(os)); break; }
-
-        super_ra[0] = O71R_OBJECT_CLASS;
-        super_ra[1] = O71R_REG_OBJ_CLASS;
-        os = class_super_extend(world_p, &world_p->exception_class,
-                                super_ra, 2);
-        if (os) { M("fail: %s", N(os)); break; }
-
-        os = o71_ics(world_p, &exe_ctx_isr, "exe_ctx");
-        if (os) { M("fail: %s", N(os)); break; }
-        os = redim(world_p->allocator_p,
-                   (void * *) &world_p->exception_class.fix_field_ofs_a,
-                   &world_p->exception_class.fix_field_n,
-                   1, sizeof(o71_kv_t));
-        if (os) { M("fail: %s", N(os)); break; }
-        world_p->exception_class.fix_field_ofs_a[0].key_r = exe_ctx_isr;
-        world_p->exception_class.fix_field_ofs_a[0].value_r =
-            FIELD_OFS(o71_exception_t, exe_ctx_r);
-
-        super_ra[0] = O71R_OBJECT_CLASS;
-        super_ra[1] = O71R_EXCEPTION_CLASS;
-        os = class_super_extend(world_p, &world_p->type_exc_class, super_ra, 2);
-        if (os) { M("fail: %s", N(os)); break; }
-
-        os = O71_OK;
-        M("hello world %p!", world_p);
-    }
-    while (0);
-
-    if (os)
-    {
-        o71_status_t osf = o71_world_finish(world_p);
-    }
-
-    return os;
-}
-
-/* o71_world_finish *********************************************************/
-O71_API o71_status_t o71_world_finish
+/* kvbag_put */
+/**
+ *  Adds/replaces a value in the bag for the given key.
+ *  @param key_r [in]
+ *      key for which to associate @a value_r;
+ *      the key gets its ref count incremented only if the bag did not contain
+ *      the key
+ *  @param value_r [in]
+ *      value to associate with @a key_r;
+ *      the reference is borrowed (value's ref count is not incremented)
+ *  @retval O71_OK
+ *  @retval O71_NO_MEM
+ *  @retval O71_MEM_LIMIT
+ *  @retval O71_ARRAY_LIMIT
+ *  @retval O71_MEM_CORRUPTED
+ *  @retval O71_BUG
+ *  @retval O71_TODO
+ */
+static o71_status_t kvbag_put
 (
-    o71_world_t * world_p
-)
-{
-    o71_status_t os;
-    o71_obj_index_t obj_x, next_obj_x;
-    unsigned int rank;
-    o71_class_t * class_p;
-    o71_obj_index_t finish_head_x, free_head_x;
-    o71_obj_index_t * finish_tail_xp;
-    o71_obj_index_t * free_tail_xp;
-
-    M("finishing world (obj_n=%lu)", world_p->obj_n);
-    finish_head_x = ~0;
-    finish_tail_xp = &finish_head_x;
-    for (obj_x = 1, rank = 0; obj_x < world_p->obj_n; ++obj_x)
-    {
-        o71_mem_obj_t * obj_p;
-        /* skip unused slots */
-        if (IS_FREE_OBJECT_SLOT(world_p->obj_pa[obj_x])) continue;
-        /* skip items already queued for destruction */
-        //if (world_p->mem_obj_pa[obj_x]->ref_n < 0) continue;
-        obj_p = world_p->mem_obj_pa[obj_x];
-        class_p = o71_obj_ptr(world_p, obj_p->class_r);
-        A(class_p);
-        if (class_p->rank > rank) rank = class_p->rank;
-        *finish_tail_xp = ~obj_x;
-        finish_tail_xp = &obj_p->destroy_next_ex;
-        M2("queueing for finish: obref_%lX", (long) O71_MOX_TO_REF(obj_x));
-    }
-    *finish_tail_xp = ~0;
-    M("max rank: %u", rank);
-    //os = o71_cleanup(world_p);
-    //AOS(os);
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_ref_t key_r,
+    o71_ref_t value_r,
+    o71_cmp_f cmp,
+    void * ctx
+);
 
-    free_head_x = ~0;
-    free_tail_xp = &free_head_x;
-    do
-    {
-        finish_tail_xp = &finish_head_x;
-        for (obj_x = ~finish_head_x; obj_x; obj_x = next_obj_x)
-        {
-            o71_mem_obj_t * obj_p;
-            obj_p = world_p->mem_obj_pa[obj_x];
-            next_obj_x = ~obj_p->destroy_next_ex;
-            class_p = o71_obj_ptr(world_p, obj_p->class_r);
-            A(class_p);
-            if (class_p->rank == rank)
-            {
-                os = class_p->finish(world_p, O71_MOX_TO_REF(obj_x));
-                M("obref_%lX(class:obref_%lX) finish: %s",
-                   (long) O71_MOX_TO_REF(obj_x), (long) obj_p->class_r, N(os));
-                if (os) break;
-                if (obj_x < O71X__COUNT) continue;
-                *free_tail_xp = ~obj_x;
-                free_tail_xp = &obj_p->destroy_next_ex;
-            }
-            else
-            {
-                *finish_tail_xp = ~obj_x;
-                finish_tail_xp = &obj_p->destroy_next_ex;
-            }
-        }
-        *finish_tail_xp = ~0;
-    }
-    while (rank--);
-    *free_tail_xp = ~0;
+/*  kvbag_tree_build  */
+/**
+ *  Builds the O71_BAG_LARGE_MODE tree of an ordered bag from sorted items
+ *  and switches the bag to that mode.
+ *  Ref counts are not affected.
+ *  @note the storage of the previous mode is overwritten, not freed; the
+ *  caller must hold on to it
+ *  @note on error the bag is not changed
+ */
+static o71_status_t kvbag_tree_build
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kv_t const * kv_a,
+    size_t kv_n
+);
 
-    for (obj_x = ~free_head_x; obj_x; obj_x = next_obj_x)
-    {
-        o71_mem_obj_t * obj_p;
-        size_t obj_size;
-        obj_p = world_p->mem_obj_pa[obj_x];
-        next_obj_x = ~obj_p->destroy_next_ex;
-        class_p = o71_obj_ptr(world_p, obj_p->class_r);
-        A(class_p);
-        obj_size = class_p->object_size;
-        os = redim(world_p->allocator_p, (void * *) &obj_p, &obj_size, 0, 1);
-        AOS(os);
-    }
+/*  kvbag_tree_collect  */
+/**
+ *  Copies the items of an ordered bag in key order.
+ *  @param kv_a [out]
+ *      receives the items; can be NULL to just count them
+ *  @returns number of items
+ */
+static size_t kvbag_tree_collect
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kv_t * kv_a
+);
 
-    os = redim(world_p->allocator_p,
-               (void * *) &world_p->obj_pa, &world_p->obj_n, 0,
-               sizeof(void *));
-    if (os) { M("oops: %s", N(os)); return os; }
+/*  kvbag_min_count  */
+/**
+ *  @returns a lower bound of the number of items in the bag, computed
+ *  without walking all of it
+ */
+static size_t kvbag_min_count
+(
+    o71_kvbag_t const * kvbag_p
+);
 
-    os = kvbag_free(world_p, &world_p->istr_bag, kv_nop_free);
-    if (os) { M("oops: %s", N(os)); return os; }
+/*  kvbag_build  */
+/**
+ *  Replaces the storage of the bag with one holding the given sorted items:
+ *  the array if the bag is still in array mode and the items fit in it,
+ *  otherwise the large mode structure built in linear time.
+ *  The previous storage is freed without touching its items.
+ *  Ref counts are not affected.
+ *  @note on error the bag is not changed
+ */
+static o71_status_t kvbag_build
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kv_t const * kv_a,
+    size_t kv_n
+);
 
-    M("goodbye cruel world %p!", world_p);
-    return O71_OK;
-}
+/*  kvbag_load  */
+/**
+ *  Fills an empty bag with items sorted by @a cmp, in linear time.
+ *  Keys get their ref count incremented; the bag takes over the references
+ *  to the values, as kvbag_put() does.
+ *  @param kv_a [in]
+ *      items with strictly increasing keys (checked in O71_CHECKED builds)
+ *  @retval O71_OK
+ *  @retval O71_NO_MEM
+ *  @retval O71_MEM_LIMIT
+ *  @retval O71_MEM_CORRUPTED
+ *  @retval O71_BUG
+ *  @note on error the bag stays empty
+ */
+static o71_status_t kvbag_load
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kv_t const * kv_a,
+    size_t kv_n,
+    o71_cmp_f cmp,
+    void * ctx
+);
 
-/* o71_check_mem_obj_ref ****************************************************/
-O71_API o71_status_t o71_check_mem_obj_ref
+/*  kvbag_merge  */
+/**
+ *  Puts a batch of items sorted by @a cmp into the bag.
+ *  Ref counts change as if kvbag_put() was called for each item.
+ *  Hash tables grow once to fit all the items, then get them inserted.
+ *  Other bags are rebuilt from a linear merge of their items with the
+ *  batch unless the batch is small compared to the bag, in which case the
+ *  items are put one by one.
+ *  @param kv_a [in]
+ *      items with strictly increasing keys
+ *  @retval O71_OK
+ *  @retval O71_NO_MEM
+ *  @retval O71_MEM_LIMIT
+ *  @retval O71_ARRAY_LIMIT
+ *  @retval O71_MEM_CORRUPTED
+ *  @retval O71_BUG
+ *  @retval O71_TODO
+ *  @note on error a rebuilt or hash mode bag is not changed while an item by
+ *  item merge can leave the items before the failing one in the bag
+ */
+static o71_status_t kvbag_merge
 (
     o71_world_t * world_p,
-    o71_ref_t obj_r
-)
-{
-    o71_obj_index_t obj_x;
+    o71_kvbag_t * kvbag_p,
+    o71_kv_t const * kv_a,
+    size_t kv_n,
+    o71_cmp_f cmp,
+    void * ctx
+);
 
-    if (!O71_IS_REF_TO_MO(obj_r)) return O71_NOT_MEM_OBJ_REF;
-    obj_x = O71_REF_TO_MOX(obj_r);
-    if (obj_x >= world_p->obj_n) return O71_UNUSED_MEM_OBJ_SLOT;
-    if (IS_FREE_OBJECT_SLOT(world_p->obj_pa[obj_x]))
-        return O71_UNUSED_MEM_OBJ_SLOT;
-    return O71_OK;
-}
+/*  kvbag_cursor_init  */
+/**
+ *  Prepares a cursor for iterating a bag from its first item.
+ */
+static void kvbag_cursor_init
+(
+    o71_kvbag_cursor_t * cursor_p
+);
 
-/* o71_model ****************************************************************/
-O71_API uint32_t o71_model
+/*  kvbag_cursor_seek  */
+/**
+ *  Positions the cursor after @a key_r.
+ *  @note for bags whose @a cmp looks into the key objects, the cursor key
+ *  (the seek key, then the last returned key) must stay alive while the
+ *  cursor is used
+ *  @retval O71_OK
+ *  @retval anything returned by @a cmp
+ */
+static o71_status_t kvbag_cursor_seek
 (
     o71_world_t * world_p,
-    o71_ref_t obj_r
-)
-{
-    o71_obj_index_t obj_x, class_x;
-    o71_ref_t class_r;
-    o71_class_t * class_p;
-    if (O71_IS_REF_TO_SINT(obj_r)) return O71M_SMALL_INT;
-    obj_x = O71_REF_TO_MOX(obj_r);
-    if (obj_x >= world_p->obj_n || IS_FREE_OBJECT_SLOT(world_p->obj_pa[obj_x]))
-        return O71M_INVALID;
-    class_r = world_p->mem_obj_pa[obj_x]->class_r;
-    class_x = O71_REF_TO_MOX(class_r);
-    class_p = world_p->obj_pa[class_x];
-    return class_p->model;
-}
+    o71_kvbag_t * kvbag_p,
+    o71_kvbag_cursor_t * cursor_p,
+    o71_ref_t key_r,
+    o71_cmp_f cmp,
+    void * ctx
+);
 
-/* o71_class ****************************************************************/
-O71_API o71_class_t * o71_class
+/*  kvbag_cursor_locate  */
+/**
+ *  Computes the position of the cursor in the current bag structure from
+ *  its state and key and marks it valid for the current bag version.
+ *  In hash mode the key is probed for from its home slot and the position
+ *  is the slot after it, or the one it would be inserted in.
+ *  @retval O71_OK
+ *  @retval anything returned by @a cmp
+ */
+static o71_status_t kvbag_cursor_locate
 (
     o71_world_t * world_p,
-    o71_ref_t obj_r
-)
-{
-    o71_obj_index_t obj_x, class_x;
-    o71_ref_t class_r;
-    if (O71_IS_REF_TO_SINT(obj_r)) return &world_p->small_int_class;
-    obj_x = O71_REF_TO_MOX(obj_r);
-    if (obj_x >= world_p->obj_n || IS_FREE_OBJECT_SLOT(world_p->obj_pa[obj_x]))
-        return NULL;
-    class_r = world_p->mem_obj_pa[obj_x]->class_r;
-    class_x = O71_REF_TO_MOX(class_r);
-    return world_p->obj_pa[class_x];
-}
+    o71_kvbag_t * kvbag_p,
+    o71_kvbag_cursor_t * cursor_p,
+    o71_cmp_f cmp,
+    void * ctx
+);
 
-/* o71_ref ******************************************************************/
-O71_API o71_status_t o71_ref
+/*  kvbag_cursor_next  */
+/**
+ *  Gets the next item; see o71_kvbag_cursor_next().
+ *  @param cmp [in]
+ *      only called to find the position again after the bag changed
+ *  @retval O71_OK
+ *  @retval O71_MISSING
+ *      no more items
+ *  @retval anything returned by @a cmp
+ */
+static o71_status_t kvbag_cursor_next
 (
     o71_world_t * world_p,
-    o71_ref_t obj_r
-)
-{
-    o71_obj_index_t obj_x;
-    if (!O71_IS_REF_TO_MO(obj_r)) return O71_OK;
-    obj_x = O71_REF_TO_MOX(obj_r);
-#if O71_CHECKED
-    {
-        o71_status_t os;
-        os = o71_check_mem_obj_ref(world_p, obj_r);
-        if (os) return os;
-        if (world_p->mem_obj_pa[obj_x]->ref_n <= 0)
-            return O71_OBJ_DESTRUCTING;
-    }
-    if (world_p->mem_obj_pa[obj_x]->ref_n + 1 < 0)
-        return O71_REF_COUNT_OVERFLOW;
-#endif
-    world_p->mem_obj_pa[obj_x]->ref_n += 1;
-    M2("obref_%lX.ref -> %lX", (long) obj_r,
-       (long) world_p->mem_obj_pa[obj_x]->ref_n);
-    return O71_OK;
-}
+    o71_kvbag_t * kvbag_p,
+    o71_kvbag_cursor_t * cursor_p,
+    o71_cmp_f cmp,
+    void * ctx,
+    o71_kv_t * kv_p
+);
 
-/* o71_deref ****************************************************************/
-O71_API o71_status_t o71_deref
+static o71_status_t kv_nop_free (o71_world_t * world_p, o71_kv_t * kv_p);
+static o71_status_t kv_free_key_deref (o71_world_t * world_p, o71_kv_t * kv_p);
+static o71_status_t deref_key_and_value (o71_world_t * world_p, o71_kv_t * kv_p);
+
+/*  merge_sorted_refs  */
+/**
+ *  Reallocates the destination array of sorted refs and inserts source
+ *  elements keeping the sort order.
+ *  @note dest and src must be sorted
+ *  @note this will keep duplicates
+ */
+static o71_status_t merge_sorted_refs
 (
     o71_world_t * world_p,
-    o71_ref_t obj_r
-)
-{
-    o71_obj_index_t obj_x;
-    if (!O71_IS_REF_TO_MO(obj_r)) return O71_OK;
-    obj_x = O71_REF_TO_MOX(obj_r);
-#if O71_CHECKED
-    {
-        o71_status_t os;
-        os = o71_check_mem_obj_ref(world_p, obj_r);
-        if (os) return os;
-    }
-#endif
-    if (world_p->mem_obj_pa[obj_x]->ref_n > 1)
-    {
-        world_p->mem_obj_pa[obj_x]->ref_n -= 1;
-        M2("obref_%lX.deref -> %lX", (long) obj_r,
-          (long) world_p->mem_obj_pa[obj_x]->ref_n);
-        return O71_OK;
-    }
-    A(world_p->mem_obj_pa[obj_x]->ref_n != 0);
-    /* ignore derefs for objects in the destroy chain */
-    if ((world_p->mem_obj_pa[obj_x]->ref_n | (intptr_t) -!obj_x) < 0)
-    {
-        M2("obref_%lX.deref -> already in destroy list", (long) obj_r);
-        return O71_OK;
-    }
-    /* chain the object to the destroy list */
-    *world_p->free_list_tail_xp = ~obj_x;
-    world_p->mem_obj_pa[obj_x]->destroy_next_ex = ~0;
-    world_p->free_list_tail_xp =
-        &world_p->mem_obj_pa[obj_x]->destroy_next_ex;
-    M2("obref_%lX.deref -> queue for destruction", (long) obj_r);
-    //M("obj_x=%lX", (long) obj_x);
-    return o71_cleanup(world_p);
-}
+    o71_ref_t * * dest_rap,
+    size_t * dest_rnp,
+    o71_ref_t * src_ra,
+    size_t src_n
+);
 
-/* o71_cleanup **************************************************************/
-O71_API o71_status_t o71_cleanup
+/*  ref_qsort  */
+/**
+ *  Sorts an array of references.
+ */
+static void ref_qsort
 (
-    o71_world_t * world_p
-)
-{
-    o71_mem_obj_t * mo_p;
-    o71_class_t * class_p;
-    o71_status_t os;
-    o71_obj_index_t obj_x, next_obj_x;
-    o71_obj_index_t free_head_x;
-    size_t obj_size;
-    if (world_p->cleaning) return O71_OK;
-    world_p->cleaning = 1;
-    M("cleanup start");
-    os = O71_OK;
-    os = 0;
-    for (obj_x = world_p->free_list_head_ex; obj_x; obj_x = next_obj_x)
-    {
-        M("obref_%lX", (long) O71_MOX_TO_REF(obj_x));
-        mo_p = world_p->mem_obj_pa[obj_x];
-        M("obref_%lX(class:obref_%lX)",
-           (long) O71_MOX_TO_REF(obj_x), (long) mo_p->class_r);
-        A(o71_model(world_p, mo_p->class_r) & O71M_CLASS);
-        class_p = world_p->obj_pa[O71_REF_TO_MOX(mo_p->class_r)];
-        A(class_p);
-        A(class_p->finish);
-        os = class_p->finish(world_p, O71_MOX_TO_REF(obj_x));
-        M("obref_%lX(class:obref_%lX) finish: %s",
-           (long) O71_MOX_TO_REF(obj_x), (long) mo_p->class_r, N(os));
-        if (os) break;
-        os = o71_deref(world_p, mo_p->class_r);
-        if (os)
-        {
-            M("deref obj class(obref_%lX): %s",
-              (long) mo_p->class_r, N(os));
-            break;
-        }
-        next_obj_x = ~mo_p->destroy_next_ex;
-        if (obj_x < O71X__COUNT) continue;
-
-        M("queue for mem free: obref_%lX", (long) O71_MOX_TO_REF(obj_x));
-    }
-
-    M("cleanup object body mem");
-    for (obj_x = world_p->free_list_head_ex; obj_x; obj_x = next_obj_x)
-    {
-        M("obref_%lX", (long) O71_MOX_TO_REF(obj_x));
-        mo_p = world_p->mem_obj_pa[obj_x];
-        next_obj_x = ~mo_p->destroy_next_ex;
-        A(o71_model(world_p, mo_p->class_r) & O71M_CLASS);
-        class_p = world_p->obj_pa[O71_REF_TO_MOX(mo_p->class_r)];
-        A(class_p);
-        obj_size = class_p->object_size;
-        os = redim(world_p->allocator_p, world_p->obj_pa + obj_x, &obj_size, 0,
-                   1);
-        if (os)
-        {
-            M("obj mem free failed: %s", N(os));
-            break;
-        }
-        os = free_object_index(world_p, obj_x);
-#if O71_CHECKED
-        if (os)
-        {
-            M("free_object_index(obref_%lX) failed: %s",
-              (long) O71_MOX_TO_REF(obj_x), N(os));
-            return os;
-        }
-#endif
-
-    }
+    o71_ref_t * ref_a,
+    size_t ref_n
+);
 
-    M("cleanup done");
-    world_p->cleaning = 0;
-    return os;
-}
+/*  refkv_qsort  */
+/**
+ *  Sorts an array of kv pairs by comparing the key reference.
+ */
+static void refkv_qsort
+(
+    o71_kv_t * kv_a,
+    size_t n
+);
 
-/* o71_cstring **************************************************************/
-O71_API o71_status_t o71_cstring
+/*  ref_search  */
+/**
+ *  Binary search for refs
+ */
+static ptrdiff_t ref_search
 (
-    o71_world_t * world_p,
-    o71_ref_t * str_rp,
-    char const * cstr_a
-)
-{
-    o71_obj_index_t str_x;
-    o71_status_t os, osf;
-    o71_string_t * str_p;
-    size_t i, n;
-    os = alloc_object(world_p, O71R_STRING_CLASS, &str_x);
-    if (os)
-    {
-        M("failed to allocate string object: %s", N(os));
-        return os;
-    }
-    A(str_x < world_p->obj_n);
-    str_p = world_p->obj_pa[str_x];
-    str_p->n = str_p->m = 0;
-    str_p->mode = O71_SM_MODIFIABLE;
-    for (n = 0; cstr_a[n]; ++n);
-    os = redim(world_p->allocator_p, (void * *) &str_p->a, &str_p->m, n, 1);
-    if (os)
-    {
-        M("failed to allocate string data: n=%zu os=%s", n, N(os));
-        osf = free_object(world_p, str_x);
-        if (osf)
-        {
-            M("FATAL: free object index: os=%s", N(osf));
-            return osf;
-        }
-        return os;
-    }
-    for (i = 0; i < n; ++i)
-        str_p->a[i] = cstr_a[i];
-    str_p->n = str_p->m = n;
-    *str_rp = O71_MOX_TO_REF(str_x);
-    return O71_OK;
-}
+    o71_ref_t * ra,
+    size_t rn,
+    o71_ref_t kr
+);
 
-/* o71_rocs *****************************************************************/
-O71_API o71_status_t o71_rocs
+/*  class_super_extend  */
+/**
+ *  Extends the array of superclasses.
+ *  @param world_p [in]
+ *  @param class_p [in, out]
+ *  @param super_ra [in, out]
+ *      has the list of classes to add (references are borrowed);
+ *      clobbered on exit
+ *  @param super_n
+ */
+static o71_status_t class_super_extend
 (
     o71_world_t * world_p,
-    o71_ref_t * str_rp,
-    char const * cstr_a
-)
-{
-    o71_obj_index_t str_x;
-    o71_status_t os, osf;
-    o71_string_t * str_p;
-    size_t i, n;
-    os = alloc_object(world_p, O71R_STRING_CLASS, &str_x);
-    if (os)
-    {
-        M("failed to allocate string object: %s", N(os));
-        return os;
-    }
-    A(str_x < world_p->obj_n);
-    str_p = world_p->obj_pa[str_x];
-    str_p->n = str_p->m = 0;
-    str_p->mode = O71_SM_READ_ONLY;
-    for (n = 0; cstr_a[n]; ++n);
-    str_p->a = (uint8_t *) cstr_a;
-    str_p->n = n;
-    str_p->m = 0;
-    *str_rp = O71_MOX_TO_REF(str_x);
-    M("allocated ro string '%s' -> obref_%lX", cstr_a, (long) *str_rp);
-    return O71_OK;
-}
+    o71_class_t * class_p,
+    o71_ref_t * super_ra,
+    size_t super_n
+);
 
-/* o71_str_freeze ***********************************************************/
-O71_API o71_status_t o71_str_freeze
+/*  set_var  */
+/**
+ *  Dereferences old value stored in destination and references the source
+ *  value and stores it in destination.
+ *  @retval O71_OK only value for release builds
+ *  @retval O71_REF_COUNT_OVERFLOW
+ *      adding a reference causes int overflow;
+ *      this should only happen due to a bug from some component;
+ *      this code can be returned only in checked or debug builds
+ *  @retval O71_OBJ_DESTRUCTING
+ *      attempt to increase the ref count of an object from the destroy chain;
+ *      this code can be returned only in checked or debug builds
+ *  @retval O71_UNUSED_MEM_OBJ_SLOT
+ *      bad reference to unused memory object slot;
+ *      this code can be returned only in checked or debug builds
+  * @retval O71_MEM_CORRUPTED
+  *     allocator detects some corruption while freeing memory for destroyed
+  *     objects
+  * @retval O71_BUG
+  *     some assertion failed
+  *     this code can be returned only in checked or debug builds
+ *
+ */
+O71_INLINE o71_status_t set_var
 (
     o71_world_t * world_p,
-    o71_ref_t str_r
-)
-{
-    o71_string_t * str_p;
-
-    if (!(o71_model(world_p, str_r) & O71M_STRING))
-    {
-        M("obref_%lX is not a string (model: 0x%X)",
-          (long) str_r, o71_model(world_p, str_r));
-        return O71_BAD_STRING_REF;
-    }
-    str_p = o71_obj_ptr(world_p, str_r);
-    if (str_p->mode == O71_SM_MODIFIABLE)
-        str_p->mode = O71_SM_READ_ONLY;
-    return 0;
-}
+    o71_ref_t * dest_rp,
+    o71_ref_t src_r
+);
 
-/* o71_str_intern ***********************************************************/
-O71_API o71_status_t o71_str_intern
+/*  arena_init  */
+/**
+ *  Inits an empty arena; no memory is allocated until the first
+ *  arena_alloc().
+ */
+static void arena_init
 (
-    o71_world_t * world_p,
-    o71_ref_t str_r,
-    o71_ref_t * intern_str_rp
-)
-{
-    o71_kvbag_loc_t loc;
-    o71_string_t * str_p;
-    o71_ref_t istr_r;
-    o71_status_t os;
-    M2("str_intern(obref_%lX)", (long) str_r);
-    str_p = o71_obj_ptr(world_p, str_r);
+    o71_arena_t * arena_p,
+    o71_allocator_t * allocator_p
+);
 
-    if (!(o71_model(world_p, str_r) & O71M_STRING))
-    {
-        M2("obref_%lX is not a string (model: 0x%X)",
-           (long) str_r, o71_model(world_p, str_r));
-        return O71_BAD_STRING_REF;
-    }
-    str_p = o71_obj_ptr(world_p, str_r);
-    if (str_p->mode == O71_SM_INTERN)
-    {
-        *intern_str_rp = str_r;
-        return o71_ref(world_p, str_r);
-    }
+/*  arena_alloc  */
+/**
+ *  Allocates a pointer aligned block from the arena.
+ *  Blocks larger than a quarter of O71_ARENA_CHUNK_SIZE get their own chunk.
+ *  @retval O71_OK
+ *  @retval O71_NO_MEM
+ *  @retval O71_MEM_LIMIT
+ *  @retval O71_MEM_CORRUPTED
+ *  @retval O71_BUG
+ *  @retval O71_TODO
+ */
+static o71_status_t arena_alloc
+(
+    o71_arena_t * arena_p,
+    void * * data_pp,
+    size_t size
+);
 
-    os = kvbag_search(world_p, &world_p->istr_bag, str_r,
-                      str_intern_cmp, NULL, &loc);
-    if (os == O71_OK)
-    {
-        *intern_str_rp = kvbag_get_loc_value(world_p, &world_p->istr_bag, &loc);
-        return o71_ref(world_p, *intern_str_rp);
-    }
-    /* no matching intern string already present */
-    A(os == O71_MISSING);
-    if (str_p->mode == O71_SM_MODIFIABLE)
-    {
-        M("TODO: dup the key to make it read-only");
-        return O71_TODO;
-    }
-    A(str_p->mode == O71_SM_READ_ONLY);
-    os = kvbag_insert(world_p, &world_p->istr_bag, str_r, str_r, &loc);
-    if (os)
-    {
-        M("failed to insert string in intern bag: %s", N(os));
-        return os;
-    }
-    str_p->mode = O71_SM_INTERN;
-    *intern_str_rp = str_r;
-#if O71_DEBUG >= 2
-    printf("intern bag:\n");
-    kvbag_dump(world_p, &world_p->istr_bag);
-#endif
+/*  arena_free  */
+/**
+ *  Releases all memory allocated from the arena.
+ */
+static o71_status_t arena_free
+(
+    o71_arena_t * arena_p
+);
 
-    return O71_OK;
-}
+/*  tokenize_source  */
+/**
+ *  Tokenizes source.
+ */
+static o71_status_t tokenize_source
+(
+    o71_code_t * code_p
+);
 
-/* o71_ics ******************************************************************/
-O71_API o71_status_t o71_ics
+/*  init_empty_block_stmt  */
+/**
+ *  Initializes an empty block statement.
+ */
+static void init_empty_block_stmt
+(
+    o71_block_stmt_token_t * block_stmt_p,
+    o71_block_stmt_token_t * parent_block_stmt_p
+);
+
+/*  match_stmt_seq  */
+/**
+ *  @param code_p [in]
+ *  @param block_stmt_p [in, out]
+ *      initialized block statement whose stmt list is extended with parsed
+ *      statements
+ *  @param src_p [in]
+ *      source token where to start matching
+ *  @param src_pp [out]
+ *      source token when matching stopped; for syntactically valid code this
+ *      should point on return to EOF or '}'
+ */
+static o71_status_t match_stmt_seq
+(
+    o71_code_t * code_p,
+    o71_block_stmt_token_t * block_stmt_p,
+    o71_token_t * src_p,
+    o71_token_t * * src_pp,
+    o71_token_type_t end_type
+);
+
+#if O71_DEBUG
+/*  obj_dump  */
+/**
+ *
+ */
+static void obj_dump
 (
     o71_world_t * world_p,
-    o71_ref_t * str_rp,
-    char const * cstr_a
-)
-{
-    o71_status_t os, dos;
-    o71_ref_t rostr_r;
+    o71_ref_t obj_r
+);
 
-    M("ics('%s')", cstr_a);
-    os = o71_rocs(world_p, &rostr_r, cstr_a);
-    if (os) return os;
+/*  kvbag_dump  */
+/**
+ *
+ */
+static void kvbag_dump
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p
+);
 
-    os = o71_str_intern(world_p, rostr_r, str_rp);
-    M("str(obref_%lX)=rocs('%s') -> is(obref_%lX): %s",
-      (long) rostr_r, cstr_a, (long) *str_rp, N(os));
-    dos = o71_deref(world_p, rostr_r);
-#if O71_CHECKED
-    if (dos) return dos;
-#else
-    (void) dos;
-#endif
+/*  kvbag_array_dump  */
+/**
+ *
+ */
+static void kvbag_array_dump
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p
+);
 
-    return os;
-}
+/*  kvbag_rbtree_dump  */
+/**
+ *  Dumps to stdout the tree
+ */
+static void kvbag_rbtree_dump
+(
+    o71_world_t * world_p,
+    o71_kvnode_t * kvnode_p,
+    unsigned int depth
+);
 
-/* o71_prep_call *****************************************************************/
-O71_API o71_status_t o71_prep_call
+/*  kvbag_btree_dump  */
+/**
+ *  Dumps to stdout the B-tree
+ */
+static void kvbag_btree_dump
 (
-    o71_flow_t * flow_p,
-    o71_ref_t func_r,
-    o71_ref_t * arg_ra,
-    size_t arg_n
-)
-{
-    o71_status_t os;
-    o71_world_t * world_p = flow_p->world_p;
-    o71_function_t * func_p;
+    o71_world_t * world_p,
+    o71_kvbtnode_t * node_p,
+    unsigned int depth
+);
 
-    if (!(o71_model(flow_p->world_p, func_r) & O71M_FUNCTION))
-    {
-        /* TODO: prepare exception */
-        return O71_BAD_FUNC_REF;
-    }
-    func_p = world_p->obj_pa[O71_REF_TO_MOX(func_r)];
-    os = func_p->call(flow_p, func_r, arg_ra, arg_n);
-    return os;
-}
+/*  kvbag_hash_dump  */
+/**
+ *  Dumps to stdout the used slots of a hash bag
+ */
+static void kvbag_hash_dump
+(
+    o71_world_t * world_p,
+    o71_kvhash_t * hash_p
+);
 
-/* o71_run ******************************************************************/
-O71_API o71_status_t o71_run
+/*  dump_token_list  */
+/**
+ *  Prints a list token types
+ */
+static void dump_token_list
 (
-    o71_flow_t * flow_p,
-    unsigned int min_depth,
-    uint32_t steps
-)
-{
-    o71_exe_ctx_t * exe_ctx_p;
-    o71_function_t * func_p;
-    o71_status_t os;
-    o71_ref_t exe_ctx_r;
+    o71_token_t * token_p,
+    size_t n
+);
 
-    A(steps <= O71_STEPS_MAX);
-    flow_p->crt_steps = 0;
-    flow_p->max_steps = steps;
-    while (flow_p->depth > min_depth)
-    {
-        /*
-        if (flow_p->exc_r != O71R_NULL)
-        {
-            M("TODO: call run in exc handling mode");
-            return O71_TODO;
-        }
-        */
+#else
+#define kvbag_dump(_w, _k) ((void) 0)
+#define dump_token_list(_tp, _n) ((void) 0)
+#endif
 
-        if (flow_p->crt_steps >= flow_p->max_steps)
-        {
-            M("reached max steps: crt=%u, max=%u",
-              flow_p->crt_steps, flow_p->max_steps);
-            return O71_PENDING;
-        }
+static o71_status_t rule_nop (o71_code_t * code_p);
 
-        exe_ctx_r = flow_p->exe_ctx_r;
-        exe_ctx_p = o71_obj_ptr(flow_p->world_p, exe_ctx_r);
-        func_p = o71_obj_ptr(flow_p->world_p, exe_ctx_p->hdr.class_r);
-        os = func_p->run(flow_p);
-        M("flow=%p, func=%p => run -> %s", flow_p, func_p, N(os));
-        A(exe_ctx_r == flow_p->exe_ctx_r);
-        switch (os)
-        {
-        case O71_EXC:
-            A(flow_p->exc_r != O71R_NULL);
-            /* fall to ok to unwind stack */
-        case O71_OK:
-            {
-                //size_t size;
-                flow_p->exe_ctx_r = exe_ctx_p->caller_r;
-                flow_p->depth -= 1;
-                //size = exe_ctx_p->size;
-                //os = redim(flow_p->world_p, (void * *) &exe_ctx_p, &size, 0, 1);
-                os = o71_deref(flow_p->world_p, exe_ctx_r);
-                AOS(os);
-            }
-            break;
-        case O71_PENDING:
-            break;
-        default:
-            M("flow_%u: function returned status %s", flow_p->flow_id, N(os));
-            return os;
-        }
-    }
-    return flow_p->exc_r == O71R_NULL ? O71_OK : O71_EXC;
-}
+static uint32_t init_exc_chain_start_xa[2] = { 0, 0 };
 
-/* o71_sfunc_create *********************************************************/
-O71_API o71_status_t o71_sfunc_create
-(
-    o71_world_t * world_p,
-    o71_ref_t * sfunc_rp,
-    uint32_t arg_n
-)
+/* char_class_a: CC_xxx flags for each byte value; bytes >= 0x80 have none */
+static uint8_t const char_class_a[0x100] =
 {
-    o71_status_t os, osf;
-    o71_obj_index_t sfunc_x;
-    o71_script_function_t * sfunc_p;
-    size_t i;
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, /* 00-07 */
+    0x00, 0x00, 0x10, 0x00, 0x00, 0x10, 0x00, 0x00, /* 08-0F */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, /* 10-17 */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, /* 18-1F */
+    0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, /* 20-27 */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, /* 28-2F */
+    0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, /* 30-37 */
+    0x06, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, /* 38-3F */
+    0x00, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x01, /* 40-47 */
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, /* 48-4F */
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, /* 50-57 */
+    0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x01, /* 58-5F */
+    0x00, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x01, /* 60-67 */
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, /* 68-6F */
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, /* 70-77 */
+    0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, /* 78-7F */
+};
 
-    os = alloc_object(world_p, O71R_SCRIPT_FUNCTION_CLASS, &sfunc_x);
-    if (os)
-    {
-        M("failed to allocate sfunc object: %s", N(os));
-        return os;
-    }
-    sfunc_p = world_p->obj_pa[sfunc_x];
-    sfunc_p->func.cls.finish = noop_object_finish;
-    sfunc_p->func.cls.super_ra = NULL;
-    sfunc_p->func.cls.fix_field_ofs_a = NULL;
-    sfunc_p->func.cls.get_field = get_missing_field;
-    sfunc_p->func.cls.set_field = set_missing_field;
-    kvbag_init(&sfunc_p->func.cls.method_bag, O71_METHOD_ARRAY_LIMIT);
-    sfunc_p->func.cls.super_n = 0;
-    sfunc_p->func.cls.object_size = 0; // this will be set by sfunc_validate
-    sfunc_p->func.cls.dyn_field_ofs = 0;
-    sfunc_p->func.cls.fix_field_n = 0;
-    sfunc_p->func.cls.model = O71MI_EXE_CTX;
-    sfunc_p->func.cls.rank = 2;
-    sfunc_p->func.call = sfunc_call;
-    sfunc_p->func.run = sfunc_run;
-    sfunc_p->insn_a = NULL;
-    sfunc_p->opnd_a = NULL;
-    sfunc_p->arg_xa = NULL;
-    sfunc_p->const_ra = NULL;
-    sfunc_p->exc_handler_a = NULL;
-    sfunc_p->exc_chain_start_xa = init_exc_chain_start_xa;
-    sfunc_p->var_n = 0;
-    sfunc_p->arg_n = 0;
-    sfunc_p->insn_n = 0;
-    sfunc_p->insn_m = 0;
-    sfunc_p->opnd_n = 0;
-    sfunc_p->opnd_m = 0;
-    sfunc_p->const_n = 0;
-    sfunc_p->const_m = 0;
-    sfunc_p->exc_handler_n = 0;
-    sfunc_p->exc_handler_m = 0;
-    sfunc_p->exc_chain_n = 1;
-    sfunc_p->exc_chain_m = 0;
-    sfunc_p->valid = 0;
-    os = redim(world_p->allocator_p, (void * *) &sfunc_p->arg_xa,
-               &sfunc_p->arg_n, arg_n, sizeof(uint32_t));
-    if (os)
-    {
-        M("failed to allocate arg index array: %s", N(os));
-        osf = free_object(world_p, sfunc_x);
-        if (osf)
-        {
-            M("FATAL: free object index: os=%s", N(osf));
-            return osf;
-        }
-        return os;
-    }
+/* builtin_str_a: content of the builtin intern strings starting with
+ * O71X__STR_FIRST, in the same (sorted) order; hash is str_hash() of the
+ * content, precomputed so that world init only links these in the intern
+ * table (the self test checks both the hashes and the order) */
+static struct builtin_str_s
+{
+    char const * a;
+    uint8_t n;
+    uint32_t hash;
+} const builtin_str_a[O71_BUILTIN_STR_N] =
+{
+    { "add", 3, 0x3B391274 },
+    { "exe_ctx", 7, 0x80125395 },
+};
 
-    for (i = 0; i < arg_n; ++i)
-        sfunc_p->arg_xa[i] = (uint32_t) i;
 
-    *sfunc_rp = O71_MOX_TO_REF(sfunc_x);
+/* grammar ******************************************************************/
+#if _DEBUG
+#define R(_h, _t, ...) { _h, (_t), { __VA_ARGS__ }, #_h ": " #_t " := " #__VA_ARGS__ }
+#else
+#define R(_h, _t, ...) { _h, (_t), { __VA_ARGS__ } }
+#endif
 
-    return O71_OK;
-}
+static char const * ttname_a[O71_TT__COUNT] =
+{
+    "<rule_end>",
+    "END",
+    "'~'",
+    "'!'",
+    "'?'",
+    "'%'",
+    "'^'",
+    "'&'",
+    "'|'",
+    "'*'",
+    "'/'",
+    "'('",
+    "')'",
+    "'['",
+    "']'",
+    "'{'",
+    "'}'",
+    "'='",
+    "'+'",
+    "'-'",
+    "'<'",
+    "'>'",
+    "'.'",
+    "','",
+    "';'",
+    "':'",
+    "'++'",
+    "'--'",
+    "'**'",
+    "'<<'",
+    "'>>'",
+    "'&&'",
+    "'^^'",
+    "'||'",
+    "'=='",
+    "'!='",
+    "'+='",
+    "'-='",
+    "'*='",
+    "'/='",
+    "'%='",
+    "'<='",
+    "'>='",
+    "'<<='",
+    "'>>='",
+    "'&='",
+    "'|='",
+    "'^='",
+    "'**='",
+    "'&&='",
+    "'^^='",
+    "'||='",
+    "'return'",
+    "'break'",
+    "'goto'",
+    "'if'",
+    "'else'",
+    "'while'",
+    "'do'",
+    "'for'",
+    "'switch'",
+    "'case'",
+    "integer",
+    "string",
+    "identifier",
+    "source",
+    "stmt_seq",
+    "stmt",
+    "expr_stmt",
+    "decl_start",
+    "block_stmt",
+    "if_stmt_start",
+    "do_stmt_start",
+    "while_cond",
+    "unary_operator",
+    "exp_operator",
+    "mul_operator",
+    "add_operator",
+    "cmp_operator",
+    "equ_operator",
+    "asg_operator",
+    "var_init",
+    "var_init_list",
+    "arg_decl",
+    "arg_decl_list",
+    "expr_list",
+    "atom_expr",
+    "postfix_expr",
+    "prefix_expr",
+    "exp_expr",
+    "and_expr",
+    "or_expr",
+    "xor_expr",
+    "mul_expr",
+    "add_expr",
+    "cmp_expr",
+    "equ_expr",
+    "logic_and_expr",
+    "logic_xor_expr",
+    "logic_or_expr",
+    "cond_expr",
+    "expr",
+};
 
-/* o71_sfunc_append_init ****************************************************/
-O71_API o71_status_t o71_sfunc_append_init
+/* utf8_codepoint_length ****************************************************/
+static unsigned int utf8_codepoint_length
 (
-    o71_world_t * world_p,
-    o71_script_function_t * sfunc_p,
-    uint32_t dest_vx,
-    o71_ref_t const_r
+    uint32_t codepoint
 )
 {
-    o71_insn_t * insn_p;
-    uint32_t * opnd_a;
-    o71_status_t os;
-    uint32_t cx;
-    uint16_t opnd_x;
+    if (codepoint < 0x80) return 1;
+    if (codepoint < 0x800) return 2;
+    if (codepoint < 0x10000) return 3;
+    return 4;
+}
 
-    os = sfunc_add_const(world_p, sfunc_p, &cx, const_r);
-    if (os)
+/* utf8_codepoint_encode ****************************************************/
+static unsigned int utf8_codepoint_encode
+(
+    uint8_t * out,
+    uint32_t codepoint
+)
+{
+    if (codepoint < 0x80)
     {
-        M("failed to add constant for INIT insn for sfunc %p: %s",
-          sfunc_p, N(os));
-        return os;
+        out[0] = (uint8_t) codepoint;
+        return 1;
     }
-
-    opnd_x = (uint16_t) sfunc_p->opnd_n;
-    os = sfunc_alloc_code(world_p, sfunc_p, &insn_p, &opnd_a, 1, 2);
-    if (os)
+    if (codepoint < 0x800)
     {
-        M("failed to allocate code for INIT insn in sfunc %p: %s",
-          sfunc_p, N(os));
-        return os;
+        out[0] = 0xC0 | (uint8_t) (codepoint >> 6);
+        out[1] = 0x80 | (uint8_t) (codepoint & 0x3F);
+        return 2;
     }
-
-    insn_p->opcode = O71O_INIT;
-    insn_p->exc_chain_x = 0;
-    insn_p->opnd_x = opnd_x;
-    opnd_a[0] = dest_vx;
-    opnd_a[1] = cx;
-
-    return O71_OK;
+    if (codepoint < 0x10000)
+    {
+        out[0] = 0xE0 | (uint8_t) (codepoint >> 12);
+        out[1] = 0x80 | (uint8_t) ((codepoint >> 6) & 0x3F);
+        out[2] = 0x80 | (uint8_t) (codepoint & 0x3F);
+        return 3;
+    }
+    out[0] = 0xF0 | (uint8_t) (codepoint >> 18);
+    out[1] = 0x80 | (uint8_t) ((codepoint >> 12) & 0x3F);
+    out[2] = 0x80 | (uint8_t) ((codepoint >> 6) & 0x3F);
+    out[3] = 0x80 | (uint8_t) (codepoint & 0x3F);
+    return 4;
 }
 
-/* o71_sfunc_append_ret *****************************************************/
-O71_API o71_status_t o71_sfunc_append_ret
+/* o71_status_name **********************************************************/
+O71_API char const * o71_status_name
 (
-    o71_world_t * world_p,
-    o71_script_function_t * sfunc_p,
-    uint32_t value_vx
+    o71_status_t status
 )
 {
-    o71_insn_t * insn_p;
-    uint32_t * opnd_p;
-    uint16_t opnd_x;
-    o71_status_t os;
-
-    opnd_x = sfunc_p->opnd_n;
-    os = sfunc_alloc_code(world_p, sfunc_p, &insn_p, &opnd_p, 1, 1);
-    if (os)
+#define X(_x) case _x: return #_x
+    switch (status)
     {
-        M("sfunc=%p: alloc code failed: %s", sfunc_p, N(os));
-        return os;
-    }
-    insn_p->opcode = O71O_RETURN;
-    insn_p->exc_chain_x = 0;
-    insn_p->opnd_x = opnd_x;
-    *opnd_p = value_vx;
+        X(O71_OK);
+        X(O71_PENDING);
+        X(O71_EXC);
 
-    return O71_OK;
-}
+        X(O71_MISSING);
 
-/* o71_sfunc_append_call ****************************************************/
-O71_API o71_status_t o71_sfunc_append_call
-(
-    o71_world_t * world_p,
-    o71_script_function_t * sfunc_p,
-    uint32_t dest_vx,
-    uint32_t func_vx,
-    uint32_t arg_n,
-    uint32_t * * arg_vxap
-)
-{
-    o71_insn_t * insn_p;
-    uint32_t * opnd_a;
-    o71_status_t os;
-    uint16_t opnd_x;
+        X(O71_NO_MEM);
+        X(O71_MEM_LIMIT);
+        X(O71_ARRAY_LIMIT);
 
-    opnd_x = (uint16_t) sfunc_p->opnd_n;
-    if (arg_n + 3 < 3)
-    {
-        M("sfunc=%p: bad arg_n=0x%X", sfunc_p, arg_n);
-        return O71_ARRAY_LIMIT;
-    }
+        X(O71_NOT_MEM_OBJ_REF);
+        X(O71_UNUSED_MEM_OBJ_SLOT);
+        X(O71_MODEL_MISMATCH);
+        X(O71_OBJ_DESTRUCTING);
+        X(O71_BAD_FUNC_REF);
+        X(O71_BAD_OPCODE);
+        X(O71_BAD_OPERAND_INDEX);
+        X(O71_BAD_CONST_INDEX);
+        X(O71_BAD_VAR_INDEX);
+        X(O71_BAD_INSN_INDEX);
+        X(O71_BAD_EXC_HANDLER_INDEX);
+        X(O71_BAD_EXC_CHAIN_INDEX);
+        X(O71_BAD_ARG_COUNT);
+        X(O71_CMP_ERROR);
+        X(O71_BAD_STRING_REF);
+        X(O71_BAD_RO_STRING_REF);
+        X(O71_BAD_INTERN_STRING_REF);
+        X(O71_BAD_CODE_POINT);
+        X(O71_COMPILE_ERROR);
+        X(O71_NO_MATCH);
 
-    os = sfunc_alloc_code(world_p, sfunc_p, &insn_p, &opnd_a, 1, arg_n + 3);
-    if (os) return os;
-    insn_p->opcode = O71O_CALL;
-    insn_p->exc_chain_x = 0;
-    insn_p->opnd_x = opnd_x;
-    opnd_a[0] = dest_vx;
-    opnd_a[1] = func_vx;
-    opnd_a[2] = arg_n;
-    *arg_vxap = opnd_a + 3;
-    return O71_OK;
+        X(O71_MEM_CORRUPTED);
+        X(O71_REF_COUNT_OVERFLOW);
+        X(O71_BUG);
+        X(O71_TODO);
+    default:
+        return "O71_unknown";
+    }
+#undef X
 }
 
-/* o71_sfunc_append_get_method **********************************************/
-O71_API o71_status_t o71_sfunc_append_get_method
+/* o71_allocator_init *******************************************************/
+O71_API o71_allocator_t * o71_allocator_init
 (
-    o71_world_t * world_p,
-    o71_script_function_t * sfunc_p,
-    uint32_t value_vx,
-    uint32_t obj_vx,
-    uint32_t name_istr_vx
+    o71_allocator_t * allocator_p,
+    o71_realloc_f realloc,
+    void * context,
+    size_t mem_limit
 )
 {
-    return sfunc_append_opc_val_obj_name(world_p, sfunc_p, O71O_GET_METHOD,
-                                         value_vx, obj_vx, name_istr_vx);
+    unsigned int i;
+    allocator_p->realloc = realloc;
+    allocator_p->context = context;
+    allocator_p->mem_usage = 0;
+    allocator_p->mem_peak = 0;
+    allocator_p->mem_limit = mem_limit;
+    for (i = 0; i < O71_SLAB_CLASS_N; ++i)
+    {
+        o71_slab_pool_t * pool_p = &allocator_p->slab_pool_a[i];
+        pool_p->partial_p = NULL;
+        pool_p->empty_p = NULL;
+        pool_p->chunk_size = sizeof(void *) + (i + 1) * O71_SLAB_GRAIN;
+        pool_p->chunk_n = (O71_SLAB_SIZE - sizeof(o71_slab_t))
+            / pool_p->chunk_size;
+    }
+#if O71_CHECKED
+    allocator_p->list.next_p = &allocator_p->list;
+    allocator_p->list.prev_p = &allocator_p->list;
+#endif
+    return allocator_p;
 }
 
-/* o71_sfunc_append_get_field ***********************************************/
-O71_API o71_status_t o71_sfunc_append_get_field
+/* o71_allocator_finish *****************************************************/
+O71_API void o71_allocator_finish
 (
-    o71_world_t * world_p,
-    o71_script_function_t * sfunc_p,
-    uint32_t value_vx,
-    uint32_t obj_vx,
-    uint32_t name_istr_vx
+    o71_allocator_t * allocator_p
 )
 {
-    return sfunc_append_opc_val_obj_name(world_p, sfunc_p, O71O_GET_FIELD,
-                                         value_vx, obj_vx, name_istr_vx);
-}
+#if O71_DEBUG
+    o71_alloc_header_t * ah;
+    if (!allocator_p->mem_usage) return;
+    M("leaked mem: %zu bytes", allocator_p->mem_usage);
+    for (ah = allocator_p->list.next_p;
+         ah != &allocator_p->list;
+         ah = ah->next_p)
+    {
+        P("p=%p s=0x%04zX %s():%u %02X %02X %02X %02X\n",
+          ah + 1, ah->size, ah->func, ah->line,
+          ((uint8_t *) (ah + 1))[0],
+          ((uint8_t *) (ah + 1))[1],
+          ((uint8_t *) (ah + 1))[2],
+          ((uint8_t *) (ah + 1))[3]);
+    }
 
-/* o71_sfunc_append_set_field ***********************************************/
-O71_API o71_status_t o71_sfunc_append_set_field
-(
-    o71_world_t * world_p,
-    o71_script_function_t * sfunc_p,
-    uint32_t value_vx,
-    uint32_t obj_vx,
-    uint32_t name_istr_vx
-)
-{
-    return sfunc_append_opc_val_obj_name(world_p, sfunc_p, O71O_SET_FIELD,
-                                         value_vx, obj_vx, name_istr_vx);
+#endif
 }
 
-/* o71_alloc_exc_chain ******************************************************/
-O71_API o71_status_t o71_alloc_exc_chain
+/* o71_world_init ***********************************************************/
+O71_API o71_status_t o71_world_init
 (
     o71_world_t * world_p,
-    o71_script_function_t * sfunc_p,
-    uint32_t * exc_chain_xp,
-    o71_exc_handler_t * * exc_handler_ap,
-    size_t exc_handler_n
+    o71_allocator_t * allocator_p
 )
 {
     o71_status_t os;
-    size_t ecn, ehn;
-    *exc_chain_xp = sfunc_p->exc_chain_n;
-    ecn = sfunc_p->exc_chain_n + 1;
-    if (ecn >= sfunc_p->exc_chain_m)
-    {
-        size_t new_m;
-        new_m = (ecn + 4) & ~3;
-        os = redim(world_p->allocator_p,
-                   (void * *) &sfunc_p->exc_chain_start_xa,
-                   &sfunc_p->exc_chain_m, new_m,
-                   sizeof(sfunc_p->exc_chain_start_xa[0]));
-        if (os) { M("ouch: %s", N(os)); return os; }
-        if (sfunc_p->exc_chain_n == 1)
-        {
-            sfunc_p->exc_chain_start_xa[0] = 0;
-            sfunc_p->exc_chain_start_xa[1] = 0;
-        }
-    }
-
-    ehn = sfunc_p->exc_handler_n + exc_handler_n;
-    if (ehn > sfunc_p->exc_handler_m)
-    {
-        size_t ehm = (ehn + 3) &~3;
-        os = redim(world_p->allocator_p, (void * *) &sfunc_p->exc_handler_a,
-                   &sfunc_p->exc_handler_m, ehm,
-                   sizeof(sfunc_p->exc_handler_a[0]));
-        if (os) { M("ouch: %s", N(os)); return os; }
-    }
+    o71_string_t * str_p;
+    size_t i;
 
-    M("ecsxa[%zu]=%u, ehn=%zu", sfunc_p->exc_chain_n,
-      sfunc_p->exc_chain_start_xa[sfunc_p->exc_chain_n],
-      sfunc_p->exc_handler_n);
-    A(sfunc_p->exc_chain_start_xa[sfunc_p->exc_chain_n]
-      == sfunc_p->exc_handler_n);
+    world_p->allocator_p = allocator_p;
+    world_p->flow_id_seed = 0;
+    world_p->kvbag_version = 0;
+    world_p->cleaning = 0;
+    world_p->free_scan_x = 0;
+    world_p->destroy_list_head_ex = ~0;
+    world_p->destroy_list_tail_xp = &world_p->destroy_list_head_ex;
+    world_p->destroy_budget = SIZE_MAX;
+    world_p->obj_page_pa = NULL;
+    world_p->gc_na = NULL;
+    world_p->gc_na_m = 0;
+    world_p->gc_stack_xa = NULL;
+    world_p->gc_stack_m = 0;
+    world_p->gc_stack_n = 0;
+    world_p->gc_alloc_n = 0;
+    world_p->gc_threshold = 0;
+    world_p->gc_stats.run_n = 0;
+    world_p->gc_stats.obj_n = 0;
+    world_p->gc_stats.byte_n = 0;
+    world_p->obj_page_m = 0;
+    world_p->obj_n = 0;
 
-    *exc_handler_ap = &sfunc_p->exc_handler_a[sfunc_p->exc_handler_n];
-    sfunc_p->exc_handler_n += exc_handler_n;
+    os = extend_object_table(world_p);
+    if (os) return os;
 
-    sfunc_p->exc_chain_n++;
-    sfunc_p->exc_chain_start_xa[sfunc_p->exc_chain_n] = sfunc_p->exc_handler_n;
+    world_p->istr_a = NULL;
+    world_p->istr_m = 0;
+    world_p->istr_n = 0;
+
+    O71_OBJ_SLOT(world_p, O71X_NULL) = &world_p->null_object;
+    O71_OBJ_SLOT(world_p, O71X_OBJECT_CLASS) = &world_p->object_class;
+    O71_OBJ_SLOT(world_p, O71X_NULL_CLASS) = &world_p->null_class;
+    O71_OBJ_SLOT(world_p, O71X_CLASS_CLASS) = &world_p->class_class;
+    O71_OBJ_SLOT(world_p, O71X_STRING_CLASS) = &world_p->string_class;
+    O71_OBJ_SLOT(world_p, O71X_SMALL_INT_CLASS) =
+        &world_p->small_int_class;
+    O71_OBJ_SLOT(world_p, O71X_REG_OBJ_CLASS) = &world_p->reg_obj_class;
+    O71_OBJ_SLOT(world_p, O71X_FUNCTION_CLASS) =
+        &world_p->function_class;
+    O71_OBJ_SLOT(world_p, O71X_SCRIPT_FUNCTION_CLASS) =
+        &world_p->script_function_class;
+    O71_OBJ_SLOT(world_p, O71X_EXCEPTION_CLASS) =
+        &world_p->exception_class;
+    O71_OBJ_SLOT(world_p, O71X_TYPE_EXC_CLASS) = &world_p->type_exc_class;
+    O71_OBJ_SLOT(world_p, O71X_ARITY_EXC_CLASS) =
+        &world_p->arity_exc_class;
+    O71_OBJ_SLOT(world_p, O71X_INT_ADD_FUNC) = &world_p->int_add_func;
+    for (i = 0; i < O71_BUILTIN_STR_N; ++i)
+        O71_OBJ_SLOT(world_p, O71X__STR_FIRST + i) =
+            &world_p->builtin_str_a[i];
 
-    return O71_OK;
-}
+    world_p->null_object.class_r = O71R_NULL_CLASS;
+    world_p->null_object.ref_n = O71_IMMORTAL_REF_N;
 
-/* o71_set_exc_chain ********************************************************/
-O71_API o71_status_t o71_set_exc_chain
-(
-    o71_world_t * world_p,
-    o71_script_function_t * sfunc_p,
-    uint32_t first_insn_x,
-    uint32_t last_insn_x,
-    uint32_t exc_chain_x
-)
-{
-    uint32_t i;
-    M("ix:[%u, %u], ecx=%u", first_insn_x, last_insn_x, exc_chain_x);
-    if (first_insn_x >= sfunc_p->insn_n || last_insn_x >= sfunc_p->insn_n
-        || first_insn_x > last_insn_x)
-        return O71_BAD_INSN_INDEX;
-    if (exc_chain_x >= sfunc_p->exc_chain_n)
-        return O71_BAD_EXC_CHAIN_INDEX;
-    for (i = first_insn_x; i <= last_insn_x; ++i)
-        sfunc_p->insn_a[i].exc_chain_x = exc_chain_x;
-    return O71_OK;
-}
+    world_p->object_class.hdr.class_r = O71R_CLASS_CLASS;
+    world_p->object_class.hdr.ref_n = O71_IMMORTAL_REF_N;
+    world_p->object_class.finish = noop_object_finish;
+    world_p->object_class.get_field = get_missing_field;
+    world_p->object_class.set_field = set_missing_field;
+    world_p->object_class.visit_refs = noop_visit_refs;
+    world_p->object_class.object_size = sizeof(o71_mem_obj_t);
+    world_p->object_class.model = O71MI_MEM_OBJ;
+    world_p->object_class.rank = 1;
+    world_p->object_class.super_ra = NULL;
+    world_p->object_class.super_n = 0;
+    world_p->object_class.dyn_field_ofs = 0;
+    world_p->object_class.fix_field_n = 0;
+    kvbag_init(&world_p->object_class.method_bag,
+               O71_METHOD_ARRAY_LIMIT, O71_BAG_HASH);
 
-/* o71_sfunc_validate *******************************************************/
-O71_API o71_status_t o71_sfunc_validate
-(
-    o71_world_t * world_p,
-    o71_script_function_t * sfunc_p
-)
-{
-    size_t i, j, nv, nvv = 0, nc, opnd_x, last_opnd_x, vx, var_n = 0;
-    uint8_t has_var_list;
+    world_p->null_class.hdr.class_r = O71R_CLASS_CLASS;
+    world_p->null_class.hdr.ref_n = O71_IMMORTAL_REF_N;
+    world_p->null_class.finish = noop_object_finish;
+    world_p->null_class.get_field = get_missing_field;
+    world_p->null_class.set_field = set_missing_field;
+    world_p->null_class.visit_refs = noop_visit_refs;
+    world_p->null_class.object_size = sizeof(o71_mem_obj_t);
+    world_p->null_class.model = O71MI_MEM_OBJ;
+    world_p->null_class.rank = 1;
+    world_p->null_class.super_ra = NULL;
+    world_p->null_class.super_n = 0;
+    world_p->null_class.dyn_field_ofs = 0;
+    world_p->null_class.fix_field_n = 0;
+    kvbag_init(&world_p->null_class.method_bag,
+               O71_METHOD_ARRAY_LIMIT, O71_BAG_HASH);
 
-    /*
-    M("validating sfunc=%p, an=%zu, vn=%zu, in=%zu, on=%zu, cn=%zu",
-      sfunc_p, sfunc_p->arg_n, sfunc_p->var_n, sfunc_p->insn_n, sfunc_p->opnd_n,
-      sfunc_p->const_n);
-      */
-    for (i = 0; i < sfunc_p->arg_n; ++i)
+    world_p->class_class.hdr.class_r = O71R_CLASS_CLASS;
+    world_p->class_class.hdr.ref_n = O71_IMMORTAL_REF_N;
+    world_p->class_class.finish = class_finish;
+    world_p->class_class.get_field = get_missing_field;
+    world_p->class_class.set_field = set_missing_field;
+    world_p->class_class.visit_refs = noop_visit_refs;
+    world_p->class_class.object_size = sizeof(o71_class_t);
+    world_p->class_class.model = O71MI_CLASS;
+    world_p->class_class.rank = 0;
+    world_p->class_class.super_ra = NULL;
+    world_p->class_class.super_n = 0;
+    world_p->class_class.dyn_field_ofs = 0;
+    world_p->class_class.fix_field_n = 0;
+    kvbag_init(&world_p->class_class.method_bag,
+               O71_METHOD_ARRAY_LIMIT, O71_BAG_HASH);
+
+    world_p->string_class.hdr.class_r = O71R_CLASS_CLASS;
+    world_p->string_class.hdr.ref_n = O71_IMMORTAL_REF_N;
+    world_p->string_class.finish = str_finish;
+    world_p->string_class.get_field = get_missing_field;
+    world_p->string_class.set_field = set_missing_field;
+    world_p->string_class.visit_refs = str_visit_refs;
+    world_p->string_class.object_size = sizeof(o71_string_t);
+    world_p->string_class.model = O71MI_STRING;
+    world_p->string_class.rank = 1;
+    world_p->string_class.super_ra = NULL;
+    world_p->string_class.super_n = 0;
+    world_p->string_class.dyn_field_ofs = 0;
+    world_p->string_class.fix_field_n = 0;
+    kvbag_init(&world_p->string_class.method_bag,
+               O71_METHOD_ARRAY_LIMIT, O71_BAG_HASH);
+
+    world_p->small_int_class.hdr.class_r = O71R_CLASS_CLASS;
+    world_p->small_int_class.hdr.ref_n = O71_IMMORTAL_REF_N;
+    world_p->small_int_class.finish = noop_object_finish;
+    world_p->small_int_class.get_field = get_missing_field;
+    world_p->small_int_class.set_field = set_missing_field;
+    world_p->small_int_class.visit_refs = noop_visit_refs;
+    world_p->small_int_class.object_size = 0; // not a memory object
+    world_p->small_int_class.model = O71MI_SMALL_INT;
+    world_p->small_int_class.rank = 1;
+    world_p->small_int_class.super_ra = NULL;
+    world_p->small_int_class.super_n = 0;
+    world_p->small_int_class.dyn_field_ofs = 0;
+    world_p->small_int_class.fix_field_n = 0;
+    kvbag_init(&world_p->small_int_class.method_bag,
+               O71_METHOD_ARRAY_LIMIT, O71_BAG_HASH);
+
+    world_p->reg_obj_class.hdr.class_r = O71R_CLASS_CLASS;
+    world_p->reg_obj_class.hdr.ref_n = O71_IMMORTAL_REF_N;
+    world_p->reg_obj_class.finish = reg_obj_finish;
+    world_p->reg_obj_class.get_field = get_reg_obj_field;
+    world_p->reg_obj_class.set_field = set_reg_obj_field;
+    world_p->reg_obj_class.visit_refs = reg_obj_visit_refs;
+    world_p->reg_obj_class.object_size = sizeof(o71_reg_obj_t);
+    world_p->reg_obj_class.model = O71MI_MEM_OBJ;
+    world_p->reg_obj_class.rank = 1;
+    world_p->reg_obj_class.super_ra = NULL;
+    world_p->reg_obj_class.super_n = 0;
+    world_p->reg_obj_class.dyn_field_ofs =
+        FIELD_OFS(o71_reg_obj_t, dyn_field_bag);
+    world_p->reg_obj_class.fix_field_n = 0;
+    kvbag_init(&world_p->reg_obj_class.method_bag,
+               O71_METHOD_ARRAY_LIMIT, O71_BAG_HASH);
+
+    world_p->function_class.hdr.class_r = O71R_CLASS_CLASS;
+    world_p->function_class.hdr.ref_n = O71_IMMORTAL_REF_N;
+    world_p->function_class.finish = noop_object_finish;
+    world_p->function_class.get_field = get_missing_field;
+    world_p->function_class.set_field = set_missing_field;
+    world_p->function_class.visit_refs = noop_visit_refs;
+    world_p->function_class.object_size = sizeof(o71_function_t);
+    world_p->function_class.model = O71MI_FUNCTION;
+    world_p->function_class.rank = 1;
+    world_p->function_class.super_ra = NULL;
+    world_p->function_class.super_n = 0;
+    world_p->function_class.dyn_field_ofs = 0;
+    world_p->function_class.fix_field_n = 0;
+    kvbag_init(&world_p->function_class.method_bag,
+               O71_METHOD_ARRAY_LIMIT, O71_BAG_HASH);
+
+    world_p->script_function_class.hdr.class_r = O71R_CLASS_CLASS;
+    world_p->script_function_class.hdr.ref_n = O71_IMMORTAL_REF_N;
+    world_p->script_function_class.finish = sfunc_finish;
+    world_p->script_function_class.get_field = get_missing_field;
+    world_p->script_function_class.set_field = set_missing_field;
+    world_p->script_function_class.visit_refs = sfunc_visit_refs;
+    world_p->script_function_class.object_size = sizeof(o71_script_function_t);
+    world_p->script_function_class.model = O71MI_SCRIPT_FUNCTION;
+    world_p->script_function_class.rank = 1;
+    world_p->script_function_class.super_ra = NULL;
+    world_p->script_function_class.super_n = 0;
+    world_p->script_function_class.dyn_field_ofs = 0;
+    world_p->script_function_class.fix_field_n = 0;
+    kvbag_init(&world_p->script_function_class.method_bag,
+               O71_METHOD_ARRAY_LIMIT, O71_BAG_HASH);
+
+    world_p->exception_class.hdr.class_r = O71R_CLASS_CLASS;
+    world_p->exception_class.hdr.ref_n = O71_IMMORTAL_REF_N;
+    world_p->exception_class.finish = exc_finish;
+    world_p->exception_class.get_field = get_reg_obj_field;
+    world_p->exception_class.set_field = set_reg_obj_field;
+    world_p->exception_class.visit_refs = exc_visit_refs;
+    world_p->exception_class.object_size = sizeof(o71_exception_t);
+    world_p->exception_class.model = O71MI_EXCEPTION;
+    world_p->exception_class.rank = 1;
+    world_p->exception_class.super_ra = NULL;
+    world_p->exception_class.super_n = 0;
+    world_p->exception_class.dyn_field_ofs =
+        FIELD_OFS(o71_reg_obj_t, dyn_field_bag);
+    world_p->exception_class.fix_field_n = 0;
+    kvbag_init(&world_p->exception_class.method_bag,
+               O71_METHOD_ARRAY_LIMIT, O71_BAG_HASH);
+
+    world_p->type_exc_class.hdr.class_r = O71R_CLASS_CLASS;
+    world_p->type_exc_class.hdr.ref_n = O71_IMMORTAL_REF_N;
+    world_p->type_exc_class.finish = exc_finish;
+    world_p->type_exc_class.get_field = get_missing_field;
+    world_p->type_exc_class.set_field = set_missing_field;
+    world_p->type_exc_class.visit_refs = exc_visit_refs;
+    world_p->type_exc_class.object_size = sizeof(o71_exception_t);
+    world_p->type_exc_class.model = O71MI_EXCEPTION;
+    world_p->type_exc_class.rank = 1;
+    world_p->type_exc_class.super_ra = NULL;
+    world_p->type_exc_class.super_n = 0;
+    world_p->type_exc_class.dyn_field_ofs = 0;
+    world_p->type_exc_class.fix_field_n = 0;
+    kvbag_init(&world_p->type_exc_class.method_bag,
+               O71_METHOD_ARRAY_LIMIT, O71_BAG_HASH);
+
+    world_p->arity_exc_class.hdr.class_r = O71R_CLASS_CLASS;
+    world_p->arity_exc_class.hdr.ref_n = O71_IMMORTAL_REF_N;
+    world_p->arity_exc_class.finish = exc_finish;
+    world_p->arity_exc_class.get_field = get_missing_field;
+    world_p->arity_exc_class.set_field = set_missing_field;
+    world_p->arity_exc_class.visit_refs = exc_visit_refs;
+    world_p->arity_exc_class.object_size = sizeof(o71_exception_t);
+    world_p->arity_exc_class.model = O71MI_EXCEPTION;
+    world_p->arity_exc_class.rank = 1;
+    world_p->arity_exc_class.super_ra = NULL;
+    world_p->arity_exc_class.super_n = 0;
+    world_p->arity_exc_class.dyn_field_ofs = 0;
+    world_p->arity_exc_class.fix_field_n = 0;
+    kvbag_init(&world_p->arity_exc_class.method_bag,
+               O71_METHOD_ARRAY_LIMIT, O71_BAG_HASH);
+
+    world_p->int_add_func.cls.hdr.class_r = O71R_FUNCTION_CLASS;
+    world_p->int_add_func.cls.hdr.ref_n = O71_IMMORTAL_REF_N;
+    world_p->int_add_func.cls.finish = noop_object_finish;
+    world_p->int_add_func.cls.get_field = get_missing_field;
+    world_p->int_add_func.cls.set_field = set_missing_field;
+    world_p->int_add_func.cls.visit_refs = noop_visit_refs;
+    world_p->int_add_func.cls.object_size = 0; // instances are not created
+    world_p->int_add_func.cls.model = O71MI_FUNCTION;
+    world_p->int_add_func.cls.rank = 1;
+    world_p->int_add_func.cls.super_ra = NULL;
+    world_p->int_add_func.cls.super_n = 0;
+    kvbag_init(&world_p->int_add_func.cls.method_bag,
+               O71_METHOD_ARRAY_LIMIT, O71_BAG_HASH);
+    world_p->int_add_func.call = int_add_call;
+    world_p->int_add_func.run = null_func_run;
+
+    for (i = 0; i < O71_BUILTIN_STR_N; ++i)
     {
-        vx = sfunc_p->arg_xa[i];
-        if (vx >= O71_VAR_LIMIT)
+        str_p = &world_p->builtin_str_a[i];
+        str_p->hdr.class_r = O71R_STRING_CLASS;
+        str_p->hdr.ref_n = O71_IMMORTAL_REF_N;
+        str_p->a = (uint8_t *) builtin_str_a[i].a;
+        str_p->n = builtin_str_a[i].n;
+        str_p->m = 0;
+        str_p->hash = builtin_str_a[i].hash;
+        str_p->mode = O71_SM_INTERN;
+        str_p->slice = 0;
+    }
+
+    flow_init(world_p, &world_p->root_flow);
+
+    do
+    {
+        o71_ref_t super_ra[3];
+
+        /* the builtin strings are known to be distinct: no lookups */
+        os = istr_grow(world_p, O71_BUILTIN_STR_N);
+        if (os) { M("fail: %s", N(os)); break; }
+        for (i = 0; i < O71_BUILTIN_STR_N; ++i)
         {
-            M("sfunc=%p: arg %zu has invalid var index 0x%zu",
-              sfunc_p, i, vx);
-            return O71_BAD_VAR_INDEX;
+            os = istr_add(world_p, O71_MOX_TO_REF(O71X__STR_FIRST + i),
+                          builtin_str_a[i].hash);
+            AOS(os);
         }
-        if (vx >= var_n) var_n = vx + 1;
+
+        os = kvbag_put(world_p, &world_p->small_int_class.method_bag,
+                       O71R_STR_ADD, O71R_INT_ADD_FUNC, ref_cmp, NULL);
+        if (os) { M("fail: %s", N(os)); break; }
+
+        super_ra[0] = O71R_OBJECT_CLASS;
+        os = class_super_extend(world_p, &world_p->null_class, super_ra, 1);
+        if (os) { M("fail: %s", N(os)); break; }
+
+        super_ra[0] = O71R_OBJECT_CLASS;
+        os = class_super_extend(world_p, &world_p->class_class, super_ra, 1);
+        if (os) { M("fail: %s", N(os)); break; }
+
+        super_ra[0] = O71R_OBJECT_CLASS;
+        os = class_super_extend(world_p, &world_p->string_class, super_ra, 1);
+        if (os) { M("fail: %s", N(os)); break; }
+
+        super_ra[0] = O71R_OBJECT_CLASS;
+        os = class_super_extend(world_p, &world_p->small_int_class,
+                                super_ra, 1);
+        if (os) { M("fail: %s", N(os)); break; }
+
+        super_ra[0] = O71R_OBJECT_CLASS;
+        os = class_super_extend(world_p, &world_p->reg_obj_class, super_ra, 1);
+        if (os) { M("fail: %s", N(os)); break; }
+
+        super_ra[0] = O71R_OBJECT_CLASS;
+        super_ra[1] = O71R_CLASS_CLASS;
+        os = class_super_extend(world_p, &world_p->function_class, super_ra, 2);
+        if (os) { M("fail: %s", N(os)); break; }
+
+        /* add function class as superclass of script_function class */
+        super_ra[0] = O71R_OBJECT_CLASS;
+        super_ra[1] = O71R_CLASS_CLASS;
+        super_ra[2] = O71R_FUNCTION_CLASS;
+        os = class_super_extend(world_p, &world_p->script_function_class,
+                                super_ra, 3);
+        if (os) { M("fail: %s", N(os)); break; }
+
+        super_ra[0] = O71R_OBJECT_CLASS;
+        super_ra[1] = O71R_REG_OBJ_CLASS;
+        os = class_super_extend(world_p, &world_p->exception_class,
+                                super_ra, 2);
+        if (os) { M("fail: %s", N(os)); break; }
+
+        os = redim(world_p->allocator_p,
+                   (void * *) &world_p->exception_class.fix_field_ofs_a,
+                   &world_p->exception_class.fix_field_n,
+                   1, sizeof(o71_kv_t));
+        if (os) { M("fail: %s", N(os)); break; }
+        world_p->exception_class.fix_field_ofs_a[0].key_r =
+            O71R_STR_EXE_CTX;
+        world_p->exception_class.fix_field_ofs_a[0].value_r =
+            FIELD_OFS(o71_exception_t, exe_ctx_r);
+
+        super_ra[0] = O71R_OBJECT_CLASS;
+        super_ra[1] = O71R_EXCEPTION_CLASS;
+        os = class_super_extend(world_p, &world_p->type_exc_class, super_ra, 2);
+        if (os) { M("fail: %s", N(os)); break; }
+
+        os = O71_OK;
+        M("hello world %p!", world_p);
     }
+    while (0);
 
-    if (!sfunc_p->insn_n)
+    if (os)
     {
-        M("sfunc=%p: no instructions to execute!", sfunc_p);
-        return O71_BAD_INSN_INDEX;
+        o71_status_t osf = o71_world_finish(world_p);
     }
 
-    if (sfunc_p->insn_a[sfunc_p->insn_n - 1].opcode < O71O__NO_FALL)
+    return os;
+}
+
+/* o71_world_finish *********************************************************/
+O71_API o71_status_t o71_world_finish
+(
+    o71_world_t * world_p
+)
+{
+    o71_status_t os;
+    o71_obj_index_t obj_x, next_obj_x;
+    unsigned int rank;
+    o71_class_t * class_p;
+    o71_obj_index_t finish_head_x, free_head_x;
+    o71_obj_index_t * finish_tail_xp;
+    o71_obj_index_t * free_tail_xp;
+
+    M("finishing world (obj_n=%lu)", world_p->obj_n);
+    /* destroy what o71_deref() left pending */
+    os = o71_cleanup(world_p);
+    if (os) { M("oops: %s", N(os)); return os; }
+    finish_head_x = ~0;
+    finish_tail_xp = &finish_head_x;
+    for (obj_x = 1, rank = 0; obj_x < world_p->obj_n; ++obj_x)
     {
-        M("sfunc=%p: last insn does not guarantee changing the flow "
-          "(last opcode = 0x%02X)!", sfunc_p,
-          sfunc_p->insn_a[sfunc_p->insn_n - 1].opcode);
-        return O71_BAD_OPCODE;
+        o71_mem_obj_t * obj_p;
+        /* skip unused slots */
+        if (IS_FREE_OBJECT_SLOT(O71_OBJ_SLOT(world_p, obj_x))) continue;
+        /* skip items already queued for destruction */
+        //if (MEM_OBJ_PTR(world_p, obj_x)->ref_n < 0) continue;
+        obj_p = MEM_OBJ_PTR(world_p, obj_x);
+        class_p = o71_obj_ptr(world_p, obj_p->class_r);
+        A(class_p);
+        if (class_p->rank > rank) rank = class_p->rank;
+        *finish_tail_xp = ~obj_x;
+        finish_tail_xp = &obj_p->destroy_next_ex;
+        M2("queueing for finish: obref_%lX", (long) O71_MOX_TO_REF(obj_x));
     }
+    *finish_tail_xp = ~0;
+    M("max rank: %u", rank);
+    //os = o71_cleanup(world_p);
+    //AOS(os);
 
-    for (i = 0; i < sfunc_p->insn_n; ++i)
+    free_head_x = ~0;
+    free_tail_xp = &free_head_x;
+    do
     {
-        M("sfunc=%p: insn %zu: opcode=0x%02X, ox=%u", sfunc_p, i,
-          sfunc_p->insn_a[i].opcode, sfunc_p->insn_a[i].opnd_x);
-#define X(_o, _v, _c, _has_vlist) \
-    case _o: nv = _v; nc = _c; has_var_list = _has_vlist; break;
-        switch (sfunc_p->insn_a[i].opcode)
+        finish_tail_xp = &finish_head_x;
+        for (obj_x = ~finish_head_x; obj_x; obj_x = next_obj_x)
         {
-            X(O71O_NOP, 0, 0, 0);
-            X(O71O_INIT, 1, 1, 0);
-            X(O71O_RETURN, 1, 0, 0);
-            X(O71O_CALL, 2, 0, 1);
-            X(O71O_GET_METHOD, 3, 0, 0);
-            X(O71O_GET_FIELD, 3, 0, 0);
-            X(O71O_SET_FIELD, 3, 0, 0);
-        default:
-            M("sfunc=%p: insn %zu: bad opcode 0x%X",
-              sfunc_p, i, sfunc_p->insn_a[i].opcode);
-            return O71_BAD_OPCODE;
-        }
-#undef X
-        opnd_x = sfunc_p->insn_a[i].opnd_x;
-        last_opnd_x = opnd_x + nv + nc + has_var_list - 1;
-        if (last_opnd_x != (uint16_t) last_opnd_x ||
-            last_opnd_x >= sfunc_p->opnd_n)
-        {
-            //M("sfunc=%p: insn %zu: bad operand index 0x%zu", sfunc_p, i, opnd_x);
-            return O71_BAD_OPERAND_INDEX;
-        }
-        if (has_var_list)
-        {
-            nvv = sfunc_p->opnd_a[last_opnd_x];
-            if (last_opnd_x + 1 + nvv <= last_opnd_x)
-                return O71_BAD_OPERAND_INDEX;
-            last_opnd_x += nvv + 1;
-            if (last_opnd_x != (uint16_t) last_opnd_x ||
-                last_opnd_x >= sfunc_p->opnd_n)
-            {
-                M("sfunc=%p: insn %zu: bad operand index %zu",
-                  sfunc_p, i, last_opnd_x);
-                return O71_BAD_OPERAND_INDEX;
-            }
-        }
-        for (j = 0; j < nv; ++j, ++opnd_x)
-        {
-            vx = sfunc_p->opnd_a[opnd_x];
-            if (vx >= O71_VAR_LIMIT)
-            {
-                M("sfunc=%p: operand %zu has invalid var index 0x%zX",
-                  sfunc_p, opnd_x, vx);
-                return O71_BAD_VAR_INDEX;
-            }
-            if (vx >= var_n) var_n = vx + 1;
-        }
-        for (j = 0; j < nc; ++j, ++opnd_x)
-        {
-            if (sfunc_p->opnd_a[opnd_x] >= sfunc_p->const_n)
+            o71_mem_obj_t * obj_p;
+            obj_p = MEM_OBJ_PTR(world_p, obj_x);
+            next_obj_x = ~obj_p->destroy_next_ex;
+            class_p = o71_obj_ptr(world_p, obj_p->class_r);
+            A(class_p);
+            if (class_p->rank == rank)
             {
-                M("sfunc=%p: operand %zu has invalid const index 0x%X "
-                  "(0x%zX limit)",
-                  sfunc_p, opnd_x, sfunc_p->opnd_a[opnd_x], sfunc_p->const_n);
-                return O71_BAD_CONST_INDEX;
+                os = class_p->finish(world_p, O71_MOX_TO_REF(obj_x));
+                M("obref_%lX(class:obref_%lX) finish: %s",
+                   (long) O71_MOX_TO_REF(obj_x), (long) obj_p->class_r, N(os));
+                if (os) break;
+                if (obj_x < O71X__COUNT) continue;
+                *free_tail_xp = ~obj_x;
+                free_tail_xp = &obj_p->destroy_next_ex;
             }
-        }
-        if (has_var_list)
-        {
-            A(nvv == sfunc_p->opnd_a[opnd_x]);
-            ++opnd_x;
-            for (j = 0; j < nvv; ++j, ++opnd_x)
+            else
             {
-                vx = sfunc_p->opnd_a[opnd_x];
-                if (vx >= O71_VAR_LIMIT)
-                {
-                    M("sfunc=%p: operand %zu has invalid var index 0x%zX",
-                      sfunc_p, opnd_x, vx);
-                    return O71_BAD_VAR_INDEX;
-                }
-                if (vx >= var_n) var_n = vx + 1;
+                *finish_tail_xp = ~obj_x;
+                finish_tail_xp = &obj_p->destroy_next_ex;
             }
         }
+        *finish_tail_xp = ~0;
     }
-    sfunc_p->var_n = var_n;
-    sfunc_p->func.cls.object_size = sizeof(o71_script_exe_ctx_t)
-        + sizeof(o71_ref_t) * sfunc_p->var_n;
-    M("computed var count: %zu; object size: %zu",
-      var_n, sfunc_p->func.cls.object_size);
-    sfunc_p->valid = 1;
-    return O71_OK;
-}
+    while (rank--);
+    *free_tail_xp = ~0;
 
-/* o71_superclass_search ****************************************************/
-O71_API ptrdiff_t o71_superclass_search
-(
-    o71_world_t * world_p,
-    o71_ref_t class_r,
-    o71_ref_t superclass_r
-)
-{
-    o71_class_t * class_p;
-    ptrdiff_t a, b, c;
-    class_p = o71_obj_ptr(world_p, class_r);
-    for (a = 0, b = class_p->super_n - 1; a <= b; )
+    for (obj_x = ~free_head_x; obj_x; obj_x = next_obj_x)
     {
-        c = (a + b) >> 1;
-        if (superclass_r == class_p->super_ra[c]) return c;
-        if (superclass_r < class_p->super_ra[c]) b = c - 1;
-        else a = c + 1;
+        o71_mem_obj_t * obj_p;
+        obj_p = MEM_OBJ_PTR(world_p, obj_x);
+        next_obj_x = ~obj_p->destroy_next_ex;
+        class_p = o71_obj_ptr(world_p, obj_p->class_r);
+        A(class_p);
+        os = slab_free(world_p->allocator_p, obj_p, class_p->object_size);
+        AOS(os);
     }
-    return -1;
+
+    for (obj_x = 0; obj_x < world_p->obj_n; obj_x += O71_OBJ_PAGE_SIZE)
+    {
+        size_t n = OBJ_PAGE_ITEM_N;
+        void * * * page_ap = &world_p->obj_page_pa[obj_x >> O71_OBJ_PAGE_BITS];
+        os = redim(world_p->allocator_p, (void * *) page_ap, &n, 0,
+                   sizeof(void *));
+        if (os) { M("oops: %s", N(os)); return os; }
+    }
+    world_p->obj_n = 0;
+    os = redim(world_p->allocator_p,
+               (void * *) &world_p->obj_page_pa, &world_p->obj_page_m, 0,
+               sizeof(void * *));
+    if (os) { M("oops: %s", N(os)); return os; }
+
+    A(world_p->istr_n == 0);
+    os = redim(world_p->allocator_p, (void * *) &world_p->istr_a,
+               &world_p->istr_m, 0, sizeof(o71_istr_slot_t));
+    if (os) { M("oops: %s", N(os)); return os; }
+
+    os = gc_release_scratch(world_p);
+    if (os) { M("oops: %s", N(os)); return os; }
+
+    os = slab_trim(world_p->allocator_p);
+    if (os) { M("oops: %s", N(os)); return os; }
+
+    M("goodbye cruel world %p!", world_p);
+    return O71_OK;
 }
 
-/* o71_reg_obj_create *******************************************************/
-O71_API o71_status_t o71_reg_obj_create
+/* o71_world_trim ***********************************************************/
+O71_API o71_status_t o71_world_trim
 (
-    o71_world_t * world_p,
-    o71_ref_t class_r,
-    o71_ref_t * reg_obj_rp
+    o71_world_t * world_p
 )
 {
+    size_t page_n, m, n, i;
+    uintptr_t * bmp_a;
     o71_status_t os;
-    o71_obj_index_t reg_obj_x;
-    o71_reg_obj_t * reg_obj_p;
-    o71_class_t * class_p;
-    unsigned int i;
 
-    class_p = o71_obj_ptr(world_p, class_r);
-    A(class_p->model & O71M_MEM_OBJ);
-    os = alloc_object(world_p, class_r, &reg_obj_x);
-    if (os)
+    /* page 0 holds the builtin objects and is never released */
+    for (page_n = world_p->obj_n >> O71_OBJ_PAGE_BITS; page_n > 1; --page_n)
     {
-        M("alloc_object failed: %s", N(os));
-        return os;
+        bmp_a = OBJ_PAGE_BMP(world_p, page_n - 1);
+        for (i = 0; i < O71_OBJ_PAGE_BMP_N && bmp_a[i] == UINTPTR_MAX; ++i);
+        if (i < O71_OBJ_PAGE_BMP_N) break;
+        n = OBJ_PAGE_ITEM_N;
+        os = redim(world_p->allocator_p,
+                   (void * *) &world_p->obj_page_pa[page_n - 1], &n, 0,
+                   sizeof(void *));
+        if (os) return os;
     }
-    *reg_obj_rp = O71_MOX_TO_REF(reg_obj_x);
-    reg_obj_p = world_p->obj_pa[reg_obj_x];
-    M("class obref_%lX: dfo=0x%lX", class_r, class_p->dyn_field_ofs);
-    if (class_p->dyn_field_ofs)
+    M("object table: %zu -> %zu pages",
+      world_p->obj_n >> O71_OBJ_PAGE_BITS, page_n);
+    world_p->obj_n = page_n << O71_OBJ_PAGE_BITS;
+    n = world_p->obj_n / BMP_BITS;
+    if (world_p->free_scan_x > n) world_p->free_scan_x = n;
+
+    m = world_p->obj_page_m;
+    if (m > 4 && page_n <= (m >> 2))
     {
-        M("init dyn field bag %p at ofs 0x%lX in dyn obj at obref_%lX",
-          ((uint8_t *) reg_obj_p + class_p->dyn_field_ofs),
-          class_p->dyn_field_ofs, *reg_obj_rp);
-        kvbag_init((o71_kvbag_t *)
-                   ((uint8_t *) reg_obj_p + class_p->dyn_field_ofs), 0x10);
+        os = redim(world_p->allocator_p, (void * *) &world_p->obj_page_pa,
+                   &world_p->obj_page_m, m >> 1, sizeof(void * *));
+        if (os) return os;
     }
 
-    for (i = 0; i < class_p->fix_field_n; ++i)
-        *(o71_ref_t *) ((uint8_t *) reg_obj_p +
-                        O71_REF_TO_SINT(class_p->fix_field_ofs_a[i].value_r))
-            = O71R_NULL;
+    os = gc_release_scratch(world_p);
+    if (os) return os;
 
-    return O71_OK;
+    return slab_trim(world_p->allocator_p);
 }
 
-/* o71_reg_obj_get_field ****************************************************/
-O71_API o71_status_t o71_reg_obj_get_field
+/* o71_gc *******************************************************************/
+O71_API o71_status_t o71_gc
 (
     o71_world_t * world_p,
-    o71_ref_t obj_r,
-    o71_ref_t field_istr_r,
-    o71_ref_t * value_rp
+    o71_gc_stats_t * stats_p
 )
 {
-    o71_kvbag_loc_t loc;
-    o71_kvbag_t * kvbag_p;
+    o71_ref_count_t * na;
     o71_mem_obj_t * obj_p;
     o71_class_t * class_p;
-    intptr_t a, b, c;
+    o71_gc_stats_t st;
+    o71_obj_index_t x;
+    size_t n;
     o71_status_t os;
 
-    A(o71_istr_check(world_p, field_istr_r) == O71_OK);
+    st.run_n = 1;
+    st.obj_n = 0;
+    st.byte_n = 0;
+    if (stats_p) *stats_p = st;
+    /* not a safe point while the destroy chain is being processed */
+    if (world_p->cleaning) return O71_OK;
+    world_p->gc_alloc_n = 0;
 
-    class_p = o71_class(world_p, obj_r);
-    if (!(class_p->model & O71M_MEM_OBJ))
+    n = world_p->obj_n;
+    if (world_p->gc_na_m < n)
     {
-        /* non-memory objects don't have fields */
-        return O71_MISSING;
+        os = redim(world_p->allocator_p, (void * *) &world_p->gc_na,
+                   &world_p->gc_na_m, n, sizeof(o71_ref_count_t));
+        if (os) return os;
+    }
+    if (world_p->gc_stack_m < n)
+    {
+        os = redim(world_p->allocator_p, (void * *) &world_p->gc_stack_xa,
+                   &world_p->gc_stack_m, n, sizeof(o71_obj_index_t));
+        if (os) return os;
     }
+    na = world_p->gc_na;
 
-    obj_p = o71_obj_ptr(world_p, obj_r);
-    a = 0;
-    b = (intptr_t) class_p->fix_field_n - 1;
-    while (a <= b)
+    /* trial counts start from the real ones; builtins, free slots and
+     * objects in the destroy chain do not take part */
+    for (x = 0; x < n; ++x)
     {
-        o71_ref_t key_r;
-        c = (a + b) >> 1;
-        key_r = class_p->fix_field_ofs_a[c].key_r;
-        if (field_istr_r == key_r)
-        {
-            /* found fixed field */
-            *value_rp = *(o71_ref_t *) ((uint8_t *) obj_p +
-                                        class_p->fix_field_ofs_a[c].value_r);
-            return O71_OK;
-        }
-        if (field_istr_r < key_r) b = c - 1;
-        else a = c + 1;
+        if (x < O71X__COUNT || IS_FREE_OBJECT_SLOT(O71_OBJ_SLOT(world_p, x))
+            || (obj_p = MEM_OBJ_PTR(world_p, x))->ref_n <= 0)
+            na[x] = GC_IGNORED;
+        else na[x] = obj_p->ref_n;
     }
-    /* put field in the dynamic bag */
-    if (!class_p->dyn_field_ofs)
+
+    /* subtract the references owned by objects */
+    for (x = O71X__COUNT; x < n; ++x)
     {
-        /* no bag for dynamic fields; return field is missing */
-        return O71_MISSING;
+        if (na[x] == GC_IGNORED) continue;
+        obj_p = MEM_OBJ_PTR(world_p, x);
+        class_p = O71_OBJ_SLOT(world_p, O71_REF_TO_MOX(obj_p->class_r));
+        os = gc_count_visit(world_p, &obj_p->class_r, NULL);
+        if (os) return os;
+        os = class_p->visit_refs(world_p, O71_MOX_TO_REF(x),
+                                 gc_count_visit, NULL);
+        if (os) return os;
     }
 
-    kvbag_p = (o71_kvbag_t *) ((uint8_t *) obj_p + class_p->dyn_field_ofs);
-    M2("obref_%lX dfo=0x%lX", (long) obj_r, (long) class_p->dyn_field_ofs);
-    os = kvbag_search(world_p, kvbag_p, field_istr_r, ref_cmp, NULL, &loc);
-    if (os == O71_OK)
+    /* objects still referenced are held from outside the object graph;
+     * mark everything reachable from them */
+    world_p->gc_stack_n = 0;
+    for (x = O71X__COUNT; x < n; ++x)
     {
-        *value_rp = kvbag_get_loc_value(world_p, kvbag_p, &loc);
-        M2("obref_%lX.obref_%lX -> obref_%lX", obj_r, field_istr_r, *value_rp);
+        if (na[x] <= 0) continue;
+        na[x] = GC_LIVE;
+        world_p->gc_stack_xa[world_p->gc_stack_n++] = x;
+    }
+    while (world_p->gc_stack_n)
+    {
+        x = world_p->gc_stack_xa[--world_p->gc_stack_n];
+        obj_p = MEM_OBJ_PTR(world_p, x);
+        class_p = O71_OBJ_SLOT(world_p, O71_REF_TO_MOX(obj_p->class_r));
+        os = gc_mark_visit(world_p, &obj_p->class_r, NULL);
+        if (os) return os;
+        os = class_p->visit_refs(world_p, O71_MOX_TO_REF(x),
+                                 gc_mark_visit, NULL);
+        if (os) return os;
     }
 
-    return os;
+    /* what is left is garbage; hold it so that clearing the references
+     * between garbage objects does not destroy anything half way */
+    for (x = O71X__COUNT; x < n; ++x)
+    {
+        if (na[x]) continue;
+        obj_p = MEM_OBJ_PTR(world_p, x);
+        class_p = O71_OBJ_SLOT(world_p, O71_REF_TO_MOX(obj_p->class_r));
+        obj_p->ref_n += 1;
+        st.obj_n += 1;
+        st.byte_n += class_p->object_size;
+    }
+    M("gc: %zu objects, %zu bytes unreachable", st.obj_n, st.byte_n);
+    for (x = O71X__COUNT; x < n; ++x)
+    {
+        if (na[x]) continue;
+        obj_p = MEM_OBJ_PTR(world_p, x);
+        class_p = O71_OBJ_SLOT(world_p, O71_REF_TO_MOX(obj_p->class_r));
+        os = class_p->visit_refs(world_p, O71_MOX_TO_REF(x),
+                                 release_ref_visit, NULL);
+        if (os) return os;
+    }
+    for (x = O71X__COUNT; x < n; ++x)
+    {
+        if (na[x]) continue;
+        os = o71_deref(world_p, O71_MOX_TO_REF(x));
+        if (os) return os;
+    }
+
+    world_p->gc_stats.run_n += 1;
+    world_p->gc_stats.obj_n += st.obj_n;
+    world_p->gc_stats.byte_n += st.byte_n;
+    if (stats_p) *stats_p = st;
+    return O71_OK;
 }
 
-/* o71_reg_obj_set_field ****************************************************/
-O71_API o71_status_t o71_reg_obj_set_field
+/* gc_count_visit ***********************************************************/
+static o71_status_t gc_count_visit
 (
     o71_world_t * world_p,
-    o71_ref_t obj_r,
-    o71_ref_t field_istr_r,
-    o71_ref_t value_r
+    o71_ref_t * ref_p,
+    void * ctx
 )
 {
-    o71_mem_obj_t * obj_p;
-    o71_class_t * class_p;
-    intptr_t a, b, c;
-    o71_status_t os;
+    o71_obj_index_t x;
+    if (!O71_IS_REF_TO_MO(*ref_p)) return O71_OK;
+    x = O71_REF_TO_MOX(*ref_p);
+    if (world_p->gc_na[x] == GC_IGNORED) return O71_OK;
+    /* visiting a reference that is not counted is a bug in some
+     * visit_refs(); the object then becomes ignored which keeps it alive */
+    A(world_p->gc_na[x] > 0);
+    world_p->gc_na[x] -= 1;
+    return O71_OK;
+}
 
-    A(o71_istr_check(world_p, field_istr_r) == O71_OK);
+/* gc_mark_visit ************************************************************/
+static o71_status_t gc_mark_visit
+(
+    o71_world_t * world_p,
+    o71_ref_t * ref_p,
+    void * ctx
+)
+{
+    o71_obj_index_t x;
+    if (!O71_IS_REF_TO_MO(*ref_p)) return O71_OK;
+    x = O71_REF_TO_MOX(*ref_p);
+    if (world_p->gc_na[x] < 0) return O71_OK;
+    world_p->gc_na[x] = GC_LIVE;
+    world_p->gc_stack_xa[world_p->gc_stack_n++] = x;
+    return O71_OK;
+}
 
-    class_p = o71_class(world_p, obj_r);
-    if (!(class_p->model & O71M_MEM_OBJ))
-    {
-        /* non-memory objects don't have fields */
-        return O71_MISSING;
-    }
+/* gc_release_scratch *******************************************************/
+static o71_status_t gc_release_scratch
+(
+    o71_world_t * world_p
+)
+{
+    o71_status_t os;
+    os = redim(world_p->allocator_p, (void * *) &world_p->gc_na,
+               &world_p->gc_na_m, 0, sizeof(o71_ref_count_t));
+    if (os) return os;
+    return redim(world_p->allocator_p, (void * *) &world_p->gc_stack_xa,
+                 &world_p->gc_stack_m, 0, sizeof(o71_obj_index_t));
+}
 
-    obj_p = o71_obj_ptr(world_p, obj_r);
-    a = 0;
-    b = (intptr_t) class_p->fix_field_n - 1;
-    while (a <= b)
-    {
-        o71_ref_t key_r;
-        c = (a + b) >> 1;
-        key_r = class_p->fix_field_ofs_a[c].key_r;
-        if (field_istr_r == key_r)
-        {
-            /* found fixed field */
-            o71_ref_t * value_rp;
-            M("storing obref_%lX into fixed field at ofs %lX of obref_%lX",
-              (long) value_r, (long) class_p->fix_field_ofs_a[c].value_r,
-              (long) obj_r);
-            value_rp = (o71_ref_t *) ((uint8_t *) obj_p
-                + (intptr_t) class_p->fix_field_ofs_a[c].value_r);
-            os = set_var(world_p, value_rp, value_r);
-            AOS(os);
-            return O71_OK;
-        }
-        if (field_istr_r < key_r) b = c - 1;
-        else a = c + 1;
-    }
-    /* put field in the dynamic bag */
-    if (!class_p->dyn_field_ofs)
-    {
-        /* no bag for dynamic fields; return field is missing */
-        return O71_MISSING;
-    }
+/* o71_check_mem_obj_ref ****************************************************/
+O71_API o71_status_t o71_check_mem_obj_ref
+(
+    o71_world_t * world_p,
+    o71_ref_t obj_r
+)
+{
+    o71_obj_index_t obj_x;
 
-    M2("obref_%lX dfo=0x%lX", (long) obj_r, (long) class_p->dyn_field_ofs);
-    os = kvbag_put(world_p, (o71_kvbag_t *)
-                   ((uint8_t *) obj_p + class_p->dyn_field_ofs),
-                   field_istr_r, value_r, ref_cmp, NULL);
-    return os;
+    if (!O71_IS_REF_TO_MO(obj_r)) return O71_NOT_MEM_OBJ_REF;
+    obj_x = O71_REF_TO_MOX(obj_r);
+    if (obj_x >= world_p->obj_n) return O71_UNUSED_MEM_OBJ_SLOT;
+    if (IS_FREE_OBJECT_SLOT(O71_OBJ_SLOT(world_p, obj_x)))
+        return O71_UNUSED_MEM_OBJ_SLOT;
+    return O71_OK;
 }
 
-/* o71_istr_check ***********************************************************/
-O71_API o71_status_t o71_istr_check
+/* o71_model ****************************************************************/
+O71_API uint32_t (o71_model)
 (
     o71_world_t * world_p,
     o71_ref_t obj_r
 )
 {
-    uint32_t model;
-    model = o71_model(world_p, obj_r);
-    if ((model & O71M_STRING))
-    {
-        o71_string_t * str_p;
-        str_p = o71_obj_ptr(world_p, obj_r);
-        return str_p->mode == O71_SM_INTERN
-            ? O71_OK : O71_BAD_INTERN_STRING_REF;
-    }
-    if (model == O71M_INVALID) return O71_UNUSED_MEM_OBJ_SLOT;
-    return (model & O71M_MEM_OBJ) ? O71_BAD_STRING_REF : O71_NOT_MEM_OBJ_REF;
+    return o71_model_fast(world_p, obj_r);
 }
 
-/* o71_reg_class_create *****************************************************/
-O71_API o71_status_t o71_reg_class_create
+/* o71_class ****************************************************************/
+O71_API o71_class_t * (o71_class)
 (
     o71_world_t * world_p,
-    o71_ref_t * fix_field_istr_ra,
-    size_t fix_field_n,
-    o71_ref_t * class_rp
+    o71_ref_t obj_r
 )
 {
-    o71_obj_index_t class_x;
-    o71_class_t * class_p;
-    o71_status_t os;
-    size_t i;
-    o71_ref_t super_ra[2] = { O71R_OBJECT_CLASS, O71R_REG_OBJ_CLASS };
-    os = alloc_object(world_p, O71R_CLASS_CLASS, &class_x);
-    if (os) { M("fail: %s", N(os)); return os; }
-    *class_rp = O71_MOX_TO_REF(class_x);
-    class_p = world_p->obj_pa[class_x];
-    class_p->model = O71MI_MEM_OBJ;
-    class_p->super_ra = NULL;
-    class_p->super_n = 0;
-    class_p->fix_field_ofs_a = NULL;
-    class_p->fix_field_n = 0;
-    class_p->finish = noop_object_finish;
-    class_p->get_field = get_reg_obj_field;
-    class_p->set_field = set_reg_obj_field;
-    class_p->object_size = sizeof(o71_reg_obj_t)
-        + sizeof(o71_ref_t) * fix_field_n;
-    class_p->dyn_field_ofs = FIELD_OFS(o71_reg_obj_t, dyn_field_bag);
-    kvbag_init(&class_p->method_bag, 0x10);
-    os = class_super_extend(world_p, class_p, super_ra, ITEM_COUNT(super_ra));
-    if (os)
-    {
-        M("fail: %s", N(os));
-        free_object(world_p, class_x);
-        return os;
-    }
-    os = redim(world_p->allocator_p, (void * *) &class_p->fix_field_ofs_a,
-               &class_p->fix_field_n, fix_field_n, sizeof(o71_kv_t));
-    if (os)
-    {
-        o71_status_t os2;
-        M("fail: %s", N(os));
-        os2 = redim(world_p->allocator_p,
-                    (void * *) &class_p->super_ra, &class_p->super_n,
-                    0, sizeof(o71_ref_t));
-        AOS(os2);
-        free_object(world_p, class_x);
-        return os;
-    }
-    for (i = 0; i < fix_field_n; ++i)
+    return o71_class_fast(world_p, obj_r);
+}
+
+/* o71_ref ******************************************************************/
+O71_API o71_status_t (o71_ref)
+(
+    o71_world_t * world_p,
+    o71_ref_t obj_r
+)
+{
+    o71_mem_obj_t * obj_p;
+    if (!O71_IS_REF_TO_MO(obj_r)) return O71_OK;
+#if O71_CHECKED
     {
-        class_p->fix_field_ofs_a[i].key_r = fix_field_istr_ra[i];
-        class_p->fix_field_ofs_a[i].value_r =
-            FIELD_OFS(o71_reg_obj_t, fix_field_a[i]);
+        o71_status_t os;
+        os = o71_check_mem_obj_ref(world_p, obj_r);
+        if (os) return os;
     }
-    refkv_qsort(class_p->fix_field_ofs_a, class_p->fix_field_n);
+#endif
+    obj_p = MEM_OBJ_PTR(world_p, O71_REF_TO_MOX(obj_r));
+#if O71_CHECKED
+    if (obj_p->ref_n <= 0) return O71_OBJ_DESTRUCTING;
+#endif
+    if (O71_IS_IMMORTAL_REF_N(obj_p->ref_n)) return O71_OK;
+#if O71_CHECKED
+    if (obj_p->ref_n + 1 == O71_IMMORTAL_REF_N) return O71_REF_COUNT_OVERFLOW;
+#endif
+    obj_p->ref_n += 1;
+    M2("obref_%lX.ref -> %lX", (long) obj_r, (long) obj_p->ref_n);
     return O71_OK;
 }
 
-/* o71_compile **************************************************************/
-O71_API o71_status_t o71_compile
+/* o71_make_immortal ********************************************************/
+O71_API o71_status_t o71_make_immortal
 (
     o71_world_t * world_p,
-    o71_code_t * code_p,
-    char const * src_name,
-    uint8_t const * src_a,
-    size_t src_n
+    o71_ref_t obj_r
 )
 {
-    o71_status_t os;
-    o71_token_t * end_token_p;
-
-    code_p->allocator_p = world_p->allocator_p;
-    code_p->src_name = src_name;
-    code_p->src_a = src_a;
-    code_p->src_n = src_n;
-    code_p->token_list = NULL;
-    code_p->token_tail = &code_p->token_list;
-
-    os = tokenize_source(code_p);
-    if (os) return os;
-
-    init_empty_block_stmt(&code_p->body, NULL);
-    os = match_stmt_seq(code_p, &code_p->body, code_p->token_list, &end_token_p,
-                        O71_TT_END);
-    if (os) { M("ouch: %s", N(os)); return os; }
-    A(end_token_p);
-    if (end_token_p->type != O71_TT_END)
+    o71_mem_obj_t * obj_p;
+    if (!O71_IS_REF_TO_MO(obj_r)) return O71_OK;
+#if O71_CHECKED
     {
-        code_p->ce_code = O71_CE_EXP_STMT_OR_EOF;
-        code_p->ce_row = end_token_p->src_row;
-        code_p->ce_col = end_token_p->src_col;
-        code_p->ce_ofs = end_token_p->src_ofs;
-        return O71_COMPILE_ERROR;
+        o71_status_t os;
+        os = o71_check_mem_obj_ref(world_p, obj_r);
+        if (os) return os;
     }
-
-    code_p->ce_ofs = 0;
+#endif
+    obj_p = MEM_OBJ_PTR(world_p, O71_REF_TO_MOX(obj_r));
+#if O71_CHECKED
+    if (obj_p->ref_n <= 0) return O71_OBJ_DESTRUCTING;
+#endif
+    obj_p->ref_n = O71_IMMORTAL_REF_N;
+    M2("obref_%lX.immortal", (long) obj_r);
     return O71_OK;
 }
 
-/* o71_code_free ************************************************************/
-O71_API o71_status_t o71_code_free
+/* o71_deref ****************************************************************/
+O71_API o71_status_t (o71_deref)
 (
-    o71_code_t * code_p
+    o71_world_t * world_p,
+    o71_ref_t obj_r
 )
 {
-    o71_status_t os;
-    size_t i;
-    o71_token_t * t, * n;
-    for (t = code_p->token_list; t; t = n)
+    o71_obj_index_t obj_x;
+    o71_mem_obj_t * obj_p;
+    if (!O71_IS_REF_TO_MO(obj_r)) return O71_OK;
+    obj_x = O71_REF_TO_MOX(obj_r);
+#if O71_CHECKED
     {
-        n = t->next;
-        os = free_token(code_p, t, 0);
-        AOS(os);
+        o71_status_t os;
+        os = o71_check_mem_obj_ref(world_p, obj_r);
+        if (os) return os;
+    }
+#endif
+    obj_p = MEM_OBJ_PTR(world_p, obj_x);
+    /* ignore derefs for immortal objects and objects in the destroy chain */
+    if (O71_IS_IMMORTAL_REF_N(obj_p->ref_n))
+    {
+        M2("obref_%lX.deref -> immortal or in destroy list", (long) obj_r);
+        return O71_OK;
+    }
+    if (obj_p->ref_n > 1)
+    {
+        obj_p->ref_n -= 1;
+        M2("obref_%lX.deref -> %lX", (long) obj_r, (long) obj_p->ref_n);
+        return O71_OK;
+    }
+    A(obj_p->ref_n == 1);
+    A(obj_x != O71X_NULL);
+    /* chain the object to the destroy list */
+    *world_p->destroy_list_tail_xp = ~obj_x;
+    obj_p->destroy_next_ex = ~0;
+    world_p->destroy_list_tail_xp = &obj_p->destroy_next_ex;
+    M2("obref_%lX.deref -> queue for destruction", (long) obj_r);
+    //M("obj_x=%lX", (long) obj_x);
+    {
+        o71_status_t os;
+        size_t done_n;
+        os = cleanup_slice(world_p, world_p->destroy_budget, &done_n);
+        return os == O71_PENDING ? O71_OK : os;
     }
-    return O71_OK;
 }
 
-/* log2_rounded_up **********************************************************/
-static uint8_t log2_rounded_up
+/* o71_cleanup **************************************************************/
+O71_API o71_status_t o71_cleanup
 (
-    uintptr_t n
+    o71_world_t * world_p
 )
 {
-    uint8_t i;
-    /* TODO: change this to lookup tables */
-    for (i = 0; n; ++i, n >>= 1);
-    return i;
+    size_t done_n;
+    return cleanup_slice(world_p, SIZE_MAX, &done_n);
 }
 
-/* redim ********************************************************************/
-static o71_status_t redim_func
+/* o71_cleanup_step *********************************************************/
+O71_API o71_status_t o71_cleanup_step
 (
-    o71_allocator_t * allocator_p,
-    void * * data_pp,
-    size_t * crt_count_p,
-    size_t new_count,
-    size_t item_size
-#if O71_CHECKED
-    , char const * func, unsigned int line
-#endif
+    o71_world_t * world_p,
+    size_t budget
 )
 {
-    size_t old_count, osize, nsize;
+    size_t done_n;
+    return cleanup_slice(world_p, budget, &done_n);
+}
+
+/* cleanup_slice ************************************************************/
+static o71_status_t cleanup_slice
+(
+    o71_world_t * world_p,
+    size_t budget,
+    size_t * done_np
+)
+{
+    o71_mem_obj_t * mo_p;
+    o71_class_t * class_p;
+    o71_ref_t class_r;
     o71_status_t os;
-#define AHF (sizeof(o71_alloc_header_t) + 4)
-#if O71_CHECKED
-    o71_alloc_header_t * ah = *data_pp;
-    o71_alloc_header_t * ahp, * ahn;
-    uint32_t tag;
-    uint8_t * ftag;
-    o71_4u8_t gtag;
-#endif
-    A(item_size);
-    if (new_count > (SIZE_MAX - AHF) / item_size) return O71_ARRAY_LIMIT;
-    old_count = *crt_count_p;
-    if (new_count > old_count
-        && (new_count - old_count) * item_size
-            > allocator_p->mem_limit - allocator_p->mem_usage)
+    o71_obj_index_t obj_x;
+    size_t done_n;
+
+    *done_np = 0;
+    if (world_p->cleaning) return O71_OK;
+    world_p->cleaning = 1;
+    M("cleanup start (budget: %zu)", budget);
+    os = O71_OK;
+    for (done_n = 0; done_n < budget; ++done_n)
     {
-        M("reached mem limit");
-        return O71_MEM_LIMIT;
-    }
-#if O71_CHECKED
-    if (old_count)
-    {
-        --ah;
-        if (ah->allocator_p != allocator_p)
-        {
-            M("bad allocator: %p instead of %p", ah->allocator_p, allocator_p);
-            return O71_BUG;
-        }
-        if (old_count * item_size != ah->size)
-        {
-            M("bad old size: p=%p (%s():%u), recorded size 0x%zX, specified size: 0x%zX",
-              ah + 1, ah->func, ah->line, ah->size, old_count * item_size);
-            return O71_BUG;
-        }
-        tag = (uint32_t) (uintptr_t) *data_pp ^ 0xA5A5A5A5;
-        if (ah->tag != tag)
-        {
-            M("corrupt block %p from %s():%u", *data_pp, ah->func, ah->line);
-            return O71_BUG;
-        }
-        ftag = (uint8_t *) *data_pp + old_count * item_size;
-        gtag.u8[0] = ftag[0];
-        gtag.u8[1] = ftag[1];
-        gtag.u8[2] = ftag[2];
-        gtag.u8[3] = ftag[3];
-        if (gtag.u32 != tag)
-        {
-            M("corrupt block %p from %s():%u", *data_pp, ah->func, ah->line);
-            return O71_BUG;
-        }
-        if (!new_count)
-        {
-            M("removing allocated block %p (%s():%u) from list before freeing",
-              *data_pp, ah->func, ah->line);
+        obj_x = ~world_p->destroy_list_head_ex;
+        if (!obj_x) break;
+        mo_p = MEM_OBJ_PTR(world_p, obj_x);
+        class_r = mo_p->class_r;
+        M("obref_%lX(class:obref_%lX)",
+           (long) O71_MOX_TO_REF(obj_x), (long) class_r);
+        A(o71_model(world_p, class_r) & O71M_CLASS);
+        class_p = O71_OBJ_SLOT(world_p, O71_REF_TO_MOX(class_r));
+        A(class_p);
+        A(class_p->finish);
+        os = class_p->finish(world_p, O71_MOX_TO_REF(obj_x));
+        M("obref_%lX(class:obref_%lX) finish: %s",
+           (long) O71_MOX_TO_REF(obj_x), (long) class_r, N(os));
+        if (os) break;
 
-            ahn = ah->next_p;
-            ahp = ah->prev_p;
-            ahn->prev_p = ahp;
-            ahp->next_p = ahn;
-        }
-        osize = AHF + old_count * item_size;
-    }
-    else osize = 0;
-    ah = *data_pp; --ah;
-    if (new_count)
-    {
-        nsize = AHF + new_count * item_size;
-        M("reallocating %p (osize=0x%zX, nsize=0x%zX)", *data_pp, old_count * item_size, new_count * item_size);
-        os = allocator_p->realloc((void * *) &ah, osize, nsize,
-                                  allocator_p->context);
-        A(os == O71_OK || os == O71_NO_MEM || os >= O71_FATAL);
-        if (os)
-        {
-            M("realloc failed: %u", os);
-            return os;
-        }
-        *data_pp = (void *) (ah + 1);
-        ah->allocator_p = allocator_p;
-        if (osize)
-        {
-            M("realloc fine, updating links for %p (%s():%u)",
-              *data_pp, ah->func, ah->line);
-            ah->next_p->prev_p = ah;
-            ah->prev_p->next_p = ah;
-        }
-        else
+        /* unlink after finish as it may have chained more objects */
+        world_p->destroy_list_head_ex = mo_p->destroy_next_ex;
+        if (mo_p->destroy_next_ex == ~(o71_obj_index_t) 0)
+            world_p->destroy_list_tail_xp = &world_p->destroy_list_head_ex;
+
+        if (obj_x >= O71X__COUNT)
         {
-            ahp = allocator_p->list.prev_p;
-            ahp->next_p = ah;
-            allocator_p->list.prev_p = ah;
-            ah->prev_p = ahp;
-            ah->next_p = &allocator_p->list;
-        ah->func = func;
-        ah->line = line;
+            os = slab_free(world_p->allocator_p, mo_p, class_p->object_size);
+            if (os)
+            {
+                M("obj mem free failed: %s", N(os));
+                break;
+            }
+            os = free_object_index(world_p, obj_x);
+#if O71_CHECKED
+            if (os)
+            {
+                M("free_object_index(obref_%lX) failed: %s",
+                  (long) O71_MOX_TO_REF(obj_x), N(os));
+                break;
+            }
+#endif
         }
 
-        ah->size = new_count * item_size;
-        tag = (uint32_t) (uintptr_t) *data_pp ^ 0xA5A5A5A5;
-        ah->tag = tag;
-        gtag.u32 = tag;
-        ftag = (uint8_t *) *data_pp + new_count * item_size;
-        ftag[0] = gtag.u8[0];
-        ftag[1] = gtag.u8[1];
-        ftag[2] = gtag.u8[2];
-        ftag[3] = gtag.u8[3];
-    }
-    else
-    {
-        os = allocator_p->realloc((void * *) &ah, osize, 0,
-                                  allocator_p->context);
-        A(os == O71_OK || os == O71_NO_MEM || os >= O71_FATAL);
+        os = o71_deref(world_p, class_r);
         if (os)
         {
-            M("free failed: %u", os);
-            return os;
+            M("deref obj class(obref_%lX): %s", (long) class_r, N(os));
+            break;
         }
-
-    }
-
-#else
-    os = allocator_p->realloc(data_pp, old_count * item_size,
-                              new_count * item_size, allocator_p->context);
-    A(os == O71_OK || os == O71_NO_MEM || os >= O71_FATAL);
-    if (os)
-    {
-        M("realloc failed: %u", os);
-        return os;
     }
-#endif
-
-    /* allocated block must be pointer aligned */
-    //M("p=%p", *data_pp);
-    A(!new_count || ((uintptr_t) *data_pp & (sizeof(uintptr_t) - 1)) == 0);
-    *crt_count_p = new_count;
-    allocator_p->mem_usage += (new_count - old_count) * item_size;
-    if (allocator_p->mem_usage > allocator_p->mem_peak)
-        allocator_p->mem_peak = allocator_p->mem_usage;
-    return O71_OK;
+    *done_np = done_n;
+    world_p->cleaning = 0;
+    M("cleanup done: %zu objects", done_n);
+    if (os) return os;
+    return ~world_p->destroy_list_head_ex ? O71_PENDING : O71_OK;
 }
 
-/* extend_array *************************************************************/
-static o71_status_t extend_array
+/* o71_cstring **************************************************************/
+O71_API o71_status_t o71_cstring
 (
-    o71_allocator_t * allocator_p,
-    void * * extra_ap,
-    void * * data_ap,
-    size_t * crt_alloc_count_p,
-    size_t * crt_used_count_p,
-    size_t extra_count,
-    size_t item_size
+    o71_world_t * world_p,
+    o71_ref_t * str_rp,
+    char const * cstr_a
 )
 {
-    size_t used_n, new_n, new_m;
     o71_status_t os;
+    size_t n;
+    for (n = 0; cstr_a[n]; ++n);
+    os = o71_str_create(world_p, str_rp, n);
+    if (os) return os;
+    os = o71_str_append(world_p, *str_rp, cstr_a, n);
+    A(os == O71_OK); /* the room is already there */
+    return O71_OK;
+}
 
-    used_n = *crt_used_count_p;
-    new_n = extra_count + used_n;
-    if (new_n < used_n || (ptrdiff_t) new_n < 0) return O71_ARRAY_LIMIT;
-
-    if (new_n > *crt_alloc_count_p)
+/* o71_str_create ***********************************************************/
+O71_API o71_status_t o71_str_create
+(
+    o71_world_t * world_p,
+    o71_ref_t * str_rp,
+    size_t reserve_n
+)
+{
+    o71_obj_index_t str_x;
+    o71_status_t os, osf;
+    o71_string_t * str_p;
+    os = alloc_object(world_p, O71R_STRING_CLASS, &str_x);
+    if (os)
     {
-        new_m = 1 << log2_rounded_up(new_n);
-        os = redim(allocator_p, data_ap, crt_alloc_count_p, new_m, item_size);
-        if (os) return os;
+        M("failed to allocate string object: %s", N(os));
+        return os;
     }
-    *extra_ap = ((uint8_t *) *data_ap) + used_n * item_size;
-    *crt_used_count_p += extra_count;
-
+    A(str_x < world_p->obj_n);
+    str_p = O71_OBJ_SLOT(world_p, str_x);
+    str_p->a = str_p->inl.sa;
+    str_p->n = 0;
+    str_p->m = O71_STR_INLINE_SIZE;
+    str_p->hash = 0;
+    str_p->mode = O71_SM_MODIFIABLE;
+    str_p->slice = 0;
+    if (reserve_n > O71_STR_INLINE_SIZE)
+    {
+        str_p->a = NULL;
+        str_p->m = 0;
+        os = redim(world_p->allocator_p, (void * *) &str_p->a, &str_p->m,
+                   reserve_n, 1);
+        if (os)
+        {
+            M("failed to allocate string data: n=%zu os=%s", reserve_n, N(os));
+            osf = free_object(world_p, str_x);
+            if (osf)
+            {
+                M("FATAL: free object index: os=%s", N(osf));
+                return osf;
+            }
+            return os;
+        }
+    }
+    *str_rp = O71_MOX_TO_REF(str_x);
     return O71_OK;
 }
 
-/* flow_init ****************************************************************/
-static void flow_init
+/* o71_str_reserve **********************************************************/
+O71_API o71_status_t o71_str_reserve
 (
     o71_world_t * world_p,
-    o71_flow_t * flow_p
+    o71_ref_t str_r,
+    size_t extra_n
 )
 {
-    flow_p->world_p = world_p;
-    flow_p->exe_ctx_r = O71R_NULL;
-    flow_p->value_r = O71R_NULL;
-    flow_p->exc_r = O71R_NULL;
-    flow_p->depth = 0;
-    flow_p->flow_id = world_p->flow_id_seed++;
+    o71_string_t * str_p;
+    size_t need_n, new_m;
+
+    if (!(o71_model(world_p, str_r) & O71M_STRING)) return O71_BAD_STRING_REF;
+    str_p = o71_obj_ptr(world_p, str_r);
+    if (str_p->mode != O71_SM_MODIFIABLE) return O71_BAD_RO_STRING_REF;
+    need_n = str_p->n + extra_n;
+    if (need_n < extra_n || (ptrdiff_t) need_n < 0) return O71_ARRAY_LIMIT;
+    if (need_n <= str_p->m) return O71_OK;
+    new_m = (size_t) 1 << log2_rounded_up(need_n - 1);
+    if (str_p->a == str_p->inl.sa)
+    {
+        /* move the content out of the object */
+        uint8_t * a = NULL;
+        size_t m = 0, i;
+        o71_status_t os;
+        os = redim(world_p->allocator_p, (void * *) &a, &m, new_m, 1);
+        if (os) return os;
+        for (i = 0; i < str_p->n; ++i) a[i] = str_p->inl.sa[i];
+        str_p->a = a;
+        str_p->m = m;
+        return O71_OK;
+    }
+    return redim(world_p->allocator_p, (void * *) &str_p->a, &str_p->m,
+                 new_m, 1);
 }
 
-/* extend_object_table ******************************************************/
-static o71_status_t extend_object_table
+/* o71_str_append ***********************************************************/
+O71_API o71_status_t o71_str_append
 (
-    o71_world_t * world_p
+    o71_world_t * world_p,
+    o71_ref_t str_r,
+    void const * data,
+    size_t n
 )
 {
-    size_t i, n, m;
+    o71_string_t * str_p;
+    uint8_t const * d = data;
     o71_status_t os;
-    n = world_p->obj_n;
-    if (n > (SIZE_MAX >> 1)) return O71_ARRAY_LIMIT;
-    m = n ? n << 1 : 0x20;
-    os = redim(world_p->allocator_p,
-               (void * *) &world_p->obj_pa, &world_p->obj_n, m, sizeof(void *));
-    if (os)
-    {
-        M("failed extending object table from %zu to %zu items", n, m);
-        return os;
-    }
-    if (!n) n = O71X__COUNT;
-    for (i = n; i < m; ++i)
-        world_p->enc_next_free_xa[i] = ENCODE_FREE_OBJECT_SLOT(i + 1);
-    //world_p->enc_next_free_xa[i] =
-    //    ENCODE_FREE_OBJECT_SLOT(world_p->free_list_head_ex);
-    world_p->free_list_head_ex = n;
+    size_t i;
+
+    os = o71_str_reserve(world_p, str_r, n);
+    if (os) return os;
+    str_p = o71_obj_ptr(world_p, str_r);
+    for (i = 0; i < n; ++i) str_p->a[str_p->n + i] = d[i];
+    str_p->n += n;
     return O71_OK;
 }
 
-/* alloc_object_index *******************************************************/
-static o71_status_t alloc_object_index
+/* o71_str_append_cp ********************************************************/
+O71_API o71_status_t o71_str_append_cp
 (
     o71_world_t * world_p,
-    o71_obj_index_t * obj_xp
+    o71_ref_t str_r,
+    uint32_t cp
 )
 {
-    o71_status_t os;
-    if (world_p->free_list_head_ex >= world_p->obj_n)
-    {
-        //M("free list head index: %lX", world_p->free_list_head_ex);
-        //M("obj num: %lX", world_p->obj_n);
-        A(world_p->free_list_head_ex == world_p->obj_n);
-        os = extend_object_table(world_p);
-        if (os) return os;
-    }
-    A(world_p->free_list_head_ex < world_p->obj_n);
-    *obj_xp = world_p->free_list_head_ex;
-    world_p->free_list_head_ex = DECODE_FREE_OBJECT_SLOT(
-        world_p->enc_next_free_xa[world_p->free_list_head_ex]);
-    M2("allocated=obref_%lX, free_head=obref_%lX, obj_n=%lX",
-       (long) O71_MOX_TO_REF(*obj_xp),
-       (long) O71_MOX_TO_REF(world_p->free_list_head_ex), (long) world_p->obj_n);
+    uint8_t b[4];
 
-    return O71_OK;
+    if (cp >= 0x110000 || (cp >= 0xD800 && cp < 0xE000))
+        return O71_BAD_CODE_POINT;
+    return o71_str_append(world_p, str_r, b, utf8_codepoint_encode(b, cp));
 }
 
-/* free_object_index ********************************************************/
-static o71_status_t free_object_index
+/* o71_str_append_int *******************************************************/
+O71_API o71_status_t o71_str_append_int
 (
     o71_world_t * world_p,
-    o71_obj_index_t obj_x
+    o71_ref_t str_r,
+    intmax_t value
 )
 {
-    A(obj_x < world_p->obj_n);
-    world_p->enc_next_free_xa[obj_x] = ENCODE_FREE_OBJECT_SLOT(
-        world_p->free_list_head_ex);
-    world_p->free_list_head_ex = obj_x;
-    return O71_OK;
+    uint8_t b[sizeof(intmax_t) * 3 + 2];
+    uintmax_t u;
+    size_t i = sizeof(b);
+
+    /* negate in unsigned arithmetic so that INTMAX_MIN works too */
+    u = value < 0 ? -(uintmax_t) value : (uintmax_t) value;
+    do b[--i] = (uint8_t) ('0' + u % 10); while (u /= 10);
+    if (value < 0) b[--i] = '-';
+    return o71_str_append(world_p, str_r, b + i, sizeof(b) - i);
 }
 
-/* alloc_object *************************************************************/
-static o71_status_t alloc_object
+/* o71_rocs *****************************************************************/
+O71_API o71_status_t o71_rocs
 (
     o71_world_t * world_p,
-    o71_ref_t class_r,
-    o71_obj_index_t * obj_xp
+    o71_ref_t * str_rp,
+    char const * cstr_a
 )
 {
-    o71_status_t os;
-    o71_class_t * class_p;
-    size_t obj_size;
-    o71_obj_index_t obj_x;
-
-    A(o71_model(world_p, class_r) & O71M_CLASS);
-
-    os = alloc_object_index(world_p, obj_xp);
+    o71_obj_index_t str_x;
+    o71_status_t os, osf;
+    o71_string_t * str_p;
+    size_t i, n;
+    os = alloc_object(world_p, O71R_STRING_CLASS, &str_x);
     if (os)
     {
-        M("failed to alloc obj index: %s", N(os));
-        return os;
-    }
-    obj_x = *obj_xp;
-    class_p = world_p->obj_pa[O71_REF_TO_MOX(class_r)];
-    obj_size = 0;
-    os = redim(world_p->allocator_p, world_p->obj_pa + obj_x,
-               &obj_size, class_p->object_size, 1);
-    if (os)
-    {
-        M("failed to allocate memory for object instance: %s", N(os));
-        free_object_index(world_p, obj_x);
-        return (os);
-    }
-
-    os = o71_ref(world_p, class_r);
-#if O71_CHECKED
-    if (os)
-    {
-        M("ref(class=obref_%lX): %s", (long) class_r, N(os));
+        M("failed to allocate string object: %s", N(os));
         return os;
     }
-#else
-    (void) os;
-#endif
-
-    world_p->mem_obj_pa[obj_x]->class_r = class_r;
-    world_p->mem_obj_pa[obj_x]->ref_n = 1;
-
+    A(str_x < world_p->obj_n);
+    str_p = O71_OBJ_SLOT(world_p, str_x);
+    str_p->n = str_p->m = 0;
+    str_p->mode = O71_SM_READ_ONLY;
+    str_p->slice = 0;
+    for (n = 0; cstr_a[n]; ++n);
+    str_p->a = (uint8_t *) cstr_a;
+    str_p->n = n;
+    str_p->m = 0;
+    str_p->hash = str_hash(str_p->a, n);
+    *str_rp = O71_MOX_TO_REF(str_x);
+    M("allocated ro string '%s' -> obref_%lX", cstr_a, (long) *str_rp);
     return O71_OK;
 }
 
-/* free_object **************************************************************/
-static o71_status_t free_object
+/* o71_str_freeze ***********************************************************/
+O71_API o71_status_t o71_str_freeze
 (
     o71_world_t * world_p,
-    o71_ref_t obj_x
+    o71_ref_t str_r
 )
 {
-    o71_class_t * class_p;
-    o71_mem_obj_t * obj_p;
-    size_t obj_size;
-    o71_ref_t class_r;
-    o71_status_t os;
-    obj_p = world_p->obj_pa[obj_x];
-    class_r = obj_p->class_r;
-    class_p = world_p->obj_pa[O71_REF_TO_MOX(class_r)];
-    obj_size = class_p->object_size;
-    os = redim(world_p->allocator_p, world_p->obj_pa + obj_x, &obj_size, 0, 1);
-    if (os)
+    o71_string_t * str_p;
+
+    if (!(o71_model(world_p, str_r) & O71M_STRING))
     {
-        M("*** BUG *** error freeing object memory: %s", N(os));
-        return os;
+        M("obref_%lX is not a string (model: 0x%X)",
+          (long) str_r, o71_model(world_p, str_r));
+        return O71_BAD_STRING_REF;
     }
-    os = free_object_index(world_p, obj_x);
-#if O71_CHECKED
-    if (os)
+    /* the buffer stays in place: no copy, no shrinking */
+    str_p = o71_obj_ptr(world_p, str_r);
+    if (str_p->mode == O71_SM_MODIFIABLE)
     {
-        M("free_object_index(obref_%lX) failed: %s",
-          (long) O71_MOX_TO_REF(obj_x), N(os));
-        return os;
+        str_p->hash = str_hash(str_p->a, str_p->n);
+        str_p->mode = O71_SM_READ_ONLY;
     }
-#endif
-    os = o71_deref(world_p, class_r);
-    AOS(os);
-    return O71_OK;
+    else if (str_p->slice && STR_SLICE_IS_SMALL(world_p, str_p))
+        return str_unslice(world_p, str_p);
+    return 0;
 }
 
-/* noop_object_finish *******************************************************/
-o71_status_t noop_object_finish
+/* o71_str_slice ************************************************************/
+O71_API o71_status_t o71_str_slice
 (
     o71_world_t * world_p,
-    o71_ref_t obj_r
+    o71_ref_t str_r,
+    size_t start,
+    size_t n,
+    o71_ref_t * slice_rp
 )
 {
-    M2("finished obref_%lX", (long) obj_r);
+    o71_obj_index_t slice_x;
+    o71_string_t * str_p;
+    o71_string_t * slice_p;
+    o71_ref_t parent_r;
+    o71_status_t os;
+    size_t i;
+
+    if (!(o71_model(world_p, str_r) & O71M_STRING)) return O71_BAD_STRING_REF;
+    str_p = o71_obj_ptr(world_p, str_r);
+    if (str_p->mode == O71_SM_MODIFIABLE) return O71_BAD_RO_STRING_REF;
+    if (start > str_p->n || n > str_p->n - start) return O71_ARRAY_LIMIT;
+    /* slices of slices point straight to the string owning the buffer */
+    parent_r = str_p->slice ? str_p->inl.parent_r : str_r;
+
+    os = alloc_object(world_p, O71R_STRING_CLASS, &slice_x);
+    if (os)
+    {
+        M("failed to allocate string object: %s", N(os));
+        return os;
+    }
+    A(slice_x < world_p->obj_n);
+    slice_p = O71_OBJ_SLOT(world_p, slice_x);
+    slice_p->n = n;
+    slice_p->mode = O71_SM_READ_ONLY;
+    if (n <= O71_STR_INLINE_SIZE)
+    {
+        /* holding on to the parent costs more than copying */
+        for (i = 0; i < n; ++i) slice_p->inl.sa[i] = str_p->a[start + i];
+        slice_p->a = slice_p->inl.sa;
+        slice_p->m = O71_STR_INLINE_SIZE;
+        slice_p->slice = 0;
+    }
+    else
+    {
+        os = o71_ref(world_p, parent_r);
+        AOS(os);
+        slice_p->a = str_p->a + start;
+        slice_p->m = 0;
+        slice_p->slice = 1;
+        slice_p->inl.parent_r = parent_r;
+    }
+    slice_p->hash = str_hash(slice_p->a, n);
+    *slice_rp = O71_MOX_TO_REF(slice_x);
     return O71_OK;
 }
 
-/* class_finish *************************************************************/
-o71_status_t class_finish
+/* o71_str_intern ***********************************************************/
+O71_API o71_status_t o71_str_intern
 (
     o71_world_t * world_p,
-    o71_ref_t class_r
+    o71_ref_t str_r,
+    o71_ref_t * intern_str_rp
 )
 {
+    o71_string_t * str_p;
+    o71_ref_t istr_r;
     o71_status_t os;
-    o71_class_t * class_p;
-    size_t i;
-
-    M("class finish");
-    /* get class object */
-    class_p = world_p->obj_pa[O71_REF_TO_MOX(class_r)];
+    uint32_t hash;
+    M2("str_intern(obref_%lX)", (long) str_r);
+    str_p = o71_obj_ptr(world_p, str_r);
 
-    /* deref all superclasses */
-    for (i = 0; i < class_p->super_n; ++i)
+    if (!(o71_model(world_p, str_r) & O71M_STRING))
     {
-        os = o71_deref(world_p, class_p->super_ra[i]);
-        AOS(os);
+        M2("obref_%lX is not a string (model: 0x%X)",
+           (long) str_r, o71_model(world_p, str_r));
+        return O71_BAD_STRING_REF;
     }
-    /* free superclasses array */
-    FREE_ARRAY(world_p->allocator_p, class_p->super_ra, class_p->super_n);
-
-    /* deref all fixed fields */
-    for (i = 0; i < class_p->fix_field_n; ++i)
+    str_p = o71_obj_ptr(world_p, str_r);
+    if (str_p->mode == O71_SM_INTERN)
     {
-        os = o71_deref(world_p, class_p->fix_field_ofs_a[i].key_r);
-        AOS(os);
+        *intern_str_rp = str_r;
+        return o71_ref(world_p, str_r);
     }
-    /* free fixed fields array */
-    FREE_ARRAY(world_p->allocator_p, class_p->fix_field_ofs_a, class_p->fix_field_n);
 
-    /* free method bag */
-    os = kvbag_free(world_p, &class_p->method_bag, deref_key_and_value);
-    AOS(os);
+    hash = str_p->mode == O71_SM_MODIFIABLE
+        ? str_hash(str_p->a, str_p->n) : str_p->hash;
+    istr_r = istr_lookup(world_p, str_p->a, str_p->n, hash);
+    if (istr_r != O71R_NULL)
+    {
+        *intern_str_rp = istr_r;
+        return o71_ref(world_p, istr_r);
+    }
+    /* no matching intern string already present; the string itself
+     * becomes the intern one */
+    if (str_p->mode == O71_SM_MODIFIABLE)
+    {
+        str_p->hash = hash;
+        str_p->mode = O71_SM_READ_ONLY;
+    }
+    else if (str_p->slice && STR_SLICE_IS_SMALL(world_p, str_p))
+    {
+        /* intern strings live forever; do not pin a large parent */
+        os = str_unslice(world_p, str_p);
+        if (os) return os;
+    }
+    A(str_p->mode == O71_SM_READ_ONLY);
+    os = istr_add(world_p, str_r, hash);
+    if (os)
+    {
+        M("failed to insert string in intern table: %s", N(os));
+        return os;
+    }
+    str_p->mode = O71_SM_INTERN;
+    str_p->hdr.ref_n = O71_IMMORTAL_REF_N;
+    *intern_str_rp = str_r;
 
-    return os;
+    return O71_OK;
 }
 
-/* alloc_exc ****************************************************************/
-static o71_status_t alloc_exc
+/* o71_ics ******************************************************************/
+O71_API o71_status_t o71_ics
 (
     o71_world_t * world_p,
-    o71_ref_t class_r,
-    o71_obj_index_t * obj_xp
+    o71_ref_t * str_rp,
+    char const * cstr_a
 )
 {
-    o71_class_t * class_p;
-    o71_exception_t * exc_p;
-    o71_status_t os;
+    o71_status_t os, dos;
+    o71_ref_t rostr_r;
 
-    class_p = o71_obj_ptr(world_p, class_r);
-    (void) class_p;
-    A((class_p->model & O71M_EXCEPTION));
-    os = alloc_object(world_p, class_r, obj_xp);
+    M("ics('%s')", cstr_a);
+    os = o71_rocs(world_p, &rostr_r, cstr_a);
     if (os) return os;
-    exc_p = world_p->obj_pa[*obj_xp];
-    kvbag_init(&exc_p->dyn_field_bag, 0x10);
-    exc_p->exe_ctx_r = O71R_NULL;
 
-    return O71_OK;
+    os = o71_str_intern(world_p, rostr_r, str_rp);
+    M("str(obref_%lX)=rocs('%s') -> is(obref_%lX): %s",
+      (long) rostr_r, cstr_a, (long) *str_rp, N(os));
+    dos = o71_deref(world_p, rostr_r);
+#if O71_CHECKED
+    if (dos) return dos;
+#else
+    (void) dos;
+#endif
+
+    return os;
 }
 
-/* get_missing_field ********************************************************/
-static o71_status_t get_missing_field
+/* o71_ics_many *************************************************************/
+O71_API o71_status_t o71_ics_many
 (
-    o71_flow_t * flow_p,
-    o71_ref_t obj_r,
-    o71_ref_t field_r,
-    o71_ref_t * value_p
+    o71_world_t * world_p,
+    char const * const * cstr_a,
+    size_t n,
+    o71_ref_t * str_ra
 )
 {
-    return O71_MISSING;
+    o71_obj_index_t str_x;
+    o71_string_t * str_p;
+    o71_ref_t str_r;
+    o71_status_t os, osf;
+    uint8_t const * a;
+    uint32_t hash;
+    size_t i, len;
+
+    M("ics_many(n=%zu)", n);
+    /* one resize for the whole batch; lookups see the names added by
+     * earlier entries so duplicates within the batch share one string */
+    if (n > SIZE_MAX - world_p->istr_n) return O71_ARRAY_LIMIT;
+    os = istr_grow(world_p, world_p->istr_n + n);
+    if (os) return os;
+    for (i = 0; i < n; ++i)
+    {
+        a = (uint8_t const *) cstr_a[i];
+        for (len = 0; a[len]; ++len);
+        hash = str_hash(a, len);
+        str_r = istr_lookup(world_p, a, len, hash);
+        if (str_r == O71R_NULL)
+        {
+            os = alloc_object(world_p, O71R_STRING_CLASS, &str_x);
+            if (os)
+            {
+                M("failed to allocate string object: %s", N(os));
+                return os;
+            }
+            str_p = O71_OBJ_SLOT(world_p, str_x);
+            str_p->a = (uint8_t *) a;
+            str_p->n = len;
+            str_p->m = 0;
+            str_p->hash = hash;
+            str_p->mode = O71_SM_INTERN;
+            str_p->slice = 0;
+            str_r = O71_MOX_TO_REF(str_x);
+            os = istr_add(world_p, str_r, hash);
+            if (os)
+            {
+                osf = free_object(world_p, str_x);
+                if (osf)
+                {
+                    M("FATAL: free object index: os=%s", N(osf));
+                    return osf;
+                }
+                return os;
+            }
+            str_p->hdr.ref_n = O71_IMMORTAL_REF_N;
+        }
+        str_ra[i] = str_r;
+    }
+    return O71_OK;
 }
 
-/* set_missing_field ********************************************************/
-static o71_status_t set_missing_field
+/* o71_str_cmp **************************************************************/
+O71_API o71_status_t o71_str_cmp
 (
-    o71_flow_t * flow_p,
-    o71_ref_t obj_r,
-    o71_ref_t field_r,
-    o71_ref_t value
+    o71_world_t * world_p,
+    o71_ref_t a_r,
+    o71_ref_t b_r
 )
 {
-    return O71_TODO;
+    o71_string_t * a_p;
+    o71_string_t * b_p;
+    size_t n, i;
+
+    if (!(o71_model(world_p, a_r) & o71_model(world_p, b_r) & O71M_STRING))
+        return O71_BAD_STRING_REF;
+    if (a_r == b_r) return O71_EQUAL;
+    a_p = o71_obj_ptr(world_p, a_r);
+    b_p = o71_obj_ptr(world_p, b_r);
+    n = a_p->n < b_p->n ? a_p->n : b_p->n;
+    i = bytes_mismatch(a_p->a, b_p->a, n);
+    if (i < n) return a_p->a[i] > b_p->a[i] ? O71_MORE : O71_LESS;
+    if (a_p->n == b_p->n) return O71_EQUAL;
+    return a_p->n > b_p->n ? O71_MORE : O71_LESS;
 }
 
-/* null_func_run ************************************************************/
-static o71_status_t null_func_run
+/* o71_str_eq ***************************************************************/
+O71_API int o71_str_eq
 (
-    o71_flow_t * flow_p
+    o71_world_t * world_p,
+    o71_ref_t a_r,
+    o71_ref_t b_r
 )
 {
-    flow_p->value_r = O71R_NULL;
-    return O71_OK;
+    o71_string_t * a_p;
+    o71_string_t * b_p;
+
+    if (!(o71_model(world_p, a_r) & o71_model(world_p, b_r) & O71M_STRING))
+        return 0;
+    if (a_r == b_r) return 1;
+    a_p = o71_obj_ptr(world_p, a_r);
+    b_p = o71_obj_ptr(world_p, b_r);
+    if (a_p->mode == O71_SM_INTERN && b_p->mode == O71_SM_INTERN) return 0;
+    if (a_p->n != b_p->n) return 0;
+    if (a_p->mode != O71_SM_MODIFIABLE && b_p->mode != O71_SM_MODIFIABLE
+        && a_p->hash != b_p->hash)
+        return 0;
+    return bytes_eq(a_p->a, b_p->a, a_p->n);
 }
 
-/* int_add_call *************************************************************/
-static o71_status_t int_add_call
+/* o71_prep_call *****************************************************************/
+O71_API o71_status_t o71_prep_call
 (
     o71_flow_t * flow_p,
     o71_ref_t func_r,
@@ -3286,2827 +3779,8191 @@ static o71_status_t int_add_call
     size_t arg_n
 )
 {
-    o71_obj_index_t exc_ox;
     o71_status_t os;
-    if (arg_n != 2)
-    {
-        // throw arity exception
-        os = alloc_exc(flow_p->world_p, O71R_ARITY_EXC_CLASS, &exc_ox);
-        if (os) return os;
-        flow_p->exc_r = O71_MOX_TO_REF(exc_ox);
-        flow_p->value_r = O71R_NULL;
-        return O71_EXC;
-    }
-    if (O71_IS_REF_TO_SINT(arg_ra[0]) && O71_IS_REF_TO_SINT(arg_ra[1]))
+    o71_world_t * world_p = flow_p->world_p;
+    o71_function_t * func_p;
+
+    if (!(o71_model(flow_p->world_p, func_r) & O71M_FUNCTION))
     {
-        // TODO: handle overflow by generating a big_int
-        flow_p->value_r = (arg_ra[0] - 1 + arg_ra[1]);
-        return O71_OK;
+        /* TODO: prepare exception */
+        return O71_BAD_FUNC_REF;
     }
-    os = alloc_exc(flow_p->world_p, O71R_TYPE_EXC_CLASS, &exc_ox);
-    if (os) return os;
-    flow_p->exc_r = O71_MOX_TO_REF(exc_ox);
-    return O71_EXC;
-    // // TODO: handle int + big_int or big_int + int
-    // flow_p->value_r = O71R_NULL;
-    // return O71_OK;
+    func_p = O71_OBJ_SLOT(world_p, O71_REF_TO_MOX(func_r));
+    os = func_p->call(flow_p, func_r, arg_ra, arg_n);
+    return os;
 }
 
-/* sfunc_call ***************************************************************/
-static o71_status_t sfunc_call
+/* o71_run ******************************************************************/
+O71_API o71_status_t o71_run
 (
     o71_flow_t * flow_p,
-    o71_ref_t func_r,
-    o71_ref_t * arg_ra,
-    size_t arg_n
+    unsigned int min_depth,
+    uint32_t steps
 )
 {
-    o71_world_t * world_p = flow_p->world_p;
-    o71_script_function_t * sfunc_p;
-    o71_script_exe_ctx_t * sec_p;
+    o71_exe_ctx_t * exe_ctx_p;
+    o71_function_t * func_p;
     o71_status_t os;
-    o71_obj_index_t ec_ox;
-    size_t i;
+    o71_ref_t exe_ctx_r;
 
-    A(o71_model(world_p, func_r) & O71M_SCRIPT_FUNCTION);
-    sfunc_p = o71_obj_ptr(world_p, func_r);
-    if (!sfunc_p->valid)
+    A(steps <= O71_STEPS_MAX);
+    flow_p->crt_steps = 0;
+    flow_p->max_steps = steps;
+    while (flow_p->depth > min_depth)
     {
-        os = o71_sfunc_validate(world_p, sfunc_p);
-        if (os)
+        /*
+        if (flow_p->exc_r != O71R_NULL)
         {
-            M("sfunc_%lX=%p: failed to prepare call due to invalid code: %s",
-              (long) func_r, sfunc_p, N(os));
+            M("TODO: call run in exc handling mode");
+            return O71_TODO;
+        }
+        */
+
+        if (flow_p->crt_steps >= flow_p->max_steps)
+        {
+            M("reached max steps: crt=%u, max=%u",
+              flow_p->crt_steps, flow_p->max_steps);
+            return O71_PENDING;
+        }
+
+        if (~flow_p->world_p->destroy_list_head_ex)
+        {
+            /* spend part of the step budget on pending destruction */
+            size_t done_n;
+            os = cleanup_slice(flow_p->world_p,
+                               flow_p->max_steps - flow_p->crt_steps, &done_n);
+            if (os && os != O71_PENDING) return os;
+            flow_p->crt_steps += done_n;
+        }
+        if (flow_p->world_p->gc_threshold
+            && flow_p->world_p->gc_alloc_n >= flow_p->world_p->gc_threshold)
+        {
+            os = o71_gc(flow_p->world_p, NULL);
+            if (os) return os;
+        }
+
+        exe_ctx_r = flow_p->exe_ctx_r;
+        exe_ctx_p = o71_obj_ptr(flow_p->world_p, exe_ctx_r);
+        func_p = o71_obj_ptr(flow_p->world_p, exe_ctx_p->hdr.class_r);
+        os = func_p->run(flow_p);
+        M("flow=%p, func=%p => run -> %s", flow_p, func_p, N(os));
+        A(exe_ctx_r == flow_p->exe_ctx_r);
+        switch (os)
+        {
+        case O71_EXC:
+            A(flow_p->exc_r != O71R_NULL);
+            /* fall through - unwind the stack as for ok */
+        case O71_OK:
+            {
+                //size_t size;
+                flow_p->exe_ctx_r = exe_ctx_p->caller_r;
+                flow_p->depth -= 1;
+                //size = exe_ctx_p->size;
+                //os = redim(flow_p->world_p, (void * *) &exe_ctx_p, &size, 0, 1);
+                os = o71_deref(flow_p->world_p, exe_ctx_r);
+                AOS(os);
+            }
+            break;
+        case O71_PENDING:
+            break;
+        default:
+            M("flow_%u: function returned status %s", flow_p->flow_id, N(os));
             return os;
         }
     }
-    if (arg_n != sfunc_p->arg_n)
+    return flow_p->exc_r == O71R_NULL ? O71_OK : O71_EXC;
+}
+
+/* o71_sfunc_create *********************************************************/
+O71_API o71_status_t o71_sfunc_create
+(
+    o71_world_t * world_p,
+    o71_ref_t * sfunc_rp,
+    uint32_t arg_n
+)
+{
+    o71_status_t os, osf;
+    o71_obj_index_t sfunc_x;
+    o71_script_function_t * sfunc_p;
+    size_t i;
+
+    os = alloc_object(world_p, O71R_SCRIPT_FUNCTION_CLASS, &sfunc_x);
+    if (os)
     {
-        M("sf%lX called with %lu args but needs %lu!",
-          func_r, (long) arg_n, (long) sfunc_p->arg_n);
-        return O71_BAD_ARG_COUNT;
+        M("failed to allocate sfunc object: %s", N(os));
+        return os;
     }
-
-    os = alloc_object(world_p, func_r, &ec_ox);
+    sfunc_p = O71_OBJ_SLOT(world_p, sfunc_x);
+    sfunc_p->func.cls.finish = sec_finish;
+    sfunc_p->func.cls.super_ra = NULL;
+    sfunc_p->func.cls.fix_field_ofs_a = NULL;
+    sfunc_p->func.cls.get_field = get_missing_field;
+    sfunc_p->func.cls.set_field = set_missing_field;
+    sfunc_p->func.cls.visit_refs = sec_visit_refs;
+    kvbag_init(&sfunc_p->func.cls.method_bag,
+               O71_METHOD_ARRAY_LIMIT, O71_BAG_HASH);
+    sfunc_p->func.cls.super_n = 0;
+    sfunc_p->func.cls.object_size = 0; // this will be set by sfunc_validate
+    sfunc_p->func.cls.dyn_field_ofs = 0;
+    sfunc_p->func.cls.fix_field_n = 0;
+    sfunc_p->func.cls.model = O71MI_EXE_CTX;
+    sfunc_p->func.cls.rank = 2;
+    sfunc_p->func.call = sfunc_call;
+    sfunc_p->func.run = sfunc_run;
+    sfunc_p->insn_a = NULL;
+    sfunc_p->opnd_a = NULL;
+    sfunc_p->arg_xa = NULL;
+    sfunc_p->const_ra = NULL;
+    sfunc_p->exc_handler_a = NULL;
+    sfunc_p->exc_chain_start_xa = init_exc_chain_start_xa;
+    sfunc_p->var_n = 0;
+    sfunc_p->arg_n = 0;
+    sfunc_p->insn_n = 0;
+    sfunc_p->insn_m = 0;
+    sfunc_p->opnd_n = 0;
+    sfunc_p->opnd_m = 0;
+    sfunc_p->const_n = 0;
+    sfunc_p->const_m = 0;
+    sfunc_p->exc_handler_n = 0;
+    sfunc_p->exc_handler_m = 0;
+    sfunc_p->exc_chain_n = 1;
+    sfunc_p->exc_chain_m = 0;
+    sfunc_p->valid = 0;
+    os = redim(world_p->allocator_p, (void * *) &sfunc_p->arg_xa,
+               &sfunc_p->arg_n, arg_n, sizeof(uint32_t));
     if (os)
     {
-        M("failed to create exe_ctx for sfunc=obref_%lX: %s",
-          (long) func_r, N(os));
+        M("failed to allocate arg index array: %s", N(os));
+        osf = free_object(world_p, sfunc_x);
+        if (osf)
+        {
+            M("FATAL: free object index: os=%s", N(osf));
+            return osf;
+        }
         return os;
     }
-    sec_p = world_p->obj_pa[ec_ox];
-    sec_p->exe_ctx.caller_r = flow_p->exe_ctx_r;
-    sec_p->ret_value_vx = -1;
-    sec_p->insn_x = 0;
-    for (i = 0; i < sfunc_p->var_n; ++i)
-        sec_p->var_ra[i] = O71R_NULL;
 
-    /* exe context borrows references from arg_ra */
-    for (i = 0; i < sfunc_p->arg_n; ++i)
-        sec_p->var_ra[sfunc_p->arg_xa[i]] = arg_ra[i];
+    for (i = 0; i < arg_n; ++i)
+        sfunc_p->arg_xa[i] = (uint32_t) i;
 
-    flow_p->exe_ctx_r = O71_MOX_TO_REF(ec_ox);
-    flow_p->depth += 1;
+    *sfunc_rp = O71_MOX_TO_REF(sfunc_x);
 
-    return O71_PENDING;
+    return O71_OK;
 }
 
-/* set_var ******************************************************************/
-O71_INLINE o71_status_t set_var
+/* o71_sfunc_append_init ****************************************************/
+O71_API o71_status_t o71_sfunc_append_init
 (
     o71_world_t * world_p,
-    o71_ref_t * dest_rp,
-    o71_ref_t src_r
+    o71_script_function_t * sfunc_p,
+    uint32_t dest_vx,
+    o71_ref_t const_r
 )
 {
+    o71_insn_t * insn_p;
+    uint32_t * opnd_a;
     o71_status_t os;
-    A(o71_model(world_p, *dest_rp) != O71M_INVALID);
-    A(o71_model(world_p, src_r) != O71M_INVALID);
-    os = o71_ref(world_p, src_r);
-#if O71_CHECKED
+    uint32_t cx;
+    uint16_t opnd_x;
+
+    os = sfunc_add_const(world_p, sfunc_p, &cx, const_r);
     if (os)
     {
-        M("failed referencing src=obref_%lX: %s", (long) src_r, N(os));
+        M("failed to add constant for INIT insn for sfunc %p: %s",
+          sfunc_p, N(os));
         return os;
     }
-#endif
-    os = o71_deref(world_p, *dest_rp);
-#if O71_CHECKED
+
+    opnd_x = (uint16_t) sfunc_p->opnd_n;
+    os = sfunc_alloc_code(world_p, sfunc_p, &insn_p, &opnd_a, 1, 2);
     if (os)
     {
-        M("failed dereferencing existing ref in dest=obref_%lX: %s",
-          (long) *dest_rp, N(os));
+        M("failed to allocate code for INIT insn in sfunc %p: %s",
+          sfunc_p, N(os));
         return os;
     }
-#endif
-    *dest_rp = src_r;
-    return os;
+
+    insn_p->opcode = O71O_INIT;
+    insn_p->exc_chain_x = 0;
+    insn_p->opnd_x = opnd_x;
+    opnd_a[0] = dest_vx;
+    opnd_a[1] = cx;
+
+    return O71_OK;
 }
 
-/* sfunc_run ****************************************************************/
-static o71_status_t sfunc_run
+/* o71_sfunc_append_ret *****************************************************/
+O71_API o71_status_t o71_sfunc_append_ret
 (
-    o71_flow_t * flow_p
+    o71_world_t * world_p,
+    o71_script_function_t * sfunc_p,
+    uint32_t value_vx
 )
 {
-    o71_world_t * world_p = flow_p->world_p;
-    o71_script_exe_ctx_t * sec_p;
-    o71_script_function_t * sfunc_p;
-    unsigned int ix, ox, ecx, ehx, ehx_lim;
-    o71_exception_t * exc_p;
+    o71_insn_t * insn_p;
+    uint32_t * opnd_p;
+    uint16_t opnd_x;
     o71_status_t os;
-    o71_ref_t laa[0x40];
-    o71_ref_t * aa;
-    uint32_t ret_value_vx;
 
-    A(flow_p->exe_ctx_r != O71R_NULL);
-    sec_p = o71_obj_ptr(world_p, flow_p->exe_ctx_r);
-    sfunc_p = o71_obj_ptr(world_p, sec_p->exe_ctx.hdr.class_r);
-    ix = (unsigned int) sec_p->insn_x;
-    if (flow_p->exc_r != O71R_NULL) goto l_exc;
-    switch (sec_p->mode)
+    opnd_x = sfunc_p->opnd_n;
+    os = sfunc_alloc_code(world_p, sfunc_p, &insn_p, &opnd_p, 1, 1);
+    if (os)
     {
-    case O71_SECM_STORE_RET_VAL:
-        ret_value_vx = sec_p->ret_value_vx;
-        sec_p->mode = O71_SECM_RUN;
-        goto l_store_ret_val;
-    case O71_SECM_IGNORE_RET_VAL:
-        sec_p->mode = O71_SECM_RUN;
-        os = o71_deref(world_p, flow_p->value_r);
-        AOS(os);
-        ++ix;
-        break;
+        M("sfunc=%p: alloc code failed: %s", sfunc_p, N(os));
+        return os;
     }
+    insn_p->opcode = O71O_RETURN;
+    insn_p->exc_chain_x = 0;
+    insn_p->opnd_x = opnd_x;
+    *opnd_p = value_vx;
 
-    for (;;)
-    {
-        if (sfunc_p->insn_a[ix].opcode >= O71O__CHFLOW)
-        {
-            flow_p->crt_steps += ix - sec_p->insn_x;
-            sec_p->insn_x = ix;
-            if (flow_p->crt_steps >= flow_p->max_steps)
-            {
-                M("reached max steps");
-                return O71_PENDING;
-            }
-        }
-
-        ox = sfunc_p->insn_a[ix].opnd_x;
-        switch (sfunc_p->insn_a[ix].opcode)
-        {
-        case O71O_NOP:
-            M("EXEC %04X: nop", ix);
-            break;
-
-        case O71O_INIT:
-            {
-                uint32_t dvx, cx;
-                dvx = sfunc_p->opnd_a[ox];
-                cx = sfunc_p->opnd_a[ox + 1];
-                M("EXEC %04X: init v%X, c%X=obref_%lX",
-                  ix, dvx, cx, sfunc_p->const_ra[cx]);
-                os = set_var(world_p, &sec_p->var_ra[dvx],
-                             sfunc_p->const_ra[cx]);
-                AOS(os);
-                break;
-            }
-
-        case O71O_GET_METHOD:
-            {
-                uint32_t dest_vx, obj_vx, name_istr_vx;
-                o71_ref_t obj_r, name_istr_r, value_r;
-                o71_class_t * class_p;
-                o71_kvbag_loc_t loc;
-                loc.rbtree.last_x = 0; // grr, to silence maybe-uninitialized
-
-                dest_vx = sfunc_p->opnd_a[ox];
-                obj_vx = sfunc_p->opnd_a[ox + 1];
-                name_istr_vx = sfunc_p->opnd_a[ox + 2];
-                A(name_istr_vx < sfunc_p->var_n);
-                A(obj_vx < sfunc_p->var_n);
-                name_istr_r = sec_p->var_ra[name_istr_vx];
-                M("EXEC %04X: get_method dest:v%X, obj:v%X=obref_%lX, name:v%X=obref_%lX",
-                  ix, dest_vx, obj_vx, sec_p->var_ra[obj_vx], name_istr_vx,
-                  name_istr_r);
-                if (!(o71_model(world_p, name_istr_r) & O71M_STRING))
-                {
-                    M("var_%X points to obref_%lX which is not a string",
-                      name_istr_vx, name_istr_r);
-                    M("TODO: throw exception");
-                    return O71_TODO;
-                }
-                obj_r = sec_p->var_ra[obj_vx];
-                class_p = o71_class(world_p, obj_r);
-                A(class_p);
-                os = kvbag_search(world_p, &class_p->method_bag, name_istr_r,
-                                  ref_cmp, NULL, &loc);
-                if (os)
-                {
-                    A(os == O71_MISSING);
-                    M("class of obref_%lX does not have method name "
-                      "str=obref_%lX", (long) obj_r, (long) name_istr_r);
-                    M("TODO: throw exception");
-                    return O71_TODO;
-                }
-                value_r = kvbag_get_loc_value(world_p, &class_p->method_bag,
-                                              &loc);
-                M("v%X <- method=obref_%lX", dest_vx, value_r);
-                os = set_var(world_p, &sec_p->var_ra[dest_vx], value_r);
-                AOS(os);
-                break;
-            }
-
-        case O71O_RETURN:
-            {
-                uint32_t svx;
-                svx = sfunc_p->opnd_a[ox];
-                /* move the variable in flow's value slot, then erase the
-                 * var so that when we clear the execution context we don't
-                 * decrement the ref count for the returned reference */
-                flow_p->value_r = sec_p->var_ra[svx];
-                sec_p->var_ra[svx] = O71R_NULL;
-                M("EXEC %04X: return v%X=obref_%lX", ix, svx, flow_p->value_r);
-                // fall into clear context
-            }
-        //l_finish_context:
-            {
-                size_t i;
-                for (i = 0; i < sfunc_p->var_n; ++i)
-                {
-                    os = o71_deref(world_p, sec_p->var_ra[i]);
-                    AOS(os);
-                }
-                return O71_OK;
-            }
-
-        case O71O_CALL:
-            {
-                uint32_t fvx, an, i;
-                fvx = sfunc_p->opnd_a[ox + 1];
-                an = sfunc_p->opnd_a[ox + 2];
-                M("EXEC %04X: call dest:v%X, func:v%X=obref_%lX, args:%u",
-                  ix, sfunc_p->opnd_a[ox], fvx, sec_p->var_ra[fvx], an);
-                if (an <= sizeof(laa) / sizeof(laa[0])) aa = &laa[0];
-                else
-                {
-                    M("TODO: alloc arg table");
-                    return O71_TODO;
-                }
-                for (i = 0; i < an; ++i)
-                {
-                    aa[i] = sec_p->var_ra[sfunc_p->opnd_a[ox + 3 + i]];
-                    os = o71_ref(world_p, aa[i]);
-                    M("arg[%u]: v%X=obref_%lX",
-                      i, sfunc_p->opnd_a[ox + 3 + i], aa[i]);
-                    AOS(os);
-                }
-                os = o71_prep_call(flow_p, sec_p->var_ra[fvx], aa, an);
-                switch (os)
-                {
-                case O71_OK:
-                    ret_value_vx = sfunc_p->opnd_a[ox];
-                    break; // fall into l_store_ret_val
-                case O71_PENDING:
-                    sec_p->ret_value_vx = sfunc_p->opnd_a[ox];
-                    sec_p->mode = O71_SECM_STORE_RET_VAL;
-                    return O71_PENDING;
-                case O71_EXC:
-                    // exception thrown; try to handle it
-                    goto l_exc;
-                default:
-                    M("unhandled prep_call status: %s", N(os));
-                    return O71_BUG;
-                }
-            }
-
-        l_store_ret_val:
-            {
-                M("storing return value obref_%lX into v%X",
-                  (long) flow_p->value_r, ret_value_vx);
-                os = o71_deref(world_p, sec_p->var_ra[ret_value_vx]);
-                AOS(os);
-                sec_p->var_ra[ret_value_vx] = flow_p->value_r;
-                break;
-            }
-
-        case O71O_GET_FIELD:
-            {
-                uint32_t vvx, ovx, fvx;
-                o71_class_t * class_p;
-                o71_ref_t obj_r, value_r;
-                vvx = sfunc_p->opnd_a[ox + 0];
-                ovx = sfunc_p->opnd_a[ox + 1];
-                fvx = sfunc_p->opnd_a[ox + 2];
-                M("EXEC %04X: get_field "
-                  "val:v%X=obref_%lX, obj:v%X=obref_%lX, field:v%X=obref_%lX",
-                  ix, vvx, sec_p->var_ra[vvx], ovx, sec_p->var_ra[ovx],
-                  fvx, sec_p->var_ra[fvx]);
-                obj_r = sec_p->var_ra[ovx];
-                class_p = o71_class(world_p, obj_r);
-                os = class_p->get_field(flow_p, obj_r,
-                                        sec_p->var_ra[fvx], &value_r);
-                switch (os)
-                {
-                case O71_OK:
-                    os = o71_deref(world_p, sec_p->var_ra[vvx]);
-                    AOS(os);
-                    sec_p->var_ra[vvx] = value_r;
-                    M("store obref_%lX into v%X", value_r, vvx);
-                    break;
-                case O71_PENDING:
-                    sec_p->mode = O71_SECM_STORE_RET_VAL;
-                    sec_p->ret_value_vx = vvx;
-                    return O71_PENDING;
-                case O71_EXC:
-                    goto l_exc;
-                default:
-                    M("unhandled set_field status: %s", N(os));
-                    return O71_BUG;
-                }
-                break;
-            }
-
-
-        case O71O_SET_FIELD:
-            {
-                uint32_t vvx, ovx, fvx;
-                o71_class_t * class_p;
-                o71_ref_t obj_r;
-                vvx = sfunc_p->opnd_a[ox + 0];
-                ovx = sfunc_p->opnd_a[ox + 1];
-                fvx = sfunc_p->opnd_a[ox + 2];
-                M("EXEC %04X: set_field "
-                  "val:v%X=obref_%lX, obj:v%X=obref_%lX, field:v%X=obref_%lX",
-                  ix, vvx, sec_p->var_ra[vvx], ovx, sec_p->var_ra[ovx],
-                  fvx, sec_p->var_ra[fvx]);
-                obj_r = sec_p->var_ra[ovx];
-                class_p = o71_class(world_p, obj_r);
-                os = class_p->set_field(flow_p, obj_r,
-                                        sec_p->var_ra[fvx], sec_p->var_ra[vvx]);
-                switch (os)
-                {
-                case O71_OK:
-                    break;
-                case O71_PENDING:
-                    sec_p->mode = O71_SECM_IGNORE_RET_VAL;
-                    return O71_PENDING;
-                case O71_EXC:
-                    goto l_exc;
-                default:
-                    M("unhandled set_field status: %s", N(os));
-                    return O71_BUG;
-                }
-                break;
-            }
-
-        default:
-            M("unhandled opcode 0x%X", sfunc_p->insn_a[ix].opcode);
-            return O71_TODO;
-
-        l_exc:
-        /* exception thrown; check to see if there's a handler for it
-         * that covers current instruction */
-            M("got exc=obref_%lX", (long) flow_p->exc_r);
-            A(o71_model(world_p, flow_p->exc_r) & O71M_EXCEPTION);
-            exc_p = o71_obj_ptr(world_p, flow_p->exc_r);
-            ecx = sfunc_p->insn_a[ix].exc_chain_x;
-            M("ix=%u, ecx=%u, ehx=[%u, %u)",
-              ix, ecx, sfunc_p->exc_chain_start_xa[ecx],
-              sfunc_p->exc_chain_start_xa[ecx + 1]);
-            for (ehx = sfunc_p->exc_chain_start_xa[ecx],
-                 ehx_lim = sfunc_p->exc_chain_start_xa[ecx + 1];
-                 ehx < ehx_lim;
-                 ++ehx)
-                if (exc_p->hdr.class_r
-                    == sfunc_p->exc_handler_a[ehx].exc_type_r
-                    || o71_superclass_search(world_p, exc_p->hdr.class_r,
-                                             sfunc_p->exc_handler_a[ehx]
-                                                .exc_type_r) >= 0)
-                    break;
-            if (ehx == ehx_lim)
-            {
-                M("exc not handled. unwinding...");
-                return O71_EXC;
-            }
-            /* store the exception */
-            sec_p->var_ra[sfunc_p->exc_handler_a[ehx].exc_var_x]
-                = flow_p->exc_r;
-            flow_p->exc_r = O71R_NULL;
-            ix = sfunc_p->exc_handler_a[ehx].insn_x;
-            M("found handler %u; jump to ix=0x%X", ehx, ix);
-            continue;
-        }
-        /* move to next instruction */
-        ++ix;
-    }
+    return O71_OK;
 }
 
-/* sfunc_alloc_code *********************************************************/
-static o71_status_t sfunc_alloc_code
+/* o71_sfunc_append_call ****************************************************/
+O71_API o71_status_t o71_sfunc_append_call
 (
     o71_world_t * world_p,
     o71_script_function_t * sfunc_p,
-    o71_insn_t * * insn_ap,
-    uint32_t * * opnd_ap,
-    size_t insn_n,
-    size_t opnd_n
+    uint32_t dest_vx,
+    uint32_t func_vx,
+    uint32_t arg_n,
+    uint32_t * * arg_vxap
 )
 {
+    o71_insn_t * insn_p;
+    uint32_t * opnd_a;
     o71_status_t os;
-    size_t n;
-
-    n = sfunc_p->insn_n + insn_n - 1;
-    if (n != (uint32_t) n)
-    {
-        M("sfunc=%p: too many instructions to be referenced by operands",
-          sfunc_p);
-        return O71_ARRAY_LIMIT;
-    }
+    uint16_t opnd_x;
 
-    n = sfunc_p->opnd_n + opnd_n - 1;
-    if (n != (uint16_t) n)
+    opnd_x = (uint16_t) sfunc_p->opnd_n;
+    if (arg_n + 3 < 3)
     {
-        M("sfunc=%p: too many operands in to be accessible from instructions",
-          sfunc_p);
+        M("sfunc=%p: bad arg_n=0x%X", sfunc_p, arg_n);
         return O71_ARRAY_LIMIT;
     }
 
-    os = extend_array(world_p->allocator_p,
-                      (void * *) insn_ap, (void * *) &sfunc_p->insn_a,
-                      &sfunc_p->insn_m, &sfunc_p->insn_n, insn_n,
-                      sizeof(o71_insn_t));
-    if (os)
-    {
-        M("sfunc=%p: failed extending insn array: %s", sfunc_p, N(os));
-        return os;
-    }
-    M("sfunc=%p; insn: a=%p, n=%zu, m=%zu",
-      sfunc_p, sfunc_p->insn_a, sfunc_p->insn_n, sfunc_p->insn_m);
-
-    os = extend_array(world_p->allocator_p,
-                      (void * *) opnd_ap, (void * *) &sfunc_p->opnd_a,
-                      &sfunc_p->opnd_m, &sfunc_p->opnd_n, opnd_n,
-                      sizeof(uint32_t));
-    if (os)
-    {
-        M("sfunc=%p: failed extending operand array: %s", sfunc_p, N(os));
-        sfunc_p->insn_n -= insn_n;
-        return os;
-    }
-    M("sfunc=%p; opnd: a=%p, n=%zu, m=%zu",
-      sfunc_p, sfunc_p->opnd_a, sfunc_p->opnd_n, sfunc_p->opnd_m);
-    sfunc_p->valid = 0;
+    os = sfunc_alloc_code(world_p, sfunc_p, &insn_p, &opnd_a, 1, arg_n + 3);
+    if (os) return os;
+    insn_p->opcode = O71O_CALL;
+    insn_p->exc_chain_x = 0;
+    insn_p->opnd_x = opnd_x;
+    opnd_a[0] = dest_vx;
+    opnd_a[1] = func_vx;
+    opnd_a[2] = arg_n;
+    *arg_vxap = opnd_a + 3;
     return O71_OK;
 }
 
-/* sfunc_add_const **********************************************************/
-static o71_status_t sfunc_add_const
+/* o71_sfunc_append_get_method **********************************************/
+O71_API o71_status_t o71_sfunc_append_get_method
 (
     o71_world_t * world_p,
     o71_script_function_t * sfunc_p,
-    uint32_t * const_xp,
-    o71_ref_t obj_r
+    uint32_t value_vx,
+    uint32_t obj_vx,
+    uint32_t name_istr_vx
 )
 {
-    size_t i;
-    o71_ref_t * const_rp;
-    o71_status_t os;
-
-    for (i = 0; i < sfunc_p->const_n; ++i)
-        if (sfunc_p->const_ra[i] == obj_r)
-        {
-            *const_xp = i;
-            return O71_OK;
-        }
-
-    *const_xp = sfunc_p->const_n;
-    os = extend_array(world_p->allocator_p, (void * *) &const_rp,
-                      (void * *) &sfunc_p->const_ra,
-                      &sfunc_p->const_m, &sfunc_p->const_n, 1,
-                      sizeof(o71_ref_t));
-    if (os) return os;
-    *const_rp = obj_r;
-    os = o71_ref(world_p, obj_r);
-    return os;
+    return sfunc_append_opc_val_obj_name(world_p, sfunc_p, O71O_GET_METHOD,
+                                         value_vx, obj_vx, name_istr_vx);
 }
 
-/* sfunc_append_opc_val_obj_name ********************************************/
-static o71_status_t sfunc_append_opc_val_obj_name
+/* o71_sfunc_append_get_field ***********************************************/
+O71_API o71_status_t o71_sfunc_append_get_field
 (
     o71_world_t * world_p,
     o71_script_function_t * sfunc_p,
-    uint8_t opcode,
     uint32_t value_vx,
     uint32_t obj_vx,
     uint32_t name_istr_vx
 )
 {
-    o71_insn_t * insn_p;
-    uint32_t * opnd_a;
-    uint16_t opnd_x;
-    o71_status_t os;
-
-    opnd_x = sfunc_p->opnd_n;
-    os = sfunc_alloc_code(world_p, sfunc_p, &insn_p, &opnd_a, 1, 3);
-    if (os)
-    {
-        M("sfunc=%p: alloc code failed: %s", sfunc_p, N(os));
-        return os;
-    }
-    insn_p->opcode = opcode;
-    insn_p->exc_chain_x = 0;
-    insn_p->opnd_x = opnd_x;
-    opnd_a[0] = value_vx;
-    opnd_a[1] = obj_vx;
-    opnd_a[2] = name_istr_vx;
-    return O71_OK;
+    return sfunc_append_opc_val_obj_name(world_p, sfunc_p, O71O_GET_FIELD,
+                                         value_vx, obj_vx, name_istr_vx);
 }
 
-/* ref_cmp ******************************************************************/
-static o71_status_t ref_cmp
+/* o71_sfunc_append_set_field ***********************************************/
+O71_API o71_status_t o71_sfunc_append_set_field
 (
     o71_world_t * world_p,
-    o71_ref_t a_r,
-    o71_ref_t b_r,
-    void * ctx
+    o71_script_function_t * sfunc_p,
+    uint32_t value_vx,
+    uint32_t obj_vx,
+    uint32_t name_istr_vx
 )
 {
-    return a_r == b_r ? O71_EQUAL : (a_r > b_r ? O71_MORE : O71_LESS);
+    return sfunc_append_opc_val_obj_name(world_p, sfunc_p, O71O_SET_FIELD,
+                                         value_vx, obj_vx, name_istr_vx);
 }
 
-/* str_finish ***************************************************************/
-static o71_status_t str_finish
+/* o71_alloc_exc_chain ******************************************************/
+O71_API o71_status_t o71_alloc_exc_chain
 (
     o71_world_t * world_p,
-    o71_ref_t obj_r
+    o71_script_function_t * sfunc_p,
+    uint32_t * exc_chain_xp,
+    o71_exc_handler_t * * exc_handler_ap,
+    size_t exc_handler_n
 )
 {
-    o71_string_t * str_p;
     o71_status_t os;
-    A(o71_model(world_p, obj_r) & O71M_STRING);
-    str_p = o71_obj_ptr(world_p, obj_r);
-    M2("remove string '%.*s' (mode=%u, m=%zu)",
-       (int) str_p->n, str_p->a, str_p->mode, str_p->m);
-#if O71_DEBUG >= 2
-    kvbag_dump(world_p, &world_p->istr_bag);
-#endif
-    if (str_p->mode == O71_SM_INTERN)
+    size_t ecn, ehn;
+    *exc_chain_xp = sfunc_p->exc_chain_n;
+    ecn = sfunc_p->exc_chain_n + 1;
+    if (ecn >= sfunc_p->exc_chain_m)
     {
-        o71_kvbag_loc_t loc;
-        os = kvbag_search(world_p, &world_p->istr_bag, obj_r,
-                          str_intern_cmp, NULL, &loc);
-        AOS(os);
-        os = kvbag_delete(world_p, &world_p->istr_bag, &loc);
-        AOS(os);
-#if O71_DEBUG >= 2
-        kvbag_dump(world_p, &world_p->istr_bag);
-        M("===================");
-#endif
+        size_t new_m;
+        new_m = (ecn + 4) & ~3;
+        os = redim(world_p->allocator_p,
+                   (void * *) &sfunc_p->exc_chain_start_xa,
+                   &sfunc_p->exc_chain_m, new_m,
+                   sizeof(sfunc_p->exc_chain_start_xa[0]));
+        if (os) { M("ouch: %s", N(os)); return os; }
+        if (sfunc_p->exc_chain_n == 1)
+        {
+            sfunc_p->exc_chain_start_xa[0] = 0;
+            sfunc_p->exc_chain_start_xa[1] = 0;
+        }
     }
-    if (str_p->m)
+
+    ehn = sfunc_p->exc_handler_n + exc_handler_n;
+    if (ehn > sfunc_p->exc_handler_m)
     {
-        os = redim(world_p->allocator_p, (void * *) &str_p->a, &str_p->m, 0, 1);
-        AOS(os);
+        size_t ehm = (ehn + 3) &~3;
+        os = redim(world_p->allocator_p, (void * *) &sfunc_p->exc_handler_a,
+                   &sfunc_p->exc_handler_m, ehm,
+                   sizeof(sfunc_p->exc_handler_a[0]));
+        if (os) { M("ouch: %s", N(os)); return os; }
     }
-    return O71_OK;
-}
 
+    M("ecsxa[%zu]=%u, ehn=%zu", sfunc_p->exc_chain_n,
+      sfunc_p->exc_chain_start_xa[sfunc_p->exc_chain_n],
+      sfunc_p->exc_handler_n);
+    A(sfunc_p->exc_chain_start_xa[sfunc_p->exc_chain_n]
+      == sfunc_p->exc_handler_n);
 
-/* str_intern_cmp ***********************************************************/
-static o71_status_t str_intern_cmp
-(
-    o71_world_t * world_p,
-    o71_ref_t a_r,
-    o71_ref_t b_r,
-    void * ctx
-)
-{
-    o71_string_t const * a_p;
-    o71_string_t const * b_p;
-    size_t i;
+    *exc_handler_ap = &sfunc_p->exc_handler_a[sfunc_p->exc_handler_n];
+    sfunc_p->exc_handler_n += exc_handler_n;
 
-    a_p = o71_obj_ptr(world_p, a_r);
-    b_p = o71_obj_ptr(world_p, b_r);
-    if (a_p->n != b_p->n)
-    {
-        // M("'%.*s' %s '%.*s'", (int) a_p->n, a_p->a,
-        //   a_p->n > b_p->n ? ">" : "<",
-        //   (int) b_p->n, b_p->a);
-        return (a_p->n > b_p->n ? O71_MORE : O71_LESS);
-    }
-    for (i = 0; i < a_p->n; ++i)
-        if (a_p->a[i] != b_p->a[i])
-        {
-            // M("'%.*s' %s '%.*s'", (int) a_p->n, a_p->a,
-            //   a_p->a[i] > b_p->a[i] ? ">" : "<",
-            //   (int) b_p->n, b_p->a);
-            return (a_p->a[i] > b_p->a[i] ? O71_MORE : O71_LESS);
-        }
-    // M("'%.*s' == '%.*s'", (int) a_p->n, a_p->a, (int) b_p->n, b_p->a);
-    return O71_EQUAL;
-}
+    sfunc_p->exc_chain_n++;
+    sfunc_p->exc_chain_start_xa[sfunc_p->exc_chain_n] = sfunc_p->exc_handler_n;
+    sfunc_p->valid = 0;
 
-/* kvbag_init ***************************************************************/
-static void kvbag_init
-(
-    o71_kvbag_t * kvbag_p,
-    uint8_t array_limit
-)
-{
-    kvbag_p->kv_a = NULL;
-    kvbag_p->n = 0;
-    kvbag_p->m = 0;
-    kvbag_p->l = array_limit;
-    kvbag_p->mode = O71_BAG_ARRAY;
+    return O71_OK;
 }
 
-
-/* kvbag_free *************************************************************/
-static o71_status_t kvbag_free
+/* o71_set_exc_chain ********************************************************/
+O71_API o71_status_t o71_set_exc_chain
 (
     o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_kv_free_f kv_free
+    o71_script_function_t * sfunc_p,
+    uint32_t first_insn_x,
+    uint32_t last_insn_x,
+    uint32_t exc_chain_x
 )
 {
-    o71_status_t os;
-    if (kvbag_p->mode == O71_BAG_ARRAY)
-        os = kvbag_array_free(world_p, kvbag_p, kv_free);
-    else
-    {
-        A(kvbag_p->mode == O71_BAG_RBTREE);
-        os = kvbag_rbtree_free(world_p, kvbag_p->tree_p, kv_free);
-    }
-
-    return os;
+    uint32_t i;
+    M("ix:[%u, %u], ecx=%u", first_insn_x, last_insn_x, exc_chain_x);
+    if (first_insn_x >= sfunc_p->insn_n || last_insn_x >= sfunc_p->insn_n
+        || first_insn_x > last_insn_x)
+        return O71_BAD_INSN_INDEX;
+    if (exc_chain_x >= sfunc_p->exc_chain_n)
+        return O71_BAD_EXC_CHAIN_INDEX;
+    for (i = first_insn_x; i <= last_insn_x; ++i)
+        sfunc_p->insn_a[i].exc_chain_x = exc_chain_x;
+    sfunc_p->valid = 0;
+    return O71_OK;
 }
 
-#if O71_DEBUG
-/* kvbag_dump ***************************************************************/
-static void kvbag_dump
+/* o71_sfunc_validate *******************************************************/
+O71_API o71_status_t o71_sfunc_validate
 (
     o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p
+    o71_script_function_t * sfunc_p
 )
 {
-    if (kvbag_p->mode == O71_BAG_ARRAY) kvbag_array_dump(world_p, kvbag_p);
-    else kvbag_rbtree_dump(world_p, kvbag_p->tree_p, 0);
+    size_t i, j, nv, nvv = 0, nc, opnd_x, last_opnd_x, vx, var_n = 0;
+    uint8_t has_var_list;
+    o71_status_t os;
+
+    /*
+    M("validating sfunc=%p, an=%zu, vn=%zu, in=%zu, on=%zu, cn=%zu",
+      sfunc_p, sfunc_p->arg_n, sfunc_p->var_n, sfunc_p->insn_n, sfunc_p->opnd_n,
+      sfunc_p->const_n);
+      */
+    for (i = 0; i < sfunc_p->arg_n; ++i)
+    {
+        vx = sfunc_p->arg_xa[i];
+        if (vx >= O71_VAR_LIMIT)
+        {
+            M("sfunc=%p: arg %zu has invalid var index 0x%zu",
+              sfunc_p, i, vx);
+            return O71_BAD_VAR_INDEX;
+        }
+        if (vx >= var_n) var_n = vx + 1;
+    }
+
+    if (!sfunc_p->insn_n)
+    {
+        M("sfunc=%p: no instructions to execute!", sfunc_p);
+        return O71_BAD_INSN_INDEX;
+    }
+
+    if (sfunc_p->insn_a[sfunc_p->insn_n - 1].opcode < O71O__NO_FALL)
+    {
+        M("sfunc=%p: last insn does not guarantee changing the flow "
+          "(last opcode = 0x%02X)!", sfunc_p,
+          sfunc_p->insn_a[sfunc_p->insn_n - 1].opcode);
+        return O71_BAD_OPCODE;
+    }
+
+    for (i = 0; i < sfunc_p->insn_n; ++i)
+    {
+        M("sfunc=%p: insn %zu: opcode=0x%02X, ox=%u", sfunc_p, i,
+          sfunc_p->insn_a[i].opcode, sfunc_p->insn_a[i].opnd_x);
+#define X(_o, _v, _c, _has_vlist) \
+    case _o: nv = _v; nc = _c; has_var_list = _has_vlist; break;
+        switch (sfunc_p->insn_a[i].opcode)
+        {
+            X(O71O_NOP, 0, 0, 0);
+            X(O71O_INIT, 1, 1, 0);
+            X(O71O_INIT_NULL, 1, 1, 0);
+            X(O71O_RETURN, 1, 0, 0);
+            X(O71O_CALL, 2, 0, 1);
+            X(O71O_CALL_MOVE, 2, 0, 1);
+            X(O71O_GET_METHOD, 3, 0, 0);
+            X(O71O_GET_FIELD, 3, 0, 0);
+            X(O71O_SET_FIELD, 3, 0, 0);
+        default:
+            M("sfunc=%p: insn %zu: bad opcode 0x%X",
+              sfunc_p, i, sfunc_p->insn_a[i].opcode);
+            return O71_BAD_OPCODE;
+        }
+#undef X
+        opnd_x = sfunc_p->insn_a[i].opnd_x;
+        last_opnd_x = opnd_x + nv + nc + has_var_list - 1;
+        if (last_opnd_x != (uint16_t) last_opnd_x ||
+            last_opnd_x >= sfunc_p->opnd_n)
+        {
+            //M("sfunc=%p: insn %zu: bad operand index 0x%zu", sfunc_p, i, opnd_x);
+            return O71_BAD_OPERAND_INDEX;
+        }
+        if (has_var_list)
+        {
+            nvv = sfunc_p->opnd_a[last_opnd_x];
+            if (last_opnd_x + 1 + nvv <= last_opnd_x)
+                return O71_BAD_OPERAND_INDEX;
+            last_opnd_x += nvv + 1;
+            if (last_opnd_x != (uint16_t) last_opnd_x ||
+                last_opnd_x >= sfunc_p->opnd_n)
+            {
+                M("sfunc=%p: insn %zu: bad operand index %zu",
+                  sfunc_p, i, last_opnd_x);
+                return O71_BAD_OPERAND_INDEX;
+            }
+        }
+        for (j = 0; j < nv; ++j, ++opnd_x)
+        {
+            vx = sfunc_p->opnd_a[opnd_x];
+            if (vx >= O71_VAR_LIMIT)
+            {
+                M("sfunc=%p: operand %zu has invalid var index 0x%zX",
+                  sfunc_p, opnd_x, vx);
+                return O71_BAD_VAR_INDEX;
+            }
+            if (vx >= var_n) var_n = vx + 1;
+        }
+        for (j = 0; j < nc; ++j, ++opnd_x)
+        {
+            if (sfunc_p->opnd_a[opnd_x] >= sfunc_p->const_n)
+            {
+                M("sfunc=%p: operand %zu has invalid const index 0x%X "
+                  "(0x%zX limit)",
+                  sfunc_p, opnd_x, sfunc_p->opnd_a[opnd_x], sfunc_p->const_n);
+                return O71_BAD_CONST_INDEX;
+            }
+        }
+        if (has_var_list)
+        {
+            A(nvv == sfunc_p->opnd_a[opnd_x]);
+            ++opnd_x;
+            for (j = 0; j < nvv; ++j, ++opnd_x)
+            {
+                vx = sfunc_p->opnd_a[opnd_x];
+                if (sfunc_p->insn_a[i].opcode == O71O_CALL_MOVE)
+                    vx &= ~O71_VX_MOVE;
+                if (vx >= O71_VAR_LIMIT)
+                {
+                    M("sfunc=%p: operand %zu has invalid var index 0x%zX",
+                      sfunc_p, opnd_x, vx);
+                    return O71_BAD_VAR_INDEX;
+                }
+                if (vx >= var_n) var_n = vx + 1;
+            }
+        }
+    }
+    for (i = 0; i < sfunc_p->exc_handler_n; ++i)
+    {
+        if (sfunc_p->exc_handler_a[i].insn_x >= sfunc_p->insn_n)
+        {
+            M("sfunc=%p: exc handler %zu jumps to bad insn index 0x%X",
+              sfunc_p, i, sfunc_p->exc_handler_a[i].insn_x);
+            return O71_BAD_INSN_INDEX;
+        }
+        vx = sfunc_p->exc_handler_a[i].exc_var_x;
+        if (vx >= O71_VAR_LIMIT)
+        {
+            M("sfunc=%p: exc handler %zu has invalid var index 0x%zX",
+              sfunc_p, i, vx);
+            return O71_BAD_VAR_INDEX;
+        }
+        if (vx >= var_n) var_n = vx + 1;
+    }
+    sfunc_p->var_n = var_n;
+    sfunc_p->func.cls.object_size = sizeof(o71_script_exe_ctx_t)
+        + sizeof(o71_ref_t) * sfunc_p->var_n;
+    M("computed var count: %zu; object size: %zu",
+      var_n, sfunc_p->func.cls.object_size);
+    os = sfunc_optimize(world_p, sfunc_p);
+    if (os) M("sfunc=%p: liveness pass skipped: %s", sfunc_p, N(os));
+    sfunc_p->valid = 1;
+    return O71_OK;
 }
-#endif
 
-/* kvbag_search *************************************************************/
-static o71_status_t kvbag_search
+/* sfunc_optimize ***********************************************************/
+static o71_status_t sfunc_optimize
+(
+    o71_world_t * world_p,
+    o71_script_function_t * sfunc_p
+)
+{
+    o71_status_t os;
+    o71_insn_t * insn_p;
+    o71_exc_handler_t * eh_p;
+    uint32_t * o;
+    uintptr_t * set_a = NULL;
+    uintptr_t * t;
+    uintptr_t m;
+    size_t set_m = 0, wn, w, ix, i, ehx, ehx_lim, insn_n;
+    uint32_t vx, ecx;
+    int changed, moved;
+
+    insn_n = sfunc_p->insn_n;
+    /* drop what a previous validation decided */
+    for (ix = 0; ix < insn_n; ++ix)
+    {
+        insn_p = &sfunc_p->insn_a[ix];
+        o = &sfunc_p->opnd_a[insn_p->opnd_x];
+        if (insn_p->opcode == O71O_INIT_NULL) insn_p->opcode = O71O_INIT;
+        else if (insn_p->opcode == O71O_CALL_MOVE)
+        {
+            insn_p->opcode = O71O_CALL;
+            for (i = 0; i < o[2]; ++i) o[3 + i] &= ~O71_VX_MOVE;
+        }
+    }
+    if (!sfunc_p->var_n) return O71_OK;
+
+    /* one var set per insn plus a scratch one */
+    wn = (sfunc_p->var_n + BMP_BITS - 1) / BMP_BITS;
+    if (insn_n + 1 > SIZE_MAX / sizeof(uintptr_t) / wn) return O71_NO_MEM;
+    os = redim(world_p->allocator_p, (void * *) &set_a, &set_m,
+               (insn_n + 1) * wn, sizeof(uintptr_t));
+    if (os) return os;
+    t = set_a + insn_n * wn;
+
+    /* backward pass: set_a[ix] holds the vars live on entry to insn ix;
+     * an exception raised by insn ix continues in any of the handlers of
+     * its chain after storing the exception in the handler's var */
+    for (i = 0; i < set_m; ++i) set_a[i] = 0;
+    do
+    {
+        changed = 0;
+        for (ix = insn_n; ix--; )
+        {
+            insn_p = &sfunc_p->insn_a[ix];
+            o = &sfunc_p->opnd_a[insn_p->opnd_x];
+            for (w = 0; w < wn; ++w)
+                t[w] = insn_p->opcode < O71O__NO_FALL
+                    ? set_a[(ix + 1) * wn + w] : 0;
+            switch (insn_p->opcode)
+            {
+            case O71O_INIT:
+            case O71O_GET_METHOD:
+            case O71O_GET_FIELD:
+            case O71O_CALL:
+                BMP_CLR(t, o[0]);
+                break;
+            }
+            ecx = insn_p->exc_chain_x;
+            if (ecx < sfunc_p->exc_chain_n)
+                for (ehx = sfunc_p->exc_chain_start_xa[ecx],
+                     ehx_lim = sfunc_p->exc_chain_start_xa[ecx + 1];
+                     ehx < ehx_lim; ++ehx)
+                {
+                    eh_p = &sfunc_p->exc_handler_a[ehx];
+                    for (w = 0; w < wn; ++w)
+                    {
+                        m = set_a[eh_p->insn_x * wn + w];
+                        if (w == eh_p->exc_var_x / BMP_BITS)
+                            m &= ~((uintptr_t) 1
+                                   << (eh_p->exc_var_x % BMP_BITS));
+                        t[w] |= m;
+                    }
+                }
+            switch (insn_p->opcode)
+            {
+            case O71O_GET_METHOD:
+            case O71O_GET_FIELD:
+                BMP_SET(t, o[1]);
+                BMP_SET(t, o[2]);
+                break;
+            case O71O_SET_FIELD:
+                BMP_SET(t, o[0]);
+                BMP_SET(t, o[1]);
+                BMP_SET(t, o[2]);
+                break;
+            case O71O_RETURN:
+                BMP_SET(t, o[0]);
+                break;
+            case O71O_CALL:
+                BMP_SET(t, o[1]);
+                for (i = 0; i < o[2]; ++i) BMP_SET(t, o[3 + i]);
+                break;
+            }
+            for (w = 0; w < wn; ++w)
+                if (set_a[ix * wn + w] != t[w])
+                {
+                    set_a[ix * wn + w] = t[w];
+                    changed = 1;
+                }
+        }
+    }
+    while (changed);
+
+    /* an argument can be moved if it is not live after the call reads its
+     * operands, neither on the normal path (where dest gets overwritten)
+     * nor on the exception path; only the last occurrence of a var in the
+     * arg list is moved and never the function var */
+    for (ix = 0; ix < insn_n; ++ix)
+    {
+        insn_p = &sfunc_p->insn_a[ix];
+        if (insn_p->opcode != O71O_CALL) continue;
+        o = &sfunc_p->opnd_a[insn_p->opnd_x];
+        for (w = 0; w < wn; ++w) t[w] = set_a[(ix + 1) * wn + w];
+        BMP_CLR(t, o[0]);
+        ecx = insn_p->exc_chain_x;
+        if (ecx < sfunc_p->exc_chain_n)
+            for (ehx = sfunc_p->exc_chain_start_xa[ecx],
+                 ehx_lim = sfunc_p->exc_chain_start_xa[ecx + 1];
+                 ehx < ehx_lim; ++ehx)
+            {
+                eh_p = &sfunc_p->exc_handler_a[ehx];
+                for (w = 0; w < wn; ++w)
+                {
+                    m = set_a[eh_p->insn_x * wn + w];
+                    if (w == eh_p->exc_var_x / BMP_BITS)
+                        m &= ~((uintptr_t) 1 << (eh_p->exc_var_x % BMP_BITS));
+                    t[w] |= m;
+                }
+            }
+        BMP_SET(t, o[1]);
+        for (moved = 0, i = o[2]; i--; )
+        {
+            vx = o[3 + i];
+            if (BMP_TEST(t, vx)) continue;
+            BMP_SET(t, vx);
+            o[3 + i] = vx | O71_VX_MOVE;
+            moved = 1;
+        }
+        if (moved) insn_p->opcode = O71O_CALL_MOVE;
+    }
+
+    /* forward pass: set_a[ix] holds the vars that may be non-null on
+     * entry to insn ix; only the args are set when the function starts */
+    for (i = 0; i < set_m; ++i) set_a[i] = 0;
+    for (i = 0; i < sfunc_p->arg_n; ++i) BMP_SET(set_a, sfunc_p->arg_xa[i]);
+    do
+    {
+        changed = 0;
+        for (ix = 0; ix < insn_n; ++ix)
+        {
+            insn_p = &sfunc_p->insn_a[ix];
+            o = &sfunc_p->opnd_a[insn_p->opnd_x];
+            for (w = 0; w < wn; ++w) t[w] = set_a[ix * wn + w];
+            ecx = insn_p->exc_chain_x;
+            if (ecx < sfunc_p->exc_chain_n)
+                for (ehx = sfunc_p->exc_chain_start_xa[ecx],
+                     ehx_lim = sfunc_p->exc_chain_start_xa[ecx + 1];
+                     ehx < ehx_lim; ++ehx)
+                {
+                    uintptr_t * h;
+                    eh_p = &sfunc_p->exc_handler_a[ehx];
+                    h = set_a + eh_p->insn_x * wn;
+                    for (w = 0; w < wn; ++w)
+                    {
+                        m = t[w];
+                        if (w == eh_p->exc_var_x / BMP_BITS)
+                            m |= (uintptr_t) 1 << (eh_p->exc_var_x % BMP_BITS);
+                        if ((h[w] | m) != h[w]) { h[w] |= m; changed = 1; }
+                    }
+                }
+            if (insn_p->opcode >= O71O__NO_FALL) continue;
+            switch (insn_p->opcode)
+            {
+            case O71O_CALL_MOVE:
+                for (i = 0; i < o[2]; ++i)
+                    if (o[3 + i] & O71_VX_MOVE)
+                        BMP_CLR(t, o[3 + i] & ~O71_VX_MOVE);
+                /* fall through */
+            case O71O_INIT:
+            case O71O_GET_METHOD:
+            case O71O_GET_FIELD:
+            case O71O_CALL:
+                BMP_SET(t, o[0]);
+                break;
+            }
+            for (w = 0; w < wn; ++w)
+                if ((set_a[(ix + 1) * wn + w] | t[w]) != set_a[(ix + 1) * wn + w])
+                {
+                    set_a[(ix + 1) * wn + w] |= t[w];
+                    changed = 1;
+                }
+        }
+    }
+    while (changed);
+
+    for (ix = 0; ix < insn_n; ++ix)
+    {
+        insn_p = &sfunc_p->insn_a[ix];
+        if (insn_p->opcode == O71O_INIT
+            && !BMP_TEST(set_a + ix * wn, sfunc_p->opnd_a[insn_p->opnd_x]))
+            insn_p->opcode = O71O_INIT_NULL;
+    }
+
+    os = redim(world_p->allocator_p, (void * *) &set_a, &set_m, 0,
+               sizeof(uintptr_t));
+    AOS(os);
+    return O71_OK;
+}
+
+/* o71_kvbag_load ***********************************************************/
+O71_API o71_status_t o71_kvbag_load
 (
     o71_world_t * world_p,
     o71_kvbag_t * kvbag_p,
-    o71_ref_t key_r,
+    o71_kv_t const * kv_a,
+    size_t kv_n,
     o71_cmp_f cmp,
-    void * ctx,
-    o71_kvbag_loc_t * loc_p
+    void * ctx
 )
 {
-    M2("bag=%p, mode=%s, key=obref_%lX", kvbag_p,
-       kvbag_p->mode ? "rbtree" : "array", key_r);
-    if (kvbag_p->mode == O71_BAG_ARRAY)
-        return kvbag_array_search(world_p, kvbag_p, key_r, cmp, ctx, loc_p);
-    A(kvbag_p->mode == O71_BAG_RBTREE);
-    return kvbag_rbtree_search(world_p, kvbag_p, key_r, cmp, ctx, loc_p);
+    return kvbag_load(world_p, kvbag_p, kv_a, kv_n, cmp ? cmp : ref_cmp, ctx);
 }
 
-/* kvbag_get_loc_value ******************************************************/
-static o71_ref_t kvbag_get_loc_value
+/* o71_kvbag_merge **********************************************************/
+O71_API o71_status_t o71_kvbag_merge
 (
     o71_world_t * world_p,
     o71_kvbag_t * kvbag_p,
-    o71_kvbag_loc_t * loc_p
+    o71_kv_t const * kv_a,
+    size_t kv_n,
+    o71_cmp_f cmp,
+    void * ctx
 )
 {
-#if O71_CHECKED
-    if (loc_p->status != O71_OK)
-    {
-        M("*** BUG *** trying to get value after key match failed (%s)!!!!",
-          N(loc_p->status));
-        return O71_MOX_TO_REF(-1);
-    }
-#endif
+    return kvbag_merge(world_p, kvbag_p, kv_a, kv_n, cmp ? cmp : ref_cmp, ctx);
+}
 
-    if (kvbag_p->mode == O71_BAG_ARRAY)
-        return kvbag_p->kv_a[loc_p->array.index].value_r;
-    return loc_p->rbtree.node_a[loc_p->rbtree.last_x]->kv.value_r;
+/* o71_kvbag_cursor_init ****************************************************/
+O71_API void o71_kvbag_cursor_init
+(
+    o71_kvbag_cursor_t * cursor_p
+)
+{
+    kvbag_cursor_init(cursor_p);
 }
 
-/* kvbag_set_loc_value ******************************************************/
-static void kvbag_set_loc_value
+/* o71_kvbag_cursor_seek ****************************************************/
+O71_API o71_status_t o71_kvbag_cursor_seek
 (
     o71_world_t * world_p,
     o71_kvbag_t * kvbag_p,
-    o71_kvbag_loc_t * loc_p,
-    o71_ref_t value_r
+    o71_kvbag_cursor_t * cursor_p,
+    o71_ref_t key_r,
+    o71_cmp_f cmp,
+    void * ctx
 )
 {
-    if (kvbag_p->mode == O71_BAG_ARRAY)
-        kvbag_p->kv_a[loc_p->array.index].value_r = value_r;
-    else loc_p->rbtree.node_a[loc_p->rbtree.last_x]->kv.value_r = value_r;
+    return kvbag_cursor_seek(world_p, kvbag_p, cursor_p, key_r,
+                             cmp ? cmp : ref_cmp, ctx);
 }
 
-/* kvbag_insert *************************************************************/
-static o71_status_t kvbag_insert
+/* o71_kvbag_cursor_next ****************************************************/
+O71_API o71_status_t o71_kvbag_cursor_next
 (
     o71_world_t * world_p,
     o71_kvbag_t * kvbag_p,
-    o71_ref_t key_r,
-    o71_ref_t value_r,
-    o71_kvbag_loc_t * loc_p
+    o71_kvbag_cursor_t * cursor_p,
+    o71_cmp_f cmp,
+    void * ctx,
+    o71_kv_t * kv_p
 )
 {
-    while (kvbag_p->mode == O71_BAG_ARRAY)
-    {
-        int i;
-        o71_status_t os;
-        if (kvbag_p->n == kvbag_p->m)
-        {
-            size_t m, nm;
-            /* array full; reallocate or switch to tree */
-            A((kvbag_p->m & (kvbag_p->m - 1)) == 0);
-            A((kvbag_p->l & (kvbag_p->l - 1)) == 0);
-            if (kvbag_p->m == kvbag_p->l)
-            {
-                o71_kv_t * kv_a = kvbag_p->kv_a;
-
-                M("switch bag from array to tree");
-                kvbag_p->tree_p = NULL;
-                os = kvbag_rbtree_multi_add(world_p, kvbag_p, kv_a, kvbag_p->n);
-                if (os)
-                {
-                    M("rbtree multi add failed: %s", N(os));
-                    if (kvbag_p->tree_p)
-                    {
-                        o71_status_t osf;
-                        osf = kvbag_rbtree_free(world_p, kvbag_p->tree_p, kv_nop_free);
-                        if (osf) return osf;
-                    }
-
-                    kvbag_p->kv_a = kv_a;
-                    return os;
-                }
-                kvbag_p->mode = O71_BAG_RBTREE;
-                // fall into the rbtree branch
-                os = kvbag_rbtree_search(world_p, kvbag_p, key_r,
-                                         str_intern_cmp, NULL, loc_p);
-                A(os == O71_MISSING);
-                break;
-            }
-            m = kvbag_p->m;
-            nm = m ? m << 1 : (kvbag_p->l < 2 ? kvbag_p->l : 2);
-            os = redim(world_p->allocator_p, (void * *) &kvbag_p->kv_a, &m, nm,
-                       sizeof(o71_kv_t));
-            if (os)
-            {
-                M("failed to extend bag array: %s", N(os));
-                return os;
-            }
-            kvbag_p->m = (uint8_t) nm;
-        }
-        A(kvbag_p->n < kvbag_p->m);
-        os = o71_ref(world_p, key_r);
-        AOS(os);
-        for (i = (int) kvbag_p->n - 1; i >= (int) loc_p->array.index; --i)
-            kvbag_p->kv_a[i + 1] = kvbag_p->kv_a[i];
-        kvbag_p->kv_a[loc_p->array.index].key_r = key_r;
-        kvbag_p->kv_a[loc_p->array.index].value_r = value_r;
-        kvbag_p->n += 1;
-        return O71_OK;
-    }
-    A(kvbag_p->mode == O71_BAG_RBTREE);
-
-    return kvbag_rbtree_insert(world_p, kvbag_p, key_r, value_r, loc_p);
+    return kvbag_cursor_next(world_p, kvbag_p, cursor_p, cmp ? cmp : ref_cmp,
+                             ctx, kv_p);
 }
 
-/* kvbag_delete *************************************************************/
-static o71_status_t kvbag_delete
+/* o71_superclass_search ****************************************************/
+O71_API ptrdiff_t o71_superclass_search
 (
     o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_kvbag_loc_t * loc_p
+    o71_ref_t class_r,
+    o71_ref_t superclass_r
 )
 {
-    return (kvbag_p->mode == O71_BAG_ARRAY)
-        ? kvbag_array_delete(world_p, kvbag_p, loc_p)
-        : kvbag_rbtree_delete(world_p, kvbag_p, loc_p);
+    o71_class_t * class_p;
+    ptrdiff_t a, b, c;
+    class_p = o71_obj_ptr(world_p, class_r);
+    for (a = 0, b = class_p->super_n - 1; a <= b; )
+    {
+        c = (a + b) >> 1;
+        if (superclass_r == class_p->super_ra[c]) return c;
+        if (superclass_r < class_p->super_ra[c]) b = c - 1;
+        else a = c + 1;
+    }
+    return -1;
 }
 
-/* kvbag_put ****************************************************************/
-static o71_status_t kvbag_put
+/* o71_reg_obj_create *******************************************************/
+O71_API o71_status_t o71_reg_obj_create
 (
     o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_ref_t key_r,
-    o71_ref_t value_r,
-    o71_cmp_f cmp,
-    void * ctx
+    o71_ref_t class_r,
+    o71_ref_t * reg_obj_rp
 )
 {
     o71_status_t os;
-    o71_kvbag_loc_t loc;
+    o71_obj_index_t reg_obj_x;
+    o71_reg_obj_t * reg_obj_p;
+    o71_class_t * class_p;
+    unsigned int i;
 
-    os = kvbag_search(world_p, kvbag_p, key_r, cmp, ctx, &loc);
-    if (os == O71_OK)
+    class_p = o71_obj_ptr(world_p, class_r);
+    A(class_p->model & O71M_MEM_OBJ);
+    os = alloc_object(world_p, class_r, &reg_obj_x);
+    if (os)
     {
-        o71_ref_t old_value_r;
-        // key already in the bag
-        old_value_r = kvbag_get_loc_value(world_p, kvbag_p, &loc);
-        os = o71_deref(world_p, old_value_r);
-        AOS(os);
-        kvbag_set_loc_value(world_p, kvbag_p, &loc, value_r);
-        return O71_OK;
+        M("alloc_object failed: %s", N(os));
+        return os;
+    }
+    *reg_obj_rp = O71_MOX_TO_REF(reg_obj_x);
+    reg_obj_p = O71_OBJ_SLOT(world_p, reg_obj_x);
+    M("class obref_%lX: dfo=0x%lX", class_r, class_p->dyn_field_ofs);
+    if (class_p->dyn_field_ofs)
+    {
+        M("init dyn field bag %p at ofs 0x%lX in dyn obj at obref_%lX",
+          ((uint8_t *) reg_obj_p + class_p->dyn_field_ofs),
+          class_p->dyn_field_ofs, *reg_obj_rp);
+        kvbag_init((o71_kvbag_t *)
+                   ((uint8_t *) reg_obj_p + class_p->dyn_field_ofs),
+                   0x10, O71_BAG_HASH);
     }
-    if (os != O71_MISSING) return os;
-    os = kvbag_insert(world_p, kvbag_p, key_r, value_r, &loc);
-    return os;
-}
 
-/* kvbag_rbtree_node_alloc **************************************************/
-static o71_status_t kvbag_rbtree_node_alloc
-(
-    o71_world_t * world_p,
-    o71_kvnode_t * * kvnode_pp
-)
-{
-    size_t n = 0;
-    return redim(world_p->allocator_p, (void * *) kvnode_pp, &n, 1,
-                 sizeof(o71_kvnode_t));
-}
+    for (i = 0; i < class_p->fix_field_n; ++i)
+        *(o71_ref_t *) ((uint8_t *) reg_obj_p +
+                        class_p->fix_field_ofs_a[i].value_r) = O71R_NULL;
 
-/* kvbag_rbtree_node_free ***************************************************/
-static o71_status_t kvbag_rbtree_node_free
-(
-    o71_world_t * world_p,
-    o71_kvnode_t * kvnode_p,
-    o71_kv_free_f kv_free
-)
-{
-    size_t n = 1;
-    o71_status_t os;
-    os = kv_free(world_p, &kvnode_p->kv);
-    AOS(os);
-    return redim(world_p->allocator_p, (void * *) &kvnode_p, &n, 0,
-                 sizeof(o71_kvnode_t));
+    return O71_OK;
 }
 
-/* kvbag_rbtree_free ********************************************************/
-static o71_status_t kvbag_rbtree_free
+/* o71_reg_obj_create_n *****************************************************/
+O71_API o71_status_t o71_reg_obj_create_n
 (
     o71_world_t * world_p,
-    o71_kvnode_t * kvnode_p,
-    o71_kv_free_f kv_free
+    o71_ref_t class_r,
+    size_t n,
+    o71_ref_t * reg_obj_ra
 )
 {
     o71_status_t os;
-    A(kvnode_p);
-    if (kvnode_p->clr[0])
+    o71_reg_obj_t * reg_obj_p;
+    o71_class_t * class_p;
+    uintptr_t * tpl_a;
+    uintptr_t * dst_a;
+    size_t i, j, word_n;
+
+    if (!n) return O71_OK;
+    class_p = o71_obj_ptr(world_p, class_r);
+    A(class_p->model & O71M_MEM_OBJ);
+    /* o71_ref_t and o71_obj_index_t have the same representation, so the
+     * output array holds the indices until they are converted to refs */
+    os = alloc_object_n(world_p, class_r, n, reg_obj_ra);
+    if (os)
     {
-        os = kvbag_rbtree_free(world_p, GET_CHILD(kvnode_p, 0), kv_free);
-        if (os) return os;
+        M("alloc_object_n failed: %s", N(os));
+        return os;
     }
-    if (kvnode_p->clr[1])
+
+    /* the first object is initialized field by field and serves as the
+     * template for the body of the others */
+    reg_obj_p = O71_OBJ_SLOT(world_p, reg_obj_ra[0]);
+    if (class_p->dyn_field_ofs)
+        kvbag_init((o71_kvbag_t *)
+                   ((uint8_t *) reg_obj_p + class_p->dyn_field_ofs),
+                   0x10, O71_BAG_HASH);
+    for (i = 0; i < class_p->fix_field_n; ++i)
+        *(o71_ref_t *) ((uint8_t *) reg_obj_p +
+                        class_p->fix_field_ofs_a[i].value_r) = O71R_NULL;
+
+    tpl_a = (uintptr_t *) (&reg_obj_p->hdr + 1);
+    word_n = (class_p->object_size - sizeof(o71_mem_obj_t))
+        / sizeof(uintptr_t);
+    for (i = 1; i < n; ++i)
     {
-        os = kvbag_rbtree_free(world_p, GET_CHILD(kvnode_p, 1), kv_free);
-        if (os) return os;
+        dst_a = (uintptr_t *) ((o71_mem_obj_t *)
+                               O71_OBJ_SLOT(world_p, reg_obj_ra[i]) + 1);
+        for (j = 0; j < word_n; ++j) dst_a[j] = tpl_a[j];
     }
-    return kvbag_rbtree_node_free(world_p, kvnode_p, kv_free);
-}
 
-#if O71_DEBUG
-/* kvbag_rbtree_dump ********************************************************/
-static void kvbag_rbtree_dump
-(
-    o71_world_t * world_p,
-    o71_kvnode_t * kvnode_p,
-    unsigned int depth
-)
-{
-    if (!kvnode_p) return;
-    kvbag_rbtree_dump(world_p, GET_CHILD(kvnode_p, O71_LESS), depth + 1);
-    printf("%.*sk=", depth * 2,
-           "                                                                ");
-    obj_dump(world_p, kvnode_p->kv.key_r);
-    printf(" -> v=");
-    obj_dump(world_p, kvnode_p->kv.value_r);
-    printf("\n");
-    // printf("%.*sk=%lX=:v=%lX= (%s)\n",
-    //        depth * 2,
-    //        kvnode_p->kv.key_r, kvnode_p->kv.value_r,
-    //        IS_RED(kvnode_p) ? "red" : "black");
-    kvbag_rbtree_dump(world_p, GET_CHILD(kvnode_p, O71_MORE), depth + 1);
+    for (i = 0; i < n; ++i) reg_obj_ra[i] = O71_MOX_TO_REF(reg_obj_ra[i]);
+    M("created %zu instances of class obref_%lX starting with obref_%lX",
+      n, (long) class_r, (long) reg_obj_ra[0]);
+
+    return O71_OK;
 }
-#endif
 
-/* kvbag_rbtree_add *********************************************************/
-static o71_status_t kvbag_rbtree_add
+/* o71_reg_obj_get_field ****************************************************/
+O71_API o71_status_t o71_reg_obj_get_field
 (
     o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_ref_t key_r,
-    o71_ref_t value_r
+    o71_ref_t obj_r,
+    o71_ref_t field_istr_r,
+    o71_ref_t * value_rp
 )
 {
-    o71_kvbag_loc_t loc;
+    o71_kvbag_t * kvbag_p;
+    o71_mem_obj_t * obj_p;
+    o71_class_t * class_p;
+    intptr_t a, b, c;
     o71_status_t os;
-    M2("kvbag_p=%p, key=obref_%lX, value=obref_%lX", kvbag_p, key_r, value_r);
-    os = kvbag_rbtree_search(world_p, kvbag_p, key_r,
-                             str_intern_cmp, NULL, &loc);
-    if (os == O71_OK)
+
+    A(o71_istr_check(world_p, field_istr_r) == O71_OK);
+
+    class_p = o71_class(world_p, obj_r);
+    if (!(class_p->model & O71M_MEM_OBJ))
     {
-        o71_kvnode_t * n = loc.rbtree.node_a[loc.rbtree.last_x];
-        M2("discarding old_value=obref_%lX for key=obref_%lX", value_r, key_r);
-        os = o71_deref(world_p, n->kv.value_r);
-        AOS(os);
-        n->kv.value_r = value_r;
-        M2("updated value to obref_%lX for key obref_%lX", value_r, key_r);
-        return O71_OK;
+        /* non-memory objects don't have fields */
+        return O71_MISSING;
     }
-    if (os != O71_MISSING)
+
+    obj_p = o71_obj_ptr(world_p, obj_r);
+    a = 0;
+    b = (intptr_t) class_p->fix_field_n - 1;
+    while (a <= b)
     {
-        M("error searching for key obref_%lX: %s", key_r, N(os));
-        return os;
+        o71_ref_t key_r;
+        c = (a + b) >> 1;
+        key_r = class_p->fix_field_ofs_a[c].key_r;
+        if (field_istr_r == key_r)
+        {
+            /* found fixed field */
+            *value_rp = *(o71_ref_t *) ((uint8_t *) obj_p +
+                                        class_p->fix_field_ofs_a[c].value_r);
+            return O71_OK;
+        }
+        if (field_istr_r < key_r) b = c - 1;
+        else a = c + 1;
+    }
+    /* put field in the dynamic bag */
+    if (!class_p->dyn_field_ofs)
+    {
+        /* no bag for dynamic fields; return field is missing */
+        return O71_MISSING;
     }
 
-    return kvbag_rbtree_insert(world_p, kvbag_p, key_r, value_r, &loc);
-}
-
+    kvbag_p = (o71_kvbag_t *) ((uint8_t *) obj_p + class_p->dyn_field_ofs);
+    M2("obref_%lX dfo=0x%lX", (long) obj_r, (long) class_p->dyn_field_ofs);
+    os = kvbag_get(world_p, kvbag_p, field_istr_r, ref_cmp, NULL, value_rp);
+    if (os == O71_OK)
+        M2("obref_%lX.obref_%lX -> obref_%lX", obj_r, field_istr_r, *value_rp);
 
-/* kvbag_rbtree_multi_add ***************************************************/
-static o71_status_t kvbag_rbtree_multi_add
-(
-    o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_kv_t * kv_a,
-    size_t kv_n
-)
-{
-    o71_status_t os;
-    size_t x;
-    if (!kv_n) return O71_OK;
-    x = kv_n / 2;
-    os = kvbag_rbtree_add(world_p, kvbag_p, kv_a[x].key_r, kv_a[x].value_r);
-    if (os) return os;
-    os = kvbag_rbtree_multi_add(world_p, kvbag_p, kv_a, x);
-    if (os) return os;
-    ++x;
-    os = kvbag_rbtree_multi_add(world_p, kvbag_p, kv_a + x, kv_n - x);
     return os;
 }
 
-/* kvbag_rbtree_insert ******************************************************/
-static o71_status_t kvbag_rbtree_insert
+/* o71_reg_obj_set_field ****************************************************/
+O71_API o71_status_t o71_reg_obj_set_field
 (
     o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_ref_t key_r,
-    o71_ref_t value_r,
-    o71_kvbag_loc_t * loc_p
+    o71_ref_t obj_r,
+    o71_ref_t field_istr_r,
+    o71_ref_t value_r
 )
 {
-    unsigned int i, gs, ps, ts;
-    o71_kvnode_t * parent;
-    o71_kvnode_t * grandpa;
-    o71_kvnode_t * uncle;
-    o71_kvnode_t * tmp;
-    o71_kvnode_t * node = NULL;
+    o71_mem_obj_t * obj_p;
+    o71_class_t * class_p;
+    intptr_t a, b, c;
     o71_status_t os;
 
-    M2("rbtree insert (k=obref_%lX, v=obref_%lX)", key_r, value_r);
-    os = kvbag_rbtree_node_alloc(world_p, &node);
-    if (os)
+    A(o71_istr_check(world_p, field_istr_r) == O71_OK);
+
+    class_p = o71_class(world_p, obj_r);
+    if (!(class_p->model & O71M_MEM_OBJ))
     {
-        M("failed to allocate rbtree node: %s", N(os));
-        return os;
+        /* non-memory objects don't have fields */
+        return O71_MISSING;
     }
-    os = o71_ref(world_p, key_r);
-    AOS(os);
-    node->kv.key_r = key_r;
-    node->kv.value_r = value_r;
-
-    i = loc_p->rbtree.last_x;
-    node->clr[0] = 1;
-    node->clr[1] = 0;
-    ts = loc_p->rbtree.side_a[i];
-    M2("ts=%u", ts);
-    A(ts < 2);
-    SET_CHILD(loc_p->rbtree.node_a[i], ts, node);
 
-    while (i)
+    obj_p = o71_obj_ptr(world_p, obj_r);
+    a = 0;
+    b = (intptr_t) class_p->fix_field_n - 1;
+    while (a <= b)
     {
-        parent = loc_p->rbtree.node_a[i];
-        if (!IS_RED(parent)) return O71_OK;
-        // parent is red (thus it is not the root)
-        grandpa = loc_p->rbtree.node_a[--i];
-        uncle = GET_CHILD(grandpa, OTHER_SIDE(loc_p->rbtree.side_a[i]));
-        if (uncle && IS_RED(uncle))
+        o71_ref_t key_r;
+        c = (a + b) >> 1;
+        key_r = class_p->fix_field_ofs_a[c].key_r;
+        if (field_istr_r == key_r)
         {
-            SET_RED(grandpa, 1);
-            SET_RED(parent, 0);
-            SET_RED(uncle, 0);
-            node = grandpa;
-            --i;
-            continue;
+            /* found fixed field */
+            o71_ref_t * value_rp;
+            M("storing obref_%lX into fixed field at ofs %lX of obref_%lX",
+              (long) value_r, (long) class_p->fix_field_ofs_a[c].value_r,
+              (long) obj_r);
+            value_rp = (o71_ref_t *) ((uint8_t *) obj_p
+                + (intptr_t) class_p->fix_field_ofs_a[c].value_r);
+            os = set_var(world_p, value_rp, value_r);
+            AOS(os);
+            return O71_OK;
         }
-        // parent is red, uncle is black or NULL
-        if ((gs = loc_p->rbtree.side_a[i])
-            != (ps = loc_p->rbtree.side_a[i + 1]))
-        {
-            // node and parent are on different sides
-            SET_CHILD(grandpa, gs, node);
-            tmp = GET_CHILD(node, gs);
-            SET_CHILD(parent, ps, tmp);
-            SET_CHILD(node, gs, parent);
+        if (field_istr_r < key_r) b = c - 1;
+        else a = c + 1;
+    }
+    /* put field in the dynamic bag */
+    if (!class_p->dyn_field_ofs)
+    {
+        /* no bag for dynamic fields; return field is missing */
+        return O71_MISSING;
+    }
 
-            tmp = node;
-            node = parent;
-            parent = tmp;
-        }
-        else ps = OTHER_SIDE(gs);
-        // node and parent are on same side: gs; ps is set to the 'other' side
-        tmp = GET_CHILD(parent, ps);
-        SET_CHILD(parent, ps, grandpa);
-        SET_RED(parent, 0);
-        SET_CHILD(grandpa, gs, tmp);
-        SET_RED(grandpa, 1);
-        tmp = loc_p->rbtree.node_a[i - 1];
-        ts = loc_p->rbtree.side_a[i - 1];
-        SET_CHILD(tmp, ts, parent);
-        return O71_OK;
+    M2("obref_%lX dfo=0x%lX", (long) obj_r, (long) class_p->dyn_field_ofs);
+    /* the bag owns the reference to the value */
+    os = o71_ref(world_p, value_r);
+    AOS(os);
+    os = kvbag_put(world_p, (o71_kvbag_t *)
+                   ((uint8_t *) obj_p + class_p->dyn_field_ofs),
+                   field_istr_r, value_r, ref_cmp, NULL);
+    if (os)
+    {
+        o71_status_t osd;
+        osd = o71_deref(world_p, value_r);
+        AOS(osd);
     }
-    // if we processed 'til the top of the path then root is changed
-    SET_RED(node, 0);
-    return O71_OK;
+    return os;
 }
 
-#if O71_DEBUG
-/* kvbag_array_dump *********************************************************/
-static void kvbag_array_dump
+/* o71_istr_check ***********************************************************/
+O71_API o71_status_t o71_istr_check
 (
     o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p
+    o71_ref_t obj_r
 )
 {
-    unsigned int i;
-    printf("[array]");
-    for (i = 0; i < kvbag_p->n; ++i)
+    uint32_t model;
+    model = o71_model(world_p, obj_r);
+    if ((model & O71M_STRING))
     {
-        printf(" k=%lX:v=%lX",
-               kvbag_p->kv_a[i].key_r, kvbag_p->kv_a[i].value_r);
+        o71_string_t * str_p;
+        str_p = o71_obj_ptr(world_p, obj_r);
+        return str_p->mode == O71_SM_INTERN
+            ? O71_OK : O71_BAD_INTERN_STRING_REF;
     }
-
-    printf("\n");
+    if (model == O71M_INVALID) return O71_UNUSED_MEM_OBJ_SLOT;
+    return (model & O71M_MEM_OBJ) ? O71_BAD_STRING_REF : O71_NOT_MEM_OBJ_REF;
 }
-#endif
 
-/* kvbag_array_search *******************************************************/
-static o71_status_t kvbag_array_search
+/* o71_reg_class_create *****************************************************/
+O71_API o71_status_t o71_reg_class_create
 (
     o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_ref_t key_r,
-    o71_cmp_f cmp,
-    void * ctx,
-    o71_kvbag_loc_t * loc_p
+    o71_ref_t * fix_field_istr_ra,
+    size_t fix_field_n,
+    o71_ref_t * class_rp
 )
 {
-    int a, b;
+    o71_obj_index_t class_x;
+    o71_class_t * class_p;
     o71_status_t os;
-    a = 0;
-    b = kvbag_p->n - 1;
-    while (a <= b)
+    size_t i;
+    o71_ref_t super_ra[2] = { O71R_OBJECT_CLASS, O71R_REG_OBJ_CLASS };
+    os = alloc_object(world_p, O71R_CLASS_CLASS, &class_x);
+    if (os) { M("fail: %s", N(os)); return os; }
+    *class_rp = O71_MOX_TO_REF(class_x);
+    class_p = O71_OBJ_SLOT(world_p, class_x);
+    class_p->model = O71MI_MEM_OBJ;
+    class_p->rank = 1;
+    class_p->super_ra = NULL;
+    class_p->super_n = 0;
+    class_p->fix_field_ofs_a = NULL;
+    class_p->fix_field_n = 0;
+    class_p->finish = reg_obj_finish;
+    class_p->get_field = get_reg_obj_field;
+    class_p->set_field = set_reg_obj_field;
+    class_p->visit_refs = reg_obj_visit_refs;
+    class_p->object_size = sizeof(o71_reg_obj_t)
+        + sizeof(o71_ref_t) * fix_field_n;
+    class_p->dyn_field_ofs = FIELD_OFS(o71_reg_obj_t, dyn_field_bag);
+    kvbag_init(&class_p->method_bag, 0x10, O71_BAG_HASH);
+    os = class_super_extend(world_p, class_p, super_ra, ITEM_COUNT(super_ra));
+    if (os)
     {
-        int c = (a + b) >> 1;
-        unsigned int r = cmp(world_p, key_r, kvbag_p->kv_a[c].key_r, ctx);
-        // M("intern_cmp(key=%lX, bag_key=%lX) -> %s",
-        //   key_r, kvbag_p->kv_a[c].key_r,
-        //   r == O71_EQUAL ? "equal" : (r ? "more" : "less"));
-        switch (r)
-        {
-        case O71_LESS: b = c - 1; break;
-        case O71_MORE: a = c + 1; break;
-        case O71_EQUAL:
-            loc_p->array.index = c;
-#if O71_CHECKED
-            loc_p->status = O71_OK;
-#endif
-            // M("match: key_r=%lX -> index=%u", key_r, a);
-            return O71_OK;
-        default:
-            M("compare error: %s", N(r));
-            loc_p->cmp_error = r;
-            return O71_CMP_ERROR;
-        }
+        M("fail: %s", N(os));
+        free_object(world_p, class_x);
+        return os;
     }
-    // a contains the position where to insert the key
-    loc_p->array.index = a;
-#if O71_CHECKED
-            loc_p->status = O71_MISSING;
-#endif
-    M2("miss: key_r=obref_%lX -> pos=%u", key_r, a);
-    return O71_MISSING;
-}
-
-/* kvbag_array_delete *******************************************************/
-static o71_status_t kvbag_array_delete
-(
-    o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_kvbag_loc_t * loc_p
-)
-{
-    unsigned int i;
-    A(kvbag_p->n > 0);
-    kvbag_p->n--;
-    A(loc_p->array.index <= kvbag_p->n);
-    for (i = loc_p->array.index; i < kvbag_p->n; ++i)
-        kvbag_p->kv_a[i] = kvbag_p->kv_a[i + 1];
+    os = redim(world_p->allocator_p, (void * *) &class_p->fix_field_ofs_a,
+               &class_p->fix_field_n, fix_field_n, sizeof(o71_kv_t));
+    if (os)
+    {
+        o71_status_t os2;
+        M("fail: %s", N(os));
+        os2 = redim(world_p->allocator_p,
+                    (void * *) &class_p->super_ra, &class_p->super_n,
+                    0, sizeof(o71_ref_t));
+        AOS(os2);
+        free_object(world_p, class_x);
+        return os;
+    }
+    for (i = 0; i < fix_field_n; ++i)
+    {
+        class_p->fix_field_ofs_a[i].key_r = fix_field_istr_ra[i];
+        class_p->fix_field_ofs_a[i].value_r =
+            FIELD_OFS(o71_reg_obj_t, fix_field_a[i]);
+    }
+    refkv_qsort(class_p->fix_field_ofs_a, class_p->fix_field_n);
     return O71_OK;
 }
 
-/* kvbag_array_free *******************************************************/
-static o71_status_t kvbag_array_free
+/* o71_compile **************************************************************/
+O71_API o71_status_t o71_compile
 (
     o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_kv_free_f kv_free
+    o71_code_t * code_p,
+    char const * src_name,
+    uint8_t const * src_a,
+    size_t src_n
 )
 {
-    unsigned int i;
     o71_status_t os;
-    size_t m;
-    for (i = 0; i < kvbag_p->n; ++i)
+    o71_token_t * end_token_p;
+
+    code_p->allocator_p = world_p->allocator_p;
+    code_p->src_name = src_name;
+    code_p->src_a = src_a;
+    code_p->src_n = src_n;
+    code_p->token_list = NULL;
+    code_p->token_tail = &code_p->token_list;
+    arena_init(&code_p->arena, world_p->allocator_p);
+
+    os = tokenize_source(code_p);
+    if (os) return os;
+
+    init_empty_block_stmt(&code_p->body, NULL);
+    os = match_stmt_seq(code_p, &code_p->body, code_p->token_list, &end_token_p,
+                        O71_TT_END);
+    if (os) { M("ouch: %s", N(os)); return os; }
+    A(end_token_p);
+    if (end_token_p->type != O71_TT_END)
     {
-        os = kv_free(world_p, kvbag_p->kv_a + i);
-        AOS(os);
+        code_p->ce_code = O71_CE_EXP_STMT_OR_EOF;
+        code_p->ce_row = end_token_p->src_row;
+        code_p->ce_col = end_token_p->src_col;
+        code_p->ce_ofs = end_token_p->src_ofs;
+        return O71_COMPILE_ERROR;
     }
-    m = kvbag_p->m;
-    FREE_ARRAY(world_p->allocator_p, kvbag_p->kv_a, m);
+
+    code_p->ce_ofs = 0;
     return O71_OK;
 }
 
-/* kvbag_rbtree_search ******************************************************/
-static o71_status_t kvbag_rbtree_search
+/* o71_code_free ************************************************************/
+O71_API o71_status_t o71_code_free
 (
-    o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_ref_t key_r,
-    o71_cmp_f cmp,
-    void * ctx,
-    o71_kvbag_loc_t * loc_p
+    o71_code_t * code_p
 )
 {
-    o71_kvnode_t * kvnode_p;
-    unsigned int i = 0;
-    loc_p->rbtree.node_a[0] = (o71_kvnode_t *) &kvbag_p->tree_p;
-    loc_p->rbtree.side_a[0] = 0;
-    //loc_p->rbtree.last_x = 0;
-    kvnode_p = kvbag_p->tree_p;
-    while (kvnode_p)
-    {
-        unsigned int cr;
-        loc_p->rbtree.node_a[++i] = kvnode_p;
-        cr = cmp(world_p, key_r, kvnode_p->kv.key_r, ctx);
-        switch (cr)
-        {
-        case O71_LESS:
-        case O71_MORE:
-            loc_p->rbtree.side_a[i] = cr;
-            kvnode_p = GET_CHILD(kvnode_p, cr);
-            break;
-        case O71_EQUAL:
-            loc_p->rbtree.side_a[i] = cr;
-            loc_p->rbtree.last_x = i;
-#if O71_CHECKED
-            loc_p->status = O71_OK;
-#endif
-            return O71_OK;
-        default:
-            loc_p->rbtree.last_x = i;
-#if O71_CHECKED
-            loc_p->status = O71_CMP_ERROR;
-#endif
-            return O71_CMP_ERROR;
-        }
-    }
-    loc_p->rbtree.last_x = i;
-#if O71_CHECKED
-    loc_p->status = O71_MISSING;
-#endif
-    return O71_MISSING;
+    code_p->token_list = NULL;
+    code_p->token_tail = &code_p->token_list;
+    return arena_free(&code_p->arena);
 }
 
-/* kvbag_rbtree_np **********************************************************/
-static o71_kvnode_t * kvbag_rbtree_np
+/* log2_rounded_up **********************************************************/
+static uint8_t log2_rounded_up
 (
-    o71_kvbag_loc_t * loc_p,
-    unsigned int side
+    uintptr_t n
 )
 {
-  o71_kvnode_t * n;
-  o71_kvnode_t * m;
-  unsigned int d;
-
-  d = loc_p->rbtree.last_x;
-  n = loc_p->rbtree.node_a[d];
-  m = GET_CHILD(n, side);
-  //if (!m) return NULL;
-  if (m)
-  {
-      loc_p->rbtree.side_a[d] = side;
-      side = OTHER_SIDE(side);
-      for (; m; m = GET_CHILD(m, side))
-      {
-        ++d;
-        loc_p->rbtree.node_a[d] = m;
-        loc_p->rbtree.side_a[d] = side;
-      }
-  }
-  else
-  {
-      do { --d; } while (d && loc_p->rbtree.side_a[d] == side);
-      if (!d) return NULL;
-  }
-
-
-  loc_p->rbtree.side_a[d] = O71_EQUAL;
-  loc_p->rbtree.last_x = d;
-  return loc_p->rbtree.node_a[d];
+    uint8_t i;
+    /* TODO: change this to lookup tables */
+    for (i = 0; n; ++i, n >>= 1);
+    return i;
 }
 
-/* kvbag_rbtree_delete ******************************************************/
-static o71_status_t kvbag_rbtree_delete
+/* lowest_bit_index *********************************************************/
+static unsigned int lowest_bit_index
 (
-    o71_world_t * world_p,
-    o71_kvbag_t * kvbag_p,
-    o71_kvbag_loc_t * loc_p
+    uintptr_t w
 )
 {
-    o71_kvnode_t * o;
-    o71_kvnode_t * d;
-    o71_kvnode_t * p;
-    o71_kvnode_t * c;
-    o71_kvnode_t * s;
-    o71_kvnode_t * sl;
-    o71_kvnode_t * sr;
-    o71_kvnode_t * t;
-    uintptr_t tmp[2];
-    unsigned int cs, ds, od, dd, ns, pd, ps, ss, os;
+#if __GNUC__ >= 4
+    return (unsigned int) __builtin_ctzll(w);
+#else
+    unsigned int i;
+    for (i = 0; !(w & 1); ++i, w >>= 1);
+    return i;
+#endif
+}
 
-    do
+/* redim ********************************************************************/
+static o71_status_t redim_func
+(
+    o71_allocator_t * allocator_p,
+    void * * data_pp,
+    size_t * crt_count_p,
+    size_t new_count,
+    size_t item_size
+#if O71_CHECKED
+    , char const * func, unsigned int line
+#endif
+)
+{
+    size_t old_count, osize, nsize;
+    o71_status_t os;
+#define AHF (sizeof(o71_alloc_header_t) + 4)
+#if O71_CHECKED
+    o71_alloc_header_t * ah = *data_pp;
+    o71_alloc_header_t * ahp, * ahn;
+    uint32_t tag;
+    uint8_t * ftag;
+    o71_4u8_t gtag;
+#endif
+    A(item_size);
+    if (new_count > (SIZE_MAX - AHF) / item_size) return O71_ARRAY_LIMIT;
+    old_count = *crt_count_p;
+    if (new_count > old_count
+        && (new_count - old_count) * item_size
+            > allocator_p->mem_limit - allocator_p->mem_usage)
     {
-        od = loc_p->rbtree.last_x;
-        o = loc_p->rbtree.node_a[od]; // the node we want to delete
-        if (GET_CHILD(o, O71_LESS) && GET_CHILD(o, O71_MORE))
+        M("reached mem limit");
+        return O71_MEM_LIMIT;
+    }
+#if O71_CHECKED
+    if (old_count)
+    {
+        --ah;
+        if (ah->allocator_p != allocator_p)
         {
-            ds = loc_p->rbtree.side_a[od - 1];
-            d = kvbag_rbtree_np(loc_p, (uint8_t) ds);
-            // now must delete d which has at most 1 non-null child
-            dd = loc_p->rbtree.last_x;
-            tmp[0] = o->clr[0]; tmp[1] = o->clr[1];
-            o->clr[0] = d->clr[0]; o->clr[1] = d->clr[1];
-            d->clr[0] = tmp[0]; d->clr[1] = tmp[1];
-            loc_p->rbtree.node_a[od] = d;
-            t = loc_p->rbtree.node_a[od - 1];
-            os = loc_p->rbtree.side_a[od - 1];
-            SET_CHILD(t, os, d);
+            M("bad allocator: %p instead of %p", ah->allocator_p, allocator_p);
+            return O71_BUG;
         }
-        else { dd = od; }
-
-        d = o;
-
-        cs = GET_CHILD(d, 0) ? O71_LESS : O71_MORE;
-        c = GET_CHILD(d, cs); // c is the only child of d or NULL
+        if (old_count * item_size != ah->size)
+        {
+            M("bad old size: p=%p (%s():%u), recorded size 0x%zX, specified size: 0x%zX",
+              ah + 1, ah->func, ah->line, ah->size, old_count * item_size);
+            return O71_BUG;
+        }
+        tag = (uint32_t) (uintptr_t) *data_pp ^ 0xA5A5A5A5;
+        if (ah->tag != tag)
+        {
+            M("corrupt block %p from %s():%u", *data_pp, ah->func, ah->line);
+            return O71_BUG;
+        }
+        ftag = (uint8_t *) *data_pp + old_count * item_size;
+        gtag.u8[0] = ftag[0];
+        gtag.u8[1] = ftag[1];
+        gtag.u8[2] = ftag[2];
+        gtag.u8[3] = ftag[3];
+        if (gtag.u32 != tag)
+        {
+            M("corrupt block %p from %s():%u", *data_pp, ah->func, ah->line);
+            return O71_BUG;
+        }
+        if (!new_count)
+        {
+            M("removing allocated block %p (%s():%u) from list before freeing",
+              *data_pp, ah->func, ah->line);
 
-        ds = loc_p->rbtree.side_a[dd - 1];
-        p = loc_p->rbtree.node_a[dd - 1];
-        if (IS_RED(d))
+            ahn = ah->next_p;
+            ahp = ah->prev_p;
+            ahn->prev_p = ahp;
+            ahp->next_p = ahn;
+        }
+        osize = AHF + old_count * item_size;
+    }
+    else osize = 0;
+    ah = *data_pp; --ah;
+    if (new_count)
+    {
+        nsize = AHF + new_count * item_size;
+        M("reallocating %p (osize=0x%zX, nsize=0x%zX)", *data_pp, old_count * item_size, new_count * item_size);
+        os = allocator_p->realloc((void * *) &ah, osize, nsize,
+                                  allocator_p->context);
+        A(os == O71_OK || os == O71_NO_MEM || os >= O71_FATAL);
+        if (os)
         {
-            // d has no children since it has at most 1 non-null child and
-            // both paths must have same ammount of black node_a
-            SET_CHILD(p, ds, NULL);
-            break;
+            M("realloc failed: %u", os);
+            return os;
         }
-        // d is black; it has either no children, or a single red child with no
-        // children of its own
-        if (c) // same as: (c && c->red)
+        *data_pp = (void *) (ah + 1);
+        ah->allocator_p = allocator_p;
+        if (osize)
         {
-            SET_CHILD(p, ds, c);
-            SET_RED(c, 0);
-            break;
+            M("realloc fine, updating links for %p (%s():%u)",
+              *data_pp, ah->func, ah->line);
+            ah->next_p->prev_p = ah;
+            ah->prev_p->next_p = ah;
+        }
+        else
+        {
+            ahp = allocator_p->list.prev_p;
+            ahp->next_p = ah;
+            allocator_p->list.prev_p = ah;
+            ah->prev_p = ahp;
+            ah->next_p = &allocator_p->list;
+        ah->func = func;
+        ah->line = line;
         }
 
-        // d is black and has no children (if c is black and its sibling is NULL then
-        // it must be NULL itself)
+        ah->size = new_count * item_size;
+        tag = (uint32_t) (uintptr_t) *data_pp ^ 0xA5A5A5A5;
+        ah->tag = tag;
+        gtag.u32 = tag;
+        ftag = (uint8_t *) *data_pp + new_count * item_size;
+        ftag[0] = gtag.u8[0];
+        ftag[1] = gtag.u8[1];
+        ftag[2] = gtag.u8[2];
+        ftag[3] = gtag.u8[3];
+    }
+    else
+    {
+        os = allocator_p->realloc((void * *) &ah, osize, 0,
+                                  allocator_p->context);
+        A(os == O71_OK || os == O71_NO_MEM || os >= O71_FATAL);
+        if (os)
+        {
+            M("free failed: %u", os);
+            return os;
+        }
 
-        SET_CHILD(p, ds, NULL);
+    }
 
-        for (pd = dd - 1; pd; p = loc_p->rbtree.node_a[--pd])
-        {
-            // n is always black (in first iteration it is NULL)
-            ns = loc_p->rbtree.side_a[pd];
-            ss = OTHER_SIDE(ns);
-            s = GET_CHILD(p, ss); // this is a non-NULL node
-            if (IS_RED(s)) // implies p is black
-            {
-                /* del case 2 */
-                t = loc_p->rbtree.node_a[pd - 1];
-                ps = loc_p->rbtree.side_a[pd - 1];
-                SET_CHILD(t, ps, s);
-                sl = GET_CHILD(s, ns);
-                SET_CHILD(p, ss, sl);
-                SET_RED(p, 1);
-                SET_CHILD(s, ns, p);
-                SET_RED(s, 0);
-                loc_p->rbtree.node_a[pd] = s;
-                ++pd;
-                s = sl; /* new s is black */
-            }
-            else
-            {
-                // s is black
-                if (!IS_RED(p) && !IS_RED(GET_CHILD(s, 0)) && !IS_RED(GET_CHILD(s, 1)))
-                {
-                    /* del case 3 */
-                    SET_RED(s, 1);
-                    continue;
-                }
-            }
-            // s must be black
-            sl = GET_CHILD(s, ns);
-            sr = GET_CHILD(s, ss);
-            if (IS_RED(p) && !IS_RED(sl) && !IS_RED(sr))
-            {
-                /* del case 4 */
-                SET_RED(p, 0);
-                SET_RED(s, 1);
-                break;
-            }
-            if (IS_RED(sl) && !IS_RED(sr))
+#else
+    os = allocator_p->realloc(data_pp, old_count * item_size,
+                              new_count * item_size, allocator_p->context);
+    A(os == O71_OK || os == O71_NO_MEM || os >= O71_FATAL);
+    if (os)
+    {
+        M("realloc failed: %u", os);
+        return os;
+    }
+#endif
+
+    /* allocated block must be pointer aligned */
+    //M("p=%p", *data_pp);
+    A(!new_count || ((uintptr_t) *data_pp & (sizeof(uintptr_t) - 1)) == 0);
+    *crt_count_p = new_count;
+    allocator_p->mem_usage += (new_count - old_count) * item_size;
+    if (allocator_p->mem_usage > allocator_p->mem_peak)
+        allocator_p->mem_peak = allocator_p->mem_usage;
+    return O71_OK;
+}
+
+/* extend_array *************************************************************/
+static o71_status_t extend_array
+(
+    o71_allocator_t * allocator_p,
+    void * * extra_ap,
+    void * * data_ap,
+    size_t * crt_alloc_count_p,
+    size_t * crt_used_count_p,
+    size_t extra_count,
+    size_t item_size
+)
+{
+    size_t used_n, new_n, new_m;
+    o71_status_t os;
+
+    used_n = *crt_used_count_p;
+    new_n = extra_count + used_n;
+    if (new_n < used_n || (ptrdiff_t) new_n < 0) return O71_ARRAY_LIMIT;
+
+    if (new_n > *crt_alloc_count_p)
+    {
+        new_m = 1 << log2_rounded_up(new_n);
+        os = redim(allocator_p, data_ap, crt_alloc_count_p, new_m, item_size);
+        if (os) return os;
+    }
+    *extra_ap = ((uint8_t *) *data_ap) + used_n * item_size;
+    *crt_used_count_p += extra_count;
+
+    return O71_OK;
+}
+
+/* slab_alloc ***************************************************************/
+static o71_status_t slab_alloc
+(
+    o71_allocator_t * allocator_p,
+    void * * body_pp,
+    size_t size
+)
+{
+    o71_slab_pool_t * pool_p;
+    o71_slab_t * slab_p;
+    void * * chunk_p;
+    size_t slab_size;
+    o71_status_t os;
+
+    A(size);
+    if (size > O71_SLAB_CLASS_N * O71_SLAB_GRAIN)
+    {
+        slab_size = 0;
+        return redim(allocator_p, body_pp, &slab_size, size, 1);
+    }
+
+    pool_p = &allocator_p->slab_pool_a[(size - 1) / O71_SLAB_GRAIN];
+    slab_p = pool_p->partial_p;
+    if (!slab_p)
+    {
+        slab_p = pool_p->empty_p;
+        if (slab_p) pool_p->empty_p = NULL;
+        else
+        {
+            slab_size = 0;
+            os = redim(allocator_p, (void * *) &slab_p, &slab_size,
+                       sizeof(o71_slab_t) + pool_p->chunk_n * pool_p->chunk_size,
+                       1);
+            if (os)
             {
-                SET_CHILD(p, ss, sl);
-                SET_CHILD(s, ns, GET_CHILD(sl, ss));
-                SET_RED(s, 1);
-                SET_CHILD(sl, ss, s);
-                SET_RED(sl, 0);
-                s = sl; // again new s is black
-                sl = GET_CHILD(s, ns);
-                sr = GET_CHILD(s, ss);
+                M("failed allocating slab for chunks of 0x%zX bytes: %s",
+                  pool_p->chunk_size, N(os));
+                return os;
             }
-            if (IS_RED(sr))
+            slab_p->pool_p = pool_p;
+        }
+        slab_p->free_chunk_p = NULL;
+        slab_p->used_n = 0;
+        slab_p->fresh_x = 0;
+        slab_p->prev_p = NULL;
+        slab_p->next_p = NULL;
+        pool_p->partial_p = slab_p;
+    }
+
+    if (slab_p->free_chunk_p)
+    {
+        chunk_p = slab_p->free_chunk_p;
+        slab_p->free_chunk_p = chunk_p[1];
+    }
+    else
+    {
+        chunk_p = (void * *) ((uint8_t *) (slab_p + 1)
+                              + slab_p->fresh_x * pool_p->chunk_size);
+        slab_p->fresh_x += 1;
+        chunk_p[0] = slab_p;
+    }
+    A(chunk_p[0] == slab_p);
+
+    slab_p->used_n += 1;
+    if (slab_p->used_n == pool_p->chunk_n)
+    {
+        /* slab is full; take it out of the partial list */
+        pool_p->partial_p = slab_p->next_p;
+        if (slab_p->next_p) slab_p->next_p->prev_p = NULL;
+    }
+    *body_pp = chunk_p + 1;
+    return O71_OK;
+}
+
+/* slab_alloc_run ***********************************************************/
+static o71_status_t slab_alloc_run
+(
+    o71_allocator_t * allocator_p,
+    void * * body_pp,
+    size_t * stride_p,
+    size_t * n_p,
+    size_t size
+)
+{
+    o71_slab_pool_t * pool_p;
+    o71_slab_t * slab_p;
+    void * * chunk_p;
+    size_t slab_size, n, i;
+    o71_status_t os;
+
+    A(size);
+    A(*n_p);
+    if (size > O71_SLAB_CLASS_N * O71_SLAB_GRAIN)
+    {
+        *n_p = 1;
+        *stride_p = size;
+        slab_size = 0;
+        return redim(allocator_p, body_pp, &slab_size, size, 1);
+    }
+
+    pool_p = &allocator_p->slab_pool_a[(size - 1) / O71_SLAB_GRAIN];
+    slab_p = pool_p->partial_p;
+    if (!slab_p || slab_p->fresh_x == pool_p->chunk_n)
+    {
+        /* the run needs unused chunks; start a slab in front of the
+         * partial list */
+        slab_p = pool_p->empty_p;
+        if (slab_p) pool_p->empty_p = NULL;
+        else
+        {
+            slab_size = 0;
+            os = redim(allocator_p, (void * *) &slab_p, &slab_size,
+                       sizeof(o71_slab_t) + pool_p->chunk_n * pool_p->chunk_size,
+                       1);
+            if (os)
             {
-                t = loc_p->rbtree.node_a[pd - 1];
-                ps = loc_p->rbtree.side_a[pd - 1];
-                SET_CHILD(t, ps, s);
-                SET_CHILD(p, ss, sl);
-                SET_RED(s, IS_RED(p));
-                SET_RED(p, 0);
-                SET_RED(sr, 0);
-                SET_CHILD(s, ns, p);
+                M("failed allocating slab for chunks of 0x%zX bytes: %s",
+                  pool_p->chunk_size, N(os));
+                return os;
             }
-            break;
+            slab_p->pool_p = pool_p;
         }
-    }
-    while (0);
-    kvbag_rbtree_node_free(world_p, o, kv_nop_free);
+        slab_p->free_chunk_p = NULL;
+        slab_p->used_n = 0;
+        slab_p->fresh_x = 0;
+        slab_p->prev_p = NULL;
+        slab_p->next_p = pool_p->partial_p;
+        if (pool_p->partial_p) pool_p->partial_p->prev_p = slab_p;
+        pool_p->partial_p = slab_p;
+    }
+
+    n = pool_p->chunk_n - slab_p->fresh_x;
+    if (n > *n_p) n = *n_p;
+    chunk_p = (void * *) ((uint8_t *) (slab_p + 1)
+                          + slab_p->fresh_x * pool_p->chunk_size);
+    for (i = 0; i < n; ++i)
+        *(void * *) ((uint8_t *) chunk_p + i * pool_p->chunk_size) = slab_p;
+    slab_p->fresh_x += n;
+    slab_p->used_n += n;
+    if (slab_p->used_n == pool_p->chunk_n)
+    {
+        /* slab is full; take it out of the partial list */
+        pool_p->partial_p = slab_p->next_p;
+        if (slab_p->next_p) slab_p->next_p->prev_p = NULL;
+    }
+    *body_pp = chunk_p + 1;
+    *stride_p = pool_p->chunk_size;
+    *n_p = n;
     return O71_OK;
 }
 
-#if O71_DEBUG
-static void obj_dump
+/* slab_free ****************************************************************/
+static o71_status_t slab_free
 (
-    o71_world_t * world_p,
-    o71_ref_t obj_r
+    o71_allocator_t * allocator_p,
+    void * body_p,
+    size_t size
 )
 {
-    o71_obj_index_t obj_x;
-    unsigned int om;
-    if (O71_IS_REF_TO_SINT(obj_r))
+    o71_slab_pool_t * pool_p;
+    o71_slab_t * slab_p;
+    void * * chunk_p;
+    size_t slab_size;
+    o71_status_t os;
+
+    if (size > O71_SLAB_CLASS_N * O71_SLAB_GRAIN)
     {
-        printf("%ld", (long) O71_REF_TO_SINT(obj_r));
-        return;
+        slab_size = size;
+        return redim(allocator_p, &body_p, &slab_size, 0, 1);
     }
-    obj_x = O71_REF_TO_MOX(obj_r);
-    if (obj_x >= world_p->obj_n || IS_FREE_OBJECT_SLOT(world_p->obj_pa[obj_x]))
+
+    chunk_p = (void * *) body_p - 1;
+    slab_p = chunk_p[0];
+    pool_p = slab_p->pool_p;
+    A(pool_p == &allocator_p->slab_pool_a[(size - 1) / O71_SLAB_GRAIN]);
+    A(slab_p->used_n);
+
+    chunk_p[1] = slab_p->free_chunk_p;
+    slab_p->free_chunk_p = chunk_p;
+    if (slab_p->used_n == pool_p->chunk_n)
     {
-        printf("BAD_REF_%lX", (long) obj_r);
-        return;
+        /* slab was full; put it back in the partial list */
+        slab_p->prev_p = NULL;
+        slab_p->next_p = pool_p->partial_p;
+        if (pool_p->partial_p) pool_p->partial_p->prev_p = slab_p;
+        pool_p->partial_p = slab_p;
     }
-    om = o71_model(world_p, obj_r);
-    if ((om & O71M_STRING))
+    slab_p->used_n -= 1;
+    if (slab_p->used_n) return O71_OK;
+
+    /* slab is empty; unlink it and either cache it or release it */
+    if (slab_p->prev_p) slab_p->prev_p->next_p = slab_p->next_p;
+    else pool_p->partial_p = slab_p->next_p;
+    if (slab_p->next_p) slab_p->next_p->prev_p = slab_p->prev_p;
+
+    if (!pool_p->empty_p)
     {
-        o71_string_t * str_p = world_p->obj_pa[obj_x];
-        printf("%sstr_%lX(\"%.*s\")",
-               str_p->mode == O71_SM_MODIFIABLE ? "" :
-               (str_p->mode == O71_SM_READ_ONLY ? "ro" : "i"),
-               (long) obj_r, (int) str_p->n, str_p->a);
-        return;
+        pool_p->empty_p = slab_p;
+        return O71_OK;
     }
-    printf("obj_%lX", obj_r);
+    slab_size = sizeof(o71_slab_t) + pool_p->chunk_n * pool_p->chunk_size;
+    os = redim(allocator_p, (void * *) &slab_p, &slab_size, 0, 1);
+    return os;
 }
 
-#endif
+/* slab_trim ****************************************************************/
+static o71_status_t slab_trim
+(
+    o71_allocator_t * allocator_p
+)
+{
+    o71_slab_pool_t * pool_p;
+    size_t slab_size;
+    unsigned int i;
+    o71_status_t os;
 
-/* class_super_extend *******************************************************/
-static o71_status_t class_super_extend
+    for (i = 0; i < O71_SLAB_CLASS_N; ++i)
+    {
+        pool_p = &allocator_p->slab_pool_a[i];
+        if (!pool_p->empty_p) continue;
+        slab_size = sizeof(o71_slab_t) + pool_p->chunk_n * pool_p->chunk_size;
+        os = redim(allocator_p, (void * *) &pool_p->empty_p, &slab_size, 0, 1);
+        if (os) return os;
+        pool_p->empty_p = NULL;
+    }
+    return O71_OK;
+}
+
+/* arena_init ***************************************************************/
+static void arena_init
 (
-    o71_world_t * world_p,
-    o71_class_t * class_p,
-    o71_ref_t * super_ra,
-    size_t super_n
+    o71_arena_t * arena_p,
+    o71_allocator_t * allocator_p
+)
+{
+    arena_p->allocator_p = allocator_p;
+    arena_p->chunk_p = NULL;
+    arena_p->crt_p = NULL;
+    arena_p->free_n = 0;
+}
+
+/* arena_alloc **************************************************************/
+static o71_status_t arena_alloc
+(
+    o71_arena_t * arena_p,
+    void * * data_pp,
+    size_t size
 )
 {
+    o71_arena_chunk_t * chunk_p;
+    size_t chunk_size;
     o71_status_t os;
-    size_t i, j;
-    ptrdiff_t x;
 
-#if O71_DEBUG
+    size = (size + sizeof(void *) - 1) & -sizeof(void *);
+    if (size <= arena_p->free_n)
     {
-        ptrdiff_t i;
-        printf("class_super_extend: class_p=%p, existing super_ra=[", class_p);
-        if (class_p->super_n)
-        {
-            for (i = 0; i < (ptrdiff_t) class_p->super_n - 1; ++i)
-                printf("o%lX, ", class_p->super_ra[i]);
-            printf("o%lX", class_p->super_ra[i]);
-        }
-        printf("], new_super_ra=[");
-        if (super_n)
-        {
-            for (i = 0; i < (ptrdiff_t) super_n - 1; ++i)
-                printf("o%lX, ", super_ra[i]);
-            printf("o%lX", super_ra[i]);
-        }
+        *data_pp = arena_p->crt_p;
+        arena_p->crt_p += size;
+        arena_p->free_n -= size;
+        return O71_OK;
+    }
 
-        printf("] => ");
+    chunk_size = size > (O71_ARENA_CHUNK_SIZE >> 2)
+        ? size : O71_ARENA_CHUNK_SIZE - sizeof(o71_arena_chunk_t);
+    if (chunk_size > SIZE_MAX - sizeof(o71_arena_chunk_t))
+        return O71_ARRAY_LIMIT;
+    chunk_p = NULL;
+    chunk_size += sizeof(o71_arena_chunk_t);
+    {
+        size_t n = 0;
+        os = redim(arena_p->allocator_p, (void * *) &chunk_p, &n,
+                   chunk_size, 1);
     }
-#endif
-    /* get rid of superclasses already in the list */
-    for (i = 0; i < super_n; )
+    if (os)
     {
-        x = ref_search(class_p->super_ra, class_p->super_n, super_ra[i]);
-        if (x >= 0)
-        {
-            super_ra[i] = super_ra[--super_n];
-            continue;
-        }
-        ++i;
+        M("failed allocating arena chunk of 0x%zX bytes: %s",
+          chunk_size, N(os));
+        return os;
+    }
+    chunk_p->size = chunk_size - sizeof(o71_arena_chunk_t);
+    *data_pp = chunk_p + 1;
+    if (size == chunk_p->size && arena_p->chunk_p)
+    {
+        /* dedicated chunk; keep bumping in the current one */
+        chunk_p->prev_p = arena_p->chunk_p->prev_p;
+        arena_p->chunk_p->prev_p = chunk_p;
+        return O71_OK;
     }
+    chunk_p->prev_p = arena_p->chunk_p;
+    arena_p->chunk_p = chunk_p;
+    arena_p->crt_p = (uint8_t *) (chunk_p + 1) + size;
+    arena_p->free_n = chunk_p->size - size;
+    return O71_OK;
+}
 
-    /* sort the ones to introduce */
-    ref_qsort(super_ra, super_n);
+/* arena_free ***************************************************************/
+static o71_status_t arena_free
+(
+    o71_arena_t * arena_p
+)
+{
+    o71_arena_chunk_t * chunk_p;
+    size_t n;
+    o71_status_t os;
 
-    for (i = 1; i < super_n && super_ra[i - 1] < super_ra[i]; ++i);
-    if (i < super_n)
+    while ((chunk_p = arena_p->chunk_p))
     {
-        for (j = i - 1; i < super_n; ++i)
-            if (super_ra[j] < super_ra[i]) super_ra[++j] = super_ra[i];
-        super_n = j;
-#if _DEBUG
-        {
-            ptrdiff_t i;
-            printf("new_super_ra after sort & uniq =[");
-            if (super_n)
+        arena_p->chunk_p = chunk_p->prev_p;
+        n = sizeof(o71_arena_chunk_t) + chunk_p->size;
+        os = redim(arena_p->allocator_p, (void * *) &chunk_p, &n, 0, 1);
+        if (os) return os;
+    }
+    arena_p->crt_p = NULL;
+    arena_p->free_n = 0;
+    return O71_OK;
+}
+
+/* flow_init ****************************************************************/
+static void flow_init
+(
+    o71_world_t * world_p,
+    o71_flow_t * flow_p
+)
+{
+    flow_p->world_p = world_p;
+    flow_p->exe_ctx_r = O71R_NULL;
+    flow_p->value_r = O71R_NULL;
+    flow_p->exc_r = O71R_NULL;
+    flow_p->depth = 0;
+    flow_p->flow_id = world_p->flow_id_seed++;
+}
+
+/* extend_object_table ******************************************************/
+static o71_status_t extend_object_table
+(
+    o71_world_t * world_p
+)
+{
+    size_t i, n, m, page_x;
+    void * * page_a;
+    uintptr_t * bmp_a;
+    o71_status_t os;
+    n = world_p->obj_n;
+    if (n > (SIZE_MAX >> 2) - O71_OBJ_PAGE_SIZE) return O71_ARRAY_LIMIT;
+    page_x = n >> O71_OBJ_PAGE_BITS;
+    if (page_x == world_p->obj_page_m)
+    {
+        /* only the page directory is copied; pages stay in place */
+        m = page_x ? page_x << 1 : 4;
+        os = redim(world_p->allocator_p, (void * *) &world_p->obj_page_pa,
+                   &world_p->obj_page_m, m, sizeof(void * *));
+        if (os)
+        {
+            M("failed extending object page directory to %zu items", m);
+            return os;
+        }
+    }
+    page_a = NULL;
+    m = 0;
+    os = redim(world_p->allocator_p, (void * *) &page_a, &m,
+               OBJ_PAGE_ITEM_N, sizeof(void *));
+    if (os)
+    {
+        M("failed allocating object table page %zu", page_x);
+        return os;
+    }
+    world_p->obj_page_pa[page_x] = page_a;
+    world_p->obj_n = n + O71_OBJ_PAGE_SIZE;
+    bmp_a = OBJ_PAGE_BMP(world_p, page_x);
+    for (i = 0; i < O71_OBJ_PAGE_SIZE; ++i) page_a[i] = FREE_OBJECT_SLOT;
+    for (i = 0; i < O71_OBJ_PAGE_BMP_N; ++i) bmp_a[i] = UINTPTR_MAX;
+    if (!n)
+    {
+        /* builtin objects live in the world structure */
+        for (i = 0; i < O71X__COUNT; ++i)
+            bmp_a[i / BMP_BITS] &= ~((uintptr_t) 1 << (i % BMP_BITS));
+    }
+    return O71_OK;
+}
+
+/* alloc_object_index *******************************************************/
+static o71_status_t alloc_object_index
+(
+    o71_world_t * world_p,
+    o71_obj_index_t * obj_xp
+)
+{
+    o71_status_t os;
+    uintptr_t * bmp_p;
+    size_t wx, wn;
+    unsigned int b;
+
+    /* take the lowest free index */
+    wn = world_p->obj_n / BMP_BITS;
+    for (wx = world_p->free_scan_x; wx < wn; ++wx)
+        if (OBJ_PAGE_BMP(world_p, wx / O71_OBJ_PAGE_BMP_N)
+            [wx % O71_OBJ_PAGE_BMP_N]) break;
+    if (wx == wn)
+    {
+        os = extend_object_table(world_p);
+        if (os) return os;
+    }
+    world_p->free_scan_x = wx;
+    bmp_p = OBJ_PAGE_BMP(world_p, wx / O71_OBJ_PAGE_BMP_N)
+        + wx % O71_OBJ_PAGE_BMP_N;
+    b = lowest_bit_index(*bmp_p);
+    *bmp_p &= ~((uintptr_t) 1 << b);
+    *obj_xp = wx * BMP_BITS + b;
+    M2("allocated=obref_%lX, obj_n=%lX",
+       (long) O71_MOX_TO_REF(*obj_xp), (long) world_p->obj_n);
+
+    return O71_OK;
+}
+
+/* alloc_object_index_n *****************************************************/
+static o71_status_t alloc_object_index_n
+(
+    o71_world_t * world_p,
+    o71_obj_index_t * obj_xa,
+    size_t n
+)
+{
+    o71_status_t os;
+    uintptr_t * bmp_p;
+    uintptr_t w;
+    size_t wx, i;
+    unsigned int b;
+
+    wx = world_p->free_scan_x;
+    for (i = 0; i < n; )
+    {
+        if (wx == world_p->obj_n / BMP_BITS)
+        {
+            os = extend_object_table(world_p);
+            if (os)
             {
-                for (i = 0; i < (ptrdiff_t) super_n - 1; ++i)
-                    printf("o%lX, ", super_ra[i]);
-                printf("o%lX", super_ra[i]);
+                while (i) free_object_index(world_p, obj_xa[--i]);
+                return os;
             }
+        }
+        bmp_p = OBJ_PAGE_BMP(world_p, wx / O71_OBJ_PAGE_BMP_N)
+            + wx % O71_OBJ_PAGE_BMP_N;
+        for (w = *bmp_p; w && i < n; w &= w - 1)
+        {
+            b = lowest_bit_index(w);
+            obj_xa[i++] = wx * BMP_BITS + b;
+        }
+        *bmp_p = w;
+        if (!w) ++wx;
+    }
+    world_p->free_scan_x = wx;
+    M2("allocated %zu indices from obref_%lX, obj_n=%lX", n,
+       (long) O71_MOX_TO_REF(obj_xa[0]), (long) world_p->obj_n);
 
-            printf("] => ");
+    return O71_OK;
+}
+
+/* free_object_index ********************************************************/
+static o71_status_t free_object_index
+(
+    o71_world_t * world_p,
+    o71_obj_index_t obj_x
+)
+{
+    size_t wx;
+    A(obj_x < world_p->obj_n);
+    A(obj_x >= O71X__COUNT);
+    O71_OBJ_SLOT(world_p, obj_x) = FREE_OBJECT_SLOT;
+    wx = obj_x / BMP_BITS;
+    OBJ_PAGE_BMP(world_p, obj_x >> O71_OBJ_PAGE_BITS)[wx % O71_OBJ_PAGE_BMP_N]
+        |= (uintptr_t) 1 << (obj_x % BMP_BITS);
+    if (wx < world_p->free_scan_x) world_p->free_scan_x = wx;
+    return O71_OK;
+}
+
+/* alloc_object *************************************************************/
+static o71_status_t alloc_object
+(
+    o71_world_t * world_p,
+    o71_ref_t class_r,
+    o71_obj_index_t * obj_xp
+)
+{
+    o71_status_t os;
+    o71_class_t * class_p;
+    o71_obj_index_t obj_x;
+
+    A(o71_model(world_p, class_r) & O71M_CLASS);
+
+    os = alloc_object_index(world_p, obj_xp);
+    if (os)
+    {
+        M("failed to alloc obj index: %s", N(os));
+        return os;
+    }
+    obj_x = *obj_xp;
+    class_p = O71_OBJ_SLOT(world_p, O71_REF_TO_MOX(class_r));
+    os = slab_alloc(world_p->allocator_p, &O71_OBJ_SLOT(world_p, obj_x),
+                    class_p->object_size);
+    if (os)
+    {
+        M("failed to allocate memory for object instance: %s", N(os));
+        free_object_index(world_p, obj_x);
+        return (os);
+    }
+
+    os = o71_ref(world_p, class_r);
+#if O71_CHECKED
+    if (os)
+    {
+        M("ref(class=obref_%lX): %s", (long) class_r, N(os));
+        return os;
+    }
+#else
+    (void) os;
+#endif
+
+    MEM_OBJ_PTR(world_p, obj_x)->class_r = class_r;
+    MEM_OBJ_PTR(world_p, obj_x)->ref_n = 1;
+    world_p->gc_alloc_n += 1;
+
+    return O71_OK;
+}
+
+/* alloc_object_n ***********************************************************/
+static o71_status_t alloc_object_n
+(
+    o71_world_t * world_p,
+    o71_ref_t class_r,
+    size_t n,
+    o71_obj_index_t * obj_xa
+)
+{
+    o71_status_t os;
+    o71_class_t * class_p;
+    o71_mem_obj_t * obj_p;
+    uint8_t * body_p;
+    size_t i, j, run_n, stride;
+
+    A(o71_model(world_p, class_r) & O71M_CLASS);
+    A(n);
+
+    class_p = O71_OBJ_SLOT(world_p, O71_REF_TO_MOX(class_r));
+#if O71_CHECKED
+    os = o71_check_mem_obj_ref(world_p, class_r);
+    if (os) return os;
+    if (class_p->hdr.ref_n <= 0) return O71_OBJ_DESTRUCTING;
+    if (!O71_IS_IMMORTAL_REF_N(class_p->hdr.ref_n)
+        && (size_t) (O71_IMMORTAL_REF_N - 1 - class_p->hdr.ref_n) < n)
+    {
+        M("ref(class=obref_%lX) by %zu overflows", (long) class_r, n);
+        return O71_REF_COUNT_OVERFLOW;
+    }
+#endif
+
+    os = alloc_object_index_n(world_p, obj_xa, n);
+    if (os)
+    {
+        M("failed to alloc %zu obj indices: %s", n, N(os));
+        return os;
+    }
+
+    for (i = 0; i < n; i += run_n)
+    {
+        run_n = n - i;
+        os = slab_alloc_run(world_p->allocator_p, (void * *) &body_p, &stride,
+                            &run_n, class_p->object_size);
+        if (os)
+        {
+            M("failed to allocate memory for object instances: %s", N(os));
+            for (j = 0; j < i; ++j)
+                slab_free(world_p->allocator_p,
+                          O71_OBJ_SLOT(world_p, obj_xa[j]),
+                          class_p->object_size);
+            for (j = 0; j < n; ++j) free_object_index(world_p, obj_xa[j]);
+            return os;
+        }
+        for (j = i; j < i + run_n; ++j, body_p += stride)
+        {
+            O71_OBJ_SLOT(world_p, obj_xa[j]) = body_p;
+            obj_p = (o71_mem_obj_t *) body_p;
+            obj_p->class_r = class_r;
+            obj_p->ref_n = 1;
+        }
+    }
+
+    /* one reference to the class for each instance */
+    if (!O71_IS_IMMORTAL_REF_N(class_p->hdr.ref_n)) class_p->hdr.ref_n += n;
+    world_p->gc_alloc_n += n;
+    M2("obref_%lX.ref -> %lX", (long) class_r, (long) class_p->hdr.ref_n);
+
+    return O71_OK;
+}
+
+/* free_object **************************************************************/
+static o71_status_t free_object
+(
+    o71_world_t * world_p,
+    o71_ref_t obj_x
+)
+{
+    o71_class_t * class_p;
+    o71_mem_obj_t * obj_p;
+    o71_ref_t class_r;
+    o71_status_t os;
+    obj_p = O71_OBJ_SLOT(world_p, obj_x);
+    class_r = obj_p->class_r;
+    class_p = O71_OBJ_SLOT(world_p, O71_REF_TO_MOX(class_r));
+    os = slab_free(world_p->allocator_p, obj_p, class_p->object_size);
+    if (os)
+    {
+        M("*** BUG *** error freeing object memory: %s", N(os));
+        return os;
+    }
+    os = free_object_index(world_p, obj_x);
+#if O71_CHECKED
+    if (os)
+    {
+        M("free_object_index(obref_%lX) failed: %s",
+          (long) O71_MOX_TO_REF(obj_x), N(os));
+        return os;
+    }
+#endif
+    os = o71_deref(world_p, class_r);
+    AOS(os);
+    return O71_OK;
+}
+
+/* noop_object_finish *******************************************************/
+o71_status_t noop_object_finish
+(
+    o71_world_t * world_p,
+    o71_ref_t obj_r
+)
+{
+    M2("finished obref_%lX", (long) obj_r);
+    return O71_OK;
+}
+
+/* class_finish *************************************************************/
+o71_status_t class_finish
+(
+    o71_world_t * world_p,
+    o71_ref_t class_r
+)
+{
+    o71_status_t os;
+    o71_class_t * class_p;
+    size_t i;
+
+    M("class finish");
+    /* get class object */
+    class_p = O71_OBJ_SLOT(world_p, O71_REF_TO_MOX(class_r));
+
+    /* deref all superclasses */
+    for (i = 0; i < class_p->super_n; ++i)
+    {
+        os = o71_deref(world_p, class_p->super_ra[i]);
+        AOS(os);
+    }
+    /* free superclasses array */
+    FREE_ARRAY(world_p->allocator_p, class_p->super_ra, class_p->super_n);
+
+    /* deref all fixed fields */
+    for (i = 0; i < class_p->fix_field_n; ++i)
+    {
+        os = o71_deref(world_p, class_p->fix_field_ofs_a[i].key_r);
+        AOS(os);
+    }
+    /* free fixed fields array */
+    FREE_ARRAY(world_p->allocator_p, class_p->fix_field_ofs_a, class_p->fix_field_n);
+
+    /* free method bag */
+    os = kvbag_free(world_p, &class_p->method_bag, deref_key_and_value);
+    AOS(os);
+
+    return os;
+}
+
+/* alloc_exc ****************************************************************/
+static o71_status_t alloc_exc
+(
+    o71_world_t * world_p,
+    o71_ref_t class_r,
+    o71_obj_index_t * obj_xp
+)
+{
+    o71_class_t * class_p;
+    o71_exception_t * exc_p;
+    o71_status_t os;
+
+    class_p = o71_obj_ptr(world_p, class_r);
+    (void) class_p;
+    A((class_p->model & O71M_EXCEPTION));
+    os = alloc_object(world_p, class_r, obj_xp);
+    if (os) return os;
+    exc_p = O71_OBJ_SLOT(world_p, *obj_xp);
+    kvbag_init(&exc_p->dyn_field_bag, 0x10, O71_BAG_HASH);
+    exc_p->exe_ctx_r = O71R_NULL;
+
+    return O71_OK;
+}
+
+/* get_missing_field ********************************************************/
+static o71_status_t get_missing_field
+(
+    o71_flow_t * flow_p,
+    o71_ref_t obj_r,
+    o71_ref_t field_r,
+    o71_ref_t * value_p
+)
+{
+    return O71_MISSING;
+}
+
+/* set_missing_field ********************************************************/
+static o71_status_t set_missing_field
+(
+    o71_flow_t * flow_p,
+    o71_ref_t obj_r,
+    o71_ref_t field_r,
+    o71_ref_t value
+)
+{
+    return O71_TODO;
+}
+
+/* null_func_run ************************************************************/
+static o71_status_t null_func_run
+(
+    o71_flow_t * flow_p
+)
+{
+    flow_p->value_r = O71R_NULL;
+    return O71_OK;
+}
+
+/* int_add_call *************************************************************/
+static o71_status_t int_add_call
+(
+    o71_flow_t * flow_p,
+    o71_ref_t func_r,
+    o71_ref_t * arg_ra,
+    size_t arg_n
+)
+{
+    o71_obj_index_t exc_ox;
+    o71_status_t os;
+    if (arg_n != 2)
+    {
+        // throw arity exception
+        os = alloc_exc(flow_p->world_p, O71R_ARITY_EXC_CLASS, &exc_ox);
+        if (os) return os;
+        flow_p->exc_r = O71_MOX_TO_REF(exc_ox);
+        flow_p->value_r = O71R_NULL;
+        return O71_EXC;
+    }
+    if (O71_IS_REF_TO_SINT(arg_ra[0]) && O71_IS_REF_TO_SINT(arg_ra[1]))
+    {
+        // TODO: handle overflow by generating a big_int
+        flow_p->value_r = (arg_ra[0] - 1 + arg_ra[1]);
+        return O71_OK;
+    }
+    os = alloc_exc(flow_p->world_p, O71R_TYPE_EXC_CLASS, &exc_ox);
+    if (os) return os;
+    flow_p->exc_r = O71_MOX_TO_REF(exc_ox);
+    return O71_EXC;
+    // // TODO: handle int + big_int or big_int + int
+    // flow_p->value_r = O71R_NULL;
+    // return O71_OK;
+}
+
+/* sfunc_finish *************************************************************/
+static o71_status_t sfunc_finish
+(
+    o71_world_t * world_p,
+    o71_ref_t obj_r
+)
+{
+    o71_script_function_t * sfunc_p;
+    o71_status_t os;
+
+    os = sfunc_visit_refs(world_p, obj_r, release_ref_visit, NULL);
+    AOS(os);
+    sfunc_p = o71_obj_ptr(world_p, obj_r);
+    FREE_ARRAY(world_p->allocator_p, sfunc_p->insn_a, sfunc_p->insn_m);
+    FREE_ARRAY(world_p->allocator_p, sfunc_p->opnd_a, sfunc_p->opnd_m);
+    FREE_ARRAY(world_p->allocator_p, sfunc_p->arg_xa, sfunc_p->arg_n);
+    FREE_ARRAY(world_p->allocator_p, sfunc_p->const_ra, sfunc_p->const_m);
+    FREE_ARRAY(world_p->allocator_p, sfunc_p->exc_handler_a,
+               sfunc_p->exc_handler_m);
+    /* until the first exception chain is added this is the static
+     * init_exc_chain_start_xa with exc_chain_m == 0 */
+    if (sfunc_p->exc_chain_m)
+    {
+        FREE_ARRAY(world_p->allocator_p, sfunc_p->exc_chain_start_xa,
+                   sfunc_p->exc_chain_m);
+    }
+    os = kvbag_free(world_p, &sfunc_p->func.cls.method_bag,
+                    deref_key_and_value);
+    AOS(os);
+    return O71_OK;
+}
+
+/* sfunc_visit_refs *********************************************************/
+static o71_status_t sfunc_visit_refs
+(
+    o71_world_t * world_p,
+    o71_ref_t obj_r,
+    o71_ref_visit_f visit,
+    void * ctx
+)
+{
+    o71_script_function_t * sfunc_p;
+    o71_status_t os;
+    size_t i;
+
+    sfunc_p = o71_obj_ptr(world_p, obj_r);
+    for (i = 0; i < sfunc_p->const_n; ++i)
+    {
+        os = visit(world_p, &sfunc_p->const_ra[i], ctx);
+        if (os) return os;
+    }
+    return O71_OK;
+}
+
+/* sfunc_call ***************************************************************/
+static o71_status_t sfunc_call
+(
+    o71_flow_t * flow_p,
+    o71_ref_t func_r,
+    o71_ref_t * arg_ra,
+    size_t arg_n
+)
+{
+    o71_world_t * world_p = flow_p->world_p;
+    o71_script_function_t * sfunc_p;
+    o71_script_exe_ctx_t * sec_p;
+    o71_status_t os;
+    o71_obj_index_t ec_ox;
+    size_t i;
+
+    A(o71_model(world_p, func_r) & O71M_SCRIPT_FUNCTION);
+    sfunc_p = o71_obj_ptr(world_p, func_r);
+    if (!sfunc_p->valid)
+    {
+        os = o71_sfunc_validate(world_p, sfunc_p);
+        if (os)
+        {
+            M("sfunc_%lX=%p: failed to prepare call due to invalid code: %s",
+              (long) func_r, sfunc_p, N(os));
+            return os;
+        }
+    }
+    if (arg_n != sfunc_p->arg_n)
+    {
+        M("sf%lX called with %lu args but needs %lu!",
+          func_r, (long) arg_n, (long) sfunc_p->arg_n);
+        return O71_BAD_ARG_COUNT;
+    }
+
+    os = alloc_object(world_p, func_r, &ec_ox);
+    if (os)
+    {
+        M("failed to create exe_ctx for sfunc=obref_%lX: %s",
+          (long) func_r, N(os));
+        return os;
+    }
+    sec_p = O71_OBJ_SLOT(world_p, ec_ox);
+    sec_p->exe_ctx.caller_r = flow_p->exe_ctx_r;
+    sec_p->ret_value_vx = -1;
+    sec_p->insn_x = 0;
+    for (i = 0; i < sfunc_p->var_n; ++i)
+        sec_p->var_ra[i] = O71R_NULL;
+
+    /* exe context borrows references from arg_ra */
+    for (i = 0; i < sfunc_p->arg_n; ++i)
+        sec_p->var_ra[sfunc_p->arg_xa[i]] = arg_ra[i];
+
+    flow_p->exe_ctx_r = O71_MOX_TO_REF(ec_ox);
+    flow_p->depth += 1;
+
+    return O71_PENDING;
+}
+
+/* set_var ******************************************************************/
+O71_INLINE o71_status_t set_var
+(
+    o71_world_t * world_p,
+    o71_ref_t * dest_rp,
+    o71_ref_t src_r
+)
+{
+    o71_status_t os;
+    A(o71_model(world_p, *dest_rp) != O71M_INVALID);
+    A(o71_model(world_p, src_r) != O71M_INVALID);
+    os = o71_ref(world_p, src_r);
+#if O71_CHECKED
+    if (os)
+    {
+        M("failed referencing src=obref_%lX: %s", (long) src_r, N(os));
+        return os;
+    }
+#endif
+    os = o71_deref(world_p, *dest_rp);
+#if O71_CHECKED
+    if (os)
+    {
+        M("failed dereferencing existing ref in dest=obref_%lX: %s",
+          (long) *dest_rp, N(os));
+        return os;
+    }
+#endif
+    *dest_rp = src_r;
+    return os;
+}
+
+/* sfunc_run ****************************************************************/
+static o71_status_t sfunc_run
+(
+    o71_flow_t * flow_p
+)
+{
+    o71_world_t * world_p = flow_p->world_p;
+    o71_script_exe_ctx_t * sec_p;
+    o71_script_function_t * sfunc_p;
+    unsigned int ix, ox, ecx, ehx, ehx_lim;
+    o71_exception_t * exc_p;
+    o71_status_t os;
+    o71_ref_t laa[0x40];
+    o71_ref_t * aa;
+    uint32_t ret_value_vx;
+
+    A(flow_p->exe_ctx_r != O71R_NULL);
+    sec_p = o71_obj_ptr(world_p, flow_p->exe_ctx_r);
+    sfunc_p = o71_obj_ptr(world_p, sec_p->exe_ctx.hdr.class_r);
+    ix = (unsigned int) sec_p->insn_x;
+    if (flow_p->exc_r != O71R_NULL) goto l_exc;
+    switch (sec_p->mode)
+    {
+    case O71_SECM_STORE_RET_VAL:
+        ret_value_vx = sec_p->ret_value_vx;
+        sec_p->mode = O71_SECM_RUN;
+        goto l_store_ret_val;
+    case O71_SECM_IGNORE_RET_VAL:
+        sec_p->mode = O71_SECM_RUN;
+        os = o71_deref(world_p, flow_p->value_r);
+        AOS(os);
+        ++ix;
+        break;
+    }
+
+    for (;;)
+    {
+        if (sfunc_p->insn_a[ix].opcode >= O71O__CHFLOW)
+        {
+            flow_p->crt_steps += ix - sec_p->insn_x;
+            sec_p->insn_x = ix;
+            if (flow_p->crt_steps >= flow_p->max_steps)
+            {
+                M("reached max steps");
+                return O71_PENDING;
+            }
+        }
+
+        ox = sfunc_p->insn_a[ix].opnd_x;
+        switch (sfunc_p->insn_a[ix].opcode)
+        {
+        case O71O_NOP:
+            M("EXEC %04X: nop", ix);
+            break;
+
+        case O71O_INIT:
+            {
+                uint32_t dvx, cx;
+                dvx = sfunc_p->opnd_a[ox];
+                cx = sfunc_p->opnd_a[ox + 1];
+                M("EXEC %04X: init v%X, c%X=obref_%lX",
+                  ix, dvx, cx, sfunc_p->const_ra[cx]);
+                os = set_var(world_p, &sec_p->var_ra[dvx],
+                             sfunc_p->const_ra[cx]);
+                AOS(os);
+                break;
+            }
+
+        case O71O_INIT_NULL:
+            {
+                uint32_t dvx, cx;
+                dvx = sfunc_p->opnd_a[ox];
+                cx = sfunc_p->opnd_a[ox + 1];
+                M("EXEC %04X: init_null v%X, c%X=obref_%lX",
+                  ix, dvx, cx, sfunc_p->const_ra[cx]);
+                A(sec_p->var_ra[dvx] == O71R_NULL);
+                os = o71_ref(world_p, sfunc_p->const_ra[cx]);
+                AOS(os);
+                sec_p->var_ra[dvx] = sfunc_p->const_ra[cx];
+                break;
+            }
+
+        case O71O_GET_METHOD:
+            {
+                uint32_t dest_vx, obj_vx, name_istr_vx;
+                o71_ref_t obj_r, name_istr_r, value_r;
+                o71_class_t * class_p;
+
+                dest_vx = sfunc_p->opnd_a[ox];
+                obj_vx = sfunc_p->opnd_a[ox + 1];
+                name_istr_vx = sfunc_p->opnd_a[ox + 2];
+                A(name_istr_vx < sfunc_p->var_n);
+                A(obj_vx < sfunc_p->var_n);
+                name_istr_r = sec_p->var_ra[name_istr_vx];
+                M("EXEC %04X: get_method dest:v%X, obj:v%X=obref_%lX, name:v%X=obref_%lX",
+                  ix, dest_vx, obj_vx, sec_p->var_ra[obj_vx], name_istr_vx,
+                  name_istr_r);
+                if (!(o71_model(world_p, name_istr_r) & O71M_STRING))
+                {
+                    M("var_%X points to obref_%lX which is not a string",
+                      name_istr_vx, name_istr_r);
+                    M("TODO: throw exception");
+                    return O71_TODO;
+                }
+                obj_r = sec_p->var_ra[obj_vx];
+                class_p = o71_class(world_p, obj_r);
+                A(class_p);
+                os = kvbag_get(world_p, &class_p->method_bag, name_istr_r,
+                               ref_cmp, NULL, &value_r);
+                if (os)
+                {
+                    A(os == O71_MISSING);
+                    M("class of obref_%lX does not have method name "
+                      "str=obref_%lX", (long) obj_r, (long) name_istr_r);
+                    M("TODO: throw exception");
+                    return O71_TODO;
+                }
+                M("v%X <- method=obref_%lX", dest_vx, value_r);
+                os = set_var(world_p, &sec_p->var_ra[dest_vx], value_r);
+                AOS(os);
+                break;
+            }
+
+        case O71O_RETURN:
+            {
+                uint32_t svx;
+                svx = sfunc_p->opnd_a[ox];
+                /* move the variable in flow's value slot, then erase the
+                 * var so that when we clear the execution context we don't
+                 * decrement the ref count for the returned reference */
+                flow_p->value_r = sec_p->var_ra[svx];
+                sec_p->var_ra[svx] = O71R_NULL;
+                M("EXEC %04X: return v%X=obref_%lX", ix, svx, flow_p->value_r);
+                // fall into clear context
+            }
+        //l_finish_context:
+            {
+                size_t i;
+                for (i = 0; i < sfunc_p->var_n; ++i)
+                {
+                    os = o71_deref(world_p, sec_p->var_ra[i]);
+                    AOS(os);
+                    sec_p->var_ra[i] = O71R_NULL;
+                }
+                return O71_OK;
+            }
+
+        case O71O_CALL:
+        case O71O_CALL_MOVE:
+            {
+                uint32_t fvx, an, i, avx;
+                fvx = sfunc_p->opnd_a[ox + 1];
+                an = sfunc_p->opnd_a[ox + 2];
+                M("EXEC %04X: call dest:v%X, func:v%X=obref_%lX, args:%u",
+                  ix, sfunc_p->opnd_a[ox], fvx, sec_p->var_ra[fvx], an);
+                if (an <= sizeof(laa) / sizeof(laa[0])) aa = &laa[0];
+                else
+                {
+                    M("TODO: alloc arg table");
+                    return O71_TODO;
+                }
+                if (sfunc_p->insn_a[ix].opcode == O71O_CALL)
+                    for (i = 0; i < an; ++i)
+                    {
+                        aa[i] = sec_p->var_ra[sfunc_p->opnd_a[ox + 3 + i]];
+                        os = o71_ref(world_p, aa[i]);
+                        M("arg[%u]: v%X=obref_%lX",
+                          i, sfunc_p->opnd_a[ox + 3 + i], aa[i]);
+                        AOS(os);
+                    }
+                else
+                    for (i = 0; i < an; ++i)
+                    {
+                        avx = sfunc_p->opnd_a[ox + 3 + i];
+                        if (avx & O71_VX_MOVE)
+                        {
+                            /* last use of the var: move its reference */
+                            avx &= ~O71_VX_MOVE;
+                            aa[i] = sec_p->var_ra[avx];
+                            sec_p->var_ra[avx] = O71R_NULL;
+                            M("arg[%u]: v%X=obref_%lX (moved)", i, avx, aa[i]);
+                            continue;
+                        }
+                        aa[i] = sec_p->var_ra[avx];
+                        os = o71_ref(world_p, aa[i]);
+                        M("arg[%u]: v%X=obref_%lX", i, avx, aa[i]);
+                        AOS(os);
+                    }
+                os = o71_prep_call(flow_p, sec_p->var_ra[fvx], aa, an);
+                switch (os)
+                {
+                case O71_OK:
+                    ret_value_vx = sfunc_p->opnd_a[ox];
+                    break; // fall into l_store_ret_val
+                case O71_PENDING:
+                    sec_p->ret_value_vx = sfunc_p->opnd_a[ox];
+                    sec_p->mode = O71_SECM_STORE_RET_VAL;
+                    return O71_PENDING;
+                case O71_EXC:
+                    // exception thrown; try to handle it
+                    goto l_exc;
+                default:
+                    M("unhandled prep_call status: %s", N(os));
+                    return O71_BUG;
+                }
+            }
+
+        l_store_ret_val:
+            {
+                M("storing return value obref_%lX into v%X",
+                  (long) flow_p->value_r, ret_value_vx);
+                os = o71_deref(world_p, sec_p->var_ra[ret_value_vx]);
+                AOS(os);
+                sec_p->var_ra[ret_value_vx] = flow_p->value_r;
+                break;
+            }
+
+        case O71O_GET_FIELD:
+            {
+                uint32_t vvx, ovx, fvx;
+                o71_class_t * class_p;
+                o71_ref_t obj_r, value_r;
+                vvx = sfunc_p->opnd_a[ox + 0];
+                ovx = sfunc_p->opnd_a[ox + 1];
+                fvx = sfunc_p->opnd_a[ox + 2];
+                M("EXEC %04X: get_field "
+                  "val:v%X=obref_%lX, obj:v%X=obref_%lX, field:v%X=obref_%lX",
+                  ix, vvx, sec_p->var_ra[vvx], ovx, sec_p->var_ra[ovx],
+                  fvx, sec_p->var_ra[fvx]);
+                obj_r = sec_p->var_ra[ovx];
+                class_p = o71_class(world_p, obj_r);
+                os = class_p->get_field(flow_p, obj_r,
+                                        sec_p->var_ra[fvx], &value_r);
+                switch (os)
+                {
+                case O71_OK:
+                    /* get_field returns a borrowed reference */
+                    os = set_var(world_p, &sec_p->var_ra[vvx], value_r);
+                    AOS(os);
+                    M("store obref_%lX into v%X", value_r, vvx);
+                    break;
+                case O71_PENDING:
+                    sec_p->mode = O71_SECM_STORE_RET_VAL;
+                    sec_p->ret_value_vx = vvx;
+                    return O71_PENDING;
+                case O71_EXC:
+                    goto l_exc;
+                default:
+                    M("unhandled set_field status: %s", N(os));
+                    return O71_BUG;
+                }
+                break;
+            }
+
+
+        case O71O_SET_FIELD:
+            {
+                uint32_t vvx, ovx, fvx;
+                o71_class_t * class_p;
+                o71_ref_t obj_r;
+                vvx = sfunc_p->opnd_a[ox + 0];
+                ovx = sfunc_p->opnd_a[ox + 1];
+                fvx = sfunc_p->opnd_a[ox + 2];
+                M("EXEC %04X: set_field "
+                  "val:v%X=obref_%lX, obj:v%X=obref_%lX, field:v%X=obref_%lX",
+                  ix, vvx, sec_p->var_ra[vvx], ovx, sec_p->var_ra[ovx],
+                  fvx, sec_p->var_ra[fvx]);
+                obj_r = sec_p->var_ra[ovx];
+                class_p = o71_class(world_p, obj_r);
+                os = class_p->set_field(flow_p, obj_r,
+                                        sec_p->var_ra[fvx], sec_p->var_ra[vvx]);
+                switch (os)
+                {
+                case O71_OK:
+                    break;
+                case O71_PENDING:
+                    sec_p->mode = O71_SECM_IGNORE_RET_VAL;
+                    return O71_PENDING;
+                case O71_EXC:
+                    goto l_exc;
+                default:
+                    M("unhandled set_field status: %s", N(os));
+                    return O71_BUG;
+                }
+                break;
+            }
+
+        default:
+            M("unhandled opcode 0x%X", sfunc_p->insn_a[ix].opcode);
+            return O71_TODO;
+
+        l_exc:
+        /* exception thrown; check to see if there's a handler for it
+         * that covers current instruction */
+            M("got exc=obref_%lX", (long) flow_p->exc_r);
+            A(o71_model(world_p, flow_p->exc_r) & O71M_EXCEPTION);
+            exc_p = o71_obj_ptr(world_p, flow_p->exc_r);
+            ecx = sfunc_p->insn_a[ix].exc_chain_x;
+            M("ix=%u, ecx=%u, ehx=[%u, %u)",
+              ix, ecx, sfunc_p->exc_chain_start_xa[ecx],
+              sfunc_p->exc_chain_start_xa[ecx + 1]);
+            for (ehx = sfunc_p->exc_chain_start_xa[ecx],
+                 ehx_lim = sfunc_p->exc_chain_start_xa[ecx + 1];
+                 ehx < ehx_lim;
+                 ++ehx)
+                if (exc_p->hdr.class_r
+                    == sfunc_p->exc_handler_a[ehx].exc_type_r
+                    || o71_superclass_search(world_p, exc_p->hdr.class_r,
+                                             sfunc_p->exc_handler_a[ehx]
+                                                .exc_type_r) >= 0)
+                    break;
+            if (ehx == ehx_lim)
+            {
+                M("exc not handled. unwinding...");
+                return O71_EXC;
+            }
+            /* store the exception */
+            os = o71_deref(world_p,
+                           sec_p->var_ra[sfunc_p->exc_handler_a[ehx].exc_var_x]);
+            AOS(os);
+            sec_p->var_ra[sfunc_p->exc_handler_a[ehx].exc_var_x]
+                = flow_p->exc_r;
+            flow_p->exc_r = O71R_NULL;
+            ix = sfunc_p->exc_handler_a[ehx].insn_x;
+            M("found handler %u; jump to ix=0x%X", ehx, ix);
+            continue;
+        }
+        /* move to next instruction */
+        ++ix;
+    }
+}
+
+/* sfunc_alloc_code *********************************************************/
+static o71_status_t sfunc_alloc_code
+(
+    o71_world_t * world_p,
+    o71_script_function_t * sfunc_p,
+    o71_insn_t * * insn_ap,
+    uint32_t * * opnd_ap,
+    size_t insn_n,
+    size_t opnd_n
+)
+{
+    o71_status_t os;
+    size_t n;
+
+    n = sfunc_p->insn_n + insn_n - 1;
+    if (n != (uint32_t) n)
+    {
+        M("sfunc=%p: too many instructions to be referenced by operands",
+          sfunc_p);
+        return O71_ARRAY_LIMIT;
+    }
+
+    n = sfunc_p->opnd_n + opnd_n - 1;
+    if (n != (uint16_t) n)
+    {
+        M("sfunc=%p: too many operands in to be accessible from instructions",
+          sfunc_p);
+        return O71_ARRAY_LIMIT;
+    }
+
+    os = extend_array(world_p->allocator_p,
+                      (void * *) insn_ap, (void * *) &sfunc_p->insn_a,
+                      &sfunc_p->insn_m, &sfunc_p->insn_n, insn_n,
+                      sizeof(o71_insn_t));
+    if (os)
+    {
+        M("sfunc=%p: failed extending insn array: %s", sfunc_p, N(os));
+        return os;
+    }
+    M("sfunc=%p; insn: a=%p, n=%zu, m=%zu",
+      sfunc_p, sfunc_p->insn_a, sfunc_p->insn_n, sfunc_p->insn_m);
+
+    os = extend_array(world_p->allocator_p,
+                      (void * *) opnd_ap, (void * *) &sfunc_p->opnd_a,
+                      &sfunc_p->opnd_m, &sfunc_p->opnd_n, opnd_n,
+                      sizeof(uint32_t));
+    if (os)
+    {
+        M("sfunc=%p: failed extending operand array: %s", sfunc_p, N(os));
+        sfunc_p->insn_n -= insn_n;
+        return os;
+    }
+    M("sfunc=%p; opnd: a=%p, n=%zu, m=%zu",
+      sfunc_p, sfunc_p->opnd_a, sfunc_p->opnd_n, sfunc_p->opnd_m);
+    sfunc_p->valid = 0;
+    return O71_OK;
+}
+
+/* sfunc_add_const **********************************************************/
+static o71_status_t sfunc_add_const
+(
+    o71_world_t * world_p,
+    o71_script_function_t * sfunc_p,
+    uint32_t * const_xp,
+    o71_ref_t obj_r
+)
+{
+    size_t i;
+    o71_ref_t * const_rp;
+    o71_status_t os;
+
+    for (i = 0; i < sfunc_p->const_n; ++i)
+        if (sfunc_p->const_ra[i] == obj_r)
+        {
+            *const_xp = i;
+            return O71_OK;
+        }
+
+    *const_xp = sfunc_p->const_n;
+    os = extend_array(world_p->allocator_p, (void * *) &const_rp,
+                      (void * *) &sfunc_p->const_ra,
+                      &sfunc_p->const_m, &sfunc_p->const_n, 1,
+                      sizeof(o71_ref_t));
+    if (os) return os;
+    *const_rp = obj_r;
+    os = o71_ref(world_p, obj_r);
+    return os;
+}
+
+/* sfunc_append_opc_val_obj_name ********************************************/
+static o71_status_t sfunc_append_opc_val_obj_name
+(
+    o71_world_t * world_p,
+    o71_script_function_t * sfunc_p,
+    uint8_t opcode,
+    uint32_t value_vx,
+    uint32_t obj_vx,
+    uint32_t name_istr_vx
+)
+{
+    o71_insn_t * insn_p;
+    uint32_t * opnd_a;
+    uint16_t opnd_x;
+    o71_status_t os;
+
+    opnd_x = sfunc_p->opnd_n;
+    os = sfunc_alloc_code(world_p, sfunc_p, &insn_p, &opnd_a, 1, 3);
+    if (os)
+    {
+        M("sfunc=%p: alloc code failed: %s", sfunc_p, N(os));
+        return os;
+    }
+    insn_p->opcode = opcode;
+    insn_p->exc_chain_x = 0;
+    insn_p->opnd_x = opnd_x;
+    opnd_a[0] = value_vx;
+    opnd_a[1] = obj_vx;
+    opnd_a[2] = name_istr_vx;
+    return O71_OK;
+}
+
+/* ref_cmp ******************************************************************/
+static o71_status_t ref_cmp
+(
+    o71_world_t * world_p,
+    o71_ref_t a_r,
+    o71_ref_t b_r,
+    void * ctx
+)
+{
+    return a_r == b_r ? O71_EQUAL : (a_r > b_r ? O71_MORE : O71_LESS);
+}
+
+/* str_finish ***************************************************************/
+static o71_status_t str_finish
+(
+    o71_world_t * world_p,
+    o71_ref_t obj_r
+)
+{
+    o71_string_t * str_p;
+    o71_status_t os;
+    A(o71_model(world_p, obj_r) & O71M_STRING);
+    str_p = o71_obj_ptr(world_p, obj_r);
+    M2("remove string '%.*s' (mode=%u, m=%zu)",
+       (int) str_p->n, str_p->a, str_p->mode, str_p->m);
+    if (str_p->mode == O71_SM_INTERN)
+    {
+        os = istr_remove(world_p, obj_r, str_p->hash);
+        AOS(os);
+    }
+    if (str_p->slice) return str_visit_refs(world_p, obj_r,
+                                            release_ref_visit, NULL);
+    if (str_p->m && str_p->a != str_p->inl.sa)
+    {
+        os = redim(world_p->allocator_p, (void * *) &str_p->a, &str_p->m, 0, 1);
+        AOS(os);
+    }
+    return O71_OK;
+}
+
+/* str_visit_refs ***********************************************************/
+static o71_status_t str_visit_refs
+(
+    o71_world_t * world_p,
+    o71_ref_t obj_r,
+    o71_ref_visit_f visit,
+    void * ctx
+)
+{
+    o71_string_t * str_p;
+    str_p = o71_obj_ptr(world_p, obj_r);
+    if (!str_p->slice) return O71_OK;
+    return visit(world_p, &str_p->inl.parent_r, ctx);
+}
+
+/* str_unslice **************************************************************/
+static o71_status_t str_unslice
+(
+    o71_world_t * world_p,
+    o71_string_t * str_p
+)
+{
+    o71_ref_t parent_r = str_p->inl.parent_r;
+    uint8_t * a;
+    size_t m, i;
+    o71_status_t os;
+
+    /* slices are never created short enough to fit in sa */
+    A(str_p->slice && str_p->n > O71_STR_INLINE_SIZE);
+    a = NULL;
+    m = 0;
+    os = redim(world_p->allocator_p, (void * *) &a, &m, str_p->n, 1);
+    if (os) return os;
+    for (i = 0; i < str_p->n; ++i) a[i] = str_p->a[i];
+    str_p->a = a;
+    str_p->m = m;
+    str_p->slice = 0;
+    return o71_deref(world_p, parent_r);
+}
+
+
+/* str_hash *****************************************************************/
+static uint32_t str_hash
+(
+    uint8_t const * a,
+    size_t n
+)
+{
+    uint32_t h = 0x811C9DC5;
+    size_t i;
+    for (i = 0; i < n; ++i)
+        h = (h ^ a[i]) * 0x01000193;
+    return h;
+}
+
+/* bytes_mismatch_scalar ****************************************************/
+static size_t bytes_mismatch_scalar
+(
+    uint8_t const * a,
+    uint8_t const * b,
+    size_t n
+)
+{
+    size_t i;
+    for (i = 0; i < n && a[i] == b[i]; ++i);
+    return i;
+}
+
+#if O71_SIMD
+/* bytes_mismatch_sse2 ******************************************************/
+static size_t bytes_mismatch_sse2
+(
+    uint8_t const * a,
+    uint8_t const * b,
+    size_t n
+)
+{
+    size_t i;
+    unsigned int m;
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        m = (unsigned int) _mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_loadu_si128((__m128i const *) (a + i)),
+                           _mm_loadu_si128((__m128i const *) (b + i))));
+        m ^= 0xFFFF;
+        if (m) return i + (unsigned int) __builtin_ctz(m);
+    }
+    for (; i < n && a[i] == b[i]; ++i);
+    return i;
+}
+
+/* bytes_mismatch_avx2 ******************************************************/
+__attribute__((target("avx2")))
+static size_t bytes_mismatch_avx2
+(
+    uint8_t const * a,
+    uint8_t const * b,
+    size_t n
+)
+{
+    size_t i;
+    uint32_t m;
+    for (i = 0; i + 32 <= n; i += 32)
+    {
+        m = (uint32_t) _mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i const *) (a + i)),
+                              _mm256_loadu_si256((__m256i const *) (b + i))));
+        m = ~m;
+        if (m) return i + (unsigned int) __builtin_ctz(m);
+    }
+    if (i + 16 <= n)
+    {
+        m = (uint32_t) _mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_loadu_si128((__m128i const *) (a + i)),
+                           _mm_loadu_si128((__m128i const *) (b + i))));
+        m ^= 0xFFFF;
+        if (m) return i + (unsigned int) __builtin_ctz(m);
+        i += 16;
+    }
+    for (; i < n && a[i] == b[i]; ++i);
+    return i;
+}
+
+/* cpu_has_avx2 *************************************************************/
+static int cpu_has_avx2 (void)
+{
+    unsigned int a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d)) return 0;
+    if (!(c & bit_OSXSAVE) || !(c & bit_AVX)) return 0;
+    /* xgetbv(0): bits 1 and 2 say the OS saves xmm and ymm registers */
+    __asm__ ("xgetbv" : "=a" (a), "=d" (d) : "c" (0));
+    if ((a & 6) != 6) return 0;
+    if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) return 0;
+    return (b & bit_AVX2) != 0;
+}
+#endif
+
+/* ascii_span_scalar ********************************************************/
+static size_t ascii_span_scalar
+(
+    uint8_t const * a,
+    size_t n
+)
+{
+    size_t i;
+    for (i = 0; i < n && a[i] >= 0x20 && a[i] < 0x80; ++i);
+    return i;
+}
+
+#if O71_SIMD
+/* ascii_span_sse2 **********************************************************/
+static size_t ascii_span_sse2
+(
+    uint8_t const * a,
+    size_t n
+)
+{
+    __m128i lim = _mm_set1_epi8(0x1F);
+    size_t i;
+    unsigned int m;
+    /* signed compare: bytes >= 0x80 are negative so they fail too */
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        m = (unsigned int) _mm_movemask_epi8(
+            _mm_cmpgt_epi8(_mm_loadu_si128((__m128i const *) (a + i)), lim));
+        m ^= 0xFFFF;
+        if (m) return i + (unsigned int) __builtin_ctz(m);
+    }
+    return i + ascii_span_scalar(a + i, n - i);
+}
+
+/* ascii_span_avx2 **********************************************************/
+__attribute__((target("avx2")))
+static size_t ascii_span_avx2
+(
+    uint8_t const * a,
+    size_t n
+)
+{
+    __m256i lim = _mm256_set1_epi8(0x1F);
+    size_t i;
+    uint32_t m;
+    for (i = 0; i + 32 <= n; i += 32)
+    {
+        m = (uint32_t) _mm256_movemask_epi8(
+            _mm256_cmpgt_epi8(_mm256_loadu_si256((__m256i const *) (a + i)),
+                              lim));
+        m = ~m;
+        if (m) return i + (unsigned int) __builtin_ctz(m);
+    }
+    return i + ascii_span_sse2(a + i, n - i);
+}
+
+/* simd_init ****************************************************************/
+static void simd_init (void)
+{
+    if (cpu_has_avx2())
+    {
+        bytes_mismatch = bytes_mismatch_avx2;
+        ascii_span = ascii_span_avx2;
+    }
+    else
+    {
+        bytes_mismatch = bytes_mismatch_sse2;
+        ascii_span = ascii_span_sse2;
+    }
+}
+#endif
+
+/* utf8_char_check **********************************************************/
+static size_t utf8_char_check
+(
+    uint8_t const * a,
+    size_t n,
+    int * ce_p
+)
+{
+    size_t len, i;
+    uint8_t c = a[0];
+
+    if (c < 0x80) return 1;
+    if (c < 0xC0 || c >= 0xF5)
+    {
+        *ce_p = O71_CE_PARSE_BAD_UTF8_START_BYTE;
+        return 0;
+    }
+    len = c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+    if (n < len)
+    {
+        *ce_p = O71_CE_PARSE_TRUNCATED_UTF8_CHAR;
+        return 0;
+    }
+    for (i = 1; i < len; ++i)
+        if ((a[i] & 0xC0) != 0x80)
+        {
+            *ce_p = O71_CE_PARSE_BAD_UTF8_CONTINUATION;
+            return 0;
+        }
+    if (c < 0xC2 || (c == 0xE0 && a[1] < 0xA0) || (c == 0xF0 && a[1] < 0x90))
+    {
+        *ce_p = O71_CE_PARSE_OVERLY_LONG_ENCODED_UTF8_CHAR;
+        return 0;
+    }
+    if (c == 0xED && a[1] >= 0xA0)
+    {
+        *ce_p = O71_CE_PARSE_SURROGATE_CODEPOINT;
+        return 0;
+    }
+    if (c == 0xF4 && a[1] >= 0x90)
+    {
+        /* above U+10FFFF */
+        *ce_p = O71_CE_PARSE_BAD_UTF8_START_BYTE;
+        return 0;
+    }
+    return len;
+}
+
+/* utf8_span ****************************************************************/
+static size_t utf8_span
+(
+    uint8_t const * a,
+    size_t n,
+    int * ce_p
+)
+{
+    size_t i, len;
+    for (i = 0; ; i += len)
+    {
+        i += ascii_span(a + i, n - i);
+        if (i == n || a[i] < 0x80) return i;
+        len = utf8_char_check(a + i, n - i, ce_p);
+        if (!len) return i;
+    }
+}
+
+/* bytes_eq *****************************************************************/
+static int bytes_eq
+(
+    uint8_t const * a,
+    uint8_t const * b,
+    size_t n
+)
+{
+    return bytes_mismatch(a, b, n) == n;
+}
+
+/* istr_lookup **************************************************************/
+static o71_ref_t istr_lookup
+(
+    o71_world_t * world_p,
+    uint8_t const * a,
+    size_t n,
+    uint32_t hash
+)
+{
+    o71_istr_slot_t * slot_a = world_p->istr_a;
+    o71_string_t * str_p;
+    size_t mask, i;
+
+    if (!world_p->istr_m) return O71R_NULL;
+    mask = world_p->istr_m - 1;
+    for (i = hash & mask; slot_a[i].str_r != O71R_NULL; i = (i + 1) & mask)
+    {
+        if (slot_a[i].hash != hash) continue;
+        str_p = o71_obj_ptr(world_p, slot_a[i].str_r);
+        if (str_p->n == n && bytes_eq(str_p->a, a, n)) return slot_a[i].str_r;
+    }
+    return O71R_NULL;
+}
+
+/* istr_grow ****************************************************************/
+static o71_status_t istr_grow
+(
+    o71_world_t * world_p,
+    size_t min_n
+)
+{
+    o71_istr_slot_t * old_a = world_p->istr_a;
+    o71_istr_slot_t * slot_a;
+    size_t old_m = world_p->istr_m;
+    size_t new_m, mask, i, j;
+    o71_status_t os;
+
+    if (min_n > SIZE_MAX / 8 / sizeof(o71_istr_slot_t)) return O71_ARRAY_LIMIT;
+    if (min_n * 4 <= old_m * 3) return O71_OK;
+    for (new_m = old_m ? old_m * 2 : 0x40; min_n * 4 > new_m * 3; new_m *= 2);
+    slot_a = NULL;
+    i = 0;
+    os = redim(world_p->allocator_p, (void * *) &slot_a, &i, new_m,
+               sizeof(o71_istr_slot_t));
+    if (os) return os;
+    mask = new_m - 1;
+    for (i = 0; i < new_m; ++i) slot_a[i].str_r = O71R_NULL;
+    for (i = 0; i < old_m; ++i)
+    {
+        if (old_a[i].str_r == O71R_NULL) continue;
+        for (j = old_a[i].hash & mask; slot_a[j].str_r != O71R_NULL;
+             j = (j + 1) & mask);
+        slot_a[j] = old_a[i];
+    }
+    os = redim(world_p->allocator_p, (void * *) &old_a, &old_m, 0,
+               sizeof(o71_istr_slot_t));
+    AOS(os);
+    world_p->istr_a = slot_a;
+    world_p->istr_m = new_m;
+    return O71_OK;
+}
+
+/* istr_add *****************************************************************/
+static o71_status_t istr_add
+(
+    o71_world_t * world_p,
+    o71_ref_t str_r,
+    uint32_t hash
+)
+{
+    o71_istr_slot_t * slot_a;
+    size_t mask, i;
+    o71_status_t os;
+
+    os = istr_grow(world_p, world_p->istr_n + 1);
+    if (os) return os;
+    slot_a = world_p->istr_a;
+    mask = world_p->istr_m - 1;
+    for (i = hash & mask; slot_a[i].str_r != O71R_NULL; i = (i + 1) & mask);
+    slot_a[i].str_r = str_r;
+    slot_a[i].hash = hash;
+    world_p->istr_n += 1;
+    return O71_OK;
+}
+
+/* istr_remove **************************************************************/
+static o71_status_t istr_remove
+(
+    o71_world_t * world_p,
+    o71_ref_t str_r,
+    uint32_t hash
+)
+{
+    o71_istr_slot_t * slot_a = world_p->istr_a;
+    size_t mask, i, j, home;
+
+    A(world_p->istr_m);
+    mask = world_p->istr_m - 1;
+    for (i = hash & mask; slot_a[i].str_r != str_r; i = (i + 1) & mask)
+        A(slot_a[i].str_r != O71R_NULL);
+    /* move back every item of the cluster that can legally sit in the
+     * hole: the ones whose home slot is not between the hole and them */
+    for (j = (i + 1) & mask; slot_a[j].str_r != O71R_NULL; j = (j + 1) & mask)
+    {
+        home = slot_a[j].hash & mask;
+        if (((j - home) & mask) < ((j - i) & mask)) continue;
+        slot_a[i] = slot_a[j];
+        i = j;
+    }
+    slot_a[i].str_r = O71R_NULL;
+    world_p->istr_n -= 1;
+    return O71_OK;
+}
+
+/* str_intern_cmp ***********************************************************/
+static o71_status_t str_intern_cmp
+(
+    o71_world_t * world_p,
+    o71_ref_t a_r,
+    o71_ref_t b_r,
+    void * ctx
+)
+{
+    o71_string_t const * a_p;
+    o71_string_t const * b_p;
+    size_t i;
+
+    a_p = o71_obj_ptr(world_p, a_r);
+    b_p = o71_obj_ptr(world_p, b_r);
+    if (a_p->n != b_p->n)
+    {
+        // M("'%.*s' %s '%.*s'", (int) a_p->n, a_p->a,
+        //   a_p->n > b_p->n ? ">" : "<",
+        //   (int) b_p->n, b_p->a);
+        return (a_p->n > b_p->n ? O71_MORE : O71_LESS);
+    }
+    i = bytes_mismatch(a_p->a, b_p->a, a_p->n);
+    if (i < a_p->n)
+    {
+        // M("'%.*s' %s '%.*s'", (int) a_p->n, a_p->a,
+        //   a_p->a[i] > b_p->a[i] ? ">" : "<",
+        //   (int) b_p->n, b_p->a);
+        return (a_p->a[i] > b_p->a[i] ? O71_MORE : O71_LESS);
+    }
+    // M("'%.*s' == '%.*s'", (int) a_p->n, a_p->a, (int) b_p->n, b_p->a);
+    return O71_EQUAL;
+}
+
+/* kvbag_init ***************************************************************/
+static void kvbag_init
+(
+    o71_kvbag_t * kvbag_p,
+    uint8_t array_limit,
+    uint8_t large_mode
+)
+{
+    kvbag_p->kv_a = NULL;
+    kvbag_p->n = 0;
+    kvbag_p->m = 0;
+    kvbag_p->l = array_limit;
+    kvbag_p->mode = O71_BAG_ARRAY;
+    kvbag_p->large_mode = large_mode;
+    kvbag_p->version = 0;
+}
+
+
+/* kvbag_free *************************************************************/
+static o71_status_t kvbag_free
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kv_free_f kv_free
+)
+{
+    o71_status_t os;
+    if (kvbag_p->mode == O71_BAG_ARRAY)
+        os = kvbag_array_free(world_p, kvbag_p, kv_free);
+    else if (kvbag_p->mode == O71_BAG_BTREE)
+        os = kvbag_btree_free(world_p, kvbag_p->btree_p, kv_free);
+    else if (kvbag_p->mode == O71_BAG_HASH)
+        os = kvbag_hash_free(world_p, kvbag_p->hash_p, kv_free);
+    else
+    {
+        A(kvbag_p->mode == O71_BAG_RBTREE);
+        os = kvbag_p->tree_p
+            ? kvbag_rbtree_free(world_p, kvbag_p->tree_p, kv_free) : O71_OK;
+    }
+
+    return os;
+}
+
+#if O71_DEBUG
+/* kvbag_dump ***************************************************************/
+static void kvbag_dump
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p
+)
+{
+    if (kvbag_p->mode == O71_BAG_ARRAY) kvbag_array_dump(world_p, kvbag_p);
+    else if (kvbag_p->mode == O71_BAG_BTREE)
+        kvbag_btree_dump(world_p, kvbag_p->btree_p, 0);
+    else if (kvbag_p->mode == O71_BAG_HASH)
+        kvbag_hash_dump(world_p, kvbag_p->hash_p);
+    else kvbag_rbtree_dump(world_p, kvbag_p->tree_p, 0);
+}
+#endif
+
+/* kvbag_search *************************************************************/
+static o71_status_t kvbag_search
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_ref_t key_r,
+    o71_cmp_f cmp,
+    void * ctx,
+    o71_kvbag_loc_t * loc_p
+)
+{
+    o71_status_t os;
+    M2("bag=%p, mode=%u, key=obref_%lX", kvbag_p, kvbag_p->mode, key_r);
+    switch (kvbag_p->mode)
+    {
+    case O71_BAG_ARRAY:
+        if (cmp == ref_cmp)
+            return kvbag_array_search_ref(world_p, kvbag_p, key_r, cmp, ctx,
+                                          loc_p);
+        return kvbag_array_search(world_p, kvbag_p, key_r, cmp, ctx, loc_p);
+    case O71_BAG_BTREE:
+        if (cmp == ref_cmp)
+            return kvbag_btree_search_ref(world_p, kvbag_p, key_r, cmp, ctx,
+                                          loc_p);
+        return kvbag_btree_search(world_p, kvbag_p, key_r, cmp, ctx, loc_p);
+    case O71_BAG_HASH:
+        A(cmp == ref_cmp);
+        os = kvbag_hash_probe(kvbag_p->hash_p, key_r, &loc_p->hash.index);
+        LOC_STATUS(loc_p, os);
+        return os;
+    }
+    A(kvbag_p->mode == O71_BAG_RBTREE);
+    if (cmp == ref_cmp)
+        return kvbag_rbtree_search_ref(world_p, kvbag_p, key_r, cmp, ctx,
+                                       loc_p);
+    return kvbag_rbtree_search(world_p, kvbag_p, key_r, cmp, ctx, loc_p);
+}
+
+/* kvbag_get ****************************************************************/
+static o71_status_t kvbag_get
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_ref_t key_r,
+    o71_cmp_f cmp,
+    void * ctx,
+    o71_ref_t * value_rp
+)
+{
+    if (kvbag_p->mode == O71_BAG_HASH)
+    {
+        o71_status_t os;
+        size_t x;
+        A(cmp == ref_cmp);
+        os = kvbag_hash_probe(kvbag_p->hash_p, key_r, &x);
+        if (os == O71_OK) *value_rp = kvbag_p->hash_p->kv_a[x].value_r;
+        return os;
+    }
+    if (cmp == ref_cmp)
+        return kvbag_lookup_ref(world_p, kvbag_p, key_r, cmp, ctx, value_rp);
+    return kvbag_lookup(world_p, kvbag_p, key_r, cmp, ctx, value_rp);
+}
+
+/* kvbag_get_loc_value ******************************************************/
+static o71_ref_t kvbag_get_loc_value
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kvbag_loc_t * loc_p
+)
+{
+#if O71_CHECKED
+    if (loc_p->status != O71_OK)
+    {
+        M("*** BUG *** trying to get value after key match failed (%s)!!!!",
+          N(loc_p->status));
+        return O71_MOX_TO_REF(-1);
+    }
+#endif
+
+    if (kvbag_p->mode == O71_BAG_ARRAY)
+        return kvbag_p->kv_a[loc_p->array.index].value_r;
+    if (kvbag_p->mode == O71_BAG_BTREE)
+        return loc_p->btree.node_a[loc_p->btree.last_x]
+            ->kv_a[loc_p->btree.index_a[loc_p->btree.last_x]].value_r;
+    if (kvbag_p->mode == O71_BAG_HASH)
+        return kvbag_p->hash_p->kv_a[loc_p->hash.index].value_r;
+    return loc_p->rbtree.node_a[loc_p->rbtree.last_x]->kv.value_r;
+}
+
+/* kvbag_set_loc_value ******************************************************/
+static void kvbag_set_loc_value
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kvbag_loc_t * loc_p,
+    o71_ref_t value_r
+)
+{
+    if (kvbag_p->mode == O71_BAG_ARRAY)
+        kvbag_p->kv_a[loc_p->array.index].value_r = value_r;
+    else if (kvbag_p->mode == O71_BAG_BTREE)
+        loc_p->btree.node_a[loc_p->btree.last_x]
+            ->kv_a[loc_p->btree.index_a[loc_p->btree.last_x]].value_r = value_r;
+    else if (kvbag_p->mode == O71_BAG_HASH)
+        kvbag_p->hash_p->kv_a[loc_p->hash.index].value_r = value_r;
+    else loc_p->rbtree.node_a[loc_p->rbtree.last_x]->kv.value_r = value_r;
+}
+
+/* kvbag_insert *************************************************************/
+static o71_status_t kvbag_insert
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_ref_t key_r,
+    o71_ref_t value_r,
+    o71_cmp_f cmp,
+    void * ctx,
+    o71_kvbag_loc_t * loc_p
+)
+{
+    o71_status_t os;
+
+    kvbag_p->version = ++world_p->kvbag_version;
+    while (kvbag_p->mode == O71_BAG_ARRAY)
+    {
+        int i;
+        if (kvbag_p->n == kvbag_p->m)
+        {
+            size_t m, nm;
+            /* array full; reallocate or switch to the large mode */
+            A((kvbag_p->m & (kvbag_p->m - 1)) == 0);
+            A((kvbag_p->l & (kvbag_p->l - 1)) == 0);
+            if (kvbag_p->m == kvbag_p->l)
+            {
+                o71_kv_t * kv_a = kvbag_p->kv_a;
+
+                if (kvbag_p->large_mode == O71_BAG_HASH)
+                {
+                    o71_kvhash_t * hash_p;
+                    M("switch bag from array to hash");
+                    os = kvbag_hash_build(world_p, kv_a, kvbag_p->n,
+                                          kvbag_p->l < 2
+                                          ? 4 : (size_t) kvbag_p->l * 2,
+                                          &hash_p);
+                    if (os)
+                    {
+                        M("hash build failed: %s", N(os));
+                        return os;
+                    }
+                    kvbag_p->hash_p = hash_p;
+                }
+                else
+                {
+                    A(kvbag_p->large_mode == O71_BAG_LARGE_MODE);
+                    M("switch bag from array to tree");
+                    os = kvbag_tree_build(world_p, kvbag_p, kv_a, kvbag_p->n);
+                    if (os)
+                    {
+                        M("tree build failed: %s", N(os));
+                        return os;
+                    }
+                }
+                kvbag_p->mode = kvbag_p->large_mode;
+                m = kvbag_p->m;
+                os = redim(world_p->allocator_p, (void * *) &kv_a, &m, 0,
+                           sizeof(o71_kv_t));
+                AOS(os);
+                // fall into the large mode branch
+                os = kvbag_search(world_p, kvbag_p, key_r, cmp, ctx, loc_p);
+                A(os == O71_MISSING);
+                break;
+            }
+            m = kvbag_p->m;
+            nm = m ? m << 1 : (kvbag_p->l < 2 ? kvbag_p->l : 2);
+            os = redim(world_p->allocator_p, (void * *) &kvbag_p->kv_a, &m, nm,
+                       sizeof(o71_kv_t));
+            if (os)
+            {
+                M("failed to extend bag array: %s", N(os));
+                return os;
+            }
+            kvbag_p->m = (uint8_t) nm;
+        }
+        A(kvbag_p->n < kvbag_p->m);
+        os = o71_ref(world_p, key_r);
+        AOS(os);
+        for (i = (int) kvbag_p->n - 1; i >= (int) loc_p->array.index; --i)
+            kvbag_p->kv_a[i + 1] = kvbag_p->kv_a[i];
+        kvbag_p->kv_a[loc_p->array.index].key_r = key_r;
+        kvbag_p->kv_a[loc_p->array.index].value_r = value_r;
+        kvbag_p->n += 1;
+        return O71_OK;
+    }
+    if (kvbag_p->mode == O71_BAG_BTREE)
+    {
+        os = kvbag_btree_insert(world_p, kvbag_p, key_r, value_r, loc_p);
+        if (os) return os;
+        os = o71_ref(world_p, key_r);
+        AOS(os);
+        return O71_OK;
+    }
+    if (kvbag_p->mode == O71_BAG_HASH)
+    {
+        os = kvbag_hash_insert(world_p, kvbag_p, key_r, value_r, loc_p);
+        if (os) return os;
+        os = o71_ref(world_p, key_r);
+        AOS(os);
+        return O71_OK;
+    }
+    A(kvbag_p->mode == O71_BAG_RBTREE);
+
+    return kvbag_rbtree_insert(world_p, kvbag_p, key_r, value_r, loc_p);
+}
+
+/* kvbag_delete *************************************************************/
+static o71_status_t kvbag_delete
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kvbag_loc_t * loc_p
+)
+{
+    kvbag_p->version = ++world_p->kvbag_version;
+    if (kvbag_p->mode == O71_BAG_ARRAY)
+        return kvbag_array_delete(world_p, kvbag_p, loc_p);
+    if (kvbag_p->mode == O71_BAG_BTREE)
+        return kvbag_btree_delete(world_p, kvbag_p, loc_p);
+    if (kvbag_p->mode == O71_BAG_HASH)
+        return kvbag_hash_delete(world_p, kvbag_p, loc_p);
+    return kvbag_rbtree_delete(world_p, kvbag_p, loc_p);
+}
+
+/* kvbag_put ****************************************************************/
+static o71_status_t kvbag_put
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_ref_t key_r,
+    o71_ref_t value_r,
+    o71_cmp_f cmp,
+    void * ctx
+)
+{
+    o71_status_t os;
+    o71_kvbag_loc_t loc;
+
+    os = kvbag_search(world_p, kvbag_p, key_r, cmp, ctx, &loc);
+    if (os == O71_OK)
+    {
+        o71_ref_t old_value_r;
+        // key already in the bag
+        old_value_r = kvbag_get_loc_value(world_p, kvbag_p, &loc);
+        os = o71_deref(world_p, old_value_r);
+        AOS(os);
+        kvbag_set_loc_value(world_p, kvbag_p, &loc, value_r);
+        return O71_OK;
+    }
+    if (os != O71_MISSING) return os;
+    os = kvbag_insert(world_p, kvbag_p, key_r, value_r, cmp, ctx, &loc);
+    return os;
+}
+
+/* kvbag_tree_build *********************************************************/
+static o71_status_t kvbag_tree_build
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kv_t const * kv_a,
+    size_t kv_n
+)
+{
+    o71_status_t os;
+#if O71_BAG_LARGE_MODE == O71_BAG_BTREE
+    o71_kvbtnode_t * root_p;
+    os = kvbag_btree_build(world_p, kv_a, kv_n, &root_p);
+    if (os) return os;
+    kvbag_p->btree_p = root_p;
+#else
+    o71_kvnode_t * root_p;
+    unsigned int red_depth;
+    for (red_depth = 0; (kv_n + 1) >> (red_depth + 1); ++red_depth);
+    os = kvbag_rbtree_build(world_p, kv_a, kv_n, red_depth, &root_p);
+    if (os) return os;
+    kvbag_p->tree_p = root_p;
+#endif
+    kvbag_p->mode = O71_BAG_LARGE_MODE;
+    return O71_OK;
+}
+
+/* kvbag_tree_collect *******************************************************/
+static size_t kvbag_tree_collect
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kv_t * kv_a
+)
+{
+    o71_kvbag_cursor_t cursor;
+    o71_kv_t kv;
+    size_t n;
+
+    /* the bag does not change so the cursor never compares keys */
+    kvbag_cursor_init(&cursor);
+    for (n = 0; kvbag_cursor_next(world_p, kvbag_p, &cursor, NULL, NULL, &kv)
+         == O71_OK; ++n)
+    {
+        if (kv_a) kv_a[n] = kv;
+    }
+    return n;
+}
+
+/* kvbag_min_count **********************************************************/
+static size_t kvbag_min_count
+(
+    o71_kvbag_t const * kvbag_p
+)
+{
+    size_t n;
+    if (kvbag_p->mode == O71_BAG_ARRAY) return kvbag_p->n;
+    if (kvbag_p->mode == O71_BAG_HASH) return kvbag_p->hash_p->n;
+    if (kvbag_p->mode == O71_BAG_BTREE)
+    {
+        o71_kvbtnode_t const * node_p = kvbag_p->btree_p;
+        /* 2 children under the root, O71_BTREE_KV_MIN + 1 under the rest */
+        if (!node_p->n) return 0;
+        for (n = 2; !node_p->leaf; node_p = node_p->child_a[0])
+            n *= O71_BTREE_KV_MIN + 1;
+        return n - 1;
+    }
+    else
+    {
+        o71_kvnode_t const * node_p;
+        unsigned int depth;
+        /* at least half of the nodes on the leftmost path are black */
+        for (depth = 0, node_p = kvbag_p->tree_p; node_p;
+             node_p = GET_CHILD(node_p, 0), ++depth);
+        return ((size_t) 1 << ((depth + 1) / 2)) - 1;
+    }
+}
+
+/* kvbag_build **************************************************************/
+static o71_status_t kvbag_build
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kv_t const * kv_a,
+    size_t kv_n
+)
+{
+    o71_kvbag_t old_bag;
+    o71_status_t os;
+    size_t i, m, nm;
+
+    kvbag_p->version = ++world_p->kvbag_version;
+    if (kvbag_p->mode == O71_BAG_ARRAY && kv_n <= kvbag_p->l)
+    {
+        m = kvbag_p->m;
+        if (kv_n > m)
+        {
+            for (nm = m ? m : (kvbag_p->l < 2 ? kvbag_p->l : 2); nm < kv_n;
+                 nm <<= 1);
+            os = redim(world_p->allocator_p, (void * *) &kvbag_p->kv_a, &m, nm,
+                       sizeof(o71_kv_t));
+            if (os) return os;
+            kvbag_p->m = (uint8_t) nm;
+        }
+        for (i = 0; i < kv_n; ++i) kvbag_p->kv_a[i] = kv_a[i];
+        kvbag_p->n = (uint8_t) kv_n;
+        return O71_OK;
+    }
+
+    old_bag = *kvbag_p;
+    if (kvbag_p->large_mode == O71_BAG_HASH)
+    {
+        o71_kvhash_t * hash_p;
+        size_t slot_n;
+        /* hash bags are only built from the array mode */
+        A(kvbag_p->mode == O71_BAG_ARRAY);
+        for (slot_n = kvbag_p->l < 2 ? 4 : (size_t) kvbag_p->l * 2;
+             !KVHASH_FITS(kv_n, slot_n); slot_n <<= 1);
+        os = kvbag_hash_build(world_p, kv_a, kv_n, slot_n, &hash_p);
+        if (os) return os;
+        kvbag_p->hash_p = hash_p;
+        kvbag_p->mode = O71_BAG_HASH;
+    }
+    else
+    {
+        os = kvbag_tree_build(world_p, kvbag_p, kv_a, kv_n);
+        if (os) return os;
+    }
+    os = kvbag_free(world_p, &old_bag, kv_nop_free);
+    AOS(os);
+    if (old_bag.mode == O71_BAG_ARRAY)
+    {
+        kvbag_p->n = 0;
+        kvbag_p->m = 0;
+    }
+    return O71_OK;
+}
+
+/* kvbag_load ***************************************************************/
+static o71_status_t kvbag_load
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kv_t const * kv_a,
+    size_t kv_n,
+    o71_cmp_f cmp,
+    void * ctx
+)
+{
+    o71_status_t os;
+    size_t i;
+
+    A(kvbag_p->mode == O71_BAG_ARRAY);
+    A(kvbag_p->n == 0);
+#if O71_CHECKED
+    for (i = 1; i < kv_n; ++i)
+        A(cmp(world_p, kv_a[i - 1].key_r, kv_a[i].key_r, ctx) == O71_LESS);
+#endif
+    os = kvbag_build(world_p, kvbag_p, kv_a, kv_n);
+    if (os) return os;
+    for (i = 0; i < kv_n; ++i)
+    {
+        os = o71_ref(world_p, kv_a[i].key_r);
+        AOS(os);
+    }
+    return O71_OK;
+}
+
+/* kvbag_merge **************************************************************/
+static o71_status_t kvbag_merge
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kv_t const * kv_a,
+    size_t kv_n,
+    o71_cmp_f cmp,
+    void * ctx
+)
+{
+    o71_kv_t * old_a = NULL;
+    o71_kv_t * new_a = NULL;
+    size_t old_n, old_m = 0, new_m = 0, i, j, w, d;
+    o71_status_t os, osf;
+
+    if (!kv_n) return O71_OK;
+    if (kvbag_p->mode == O71_BAG_HASH)
+    {
+        o71_kvhash_t * hash_p = kvbag_p->hash_p;
+        o71_kvhash_t * new_p;
+        size_t slot_n, x;
+
+        A(cmp == ref_cmp);
+        for (slot_n = hash_p->mask + 1; !KVHASH_FITS(hash_p->n + kv_n, slot_n);
+             slot_n <<= 1);
+        if (slot_n > hash_p->mask + 1)
+        {
+            M2("grow hash bag %p to %lu slots", kvbag_p,
+               (unsigned long) slot_n);
+            os = kvbag_hash_build(world_p, hash_p->kv_a, hash_p->mask + 1,
+                                  slot_n, &new_p);
+            if (os) return os;
+            os = kvbag_hash_table_free(world_p, hash_p);
+            AOS(os);
+            kvbag_p->hash_p = hash_p = new_p;
+        }
+        kvbag_p->version = ++world_p->kvbag_version;
+        for (j = 0; j < kv_n; ++j)
+        {
+            if (kvbag_hash_probe(hash_p, kv_a[j].key_r, &x) == O71_OK)
+            {
+                os = o71_deref(world_p, hash_p->kv_a[x].value_r);
+                AOS(os);
+                hash_p->kv_a[x].value_r = kv_a[j].value_r;
+                continue;
+            }
+            kvbag_hash_place(hash_p, x, kv_a[j].key_r, kv_a[j].value_r);
+            os = o71_ref(world_p, kv_a[j].key_r);
+            AOS(os);
+        }
+        return O71_OK;
+    }
+    if (kv_n * KVBAG_MERGE_PUT_RATIO < kvbag_min_count(kvbag_p))
+    {
+        for (j = 0; j < kv_n; ++j)
+        {
+            os = kvbag_put(world_p, kvbag_p, kv_a[j].key_r, kv_a[j].value_r,
+                           cmp, ctx);
+            if (os) return os;
+        }
+        return O71_OK;
+    }
+
+    if (kvbag_p->mode == O71_BAG_ARRAY)
+    {
+        old_a = kvbag_p->kv_a;
+        old_n = kvbag_p->n;
+    }
+    else
+    {
+        old_n = kvbag_tree_collect(world_p, kvbag_p, NULL);
+        os = redim(world_p->allocator_p, (void * *) &old_a, &old_m, old_n,
+                   sizeof(o71_kv_t));
+        if (os) return os;
+        kvbag_tree_collect(world_p, kvbag_p, old_a);
+    }
+    os = redim(world_p->allocator_p, (void * *) &new_a, &new_m, old_n + kv_n,
+               sizeof(o71_kv_t));
+
+    /* for equal keys the bag keeps its key and takes the new value; the
+     * replaced items are stacked at the end of new_a, which is never
+     * reached by the merged items */
+    for (i = j = w = 0, d = new_m; !os && (i < old_n || j < kv_n); )
+    {
+        o71_status_t c;
+        if (i == old_n) c = O71_MORE;
+        else if (j == kv_n) c = O71_LESS;
+        else c = cmp(world_p, old_a[i].key_r, kv_a[j].key_r, ctx);
+        switch (c)
+        {
+        case O71_LESS:
+            new_a[w++] = old_a[i++];
+            break;
+        case O71_MORE:
+            new_a[w++] = kv_a[j++];
+            break;
+        case O71_EQUAL:
+            d -= 1;
+            new_a[d].key_r = kv_a[j].key_r;
+            new_a[d].value_r = old_a[i].value_r;
+            new_a[w].key_r = old_a[i++].key_r;
+            new_a[w++].value_r = kv_a[j++].value_r;
+            break;
+        default:
+            os = c;
+        }
+    }
+
+    if (!os) os = kvbag_build(world_p, kvbag_p, new_a, w);
+    if (old_m)
+    {
+        osf = redim(world_p->allocator_p, (void * *) &old_a, &old_m, 0,
+                    sizeof(o71_kv_t));
+        AOS(osf);
+    }
+    if (!os)
+    {
+        /* batch keys are now in the bag, except the ones of replaced items
+         * that are stacked with the values they replaced */
+        for (j = 0; j < kv_n; ++j)
+        {
+            osf = o71_ref(world_p, kv_a[j].key_r);
+            AOS(osf);
+        }
+        for (; d < new_m; ++d)
+        {
+            osf = o71_deref(world_p, new_a[d].key_r);
+            AOS(osf);
+            osf = o71_deref(world_p, new_a[d].value_r);
+            AOS(osf);
+        }
+    }
+    if (new_m)
+    {
+        osf = redim(world_p->allocator_p, (void * *) &new_a, &new_m, 0,
+                    sizeof(o71_kv_t));
+        AOS(osf);
+    }
+    return os;
+}
+
+/* kvbag_cursor_init ********************************************************/
+static void kvbag_cursor_init
+(
+    o71_kvbag_cursor_t * cursor_p
+)
+{
+    cursor_p->key_r = O71R_NULL;
+    cursor_p->depth = 0;
+    cursor_p->version = 0;
+    cursor_p->state = O71_KVBAG_CURSOR_START;
+}
+
+/* kvbag_cursor_seek ********************************************************/
+static o71_status_t kvbag_cursor_seek
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kvbag_cursor_t * cursor_p,
+    o71_ref_t key_r,
+    o71_cmp_f cmp,
+    void * ctx
+)
+{
+    o71_status_t os;
+    cursor_p->key_r = key_r;
+    cursor_p->state = O71_KVBAG_CURSOR_AFTER;
+    os = kvbag_cursor_locate(world_p, kvbag_p, cursor_p, cmp, ctx);
+    if (os) cursor_p->state = O71_KVBAG_CURSOR_START;
+    return os;
+}
+
+/* kvbag_cursor_locate ******************************************************/
+static o71_status_t kvbag_cursor_locate
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kvbag_cursor_t * cursor_p,
+    o71_cmp_f cmp,
+    void * ctx
+)
+{
+    o71_ref_t key_r = cursor_p->key_r;
+    int start = cursor_p->state == O71_KVBAG_CURSOR_START;
+    o71_status_t os;
+    size_t a, b, c;
+
+    switch (kvbag_p->mode)
+    {
+    case O71_BAG_ARRAY:
+        if (start) c = 0;
+        else
+        {
+            /* first item with a key greater than key_r */
+            for (a = 0, b = kvbag_p->n; a < b; )
+            {
+                c = (a + b) / 2;
+                os = cmp(world_p, kvbag_p->kv_a[c].key_r, key_r, ctx);
+                if (os == O71_MORE) b = c;
+                else if (os == O71_LESS || os == O71_EQUAL) a = c + 1;
+                else return os;
+            }
+            c = a;
+        }
+        cursor_p->array.index = c;
+        break;
+
+    case O71_BAG_HASH:
+        if (start) c = 0;
+        else
+        {
+            /* positions past the last slot stand for the slots again, for
+             * the items that wrapped around the end of the table */
+            o71_kvhash_t * hash_p = kvbag_p->hash_p;
+            a = KVHASH_HOME(key_r, hash_p->mask);
+            os = kvbag_hash_probe(hash_p, key_r, &c);
+            c = a + ((c - a) & hash_p->mask) + (os == O71_OK);
+        }
+        cursor_p->array.index = c;
+        break;
+
+    case O71_BAG_BTREE:
+        {
+            o71_kvbtnode_t * node_p = kvbag_p->btree_p;
+            unsigned int depth;
+            for (depth = 0; ; node_p = node_p->child_a[a])
+            {
+                /* a: number of keys not greater than key_r */
+                a = 0;
+                b = node_p->n;
+                while (!start && a < b)
+                {
+                    c = (a + b) / 2;
+                    os = cmp(world_p, node_p->kv_a[c].key_r, key_r, ctx);
+                    if (os == O71_MORE) b = c;
+                    else if (os == O71_LESS || os == O71_EQUAL) a = c + 1;
+                    else return os;
+                }
+                A(depth < O71_BTREE_DEPTH_MAX);
+                cursor_p->btree.node_a[depth] = node_p;
+                cursor_p->btree.index_a[depth] = (uint8_t) a;
+                depth += 1;
+                if (node_p->leaf) break;
+            }
+            /* drop the nodes that have no items left */
+            while (depth && cursor_p->btree.index_a[depth - 1]
+                   == cursor_p->btree.node_a[depth - 1]->n) depth -= 1;
+            cursor_p->depth = depth;
+        }
+        break;
+
+    default:
+        {
+            o71_kvnode_t * node_p = kvbag_p->tree_p;
+            unsigned int depth = 0;
+            /* keep the nodes where the path goes left: their items come
+             * after the ones in their left subtree */
+            while (node_p)
+            {
+                os = start ? O71_MORE : cmp(world_p, node_p->kv.key_r, key_r,
+                                            ctx);
+                if (os == O71_MORE)
+                {
+                    A(depth < ITEM_COUNT(cursor_p->rbtree.node_a));
+                    cursor_p->rbtree.node_a[depth++] = node_p;
+                    node_p = GET_CHILD(node_p, 0);
+                }
+                else if (os == O71_LESS || os == O71_EQUAL)
+                    node_p = GET_CHILD(node_p, 1);
+                else return os;
+            }
+            cursor_p->depth = depth;
+        }
+    }
+    cursor_p->version = kvbag_p->version;
+    return O71_OK;
+}
+
+/* kvbag_cursor_next ********************************************************/
+static o71_status_t kvbag_cursor_next
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kvbag_cursor_t * cursor_p,
+    o71_cmp_f cmp,
+    void * ctx,
+    o71_kv_t * kv_p
+)
+{
+    o71_status_t os;
+    size_t x;
+
+    if (cursor_p->state == O71_KVBAG_CURSOR_START
+        || cursor_p->version != kvbag_p->version)
+    {
+        os = kvbag_cursor_locate(world_p, kvbag_p, cursor_p, cmp, ctx);
+        if (os) return os;
+    }
+
+    switch (kvbag_p->mode)
+    {
+    case O71_BAG_ARRAY:
+        x = cursor_p->array.index;
+        if (x >= kvbag_p->n) return O71_MISSING;
+        *kv_p = kvbag_p->kv_a[x];
+        cursor_p->array.index = x + 1;
+        break;
+
+    case O71_BAG_HASH:
+        {
+            /* first pass over the slots: the items at or after their home
+             * slot; second pass: the items that wrapped around the end of
+             * the table, which fill the slots up to the first other one */
+            o71_kvhash_t * hash_p = kvbag_p->hash_p;
+            size_t mask = hash_p->mask;
+            o71_ref_t k;
+            int wrapped;
+            for (x = cursor_p->array.index; ; ++x)
+            {
+                if (x > mask * 2 + 1) return O71_MISSING;
+                k = hash_p->kv_a[x & mask].key_r;
+                wrapped = k != O71_KVHASH_FREE_KEY
+                    && (x & mask) < KVHASH_HOME(k, mask);
+                if (x > mask)
+                {
+                    if (!wrapped) return O71_MISSING;
+                    break;
+                }
+                if (k != O71_KVHASH_FREE_KEY && !wrapped) break;
+            }
+            *kv_p = hash_p->kv_a[x & mask];
+            cursor_p->array.index = x + 1;
+        }
+        break;
+
+    case O71_BAG_BTREE:
+        {
+            o71_kvbtnode_t * node_p;
+            unsigned int depth = cursor_p->depth;
+            if (!depth) return O71_MISSING;
+            node_p = cursor_p->btree.node_a[depth - 1];
+            x = cursor_p->btree.index_a[depth - 1];
+            *kv_p = node_p->kv_a[x];
+            cursor_p->btree.index_a[depth - 1] = (uint8_t) (x + 1);
+            /* the items after kv_a[x] start with the leftmost leaf of
+             * child_a[x + 1] */
+            for (x += 1; !node_p->leaf; x = 0)
+            {
+                node_p = node_p->child_a[x];
+                A(depth < O71_BTREE_DEPTH_MAX);
+                cursor_p->btree.node_a[depth] = node_p;
+                cursor_p->btree.index_a[depth] = 0;
+                depth += 1;
+            }
+            while (depth && cursor_p->btree.index_a[depth - 1]
+                   == cursor_p->btree.node_a[depth - 1]->n) depth -= 1;
+            cursor_p->depth = depth;
+        }
+        break;
+
+    default:
+        {
+            o71_kvnode_t * node_p;
+            unsigned int depth = cursor_p->depth;
+            if (!depth) return O71_MISSING;
+            node_p = cursor_p->rbtree.node_a[--depth];
+            *kv_p = node_p->kv;
+            for (node_p = GET_CHILD(node_p, 1); node_p;
+                 node_p = GET_CHILD(node_p, 0))
+            {
+                A(depth < ITEM_COUNT(cursor_p->rbtree.node_a));
+                cursor_p->rbtree.node_a[depth++] = node_p;
+            }
+            cursor_p->depth = depth;
+        }
+    }
+    cursor_p->key_r = kv_p->key_r;
+    cursor_p->state = O71_KVBAG_CURSOR_AFTER;
+    return O71_OK;
+}
+
+/* kvbag_visit_values *******************************************************/
+static o71_status_t kvbag_visit_values
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_ref_visit_f visit,
+    void * ctx
+)
+{
+    o71_status_t os;
+    unsigned int i;
+
+    if (kvbag_p->mode == O71_BAG_ARRAY)
+    {
+        for (i = 0; i < kvbag_p->n; ++i)
+        {
+            os = visit(world_p, &kvbag_p->kv_a[i].value_r, ctx);
+            if (os) return os;
+        }
+        return O71_OK;
+    }
+    if (kvbag_p->mode == O71_BAG_BTREE)
+        return kvbag_btree_visit_values(world_p, kvbag_p->btree_p, visit, ctx);
+    if (kvbag_p->mode == O71_BAG_HASH)
+    {
+        o71_kvhash_t * hash_p = kvbag_p->hash_p;
+        size_t x;
+        for (x = 0; x <= hash_p->mask; ++x)
+        {
+            if (hash_p->kv_a[x].key_r == O71_KVHASH_FREE_KEY) continue;
+            os = visit(world_p, &hash_p->kv_a[x].value_r, ctx);
+            if (os) return os;
+        }
+        return O71_OK;
+    }
+    A(kvbag_p->mode == O71_BAG_RBTREE);
+    return kvbag_p->tree_p
+        ? kvbag_rbtree_visit_values(world_p, kvbag_p->tree_p, visit, ctx)
+        : O71_OK;
+}
+
+/* kvbag_rbtree_visit_values ************************************************/
+static o71_status_t kvbag_rbtree_visit_values
+(
+    o71_world_t * world_p,
+    o71_kvnode_t * kvnode_p,
+    o71_ref_visit_f visit,
+    void * ctx
+)
+{
+    o71_status_t os;
+    A(kvnode_p);
+    if (GET_CHILD(kvnode_p, 0))
+    {
+        os = kvbag_rbtree_visit_values(world_p, GET_CHILD(kvnode_p, 0),
+                                       visit, ctx);
+        if (os) return os;
+    }
+    if (GET_CHILD(kvnode_p, 1))
+    {
+        os = kvbag_rbtree_visit_values(world_p, GET_CHILD(kvnode_p, 1),
+                                       visit, ctx);
+        if (os) return os;
+    }
+    return visit(world_p, &kvnode_p->kv.value_r, ctx);
+}
+
+/* kvbag_rbtree_node_alloc **************************************************/
+static o71_status_t kvbag_rbtree_node_alloc
+(
+    o71_world_t * world_p,
+    o71_kvnode_t * * kvnode_pp
+)
+{
+    size_t n = 0;
+    return redim(world_p->allocator_p, (void * *) kvnode_pp, &n, 1,
+                 sizeof(o71_kvnode_t));
+}
+
+/* kvbag_rbtree_node_free ***************************************************/
+static o71_status_t kvbag_rbtree_node_free
+(
+    o71_world_t * world_p,
+    o71_kvnode_t * kvnode_p,
+    o71_kv_free_f kv_free
+)
+{
+    size_t n = 1;
+    o71_status_t os;
+    os = kv_free(world_p, &kvnode_p->kv);
+    AOS(os);
+    return redim(world_p->allocator_p, (void * *) &kvnode_p, &n, 0,
+                 sizeof(o71_kvnode_t));
+}
+
+/* kvbag_rbtree_free ********************************************************/
+static o71_status_t kvbag_rbtree_free
+(
+    o71_world_t * world_p,
+    o71_kvnode_t * kvnode_p,
+    o71_kv_free_f kv_free
+)
+{
+    o71_status_t os;
+    A(kvnode_p);
+    if (GET_CHILD(kvnode_p, 0))
+    {
+        os = kvbag_rbtree_free(world_p, GET_CHILD(kvnode_p, 0), kv_free);
+        if (os) return os;
+    }
+    if (GET_CHILD(kvnode_p, 1))
+    {
+        os = kvbag_rbtree_free(world_p, GET_CHILD(kvnode_p, 1), kv_free);
+        if (os) return os;
+    }
+    return kvbag_rbtree_node_free(world_p, kvnode_p, kv_free);
+}
+
+#if O71_DEBUG
+/* kvbag_rbtree_dump ********************************************************/
+static void kvbag_rbtree_dump
+(
+    o71_world_t * world_p,
+    o71_kvnode_t * kvnode_p,
+    unsigned int depth
+)
+{
+    if (!kvnode_p) return;
+    kvbag_rbtree_dump(world_p, GET_CHILD(kvnode_p, O71_LESS), depth + 1);
+    printf("%.*sk=", depth * 2,
+           "                                                                ");
+    obj_dump(world_p, kvnode_p->kv.key_r);
+    printf(" -> v=");
+    obj_dump(world_p, kvnode_p->kv.value_r);
+    printf("\n");
+    // printf("%.*sk=%lX=:v=%lX= (%s)\n",
+    //        depth * 2,
+    //        kvnode_p->kv.key_r, kvnode_p->kv.value_r,
+    //        IS_RED(kvnode_p) ? "red" : "black");
+    kvbag_rbtree_dump(world_p, GET_CHILD(kvnode_p, O71_MORE), depth + 1);
+}
+#endif
+
+/* kvbag_rbtree_build *******************************************************/
+static o71_status_t kvbag_rbtree_build
+(
+    o71_world_t * world_p,
+    o71_kv_t const * kv_a,
+    size_t kv_n,
+    unsigned int red_depth,
+    o71_kvnode_t * * node_pp
+)
+{
+    o71_kvnode_t * left_p;
+    o71_kvnode_t * right_p = NULL;
+    o71_kvnode_t * node_p = NULL;
+    o71_status_t os, osf;
+    size_t x;
+
+    *node_pp = NULL;
+    if (!kv_n) return O71_OK;
+    x = kv_n / 2;
+    os = kvbag_rbtree_build(world_p, kv_a, x, red_depth - 1, &left_p);
+    if (os) return os;
+    os = kvbag_rbtree_node_alloc(world_p, &node_p);
+    if (!os) os = kvbag_rbtree_build(world_p, kv_a + x + 1, kv_n - x - 1,
+                                     red_depth - 1, &right_p);
+    if (os)
+    {
+        if (node_p)
+        {
+            osf = kvbag_rbtree_node_free(world_p, node_p, kv_nop_free);
+            AOS(osf);
+        }
+        if (left_p)
+        {
+            osf = kvbag_rbtree_free(world_p, left_p, kv_nop_free);
+            AOS(osf);
+        }
+        return os;
+    }
+    node_p->kv = kv_a[x];
+    node_p->clr[0] = (uintptr_t) left_p | (red_depth == 0);
+    node_p->clr[1] = (uintptr_t) right_p;
+    *node_pp = node_p;
+    return O71_OK;
+}
+
+/* kvbag_rbtree_insert ******************************************************/
+static o71_status_t kvbag_rbtree_insert
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_ref_t key_r,
+    o71_ref_t value_r,
+    o71_kvbag_loc_t * loc_p
+)
+{
+    unsigned int i, gs, ps, ts;
+    o71_kvnode_t * parent;
+    o71_kvnode_t * grandpa;
+    o71_kvnode_t * uncle;
+    o71_kvnode_t * tmp;
+    o71_kvnode_t * node = NULL;
+    o71_status_t os;
+
+    M2("rbtree insert (k=obref_%lX, v=obref_%lX)", key_r, value_r);
+    os = kvbag_rbtree_node_alloc(world_p, &node);
+    if (os)
+    {
+        M("failed to allocate rbtree node: %s", N(os));
+        return os;
+    }
+    os = o71_ref(world_p, key_r);
+    AOS(os);
+    node->kv.key_r = key_r;
+    node->kv.value_r = value_r;
+
+    i = loc_p->rbtree.last_x;
+    node->clr[0] = 1;
+    node->clr[1] = 0;
+    ts = loc_p->rbtree.side_a[i];
+    M2("ts=%u", ts);
+    A(ts < 2);
+    SET_CHILD(loc_p->rbtree.node_a[i], ts, node);
+
+    while (i)
+    {
+        parent = loc_p->rbtree.node_a[i];
+        if (!IS_RED(parent)) return O71_OK;
+        // parent is red (thus it is not the root)
+        grandpa = loc_p->rbtree.node_a[--i];
+        uncle = GET_CHILD(grandpa, OTHER_SIDE(loc_p->rbtree.side_a[i]));
+        if (uncle && IS_RED(uncle))
+        {
+            SET_RED(grandpa, 1);
+            SET_RED(parent, 0);
+            SET_RED(uncle, 0);
+            node = grandpa;
+            --i;
+            continue;
+        }
+        // parent is red, uncle is black or NULL
+        if ((gs = loc_p->rbtree.side_a[i])
+            != (ps = loc_p->rbtree.side_a[i + 1]))
+        {
+            // node and parent are on different sides
+            SET_CHILD(grandpa, gs, node);
+            tmp = GET_CHILD(node, gs);
+            SET_CHILD(parent, ps, tmp);
+            SET_CHILD(node, gs, parent);
+
+            tmp = node;
+            node = parent;
+            parent = tmp;
+        }
+        else ps = OTHER_SIDE(gs);
+        // node and parent are on same side: gs; ps is set to the 'other' side
+        tmp = GET_CHILD(parent, ps);
+        SET_CHILD(parent, ps, grandpa);
+        SET_RED(parent, 0);
+        SET_CHILD(grandpa, gs, tmp);
+        SET_RED(grandpa, 1);
+        tmp = loc_p->rbtree.node_a[i - 1];
+        ts = loc_p->rbtree.side_a[i - 1];
+        SET_CHILD(tmp, ts, parent);
+        return O71_OK;
+    }
+    // if we processed 'til the top of the path then root is changed
+    SET_RED(node, 0);
+    return O71_OK;
+}
+
+#if O71_DEBUG
+/* kvbag_array_dump *********************************************************/
+static void kvbag_array_dump
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p
+)
+{
+    unsigned int i;
+    printf("[array]");
+    for (i = 0; i < kvbag_p->n; ++i)
+    {
+        printf(" k=%lX:v=%lX",
+               kvbag_p->kv_a[i].key_r, kvbag_p->kv_a[i].value_r);
+    }
+
+    printf("\n");
+}
+#endif
+
+/* KVBAG_SEARCH_DEF *********************************************************/
+/*
+ *  Defines kvbag_array_search<kind>(), kvbag_rbtree_search<kind>() and
+ *  kvbag_btree_search<kind>() comparing keys with _cmp(world_p, a, b, ctx);
+ *  a macro comparator gets inlined in the probe loops.
+ */
+#define KVBAG_SEARCH_DEF(_kind, _cmp)                                          \
+static o71_status_t kvbag_array_search ## _kind                                \
+(                                                                              \
+    o71_world_t * world_p,                                                     \
+    o71_kvbag_t * kvbag_p,                                                     \
+    o71_ref_t key_r,                                                           \
+    o71_cmp_f cmp,                                                             \
+    void * ctx,                                                                \
+    o71_kvbag_loc_t * loc_p                                                    \
+)                                                                              \
+{                                                                              \
+    int a, b;                                                                  \
+    a = 0;                                                                     \
+    b = kvbag_p->n - 1;                                                        \
+    while (a <= b)                                                             \
+    {                                                                          \
+        int c = (a + b) >> 1;                                                  \
+        unsigned int r = _cmp(world_p, key_r, kvbag_p->kv_a[c].key_r, ctx);    \
+        switch (r)                                                             \
+        {                                                                      \
+        case O71_LESS: b = c - 1; break;                                       \
+        case O71_MORE: a = c + 1; break;                                       \
+        case O71_EQUAL:                                                        \
+            loc_p->array.index = c;                                            \
+            LOC_STATUS(loc_p, O71_OK);                                         \
+            return O71_OK;                                                     \
+        default:                                                               \
+            M("compare error: %s", N(r));                                      \
+            loc_p->cmp_error = r;                                              \
+            return O71_CMP_ERROR;                                              \
+        }                                                                      \
+    }                                                                          \
+    /* a contains the position where to insert the key */                      \
+    loc_p->array.index = a;                                                    \
+    LOC_STATUS(loc_p, O71_MISSING);                                            \
+    M2("miss: key_r=obref_%lX -> pos=%u", key_r, a);                           \
+    return O71_MISSING;                                                        \
+}                                                                              \
+                                                                               \
+static o71_status_t kvbag_rbtree_search ## _kind                               \
+(                                                                              \
+    o71_world_t * world_p,                                                     \
+    o71_kvbag_t * kvbag_p,                                                     \
+    o71_ref_t key_r,                                                           \
+    o71_cmp_f cmp,                                                             \
+    void * ctx,                                                                \
+    o71_kvbag_loc_t * loc_p                                                    \
+)                                                                              \
+{                                                                              \
+    o71_kvnode_t * kvnode_p;                                                   \
+    unsigned int i = 0;                                                        \
+    loc_p->rbtree.node_a[0] = (o71_kvnode_t *) &kvbag_p->tree_p;               \
+    loc_p->rbtree.side_a[0] = 0;                                               \
+    kvnode_p = kvbag_p->tree_p;                                                \
+    while (kvnode_p)                                                           \
+    {                                                                          \
+        unsigned int cr;                                                       \
+        loc_p->rbtree.node_a[++i] = kvnode_p;                                  \
+        cr = _cmp(world_p, key_r, kvnode_p->kv.key_r, ctx);                    \
+        switch (cr)                                                            \
+        {                                                                      \
+        case O71_LESS:                                                         \
+        case O71_MORE:                                                         \
+            loc_p->rbtree.side_a[i] = cr;                                      \
+            kvnode_p = GET_CHILD(kvnode_p, cr);                                \
+            break;                                                             \
+        case O71_EQUAL:                                                        \
+            loc_p->rbtree.side_a[i] = cr;                                      \
+            loc_p->rbtree.last_x = i;                                          \
+            LOC_STATUS(loc_p, O71_OK);                                         \
+            return O71_OK;                                                     \
+        default:                                                               \
+            loc_p->rbtree.last_x = i;                                          \
+            loc_p->cmp_error = cr;                                             \
+            LOC_STATUS(loc_p, O71_CMP_ERROR);                                  \
+            return O71_CMP_ERROR;                                              \
+        }                                                                      \
+    }                                                                          \
+    loc_p->rbtree.last_x = i;                                                  \
+    LOC_STATUS(loc_p, O71_MISSING);                                            \
+    return O71_MISSING;                                                        \
+}                                                                              \
+                                                                               \
+static o71_status_t kvbag_btree_search ## _kind                                \
+(                                                                              \
+    o71_world_t * world_p,                                                     \
+    o71_kvbag_t * kvbag_p,                                                     \
+    o71_ref_t key_r,                                                           \
+    o71_cmp_f cmp,                                                             \
+    void * ctx,                                                                \
+    o71_kvbag_loc_t * loc_p                                                    \
+)                                                                              \
+{                                                                              \
+    o71_kvbtnode_t * node_p;                                                   \
+    unsigned int d;                                                            \
+    int a, b;                                                                  \
+                                                                               \
+    node_p = kvbag_p->btree_p;                                                 \
+    for (d = 0; ; ++d)                                                         \
+    {                                                                          \
+        A(d < O71_BTREE_DEPTH_MAX);                                            \
+        loc_p->btree.node_a[d] = node_p;                                       \
+        a = 0;                                                                 \
+        b = node_p->n - 1;                                                     \
+        while (a <= b)                                                         \
+        {                                                                      \
+            int c = (a + b) >> 1;                                              \
+            unsigned int r = _cmp(world_p, key_r, node_p->kv_a[c].key_r, ctx); \
+            switch (r)                                                         \
+            {                                                                  \
+            case O71_LESS: b = c - 1; break;                                   \
+            case O71_MORE: a = c + 1; break;                                   \
+            case O71_EQUAL:                                                    \
+                loc_p->btree.index_a[d] = (uint8_t) c;                         \
+                loc_p->btree.last_x = d;                                       \
+                LOC_STATUS(loc_p, O71_OK);                                     \
+                return O71_OK;                                                 \
+            default:                                                           \
+                M("compare error: %s", N(r));                                  \
+                loc_p->btree.last_x = d;                                       \
+                loc_p->cmp_error = r;                                          \
+                LOC_STATUS(loc_p, O71_CMP_ERROR);                              \
+                return O71_CMP_ERROR;                                          \
+            }                                                                  \
+        }                                                                      \
+        /* a is the insert position in this node or the child to descend */    \
+        loc_p->btree.index_a[d] = (uint8_t) a;                                 \
+        if (node_p->leaf) break;                                               \
+        node_p = node_p->child_a[a];                                           \
+    }                                                                          \
+    loc_p->btree.last_x = d;                                                   \
+    LOC_STATUS(loc_p, O71_MISSING);                                            \
+    M2("miss: key_r=obref_%lX -> depth=%u pos=%u", key_r, d, a);               \
+    return O71_MISSING;                                                        \
+}
+
+KVBAG_SEARCH_DEF(, KVBAG_CMP_ANY)
+KVBAG_SEARCH_DEF(_ref, KVBAG_CMP_REF)
+
+/* KVBAG_LOOKUP_DEF *********************************************************/
+/*
+ *  Defines kvbag_lookup<kind>() for array, red/black tree and B-tree bags,
+ *  comparing keys with _cmp(world_p, a, b, ctx) like KVBAG_SEARCH_DEF.
+ */
+#define KVBAG_LOOKUP_DEF(_kind, _cmp)                                          \
+static o71_status_t kvbag_lookup ## _kind                                      \
+(                                                                              \
+    o71_world_t * world_p,                                                     \
+    o71_kvbag_t * kvbag_p,                                                     \
+    o71_ref_t key_r,                                                           \
+    o71_cmp_f cmp,                                                             \
+    void * ctx,                                                                \
+    o71_ref_t * value_rp                                                       \
+)                                                                              \
+{                                                                              \
+    o71_kv_t * kv_a;                                                           \
+    o71_kvbtnode_t * node_p = NULL;                                            \
+    o71_kvnode_t * kvnode_p;                                                   \
+    unsigned int r;                                                            \
+    int a, b, c;                                                               \
+                                                                               \
+    if (kvbag_p->mode == O71_BAG_RBTREE)                                       \
+    {                                                                          \
+        for (kvnode_p = kvbag_p->tree_p; kvnode_p;                             \
+             kvnode_p = GET_CHILD(kvnode_p, r))                                \
+        {                                                                      \
+            r = _cmp(world_p, key_r, kvnode_p->kv.key_r, ctx);                 \
+            if (r == O71_EQUAL)                                                \
+            {                                                                  \
+                *value_rp = kvnode_p->kv.value_r;                              \
+                return O71_OK;                                                 \
+            }                                                                  \
+            if (r > O71_MORE) return (o71_status_t) r;                         \
+        }                                                                      \
+        return O71_MISSING;                                                    \
+    }                                                                          \
+    if (kvbag_p->mode == O71_BAG_ARRAY)                                        \
+    {                                                                          \
+        kv_a = kvbag_p->kv_a;                                                  \
+        b = kvbag_p->n - 1;                                                    \
+    }                                                                          \
+    else                                                                       \
+    {                                                                          \
+        A(kvbag_p->mode == O71_BAG_BTREE);                                     \
+        node_p = kvbag_p->btree_p;                                             \
+        kv_a = node_p->kv_a;                                                   \
+        b = node_p->n - 1;                                                     \
+    }                                                                          \
+    for (;;)                                                                   \
+    {                                                                          \
+        a = 0;                                                                 \
+        while (a <= b)                                                         \
+        {                                                                      \
+            c = (a + b) >> 1;                                                  \
+            r = _cmp(world_p, key_r, kv_a[c].key_r, ctx);                      \
+            if (r == O71_LESS) b = c - 1;                                      \
+            else if (r == O71_MORE) a = c + 1;                                 \
+            else if (r == O71_EQUAL)                                           \
+            {                                                                  \
+                *value_rp = kv_a[c].value_r;                                   \
+                return O71_OK;                                                 \
+            }                                                                  \
+            else return (o71_status_t) r;                                      \
+        }                                                                      \
+        if (!node_p || node_p->leaf) return O71_MISSING;                       \
+        node_p = node_p->child_a[a];                                           \
+        kv_a = node_p->kv_a;                                                   \
+        b = node_p->n - 1;                                                     \
+    }                                                                          \
+}
+
+KVBAG_LOOKUP_DEF(, KVBAG_CMP_ANY)
+KVBAG_LOOKUP_DEF(_ref, KVBAG_CMP_REF)
+
+/* kvbag_array_delete *******************************************************/
+static o71_status_t kvbag_array_delete
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kvbag_loc_t * loc_p
+)
+{
+    unsigned int i;
+    A(kvbag_p->n > 0);
+    kvbag_p->n--;
+    A(loc_p->array.index <= kvbag_p->n);
+    for (i = loc_p->array.index; i < kvbag_p->n; ++i)
+        kvbag_p->kv_a[i] = kvbag_p->kv_a[i + 1];
+    return O71_OK;
+}
+
+/* kvbag_array_free *******************************************************/
+static o71_status_t kvbag_array_free
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kv_free_f kv_free
+)
+{
+    unsigned int i;
+    o71_status_t os;
+    size_t m;
+    for (i = 0; i < kvbag_p->n; ++i)
+    {
+        os = kv_free(world_p, kvbag_p->kv_a + i);
+        AOS(os);
+    }
+    m = kvbag_p->m;
+    FREE_ARRAY(world_p->allocator_p, kvbag_p->kv_a, m);
+    return O71_OK;
+}
+
+/* kvbag_rbtree_np **********************************************************/
+static o71_kvnode_t * kvbag_rbtree_np
+(
+    o71_kvbag_loc_t * loc_p,
+    unsigned int side
+)
+{
+  o71_kvnode_t * n;
+  o71_kvnode_t * m;
+  unsigned int d;
+
+  d = loc_p->rbtree.last_x;
+  n = loc_p->rbtree.node_a[d];
+  m = GET_CHILD(n, side);
+  //if (!m) return NULL;
+  if (m)
+  {
+      loc_p->rbtree.side_a[d] = side;
+      side = OTHER_SIDE(side);
+      for (; m; m = GET_CHILD(m, side))
+      {
+        ++d;
+        loc_p->rbtree.node_a[d] = m;
+        loc_p->rbtree.side_a[d] = side;
+      }
+  }
+  else
+  {
+      do { --d; } while (d && loc_p->rbtree.side_a[d] == side);
+      if (!d) return NULL;
+  }
+
+
+  loc_p->rbtree.side_a[d] = O71_EQUAL;
+  loc_p->rbtree.last_x = d;
+  return loc_p->rbtree.node_a[d];
+}
+
+/* kvbag_rbtree_delete ******************************************************/
+static o71_status_t kvbag_rbtree_delete
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kvbag_loc_t * loc_p
+)
+{
+    o71_kvnode_t * o;
+    o71_kvnode_t * d;
+    o71_kvnode_t * p;
+    o71_kvnode_t * c;
+    o71_kvnode_t * s;
+    o71_kvnode_t * sl;
+    o71_kvnode_t * sr;
+    o71_kvnode_t * t;
+    uintptr_t tmp[2];
+    unsigned int cs, ds, od, dd, ns, pd, ps, ss, os;
+
+    do
+    {
+        od = loc_p->rbtree.last_x;
+        o = loc_p->rbtree.node_a[od]; // the node we want to delete
+        if (GET_CHILD(o, O71_LESS) && GET_CHILD(o, O71_MORE))
+        {
+            ds = loc_p->rbtree.side_a[od - 1];
+            d = kvbag_rbtree_np(loc_p, (uint8_t) ds);
+            // now must delete d which has at most 1 non-null child
+            dd = loc_p->rbtree.last_x;
+            tmp[0] = o->clr[0]; tmp[1] = o->clr[1];
+            o->clr[0] = d->clr[0]; o->clr[1] = d->clr[1];
+            d->clr[0] = tmp[0]; d->clr[1] = tmp[1];
+            loc_p->rbtree.node_a[od] = d;
+            t = loc_p->rbtree.node_a[od - 1];
+            os = loc_p->rbtree.side_a[od - 1];
+            SET_CHILD(t, os, d);
+        }
+        else { dd = od; }
+
+        d = o;
+
+        cs = GET_CHILD(d, 0) ? O71_LESS : O71_MORE;
+        c = GET_CHILD(d, cs); // c is the only child of d or NULL
+
+        ds = loc_p->rbtree.side_a[dd - 1];
+        p = loc_p->rbtree.node_a[dd - 1];
+        if (IS_RED(d))
+        {
+            // d has no children since it has at most 1 non-null child and
+            // both paths must have same ammount of black node_a
+            SET_CHILD(p, ds, NULL);
+            break;
+        }
+        // d is black; it has either no children, or a single red child with no
+        // children of its own
+        if (c) // same as: (c && c->red)
+        {
+            SET_CHILD(p, ds, c);
+            SET_RED(c, 0);
+            break;
+        }
+
+        // d is black and has no children (if c is black and its sibling is NULL then
+        // it must be NULL itself)
+
+        SET_CHILD(p, ds, NULL);
+
+        for (pd = dd - 1; pd; p = loc_p->rbtree.node_a[--pd])
+        {
+            // n is always black (in first iteration it is NULL)
+            ns = loc_p->rbtree.side_a[pd];
+            ss = OTHER_SIDE(ns);
+            s = GET_CHILD(p, ss); // this is a non-NULL node
+            if (IS_RED(s)) // implies p is black
+            {
+                /* del case 2 */
+                t = loc_p->rbtree.node_a[pd - 1];
+                ps = loc_p->rbtree.side_a[pd - 1];
+                SET_CHILD(t, ps, s);
+                sl = GET_CHILD(s, ns);
+                SET_CHILD(p, ss, sl);
+                SET_RED(p, 1);
+                SET_CHILD(s, ns, p);
+                SET_RED(s, 0);
+                loc_p->rbtree.node_a[pd] = s;
+                ++pd;
+                s = sl; /* new s is black */
+            }
+            else
+            {
+                // s is black
+                if (!IS_RED(p) && !IS_RED(GET_CHILD(s, 0)) && !IS_RED(GET_CHILD(s, 1)))
+                {
+                    /* del case 3 */
+                    SET_RED(s, 1);
+                    continue;
+                }
+            }
+            // s must be black
+            sl = GET_CHILD(s, ns);
+            sr = GET_CHILD(s, ss);
+            if (IS_RED(p) && !IS_RED(sl) && !IS_RED(sr))
+            {
+                /* del case 4 */
+                SET_RED(p, 0);
+                SET_RED(s, 1);
+                break;
+            }
+            if (IS_RED(sl) && !IS_RED(sr))
+            {
+                SET_CHILD(p, ss, sl);
+                SET_CHILD(s, ns, GET_CHILD(sl, ss));
+                SET_RED(s, 1);
+                SET_CHILD(sl, ss, s);
+                SET_RED(sl, 0);
+                s = sl; // again new s is black
+                sl = GET_CHILD(s, ns);
+                sr = GET_CHILD(s, ss);
+            }
+            if (IS_RED(sr))
+            {
+                t = loc_p->rbtree.node_a[pd - 1];
+                ps = loc_p->rbtree.side_a[pd - 1];
+                SET_CHILD(t, ps, s);
+                SET_CHILD(p, ss, sl);
+                SET_RED(s, IS_RED(p));
+                SET_RED(p, 0);
+                SET_RED(sr, 0);
+                SET_CHILD(s, ns, p);
+            }
+            break;
+        }
+    }
+    while (0);
+    kvbag_rbtree_node_free(world_p, o, kv_nop_free);
+    return O71_OK;
+}
+
+/* kvbag_btree_node_alloc ***************************************************/
+static o71_status_t kvbag_btree_node_alloc
+(
+    o71_world_t * world_p,
+    unsigned int leaf,
+    o71_kvbtnode_t * * node_pp
+)
+{
+    size_t n = 0;
+    o71_status_t os;
+    *node_pp = NULL;
+    os = redim(world_p->allocator_p, (void * *) node_pp, &n, 1,
+               leaf ? FIELD_OFS(o71_kvbtnode_t, child_a)
+               : sizeof(o71_kvbtnode_t));
+    if (os) return os;
+    (*node_pp)->n = 0;
+    (*node_pp)->leaf = (uint8_t) (leaf != 0);
+    return O71_OK;
+}
+
+/* kvbag_btree_node_free ****************************************************/
+static o71_status_t kvbag_btree_node_free
+(
+    o71_world_t * world_p,
+    o71_kvbtnode_t * node_p
+)
+{
+    size_t n = 1;
+    return redim(world_p->allocator_p, (void * *) &node_p, &n, 0,
+                 node_p->leaf ? FIELD_OFS(o71_kvbtnode_t, child_a)
+                 : sizeof(o71_kvbtnode_t));
+}
+
+/* kvbag_btree_insert *******************************************************/
+static o71_status_t kvbag_btree_insert
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_ref_t key_r,
+    o71_ref_t value_r,
+    o71_kvbag_loc_t * loc_p
+)
+{
+    o71_kvbtnode_t * new_a[O71_BTREE_DEPTH_MAX + 1];
+    o71_kv_t tkv_a[O71_BTREE_KV_MAX + 1];
+    o71_kvbtnode_t * tchild_a[O71_BTREE_KV_MAX + 2];
+    o71_kvbtnode_t * node_p;
+    o71_kvbtnode_t * right_p = NULL;
+    o71_kv_t kv;
+    unsigned int d, i, j, k, split_n, new_n;
+    o71_status_t os;
+
+    A(loc_p->btree.node_a[loc_p->btree.last_x]->leaf);
+    /* count the full nodes that will split; if the root splits too then
+     * a new root is needed */
+    for (d = loc_p->btree.last_x, split_n = 0;
+         loc_p->btree.node_a[d]->n == O71_BTREE_KV_MAX; --d)
+    {
+        ++split_n;
+        if (!d) break;
+    }
+    new_n = split_n;
+    if (split_n == loc_p->btree.last_x + 1)
+    {
+        if (split_n == O71_BTREE_DEPTH_MAX) return O71_ARRAY_LIMIT;
+        ++new_n;
+    }
+    for (k = 0; k < new_n; ++k)
+    {
+        os = kvbag_btree_node_alloc(world_p, k == 0, &new_a[k]);
+        if (os)
+        {
+            M("failed to allocate btree node: %s", N(os));
+            while (k) { --k; kvbag_btree_node_free(world_p, new_a[k]); }
+            return os;
+        }
+    }
+
+    kv.key_r = key_r;
+    kv.value_r = value_r;
+    for (d = loc_p->btree.last_x, k = 0; ; --d)
+    {
+        node_p = loc_p->btree.node_a[d];
+        i = loc_p->btree.index_a[d];
+        if (node_p->n < O71_BTREE_KV_MAX)
+        {
+            for (j = node_p->n; j > i; --j) node_p->kv_a[j] = node_p->kv_a[j - 1];
+            node_p->kv_a[i] = kv;
+            if (!node_p->leaf)
+            {
+                for (j = node_p->n + 1; j > i + 1; --j)
+                    node_p->child_a[j] = node_p->child_a[j - 1];
+                node_p->child_a[i + 1] = right_p;
+            }
+            node_p->n += 1;
+            return O71_OK;
+        }
+        /* full node: the items plus the new one are spread over this node
+         * and a new right sibling; the median moves up into the parent */
+        for (j = 0; j < i; ++j) tkv_a[j] = node_p->kv_a[j];
+        tkv_a[i] = kv;
+        for (j = i; j < O71_BTREE_KV_MAX; ++j) tkv_a[j + 1] = node_p->kv_a[j];
+        if (!node_p->leaf)
+        {
+            for (j = 0; j <= i; ++j) tchild_a[j] = node_p->child_a[j];
+            tchild_a[i + 1] = right_p;
+            for (j = i + 1; j <= O71_BTREE_KV_MAX; ++j)
+                tchild_a[j + 1] = node_p->child_a[j];
+        }
+        right_p = new_a[k++];
+        node_p->n = O71_BTREE_KV_MIN;
+        right_p->n = O71_BTREE_KV_MAX - O71_BTREE_KV_MIN;
+        for (j = 0; j < O71_BTREE_KV_MIN; ++j) node_p->kv_a[j] = tkv_a[j];
+        for (j = 0; j < right_p->n; ++j)
+            right_p->kv_a[j] = tkv_a[O71_BTREE_KV_MIN + 1 + j];
+        if (!node_p->leaf)
+        {
+            for (j = 0; j <= O71_BTREE_KV_MIN; ++j)
+                node_p->child_a[j] = tchild_a[j];
+            for (j = 0; j <= right_p->n; ++j)
+                right_p->child_a[j] = tchild_a[O71_BTREE_KV_MIN + 1 + j];
+        }
+        kv = tkv_a[O71_BTREE_KV_MIN];
+        if (!d)
+        {
+            /* root split: the tree grows one level */
+            A(k + 1 == new_n);
+            node_p = new_a[k];
+            node_p->n = 1;
+            node_p->kv_a[0] = kv;
+            node_p->child_a[0] = loc_p->btree.node_a[0];
+            node_p->child_a[1] = right_p;
+            kvbag_p->btree_p = node_p;
+            return O71_OK;
+        }
+    }
+}
+
+/* kvbag_btree_delete *******************************************************/
+static o71_status_t kvbag_btree_delete
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kvbag_loc_t * loc_p
+)
+{
+    o71_kvbtnode_t * node_p;
+    o71_kvbtnode_t * parent_p;
+    o71_kvbtnode_t * sib_p;
+    o71_kvbtnode_t * left_p;
+    o71_kvbtnode_t * right_p;
+    unsigned int d, i, j, ci;
+    o71_status_t os;
+
+    d = loc_p->btree.last_x;
+    node_p = loc_p->btree.node_a[d];
+    i = loc_p->btree.index_a[d];
+    A(i < node_p->n);
+    if (!node_p->leaf)
+    {
+        /* replace the item with its predecessor: the last item in the
+         * rightmost leaf of the left subtree; then delete that one */
+        o71_kvbtnode_t * inner_p = node_p;
+        for (node_p = node_p->child_a[i]; ; node_p = node_p->child_a[node_p->n])
+        {
+            ++d;
+            A(d < O71_BTREE_DEPTH_MAX);
+            loc_p->btree.node_a[d] = node_p;
+            if (node_p->leaf) break;
+            loc_p->btree.index_a[d] = node_p->n;
+        }
+        inner_p->kv_a[i] = node_p->kv_a[node_p->n - 1];
+        i = node_p->n - 1;
+    }
+    for (j = i + 1; j < node_p->n; ++j) node_p->kv_a[j - 1] = node_p->kv_a[j];
+    node_p->n -= 1;
+
+    /* fix underflow going up: borrow from a sibling or merge with it */
+    for (; d && node_p->n < O71_BTREE_KV_MIN; node_p = parent_p, --d)
+    {
+        parent_p = loc_p->btree.node_a[d - 1];
+        ci = loc_p->btree.index_a[d - 1];
+        if (ci > 0 && (sib_p = parent_p->child_a[ci - 1])->n > O71_BTREE_KV_MIN)
+        {
+            for (j = node_p->n; j > 0; --j) node_p->kv_a[j] = node_p->kv_a[j - 1];
+            node_p->kv_a[0] = parent_p->kv_a[ci - 1];
+            parent_p->kv_a[ci - 1] = sib_p->kv_a[sib_p->n - 1];
+            if (!node_p->leaf)
+            {
+                for (j = node_p->n + 1; j > 0; --j)
+                    node_p->child_a[j] = node_p->child_a[j - 1];
+                node_p->child_a[0] = sib_p->child_a[sib_p->n];
+            }
+            sib_p->n -= 1;
+            node_p->n += 1;
+            break;
+        }
+        if (ci < parent_p->n
+            && (sib_p = parent_p->child_a[ci + 1])->n > O71_BTREE_KV_MIN)
+        {
+            node_p->kv_a[node_p->n] = parent_p->kv_a[ci];
+            parent_p->kv_a[ci] = sib_p->kv_a[0];
+            for (j = 1; j < sib_p->n; ++j) sib_p->kv_a[j - 1] = sib_p->kv_a[j];
+            if (!node_p->leaf)
+            {
+                node_p->child_a[node_p->n + 1] = sib_p->child_a[0];
+                for (j = 1; j <= sib_p->n; ++j)
+                    sib_p->child_a[j - 1] = sib_p->child_a[j];
+            }
+            sib_p->n -= 1;
+            node_p->n += 1;
+            break;
+        }
+        if (ci > 0)
+        {
+            ci -= 1;
+            left_p = parent_p->child_a[ci];
+            right_p = node_p;
+        }
+        else
+        {
+            left_p = node_p;
+            right_p = parent_p->child_a[ci + 1];
+        }
+        /* merge: left + separator + right */
+        left_p->kv_a[left_p->n] = parent_p->kv_a[ci];
+        for (j = 0; j < right_p->n; ++j)
+            left_p->kv_a[left_p->n + 1 + j] = right_p->kv_a[j];
+        if (!left_p->leaf)
+        {
+            for (j = 0; j <= right_p->n; ++j)
+                left_p->child_a[left_p->n + 1 + j] = right_p->child_a[j];
+        }
+        left_p->n += 1 + right_p->n;
+        for (j = ci + 1; j < parent_p->n; ++j)
+        {
+            parent_p->kv_a[j - 1] = parent_p->kv_a[j];
+            parent_p->child_a[j] = parent_p->child_a[j + 1];
+        }
+        parent_p->n -= 1;
+        os = kvbag_btree_node_free(world_p, right_p);
+        AOS(os);
+    }
+
+    node_p = kvbag_p->btree_p;
+    if (!node_p->n && !node_p->leaf)
+    {
+        /* root emptied by a merge: the tree shrinks one level */
+        kvbag_p->btree_p = node_p->child_a[0];
+        os = kvbag_btree_node_free(world_p, node_p);
+        AOS(os);
+    }
+    return O71_OK;
+}
+
+/* kvbag_btree_build ********************************************************/
+static o71_status_t kvbag_btree_build
+(
+    o71_world_t * world_p,
+    o71_kv_t const * kv_a,
+    size_t kv_n,
+    o71_kvbtnode_t * * root_pp
+)
+{
+    size_t span;
+    unsigned int height;
+
+    /* the lowest tree that fits: height h holds up to 16^(h+1) - 1 items */
+    for (height = 0, span = O71_BTREE_KV_MAX + 1; kv_n >= span; ++height)
+        span *= O71_BTREE_KV_MAX + 1;
+    A(height < O71_BTREE_DEPTH_MAX);
+    return kvbag_btree_build_node(world_p, kv_a, kv_n, height, 2, root_pp);
+}
+
+/* kvbag_btree_build_node ***************************************************/
+static o71_status_t kvbag_btree_build_node
+(
+    o71_world_t * world_p,
+    o71_kv_t const * kv_a,
+    size_t kv_n,
+    unsigned int height,
+    size_t child_min,
+    o71_kvbtnode_t * * node_pp
+)
+{
+    o71_kvbtnode_t * node_p;
+    o71_status_t os, osf;
+    size_t span, c, q, r, i, cn;
+
+    os = kvbag_btree_node_alloc(world_p, height == 0, &node_p);
+    if (os) return os;
+    if (!height)
+    {
+        A(kv_n <= O71_BTREE_KV_MAX);
+        for (i = 0; i < kv_n; ++i) node_p->kv_a[i] = kv_a[i];
+        node_p->n = (uint8_t) kv_n;
+        *node_pp = node_p;
+        return O71_OK;
+    }
+    /* a full child subtree holds span - 1 items */
+    for (span = 1, i = 0; i < height; ++i) span *= O71_BTREE_KV_MAX + 1;
+    c = (kv_n + span) / span;
+    if (c < child_min) c = child_min;
+    A(c <= O71_BTREE_KV_MAX + 1);
+    /* child i gets q - 1 or q items and is followed by a separator item */
+    q = (kv_n + 1) / c;
+    r = (kv_n + 1) % c;
+    for (i = 0; i < c; ++i)
+    {
+        cn = q - 1 + (i < r);
+        os = kvbag_btree_build_node(world_p, kv_a, cn, height - 1,
+                                    O71_BTREE_KV_MIN + 1, &node_p->child_a[i]);
+        if (os)
+        {
+            if (i)
+            {
+                /* free the children built so far */
+                node_p->n = (uint8_t) (i - 1);
+                osf = kvbag_btree_free(world_p, node_p, kv_nop_free);
+            }
+            else osf = kvbag_btree_node_free(world_p, node_p);
+            AOS(osf);
+            return os;
+        }
+        kv_a += cn;
+        if (i + 1 < c) node_p->kv_a[i] = *kv_a++;
+    }
+    node_p->n = (uint8_t) (c - 1);
+    *node_pp = node_p;
+    return O71_OK;
+}
+
+/* kvbag_btree_free *********************************************************/
+static o71_status_t kvbag_btree_free
+(
+    o71_world_t * world_p,
+    o71_kvbtnode_t * node_p,
+    o71_kv_free_f kv_free
+)
+{
+    unsigned int i;
+    o71_status_t os;
+    A(node_p);
+    for (i = 0; i < node_p->n; ++i)
+    {
+        os = kv_free(world_p, &node_p->kv_a[i]);
+        AOS(os);
+    }
+    if (!node_p->leaf)
+    {
+        for (i = 0; i <= node_p->n; ++i)
+        {
+            os = kvbag_btree_free(world_p, node_p->child_a[i], kv_free);
+            if (os) return os;
+        }
+    }
+    return kvbag_btree_node_free(world_p, node_p);
+}
+
+/* kvbag_btree_visit_values *************************************************/
+static o71_status_t kvbag_btree_visit_values
+(
+    o71_world_t * world_p,
+    o71_kvbtnode_t * node_p,
+    o71_ref_visit_f visit,
+    void * ctx
+)
+{
+    unsigned int i;
+    o71_status_t os;
+    A(node_p);
+    for (i = 0; i < node_p->n; ++i)
+    {
+        os = visit(world_p, &node_p->kv_a[i].value_r, ctx);
+        if (os) return os;
+    }
+    if (!node_p->leaf)
+    {
+        for (i = 0; i <= node_p->n; ++i)
+        {
+            os = kvbag_btree_visit_values(world_p, node_p->child_a[i],
+                                          visit, ctx);
+            if (os) return os;
+        }
+    }
+    return O71_OK;
+}
+
+#if O71_DEBUG
+/* kvbag_btree_dump *********************************************************/
+static void kvbag_btree_dump
+(
+    o71_world_t * world_p,
+    o71_kvbtnode_t * node_p,
+    unsigned int depth
+)
+{
+    unsigned int i;
+    for (i = 0; i <= node_p->n; ++i)
+    {
+        if (!node_p->leaf)
+            kvbag_btree_dump(world_p, node_p->child_a[i], depth + 1);
+        if (i == node_p->n) break;
+        printf("%.*sk=", depth * 2,
+               "                                                                ");
+        obj_dump(world_p, node_p->kv_a[i].key_r);
+        printf(" -> v=");
+        obj_dump(world_p, node_p->kv_a[i].value_r);
+        printf("\n");
+    }
+}
+#endif
+
+/* kvbag_hash_alloc *********************************************************/
+static o71_status_t kvbag_hash_alloc
+(
+    o71_world_t * world_p,
+    size_t slot_n,
+    o71_kvhash_t * * hash_pp
+)
+{
+    o71_kvhash_t * hash_p = NULL;
+    size_t n = 0, x;
+    o71_status_t os;
+
+    A(slot_n && !(slot_n & (slot_n - 1)));
+    os = redim(world_p->allocator_p, (void * *) &hash_p, &n, 1,
+               sizeof(o71_kvhash_t) + slot_n * sizeof(o71_kv_t));
+    if (os) return os;
+    hash_p->n = 0;
+    hash_p->mask = slot_n - 1;
+    for (x = 0; x < slot_n; ++x) hash_p->kv_a[x].key_r = O71_KVHASH_FREE_KEY;
+    *hash_pp = hash_p;
+    return O71_OK;
+}
+
+/* kvbag_hash_table_free ****************************************************/
+static o71_status_t kvbag_hash_table_free
+(
+    o71_world_t * world_p,
+    o71_kvhash_t * hash_p
+)
+{
+    size_t n = 1;
+    return redim(world_p->allocator_p, (void * *) &hash_p, &n, 0,
+                 sizeof(o71_kvhash_t) + (hash_p->mask + 1) * sizeof(o71_kv_t));
+}
+
+/* kvbag_hash_probe *********************************************************/
+static o71_status_t kvbag_hash_probe
+(
+    o71_kvhash_t * hash_p,
+    o71_ref_t key_r,
+    size_t * index_p
+)
+{
+    size_t mask = hash_p->mask;
+    size_t x, d, e;
+    o71_ref_t k;
+
+    for (x = KVHASH_HOME(key_r, mask), d = 0; ; x = (x + 1) & mask, ++d)
+    {
+        k = hash_p->kv_a[x].key_r;
+        if (k == key_r)
+        {
+            *index_p = x;
+            return O71_OK;
+        }
+        /* stop at a free slot, at an item that has its home after ours or
+         * at one with the same home and a greater key */
+        if (k == O71_KVHASH_FREE_KEY
+            || (e = (x - KVHASH_HOME(k, mask)) & mask) < d
+            || (e == d && k > key_r))
+        {
+            *index_p = x;
+            return O71_MISSING;
+        }
+    }
+}
+
+/* kvbag_hash_place *********************************************************/
+static void kvbag_hash_place
+(
+    o71_kvhash_t * hash_p,
+    size_t index,
+    o71_ref_t key_r,
+    o71_ref_t value_r
+)
+{
+    o71_kv_t kv, t;
+
+    kv.key_r = key_r;
+    kv.value_r = value_r;
+    for (;; index = (index + 1) & hash_p->mask)
+    {
+        t = hash_p->kv_a[index];
+        hash_p->kv_a[index] = kv;
+        if (t.key_r == O71_KVHASH_FREE_KEY) break;
+        kv = t;
+    }
+    hash_p->n += 1;
+}
+
+/* kvbag_hash_build *********************************************************/
+static o71_status_t kvbag_hash_build
+(
+    o71_world_t * world_p,
+    o71_kv_t const * kv_a,
+    size_t kv_n,
+    size_t slot_n,
+    o71_kvhash_t * * hash_pp
+)
+{
+    o71_kvhash_t * hash_p;
+    o71_status_t os;
+    size_t i, x;
+
+    os = kvbag_hash_alloc(world_p, slot_n, &hash_p);
+    if (os) return os;
+    for (i = 0; i < kv_n; ++i)
+    {
+        // kv_a can be the slot array of an old table
+        if (kv_a[i].key_r == O71_KVHASH_FREE_KEY) continue;
+        os = kvbag_hash_probe(hash_p, kv_a[i].key_r, &x);
+        A(os == O71_MISSING);
+        A(KVHASH_FITS(hash_p->n + 1, slot_n));
+        kvbag_hash_place(hash_p, x, kv_a[i].key_r, kv_a[i].value_r);
+    }
+    *hash_pp = hash_p;
+    return O71_OK;
+}
+
+/* kvbag_hash_insert ********************************************************/
+static o71_status_t kvbag_hash_insert
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_ref_t key_r,
+    o71_ref_t value_r,
+    o71_kvbag_loc_t * loc_p
+)
+{
+    o71_kvhash_t * hash_p = kvbag_p->hash_p;
+    o71_kvhash_t * new_p;
+    o71_status_t os;
+
+    if (!KVHASH_FITS(hash_p->n + 1, hash_p->mask + 1))
+    {
+        M2("grow hash bag %p to %lu slots", kvbag_p,
+           (unsigned long) (hash_p->mask + 1) * 2);
+        os = kvbag_hash_build(world_p, hash_p->kv_a, hash_p->mask + 1,
+                              (hash_p->mask + 1) * 2, &new_p);
+        if (os) return os;
+        os = kvbag_hash_table_free(world_p, hash_p);
+        AOS(os);
+        kvbag_p->hash_p = hash_p = new_p;
+        os = kvbag_hash_probe(hash_p, key_r, &loc_p->hash.index);
+        A(os == O71_MISSING);
+    }
+    kvbag_hash_place(hash_p, loc_p->hash.index, key_r, value_r);
+    return O71_OK;
+}
+
+/* kvbag_hash_delete ********************************************************/
+static o71_status_t kvbag_hash_delete
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kvbag_loc_t * loc_p
+)
+{
+    o71_kvhash_t * hash_p = kvbag_p->hash_p;
+    size_t mask = hash_p->mask;
+    size_t x, y;
+    o71_ref_t k;
+
+    x = loc_p->hash.index;
+    A(hash_p->kv_a[x].key_r != O71_KVHASH_FREE_KEY);
+    /* pull back the items after it until a free slot or an item that is
+     * in its home slot */
+    for (;; x = y)
+    {
+        y = (x + 1) & mask;
+        k = hash_p->kv_a[y].key_r;
+        if (k == O71_KVHASH_FREE_KEY || KVHASH_HOME(k, mask) == y) break;
+        hash_p->kv_a[x] = hash_p->kv_a[y];
+    }
+    hash_p->kv_a[x].key_r = O71_KVHASH_FREE_KEY;
+    hash_p->n -= 1;
+    return O71_OK;
+}
+
+/* kvbag_hash_free **********************************************************/
+static o71_status_t kvbag_hash_free
+(
+    o71_world_t * world_p,
+    o71_kvhash_t * hash_p,
+    o71_kv_free_f kv_free
+)
+{
+    size_t x;
+    o71_status_t os;
+    A(hash_p);
+    for (x = 0; x <= hash_p->mask; ++x)
+    {
+        if (hash_p->kv_a[x].key_r == O71_KVHASH_FREE_KEY) continue;
+        os = kv_free(world_p, &hash_p->kv_a[x]);
+        AOS(os);
+    }
+    return kvbag_hash_table_free(world_p, hash_p);
+}
+
+#if O71_DEBUG
+/* kvbag_hash_dump **********************************************************/
+static void kvbag_hash_dump
+(
+    o71_world_t * world_p,
+    o71_kvhash_t * hash_p
+)
+{
+    size_t x;
+    printf("[hash n=%lu slots=%lu]\n",
+           (unsigned long) hash_p->n, (unsigned long) hash_p->mask + 1);
+    for (x = 0; x <= hash_p->mask; ++x)
+    {
+        if (hash_p->kv_a[x].key_r == O71_KVHASH_FREE_KEY) continue;
+        printf("  #%lu k=", (unsigned long) x);
+        obj_dump(world_p, hash_p->kv_a[x].key_r);
+        printf(" -> v=");
+        obj_dump(world_p, hash_p->kv_a[x].value_r);
+        printf("\n");
+    }
+}
+#endif
+
+#if O71_DEBUG
+static void obj_dump
+(
+    o71_world_t * world_p,
+    o71_ref_t obj_r
+)
+{
+    o71_obj_index_t obj_x;
+    unsigned int om;
+    if (O71_IS_REF_TO_SINT(obj_r))
+    {
+        printf("%ld", (long) O71_REF_TO_SINT(obj_r));
+        return;
+    }
+    obj_x = O71_REF_TO_MOX(obj_r);
+    if (obj_x >= world_p->obj_n
+        || IS_FREE_OBJECT_SLOT(O71_OBJ_SLOT(world_p, obj_x)))
+    {
+        printf("BAD_REF_%lX", (long) obj_r);
+        return;
+    }
+    om = o71_model(world_p, obj_r);
+    if ((om & O71M_STRING))
+    {
+        o71_string_t * str_p = O71_OBJ_SLOT(world_p, obj_x);
+        printf("%sstr_%lX(\"%.*s\")",
+               str_p->mode == O71_SM_MODIFIABLE ? "" :
+               (str_p->mode == O71_SM_READ_ONLY ? "ro" : "i"),
+               (long) obj_r, (int) str_p->n, str_p->a);
+        return;
+    }
+    printf("obj_%lX", obj_r);
+}
+
+#endif
+
+/* class_super_extend *******************************************************/
+static o71_status_t class_super_extend
+(
+    o71_world_t * world_p,
+    o71_class_t * class_p,
+    o71_ref_t * super_ra,
+    size_t super_n
+)
+{
+    o71_status_t os;
+    size_t i, j;
+    ptrdiff_t x;
+
+#if O71_DEBUG
+    {
+        ptrdiff_t i;
+        printf("class_super_extend: class_p=%p, existing super_ra=[", class_p);
+        if (class_p->super_n)
+        {
+            for (i = 0; i < (ptrdiff_t) class_p->super_n - 1; ++i)
+                printf("o%lX, ", class_p->super_ra[i]);
+            printf("o%lX", class_p->super_ra[i]);
+        }
+        printf("], new_super_ra=[");
+        if (super_n)
+        {
+            for (i = 0; i < (ptrdiff_t) super_n - 1; ++i)
+                printf("o%lX, ", super_ra[i]);
+            printf("o%lX", super_ra[i]);
+        }
+
+        printf("] => ");
+    }
+#endif
+    /* get rid of superclasses already in the list */
+    for (i = 0; i < super_n; )
+    {
+        x = ref_search(class_p->super_ra, class_p->super_n, super_ra[i]);
+        if (x >= 0)
+        {
+            super_ra[i] = super_ra[--super_n];
+            continue;
+        }
+        ++i;
+    }
+
+    /* sort the ones to introduce */
+    ref_qsort(super_ra, super_n);
+
+    for (i = 1; i < super_n && super_ra[i - 1] < super_ra[i]; ++i);
+    if (i < super_n)
+    {
+        for (j = i - 1; i < super_n; ++i)
+            if (super_ra[j] < super_ra[i]) super_ra[++j] = super_ra[i];
+        super_n = j;
+#if _DEBUG
+        {
+            ptrdiff_t i;
+            printf("new_super_ra after sort & uniq =[");
+            if (super_n)
+            {
+                for (i = 0; i < (ptrdiff_t) super_n - 1; ++i)
+                    printf("o%lX, ", super_ra[i]);
+                printf("o%lX", super_ra[i]);
+            }
+
+            printf("] => ");
+        }
+#endif
+    }
+
+    os = merge_sorted_refs(world_p, &class_p->super_ra, &class_p->super_n,
+                           super_ra, super_n);
+#if O71_DEBUG
+    {
+        ptrdiff_t i;
+        printf("status: %s, output super_ra=[", N(os));
+        if (class_p->super_n)
+        {
+            for (i = 0; i < (ptrdiff_t) class_p->super_n - 1; ++i)
+                printf("o%lX, ", class_p->super_ra[i]);
+            printf("o%lX", class_p->super_ra[i]);
+        }
+        printf("].\n");
+    }
+#endif
+    return os;
+}
+
+/* merge_sorted_refs ********************************************************/
+static o71_status_t merge_sorted_refs
+(
+    o71_world_t * world_p,
+    o71_ref_t * * dest_rap,
+    size_t * dest_rnp,
+    o71_ref_t * src_ra,
+    size_t src_n
+)
+{
+    o71_status_t os;
+    ptrdiff_t i, j, k;
+    o71_ref_t * dest_ra;
+
+    A(dest_rnp + src_n >= dest_rnp);
+    i = (ptrdiff_t) *dest_rnp - 1;
+    k = (ptrdiff_t) (*dest_rnp + src_n);
+    os = redim(world_p->allocator_p, (void * *) dest_rap, dest_rnp, (size_t) k,
+               sizeof(o71_ref_t));
+    if (os) return os;
+    dest_ra = *dest_rap;
+    j = (ptrdiff_t) src_n - 1;
+    --k;
+    while (i >= 0 && i < k)
+    {
+        dest_ra[k--] = (dest_ra[i] > src_ra[j]) ? dest_ra[i--] : src_ra[j--];
+    }
+    while (i < k) dest_ra[k--] = src_ra[j--];
+    return O71_OK;
+}
+
+
+/* ref_search ***************************************************************/
+static ptrdiff_t ref_search
+(
+    o71_ref_t * ra,
+    size_t rn,
+    o71_ref_t kr
+)
+{
+    ptrdiff_t a, b, c;
+    for (a = 0, b = (ptrdiff_t) rn - 1; a <= b; )
+    {
+        c = (a + b) >> 1;
+        if (kr == ra[c]) return c;
+        if (kr < ra[c]) b = c - 1;
+        else a = c + 1;
+    }
+    return ~a;
+}
+
+/* ref_qsort ****************************************************************/
+static void ref_qsort
+(
+    o71_ref_t * ref_a,
+    size_t ref_n
+)
+{
+    size_t i, j;
+    int ii, jj;
+    o71_ref_t r;
+
+    for (; ref_n > 1;)
+    {
+        i = 0;
+        j = ref_n - 1;
+        ii = 1; jj = 0;
+        while (i < j)
+        {
+            if (ref_a[i] > ref_a[j])
+            {
+                r = ref_a[i];
+                ref_a[i] = ref_a[j];
+                ref_a[j] = r;
+                ii ^= 1;
+                jj ^= -1;
+            }
+            i += ii;
+            j += jj;
+        }
+        /* launch the short side recursively so that depth is logarithmic */
+        if (i < ref_n - i - 1)
+        {
+            ref_qsort(ref_a, i);
+            ref_a += i + 1;
+            ref_n -= i + 1;
+        }
+        else
+        {
+            ref_qsort(ref_a + i + 1, ref_n - (i + 1));
+            ref_n = i;
+        }
+    }
+}
+
+/* refkv_qsort **************************************************************/
+static void refkv_qsort
+(
+    o71_kv_t * kv_a,
+    size_t n
+)
+{
+    size_t i, j;
+    int ii, jj;
+    o71_kv_t r;
+
+    for (; n > 1;)
+    {
+        i = 0;
+        j = n - 1;
+        ii = 1; jj = 0;
+        while (i < j)
+        {
+            if (kv_a[i].key_r > kv_a[j].key_r)
+            {
+                r = kv_a[i];
+                kv_a[i] = kv_a[j];
+                kv_a[j] = r;
+                ii ^= 1;
+                jj ^= -1;
+            }
+            i += ii;
+            j += jj;
+        }
+        /* launch the short side recursively so that depth is logarithmic */
+        if (i < n - i - 1)
+        {
+            refkv_qsort(kv_a, i);
+            kv_a += i + 1;
+            n -= i + 1;
+        }
+        else
+        {
+            refkv_qsort(kv_a + i + 1, n - (i + 1));
+            n = i;
+        }
+    }
+}
+
+/* get_reg_obj_field ********************************************************/
+static o71_status_t get_reg_obj_field
+(
+    o71_flow_t * flow_p,
+    o71_ref_t obj_r,
+    o71_ref_t field_r,
+    o71_ref_t * value_rp
+)
+{
+    o71_status_t os;
+    A(o71_model(flow_p->world_p, obj_r) != O71M_INVALID);
+    A(o71_model(flow_p->world_p, field_r) != O71M_INVALID);
+    os = o71_istr_check(flow_p->world_p, field_r);
+    if (os)
+    {
+        M("bad field name obref_%lX: %s", (long) field_r, N(os));
+        return os;
+    }
+    return o71_reg_obj_get_field(flow_p->world_p, obj_r, field_r, value_rp);
+}
+
+
+/* set_reg_obj_field ********************************************************/
+static o71_status_t set_reg_obj_field
+(
+    o71_flow_t * flow_p,
+    o71_ref_t obj_r,
+    o71_ref_t field_r,
+    o71_ref_t value_r
+)
+{
+    o71_status_t os;
+    A(o71_model(flow_p->world_p, obj_r) != O71M_INVALID);
+    A(o71_model(flow_p->world_p, field_r) != O71M_INVALID);
+    A(o71_model(flow_p->world_p, value_r) != O71M_INVALID);
+    os = o71_istr_check(flow_p->world_p, field_r);
+    if (os)
+    {
+        M("bad field name obref_%lX: %s", (long) field_r, N(os));
+        return os;
+    }
+    return o71_reg_obj_set_field(flow_p->world_p, obj_r, field_r, value_r);
+}
+
+/* release_ref_visit ********************************************************/
+static o71_status_t release_ref_visit
+(
+    o71_world_t * world_p,
+    o71_ref_t * ref_p,
+    void * ctx
+)
+{
+    o71_ref_t r;
+    r = *ref_p;
+    *ref_p = O71R_NULL;
+    return o71_deref(world_p, r);
+}
+
+/* noop_visit_refs **********************************************************/
+static o71_status_t noop_visit_refs
+(
+    o71_world_t * world_p,
+    o71_ref_t obj_r,
+    o71_ref_visit_f visit,
+    void * ctx
+)
+{
+    return O71_OK;
+}
+
+/* reg_obj_visit_refs *******************************************************/
+static o71_status_t reg_obj_visit_refs
+(
+    o71_world_t * world_p,
+    o71_ref_t obj_r,
+    o71_ref_visit_f visit,
+    void * ctx
+)
+{
+    o71_mem_obj_t * obj_p;
+    o71_class_t * class_p;
+    o71_status_t os;
+    size_t i;
+
+    obj_p = MEM_OBJ_PTR(world_p, O71_REF_TO_MOX(obj_r));
+    class_p = O71_OBJ_SLOT(world_p, O71_REF_TO_MOX(obj_p->class_r));
+    for (i = 0; i < class_p->fix_field_n; ++i)
+    {
+        os = visit(world_p, (o71_ref_t *) ((uint8_t *) obj_p
+                   + class_p->fix_field_ofs_a[i].value_r), ctx);
+        if (os) return os;
+    }
+    if (!class_p->dyn_field_ofs) return O71_OK;
+    return kvbag_visit_values(world_p, (o71_kvbag_t *)
+                              ((uint8_t *) obj_p + class_p->dyn_field_ofs),
+                              visit, ctx);
+}
+
+/* reg_obj_finish ***********************************************************/
+static o71_status_t reg_obj_finish
+(
+    o71_world_t * world_p,
+    o71_ref_t obj_r
+)
+{
+    o71_mem_obj_t * obj_p;
+    o71_class_t * class_p;
+    o71_status_t os;
+
+    os = reg_obj_visit_refs(world_p, obj_r, release_ref_visit, NULL);
+    if (os) return os;
+    obj_p = MEM_OBJ_PTR(world_p, O71_REF_TO_MOX(obj_r));
+    class_p = O71_OBJ_SLOT(world_p, O71_REF_TO_MOX(obj_p->class_r));
+    if (!class_p->dyn_field_ofs) return O71_OK;
+    return kvbag_free(world_p, (o71_kvbag_t *)
+                      ((uint8_t *) obj_p + class_p->dyn_field_ofs),
+                      kv_free_key_deref);
+}
+
+/* exc_visit_refs ***********************************************************/
+static o71_status_t exc_visit_refs
+(
+    o71_world_t * world_p,
+    o71_ref_t obj_r,
+    o71_ref_visit_f visit,
+    void * ctx
+)
+{
+    o71_exception_t * exc_p;
+    o71_status_t os;
+
+    exc_p = O71_OBJ_SLOT(world_p, O71_REF_TO_MOX(obj_r));
+    os = visit(world_p, &exc_p->exe_ctx_r, ctx);
+    if (os) return os;
+    return kvbag_visit_values(world_p, &exc_p->dyn_field_bag, visit, ctx);
+}
+
+/* exc_finish ***************************************************************/
+static o71_status_t exc_finish
+(
+    o71_world_t * world_p,
+    o71_ref_t obj_r
+)
+{
+    o71_exception_t * exc_p;
+    o71_status_t os;
+
+    os = exc_visit_refs(world_p, obj_r, release_ref_visit, NULL);
+    if (os) return os;
+    exc_p = O71_OBJ_SLOT(world_p, O71_REF_TO_MOX(obj_r));
+    return kvbag_free(world_p, &exc_p->dyn_field_bag, kv_free_key_deref);
+}
+
+/* sec_visit_refs ***********************************************************/
+static o71_status_t sec_visit_refs
+(
+    o71_world_t * world_p,
+    o71_ref_t obj_r,
+    o71_ref_visit_f visit,
+    void * ctx
+)
+{
+    o71_script_exe_ctx_t * sec_p;
+    o71_script_function_t * sfunc_p;
+    o71_status_t os;
+    size_t i;
+
+    sec_p = O71_OBJ_SLOT(world_p, O71_REF_TO_MOX(obj_r));
+    sfunc_p = O71_OBJ_SLOT(world_p,
+                           O71_REF_TO_MOX(sec_p->exe_ctx.hdr.class_r));
+    for (i = 0; i < sfunc_p->var_n; ++i)
+    {
+        os = visit(world_p, &sec_p->var_ra[i], ctx);
+        if (os) return os;
+    }
+    return O71_OK;
+}
+
+/* sec_finish ***************************************************************/
+static o71_status_t sec_finish
+(
+    o71_world_t * world_p,
+    o71_ref_t obj_r
+)
+{
+    return sec_visit_refs(world_p, obj_r, release_ref_visit, NULL);
+}
+
+/* rule_nop *****************************************************************/
+static o71_status_t rule_nop (o71_code_t * code_p)
+{
+    (void) code_p;
+    return 0;
+}
+
+/* tokenize_source **********************************************************/
+static o71_status_t tokenize_source
+(
+    o71_code_t * code_p
+)
+{
+    size_t ofs, chlen;
+    uint32_t row, col, ch, nch;
+    int ce, digit;
+    o71_status_t os;
+    unsigned int base;
+    size_t str_n, i;
+    uint8_t const * src_a;
+    size_t src_n, src_ofs;
+    o71_token_t * token_p;
+    unsigned int type;
+
+    src_a = code_p->src_a;
+    src_n = code_p->src_n;
+#define CE(_e) { ce = _e; break; }
+    ce = O71_CE_NONE;
+    /* single pass: UTF-8 is validated where it can show up (comments and
+     * strings) while tokenizing */
+    for (ofs = 0, row = 1, col = 1; ofs < src_n; )
+    {
+        ch = src_a[ofs];
+        if (ch <= 0x20)
+        {
+            if (ch == ' ')
+            {
+                for (++ofs, ++col; ofs < src_n && src_a[ofs] == ' ';
+                     ++ofs, ++col);
+                continue;
+            }
+            if (!(CHAR_CLASS(ch) & CC_EOL))
+                CE(O71_CE_PARSE_BAD_CONTROL_CHAR);
+            if (ch == '\r')
+            {
+                if (ofs + 1 < src_n && src_a[ofs + 1] == '\n') ++ofs;
+            }
+            ++ofs;
+            ++row;
+            col = 1;
+            continue;
+        }
+        /* non-whitespace character */
+        if (ch == '#')
+        {
+            /* skip until EOL */
+            ++ofs;
+            ofs += utf8_span(src_a + ofs, src_n - ofs, &ce);
+            if (ce) break;
+            /* don't bother to update the column here as we either reached
+             * end of line or end of file */
+            continue;
+        }
+
+        src_ofs = ofs;
+        if (IS_ID_START_CHAR(ch))
+        {
+            o71_id_token_t * id_token_p;
+            for (++ofs; ofs < src_n && IS_ID_BODY_CHAR(src_a[ofs]); ++ofs);
+            ARENA_ALLOC(os, &code_p->arena, id_token_p);
+            if (os) return os;
+            token_p = &id_token_p->base;
+            token_p->type = token_p->base_type = O71_TT_IDENTIFIER;
+            id_token_p->a = src_a + src_ofs;
+            id_token_p->n = ofs - src_ofs;
+        }
+        else if (IS_DIGIT(ch))
+        {
+            o71_int_token_t * int_token_p;
+            uint64_t num;
+            base = 10;
+            if (ch == '0' && ofs + 1 < src_n)
+            {
+                ch = src_a[++ofs];
+                switch (ch)
+                {
+                case 'b': ++ofs; base = 2; break;
+                case 'o': ++ofs; base = 8; break;
+                case 'd': ++ofs; base = 10; break;
+                case 'x': ++ofs; base = 16; break;
+                }
+            }
+            num = 0;
+            for (; ofs < src_n && IS_ID_BODY_CHAR(src_a[ofs]); ++ofs)
+            {
+                if (src_a[ofs] == '_') continue;
+                digit = ALPHANUM_TO_DIGIT(src_a[ofs]);
+                if (digit >= (int) base) CE(O71_CE_PARSE_BAD_NUMBER);
+                num = num * base + digit;
+            }
+            if (ce) break;
+            ARENA_ALLOC(os, &code_p->arena, int_token_p);
+            if (os) return os;
+            token_p = &int_token_p->base;
+            token_p->type = token_p->base_type = O71_TT_INTEGER;
+            int_token_p->val = num;
+        }
+        else if (ch == '"')
+        {
+            o71_str_token_t * str_token_p;
+            //M("ofs=%zX", ofs);
+            ++ofs;
+            for (str_n = 0; ofs < src_n && src_a[ofs] != '"'
+                 && !(CHAR_CLASS(src_a[ofs]) & CC_EOL); )
+            {
+                //M("ofs=%zX", ofs);
+                if (src_a[ofs] >= 0x80)
+                {
+                    chlen = utf8_char_check(src_a + ofs, src_n - ofs, &ce);
+                    if (!chlen) break;
+                    ofs += chlen;
+                    str_n += chlen;
+                    continue;
+                }
+                if (src_a[ofs] < 0x20) CE(O71_CE_PARSE_BAD_CONTROL_CHAR);
+                if (src_a[ofs++] != '\\') ++str_n;
+                else
+                {
+                    if (ofs == src_n) CE(O71_CE_PARSE_UNFINISHED_STRING);
+                    switch (ch = src_a[ofs++])
+                    {
+                    case '0':
+                    case 'n':
+                    case 'r':
+                    case 'v':
+                    case 'e':
+                    case 't':
+                    case 'a':
+                    case 'b':
+                    case '\\':
+                    case '\'':
+                    case '"':
+                        ++str_n;
+                        continue;
+                    case 'x': // \xAB
+                        if (ofs + 2 > src_n ||
+                            !IS_HEX_DIGIT(src_a[ofs]) ||
+                            !IS_HEX_DIGIT(src_a[ofs + 1]))
+                            break;
+                        ofs += 2;
+                        ++str_n;
+                        continue;
+                    case 'c': // \c12
+                        if (ofs + 2 > src_n ||
+                            !IS_HEX_DIGIT(src_a[ofs]) ||
+                            !IS_HEX_DIGIT(src_a[ofs + 1]))
+                            break;
+                        ch = (ALPHANUM_TO_DIGIT(src_a[ofs]) << 4)
+                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 1]));
+                        ofs += 2;
+                        str_n += utf8_codepoint_length(ch);
+                        continue;
+                    case 'u': // \u1234
+                        if (ofs + 4 > src_n ||
+                            !IS_HEX_DIGIT(src_a[ofs]) ||
+                            !IS_HEX_DIGIT(src_a[ofs + 1]) ||
+                            !IS_HEX_DIGIT(src_a[ofs + 2]) ||
+                            !IS_HEX_DIGIT(src_a[ofs + 3]))
+                            break;
+                        ch = (ALPHANUM_TO_DIGIT(src_a[ofs]) << 12)
+                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 1]) << 8)
+                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 2]) << 4)
+                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 3]));
+                        ofs += 4;
+                        str_n += utf8_codepoint_length(ch);
+                        continue;
+                    case 'U': // \U123456
+                        if (ofs + 6 > src_n ||
+                            !IS_HEX_DIGIT(src_a[ofs]) ||
+                            !IS_HEX_DIGIT(src_a[ofs + 1]) ||
+                            !IS_HEX_DIGIT(src_a[ofs + 2]) ||
+                            !IS_HEX_DIGIT(src_a[ofs + 3]) ||
+                            !IS_HEX_DIGIT(src_a[ofs + 4]) ||
+                            !IS_HEX_DIGIT(src_a[ofs + 5]))
+                            break;
+                        ch = (ALPHANUM_TO_DIGIT(src_a[ofs]) << 20)
+                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 1]) << 16)
+                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 2]) << 12)
+                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 3]) << 8)
+                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 4]) << 4)
+                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 5]));
+                        if (ch >= 0x110000) break;
+                        str_n += utf8_codepoint_length(ch);
+                        ofs += 6;
+                        continue;
+                    }
+                    CE(O71_CE_PARSE_BAD_STRING_ESCAPE);
+                }
+            }
+            //M("str_n=%zu", str_n);
+            if (ce) break;
+            if (ofs == src_n || src_a[ofs] != '"')
+                CE(O71_CE_PARSE_UNFINISHED_STRING);
+            A(src_a[ofs] == '"');
+            ARENA_ALLOC(os, &code_p->arena, str_token_p);
+            if (os) return os;
+            token_p = &str_token_p->base;
+            token_p->type = token_p->base_type = O71_TT_STRING;
+            str_token_p->n = str_n + 1;
+            os = arena_alloc(&code_p->arena, (void * *) &str_token_p->a,
+                             str_n + 1);
+            if (os)
+            {
+                return os;
+            }
+            for (i = 0, ofs = src_ofs + 1; src_a[ofs] != '"'; )
+            {
+                //M("ofs=%zX ch: %c", ofs, src_a[ofs]);
+                A(i < str_n);
+                if (src_a[ofs] != '\\') str_token_p->a[i++] = src_a[ofs++];
+                else
+                {
+                    ++ofs;
+                    switch (ch = src_a[ofs++])
+                    {
+                    case '0': str_token_p->a[i++] = 0; break;
+                    case 'n': str_token_p->a[i++] = '\n'; break;
+                    case 'r': str_token_p->a[i++] = '\r'; break;
+                    case 'v': str_token_p->a[i++] = '\v'; break;
+                    case 'e': str_token_p->a[i++] = '\x1B'; break;
+                    case 't': str_token_p->a[i++] = '\t'; break;
+                    case 'a': str_token_p->a[i++] = '\a'; break;
+                    case 'b': str_token_p->a[i++] = '\b'; break;
+                    case '\\': str_token_p->a[i++] = '\\'; break;
+                    case '\'': str_token_p->a[i++] = '\''; break;
+                    case '"': str_token_p->a[i++] = '\"'; break;
+                    case 'x': // \xAB
+                        str_token_p->a[i++]
+                            = (ALPHANUM_TO_DIGIT(src_a[ofs]) << 4)
+                            | ALPHANUM_TO_DIGIT(src_a[ofs + 1]);
+                        ofs += 2;
+                        break;
+                    case 'c': // \cAB
+                        ch = (ALPHANUM_TO_DIGIT(src_a[ofs]) << 4)
+                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 1]));
+                        ofs += 2;
+                        i += utf8_codepoint_encode(str_token_p->a + i, ch);
+                        break;
+                    case 'u': // \u1234
+                        ch = (ALPHANUM_TO_DIGIT(src_a[ofs]) << 12)
+                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 1]) << 8)
+                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 2]) << 4)
+                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 3]));
+                        ofs += 4;
+                        i += utf8_codepoint_encode(str_token_p->a + i, ch);
+                        break;
+                    case 'U': // \U123456
+                        ch = (ALPHANUM_TO_DIGIT(src_a[ofs]) << 20)
+                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 1]) << 16)
+                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 2]) << 12)
+                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 3]) << 8)
+                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 4]) << 4)
+                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 5]));
+                        ofs += 6;
+                        i += utf8_codepoint_encode(str_token_p->a + i, ch);
+                        break;
+                    }
+                }
+            }
+            str_token_p->a[str_n] = 0;
+            M("i=%zu, str_n=%zu", i, str_n);
+            A(i == str_n);
+            A(src_a[ofs] == '"');
+            ++ofs;
+            //A(ofs == src_ofs + src_len);
+        }
+        else
+        {
+            ++ofs;
+            nch = ofs < src_n ? src_a[ofs] : 0;
+            switch (ch)
+            {
+            case '~': type = O71_TT_TILDE; break;
+            case '?': type = O71_TT_QUESTION; break;
+            case '(': type = O71_TT_PAREN_OPEN; break;
+            case ')': type = O71_TT_PAREN_CLOSE; break;
+            case '[': type = O71_TT_SQUARE_BRACKET_OPEN; break;
+            case ']': type = O71_TT_SQUARE_BRACKET_CLOSE; break;
+            case '{': type = O71_TT_CURLY_BRACKET_OPEN; break;
+            case '}': type = O71_TT_CURLY_BRACKET_CLOSE; break;
+            case '.': type = O71_TT_DOT; break;
+            case ',': type = O71_TT_COMMA; break;
+            case ';': type = O71_TT_SEMICOLON; break;
+            case ':': type = O71_TT_COLON; break;
+            case '!':
+                if (nch == '=') { ++ofs; type = O71_TT_EXCLAMATION_EQUAL; }
+                else type = O71_TT_EXCLAMATION;
+                break;
+            case '%':
+                if (nch == '=') { ++ofs; type = O71_TT_PERCENT_EQUAL; }
+                else type = O71_TT_PERCENT;
+                break;
+            case '^':
+                switch (nch)
+                {
+                case '^':
+                    if (++ofs < src_n && src_a[ofs] == '=')
+                    {
+                        ++ofs;
+                        type = O71_TT_CARET_CARET_EQUAL;
+                        break;
+                    }
+                    else type = O71_TT_CARET_CARET;
+                    break;
+                case '=': ++ofs; type = O71_TT_CARET_EQUAL; break;
+                default:
+                    type = O71_TT_CARET;
+                }
+                break;
+            case '&':
+                switch (nch)
+                {
+                case '&':
+                    if (++ofs < src_n && src_a[ofs] == '=')
+                    {
+                        ++ofs;
+                        type = O71_TT_AMPERSAND_AMPERSAND_EQUAL;
+                        break;
+                    }
+                    else type = O71_TT_AMPERSAND_AMPERSAND;
+                    break;
+                case '=': ++ofs; type = O71_TT_AMPERSAND_EQUAL; break;
+                default:
+                    type = O71_TT_AMPERSAND;
+                }
+                break;
+            case '|':
+                switch (nch)
+                {
+                case '&':
+                    if (++ofs < src_n && src_a[ofs] == '=')
+                    {
+                        ++ofs;
+                        type = O71_TT_PIPE_PIPE_EQUAL;
+                        break;
+                    }
+                    else type = O71_TT_PIPE_PIPE;
+                    break;
+                case '=': ++ofs; type = O71_TT_PIPE_EQUAL; break;
+                default:
+                    type = O71_TT_PIPE;
+                }
+                break;
+            case '+':
+                switch (nch)
+                {
+                case '+': ++ofs; type = O71_TT_PLUS_PLUS; break;
+                case '=': ++ofs; type = O71_TT_PLUS_EQUAL; break;
+                default: type = O71_TT_PLUS;
+                }
+                break;
+            case '-':
+                switch (nch)
+                {
+                case '-': ++ofs; type = O71_TT_MINUS_MINUS; break;
+                case '=': ++ofs; type = O71_TT_MINUS_EQUAL; break;
+                default: type = O71_TT_MINUS;
+                }
+                break;
+            case '*':
+                switch (nch)
+                {
+                case '*':
+                    if (++ofs < src_n && src_a[ofs] == '=')
+                    {
+                        ++ofs;
+                        type = O71_TT_STAR_STAR_EQUAL;
+                    }
+                    else type = O71_TT_STAR_STAR;
+                    break;
+                case '=': ++ofs; type = O71_TT_STAR_EQUAL; break;
+                default: type = O71_TT_STAR;
+                }
+                break;
+            case '/':
+                if (nch == '=') { ++ofs; type = O71_TT_SLASH_EQUAL; }
+                else type = O71_TT_SLASH;
+                break;
+            case '=':
+                if (nch == '=') { ++ofs; type = O71_TT_EQUAL_EQUAL; }
+                else type = O71_TT_EQUAL;
+                break;
+            case '<':
+                switch (nch)
+                {
+                case '<':
+                    if (++ofs < src_n && src_a[ofs] == '=')
+                    {
+                        ++ofs;
+                        type = O71_TT_LESS_LESS_EQUAL;
+                    }
+                    else type = O71_TT_LESS_LESS;
+                    break;
+                case '=':
+                    ++ofs;
+                    type = O71_TT_LESS_EQUAL;
+                    break;
+                default:
+                    type = O71_TT_LESS;
+                }
+                break;
+            case '>':
+                switch (nch)
+                {
+                case '>':
+                    if (++ofs < src_n && src_a[ofs] == '=')
+                    {
+                        ++ofs;
+                        type = O71_TT_GREATER_GREATER_EQUAL;
+                    }
+                    else type = O71_TT_GREATER_GREATER;
+                    break;
+                case '=':
+                    ++ofs;
+                    type = O71_TT_GREATER_EQUAL;
+                    break;
+                default:
+                    type = O71_TT_GREATER;
+                }
+                break;
+            case '"':
+                break;
+            default:
+                if (ch >= 0x80
+                    && !utf8_char_check(src_a + src_ofs, src_n - src_ofs, &ce))
+                {
+                    ofs = src_ofs;
+                    break;
+                }
+                CE(O71_CE_PARSE_BAD_CHAR);
+            }
+            if (ce) break;
+            ARENA_ALLOC(os, &code_p->arena, token_p);
+            if (os) return os;
+            token_p->type = token_p->base_type = type;
         }
-#endif
+        if (ce) break;
+        token_p->src_ofs = src_ofs;
+        token_p->src_row = row;
+        token_p->src_col = col;
+        col += (token_p->src_len = ofs - src_ofs);
+        token_p->next = NULL;
+        *code_p->token_tail = token_p;
+        code_p->token_tail = &token_p->next;
+        M("token type=%u: %s %.*s", token_p->type, ttname_a[token_p->type],
+          (int) token_p->src_len, src_a + token_p->src_ofs);
     }
 
-    os = merge_sorted_refs(world_p, &class_p->super_ra, &class_p->super_n,
-                           super_ra, super_n);
-#if O71_DEBUG
+#undef CE
+    if (ce)
     {
-        ptrdiff_t i;
-        printf("status: %s, output super_ra=[", N(os));
-        if (class_p->super_n)
-        {
-            for (i = 0; i < (ptrdiff_t) class_p->super_n - 1; ++i)
-                printf("o%lX, ", class_p->super_ra[i]);
-            printf("o%lX", class_p->super_ra[i]);
-        }
-        printf("].\n");
+        code_p->ce_code = ce;
+        code_p->ce_row = row;
+        code_p->ce_col = col;
+        code_p->ce_ofs = ofs;
+        return O71_COMPILE_ERROR;
     }
-#endif
-    return os;
-}
-
-/* merge_sorted_refs ********************************************************/
-static o71_status_t merge_sorted_refs
-(
-    o71_world_t * world_p,
-    o71_ref_t * * dest_rap,
-    size_t * dest_rnp,
-    o71_ref_t * src_ra,
-    size_t src_n
-)
-{
-    o71_status_t os;
-    ptrdiff_t i, j, k;
-    o71_ref_t * dest_ra;
 
-    A(dest_rnp + src_n >= dest_rnp);
-    i = (ptrdiff_t) *dest_rnp - 1;
-    k = (ptrdiff_t) (*dest_rnp + src_n);
-    os = redim(world_p->allocator_p, (void * *) dest_rap, dest_rnp, (size_t) k,
-               sizeof(o71_ref_t));
+    ARENA_ALLOC(os, &code_p->arena, token_p);
     if (os) return os;
-    dest_ra = *dest_rap;
-    j = (ptrdiff_t) src_n - 1;
-    --k;
-    while (i >= 0 && i < k)
-    {
-        dest_ra[k--] = (dest_ra[i] > src_ra[j]) ? dest_ra[i--] : src_ra[j--];
-    }
-    while (i < k) dest_ra[k--] = src_ra[j--];
+    token_p->src_ofs = src_n;
+    token_p->src_len = 0;
+    token_p->src_row = row;
+    token_p->src_col = col;
+    token_p->type = token_p->base_type = O71_TT_END;
+    token_p->next = NULL;
+    *code_p->token_tail = token_p;
+    code_p->token_tail = &token_p->next;
+    M("tokenization done!");
     return O71_OK;
 }
 
-
-/* ref_search ***************************************************************/
-static ptrdiff_t ref_search
-(
-    o71_ref_t * ra,
-    size_t rn,
-    o71_ref_t kr
-)
-{
-    ptrdiff_t a, b, c;
-    for (a = 0, b = (ptrdiff_t) rn - 1; a <= b; )
-    {
-        c = (a + b) >> 1;
-        if (kr == ra[c]) return c;
-        if (kr < ra[c]) b = c - 1;
-        else a = c + 1;
-    }
-    return ~a;
-}
-
-/* ref_qsort ****************************************************************/
-static void ref_qsort
-(
-    o71_ref_t * ref_a,
-    size_t ref_n
-)
-{
-    size_t i, j;
-    int ii, jj;
-    o71_ref_t r;
-
-    for (; ref_n > 1;)
-    {
-        i = 0;
-        j = ref_n - 1;
-        ii = 1; jj = 0;
-        while (i < j)
-        {
-            if (ref_a[i] > ref_a[j])
-            {
-                r = ref_a[i];
-                ref_a[i] = ref_a[j];
-                ref_a[j] = r;
-                ii ^= 1;
-                jj ^= -1;
-            }
-            i += ii;
-            j += jj;
-        }
-        /* launch the short side recursively so that depth is logarithmic */
-        if (i < ref_n - i - 1)
-        {
-            ref_qsort(ref_a, i);
-            ref_a += i + 1;
-            ref_n -= i + 1;
-        }
-        else
-        {
-            ref_qsort(ref_a + i + 1, ref_n - (i + 1));
-            ref_n = i;
-        }
-    }
-}
-
-/* refkv_qsort **************************************************************/
-static void refkv_qsort
+#if _DEBUG
+static void dump_token_list
 (
-    o71_kv_t * kv_a,
+    o71_token_t * token_p,
     size_t n
 )
 {
-    size_t i, j;
-    int ii, jj;
-    o71_kv_t r;
-
-    for (; n > 1;)
-    {
-        i = 0;
-        j = n - 1;
-        ii = 1; jj = 0;
-        while (i < j)
-        {
-            if (kv_a[i].key_r > kv_a[j].key_r)
-            {
-                r = kv_a[i];
-                kv_a[i] = kv_a[j];
-                kv_a[j] = r;
-                ii ^= 1;
-                jj ^= -1;
-            }
-            i += ii;
-            j += jj;
-        }
-        /* launch the short side recursively so that depth is logarithmic */
-        if (i < n - i - 1)
-        {
-            refkv_qsort(kv_a, i);
-            kv_a += i + 1;
-            n -= i + 1;
-        }
-        else
-        {
-            refkv_qsort(kv_a + i + 1, n - (i + 1));
-            n = i;
-        }
-    }
-}
-
-/* get_reg_obj_field ********************************************************/
-static o71_status_t get_reg_obj_field
-(
-    o71_flow_t * flow_p,
-    o71_ref_t obj_r,
-    o71_ref_t field_r,
-    o71_ref_t * value_rp
-)
-{
-    o71_status_t os;
-    A(o71_model(flow_p->world_p, obj_r) != O71M_INVALID);
-    A(o71_model(flow_p->world_p, field_r) != O71M_INVALID);
-    os = o71_istr_check(flow_p->world_p, field_r);
-    if (os)
-    {
-        M("bad field name obref_%lX: %s", (long) field_r, N(os));
-        return os;
-    }
-    return o71_reg_obj_get_field(flow_p->world_p, obj_r, field_r, value_rp);
+    for (; token_p && n; token_p = token_p->next, --n)
+        printf("%s%*s", ttname_a[token_p->type], (int) !!n, "");
 }
 
+#endif
 
-/* set_reg_obj_field ********************************************************/
-static o71_status_t set_reg_obj_field
-(
-    o71_flow_t * flow_p,
-    o71_ref_t obj_r,
-    o71_ref_t field_r,
-    o71_ref_t value_r
-)
+/* kv_nop_free **************************************************************/
+static o71_status_t kv_nop_free (o71_world_t * world_p, o71_kv_t * kv_p)
 {
-    o71_status_t os;
-    A(o71_model(flow_p->world_p, obj_r) != O71M_INVALID);
-    A(o71_model(flow_p->world_p, field_r) != O71M_INVALID);
-    A(o71_model(flow_p->world_p, value_r) != O71M_INVALID);
-    os = o71_istr_check(flow_p->world_p, field_r);
-    if (os)
-    {
-        M("bad field name obref_%lX: %s", (long) field_r, N(os));
-        return os;
-    }
-    return o71_reg_obj_set_field(flow_p->world_p, obj_r, field_r, value_r);
+    return O71_OK;
 }
 
-/* free_token ***************************************************************/
-static o71_status_t free_token
-(
-    o71_code_t * code_p,
-    o71_token_t * token_p,
-    unsigned int min_tt
-)
+/* kv_free_key_deref ********************************************************/
+static o71_status_t kv_free_key_deref (o71_world_t * world_p, o71_kv_t * kv_p)
 {
     o71_status_t os;
-    unsigned int i;
-    o71_str_token_t * str_token_p;
-    o71_id_token_t * id_token_p;
-    o71_int_token_t * int_token_p;
-    o71_unary_expr_token_t * unary_expr_p;
-    o71_binary_expr_token_t * binary_expr_p;
-    o71_cond_expr_token_t * cond_expr_p;
-
-    if (token_p->type < min_tt) return O71_OK;
-    M("free_token %p(base_type=%s, type=%s)", 
-      token_p, ttname_a[token_p->base_type], ttname_a[token_p->type]);
-    switch (token_p->base_type)
-    {
-    case O71_TT_STRING:
-        str_token_p = (o71_str_token_t *) token_p;
-        FREE_ARRAY(code_p->allocator_p, str_token_p->a, str_token_p->n);
-        FREE(code_p->allocator_p, str_token_p);
-        break;
-    case O71_TT_IDENTIFIER:
-        id_token_p = (o71_id_token_t *) token_p;
-        FREE(code_p->allocator_p, id_token_p);
-        break;
-    case O71_TT_INTEGER:
-        int_token_p = (o71_int_token_t *) token_p;
-        FREE(code_p->allocator_p, int_token_p);
-        break;
-    case O71_TT_ATOM_EXPR:
-    case O71_TT_POSTFIX_EXPR:
-    case O71_TT_PREFIX_EXPR:
-        unary_expr_p = (o71_unary_expr_token_t *) token_p;
-        os = free_token(code_p, unary_expr_p->sub_expr_p, min_tt);
-        if (os) return (os);
-        FREE(code_p->allocator_p, unary_expr_p);
-        break;
-    case O71_TT_EXP_EXPR:
-    case O71_TT_AND_EXPR:
-    case O71_TT_OR_EXPR:
-    case O71_TT_XOR_EXPR:
-    case O71_TT_MUL_EXPR:
-    case O71_TT_ADD_EXPR:
-    case O71_TT_CMP_EXPR:
-    case O71_TT_EQU_EXPR:
-    case O71_TT_LOGIC_AND_EXPR:
-    case O71_TT_LOGIC_XOR_EXPR:
-    case O71_TT_LOGIC_OR_EXPR:
-    case O71_TT_EXPR:
-        binary_expr_p = (o71_binary_expr_token_t *) token_p;
-        os = free_token(code_p, binary_expr_p->sub_expr_pa[0], min_tt);
-        if (os) return (os);
-        os = free_token(code_p, binary_expr_p->sub_expr_pa[1], min_tt);
-        if (os) return (os);
-        FREE(code_p->allocator_p, unary_expr_p);
-        break;
-    case O71_TT_COND_EXPR:
-        cond_expr_p = (o71_cond_expr_token_t *) token_p;
-        os = free_token(code_p, cond_expr_p->sub_expr_pa[0], min_tt);
-        if (os) return (os);
-        os = free_token(code_p, cond_expr_p->sub_expr_pa[1], min_tt);
-        if (os) return (os);
-        os = free_token(code_p, cond_expr_p->cond_p, min_tt);
-        if (os) return (os);
-        FREE(code_p->allocator_p, cond_expr_p);
-        break;
-
-    default:
-        FREE(code_p->allocator_p, token_p);
-        break;
-    }
-    return O71_OK;
+    os = o71_deref(world_p, kv_p->key_r);
+    return os;
 }
 
-/* rule_nop *****************************************************************/
-static o71_status_t rule_nop (o71_code_t * code_p)
+/* deref_key_and_value ******************************************************/
+static o71_status_t deref_key_and_value (o71_world_t * world_p, o71_kv_t * kv_p)
 {
-    (void) code_p;
-    return 0;
+    o71_status_t os;
+    os = o71_deref(world_p, kv_p->key_r);
+    AOS(os);
+    os = o71_deref(world_p, kv_p->value_r);
+    AOS(os);
+    return os;
 }
 
-/* tokenize_source **********************************************************/
-static o71_status_t tokenize_source
+/* init_empty_block_stmt ****************************************************/
+static void init_empty_block_stmt
 (
-    o71_code_t * code_p
+    o71_block_stmt_token_t * block_stmt_p,
+    o71_block_stmt_token_t * parent_block_stmt_p
 )
 {
-    size_t ofs;
-    uint32_t row, col, ch, nch;
-    int chlen, ce, digit;
-    o71_status_t os;
-    unsigned int base;
-    size_t str_n, i;
-    o71_allocator_t * allocator_p;
-    uint8_t const * src_a;
-    size_t src_n, src_ofs;
-    o71_token_t * token_p;
-    unsigned int type;
+    block_stmt_p->base.next = NULL;
+    block_stmt_p->base.src_ofs = 0;
+    block_stmt_p->base.src_len = 0;
+    block_stmt_p->base.src_row = 0;
+    block_stmt_p->base.src_col = 0;
+    block_stmt_p->base.type = O71_TT_BLOCK_STMT;
+    block_stmt_p->base.base_type = O71_TT_BLOCK_STMT;
+    block_stmt_p->parent_block_stmt_p = parent_block_stmt_p;
+    block_stmt_p->stmt_list_p = NULL;
+    block_stmt_p->stmt_tail_pp = &block_stmt_p->stmt_list_p;
+    block_stmt_p->var_list_p = NULL;
+    block_stmt_p->var_tail_pp = &block_stmt_p->var_list_p;
+}
 
-    allocator_p = code_p->allocator_p;
-    src_a = code_p->src_a;
-    src_n = code_p->src_n;
-#define CE(_e) { ce = _e; break; }
-    ce = O71_CE_NONE;
-    for (ofs = 0, row = 1, col = 1; ofs < src_n; ofs += chlen)
-    {
-        if (src_a[ofs] < 0x20)
-        {
-            if (src_a[ofs] == '\r')
-            {
-                row += 1;
-                col = 1;
-                if (ofs + 1 < src_n && src_a[ofs + 1] == '\n')
-                {
-                    chlen = 2;
-                    continue;
-                }
-                chlen = 1;
-                continue;
-            }
-            if (src_a[ofs] == '\n')
-            {
-                row += 1;
-                col = 1;
-                chlen = 1;
-                continue;
-            }
-            CE(O71_CE_PARSE_BAD_CONTROL_CHAR);
-        }
-        if (src_a[ofs] < 0x80)
-        {
-            chlen = 1;
-            continue;
-        }
-        if (src_a[ofs] < 0xC0) CE(O71_CE_PARSE_BAD_UTF8_START_BYTE);
-        if (src_a[ofs] < 0xE0)
-        {
-            if (ofs + 2 > src_n)
-                CE(O71_CE_PARSE_TRUNCATED_UTF8_CHAR);
-            if ((src_a[ofs + 1] & 0xC0) != 0x80)
-                CE(O71_CE_PARSE_BAD_UTF8_CONTINUATION);
-            if (src_a[ofs] < 0xC2)
-                CE(O71_CE_PARSE_OVERLY_LONG_ENCODED_UTF8_CHAR);
-            chlen = 2;
-            col += 1;
-        }
-        if (src_a[ofs] < 0xF0)
-        {
-            if (ofs + 3 > src_n)
-                CE(O71_CE_PARSE_TRUNCATED_UTF8_CHAR);
-            if (((src_a[ofs + 1] | src_a[ofs + 2]) & 0xC0) != 0x80)
-                CE(O71_CE_PARSE_BAD_UTF8_CONTINUATION);
-            if (src_a[ofs] == 0xE0 && src_a[ofs + 1] < 0xA0)
-                CE(O71_CE_PARSE_OVERLY_LONG_ENCODED_UTF8_CHAR);
-            if (src_a[ofs] == 0xED && src_a[ofs + 1] >= 0xA0)
-                CE(O71_CE_PARSE_SURROGATE_CODEPOINT);
-            chlen = 3;
-            col += 1;
-        }
-        if (src_a[ofs] < 0xF8)
-        {
-            if (ofs + 4 > src_n)
-                CE(O71_CE_PARSE_TRUNCATED_UTF8_CHAR);
-            if (((src_a[ofs + 1] | src_a[ofs + 2] | src_a[ofs + 3]) & 0xC0)
-                != 0x80) CE(O71_CE_PARSE_BAD_UTF8_CONTINUATION);
-            if (src_a[ofs] == 0xF0 && src_a[ofs + 1] < 0x90)
-                CE(O71_CE_PARSE_OVERLY_LONG_ENCODED_UTF8_CHAR);
-        }
-        CE(O71_CE_PARSE_BAD_UTF8_START_BYTE);
-    }
+/* match_expr ***************************************************************/
+static o71_status_t match_expr
+(
+    o71_code_t * code_p,
+    o71_token_type_t expr_type,
+    o71_token_t * * expr_pp,
+    o71_token_t * src_p,
+    o71_token_t * * src_pp
+)
+{
+    o71_token_t * expr_p;
+    o71_token_t * lookup_p;
+    o71_unary_expr_token_t * unary_expr_p;
+    o71_status_t os = O71_OK;
 
-    if (!ce) for (ofs = 0, row = 1, col = 1; ofs < src_n; )
+    P("match_expr(%s): ", ttname_a[expr_type]); 
+    dump_token_list(src_p, 8); P(".\n");
+    do
     {
-        ch = src_a[ofs];
-        if (ch <= 0x20)
+        P("loop match_expr(%s): ", ttname_a[expr_type]); 
+        dump_token_list(src_p, 8); 
+        lookup_p = src_p->next;
+        P(". lookup: %s.\n", ttname_a[lookup_p->type]);
+        switch (src_p->type)
         {
-            if (ch == ' ') { col += 1; ofs += 1; continue; }
-            A(ch == '\n' || ch == '\r');
-            if (ch == '\r')
+        case O71_TT_IDENTIFIER:
+        case O71_TT_STRING:
+        case O71_TT_INTEGER:
+            ARENA_ALLOC(os, &code_p->arena, unary_expr_p);
+            if (os) { M("ouch: %s", N(os)); break; }
+            unary_expr_p->base.next = src_p->next;
+            unary_expr_p->sub_expr_p = src_p;
+            src_p = &unary_expr_p->base;
+            src_p->type = src_p->base_type = O71_TT_ATOM_EXPR;
+            break;
+            
+        case O71_TT_PAREN_OPEN:
+            os = match_expr(code_p, O71_TT_EXPR, &expr_p, src_p->next, &src_p);
+            if (os) { M("ouch: %s", N(os)); break; }
+            if (src_p->type != O71_TT_PAREN_CLOSE)
             {
-                if (ofs + 1 < src_n && src_a[ofs + 1] == '\n') ++ofs;
+                code_p->ce_code = O71_CE_EXP_PAREN_CLOSE_AFTER_EXPR;
+                code_p->ce_ofs = src_p->src_ofs;
+                code_p->ce_row = src_p->src_row;
+                code_p->ce_col = src_p->src_col;
+                os = O71_COMPILE_ERROR;
+                break;
             }
-            ++ofs;
-            ++row;
-            col = 1;
-            continue;
-        }
-        /* non-whitespace character */
-        if (ch == '#')
-        {
-            /* skip until EOL */
-            for (; ofs < src_n && src_a[ofs] >= 0x20; ++ofs);
-            /* don't bother to update the column here as we either reached
-             * end of line or end of file */
-            continue;
-        }
+            expr_p->next = src_p->next;
+            src_p = expr_p;
+            break;
 
-        src_ofs = ofs;
-        if (IS_ID_START_CHAR(ch))
-        {
-            o71_id_token_t * id_token_p;
-            for (++ofs; ofs < src_n && IS_ID_BODY_CHAR(src_a[ofs]); ++ofs);
-            ALLOC(os, code_p->allocator_p, id_token_p);
-            if (os) return os;
-            token_p = &id_token_p->base;
-            token_p->type = token_p->base_type = O71_TT_IDENTIFIER;
-            id_token_p->a = src_a + src_ofs;
-            id_token_p->n = ofs - src_ofs;
-        }
-        else if (IS_DIGIT(ch))
-        {
-            o71_int_token_t * int_token_p;
-            uint64_t num;
-            base = 10;
-            if (ch == '0' && ofs + 1 < src_n)
-            {
-                ch = src_a[++ofs];
-                switch (ch)
-                {
-                case 'b': ++ofs; base = 2; break;
-                case 'o': ++ofs; base = 8; break;
-                case 'd': ++ofs; base = 10; break;
-                case 'x': ++ofs; base = 16; break;
-                }
-            }
-            num = 0;
-            for (; ofs < src_n &&
-                 (src_a[ofs] == '_' || IS_DIGIT(src_a[ofs]) ||
-                  IS_ALPHA(src_a[ofs]));
-                 ++ofs)
-            {
-                if (src_a[ofs] == '_') continue;
-                digit = ALPHANUM_TO_DIGIT(src_a[ofs]);
-                if (digit >= (int) base) CE(O71_CE_PARSE_BAD_NUMBER);
-                num = num * base + digit;
-            }
-            if (ce) break;
-            ALLOC(os, code_p->allocator_p, int_token_p);
-            if (os) return os;
-            token_p = &int_token_p->base;
-            token_p->type = token_p->base_type = O71_TT_INTEGER;
-            int_token_p->val = num;
-        }
-        else if (ch == '"')
-        {
-            o71_str_token_t * str_token_p;
-            //M("ofs=%zX", ofs);
-            ++ofs;
-            for (str_n = 0;
-                 ofs < src_n && src_a[ofs] != '"' && src_a[ofs] != '\n'; )
+        case O71_TT_ATOM_EXPR:
+            src_p->type = O71_TT_POSTFIX_EXPR;
+            break;
+            
+        case O71_TT_POSTFIX_EXPR:
+            switch (lookup_p->type)
             {
-                //M("ofs=%zX", ofs);
-                if (src_a[ofs++] != '\\') ++str_n;
-                else
-                {
-                    if (ofs == src_n) CE(O71_CE_PARSE_UNFINISHED_STRING);
-                    switch (ch = src_a[ofs++])
-                    {
-                    case '0':
-                    case 'n':
-                    case 'r':
-                    case 'v':
-                    case 'e':
-                    case 't':
-                    case 'a':
-                    case 'b':
-                    case '\\':
-                    case '\'':
-                    case '"':
-                        ++str_n;
-                        continue;
-                    case 'x': // \xAB
-                        if (ofs + 2 > src_n ||
-                            !IS_HEX_DIGIT(src_a[ofs]) ||
-                            !IS_HEX_DIGIT(src_a[ofs + 1]))
-                            break;
-                        ofs += 2;
-                        ++str_n;
-                        continue;
-                    case 'c': // \c12
-                        if (ofs + 2 > src_n ||
-                            !IS_HEX_DIGIT(src_a[ofs]) ||
-                            !IS_HEX_DIGIT(src_a[ofs + 1]))
-                            break;
-                        ch = (ALPHANUM_TO_DIGIT(src_a[ofs]) << 4)
-                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 1]));
-                        ofs += 2;
-                        str_n += utf8_codepoint_length(ch);
-                        continue;
-                    case 'u': // \u1234
-                        if (ofs + 4 > src_n ||
-                            !IS_HEX_DIGIT(src_a[ofs]) ||
-                            !IS_HEX_DIGIT(src_a[ofs + 1]) ||
-                            !IS_HEX_DIGIT(src_a[ofs + 2]) ||
-                            !IS_HEX_DIGIT(src_a[ofs + 3]))
-                            break;
-                        ch = (ALPHANUM_TO_DIGIT(src_a[ofs]) << 12)
-                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 1]) << 8)
-                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 2]) << 4)
-                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 3]));
-                        ofs += 4;
-                        str_n += utf8_codepoint_length(ch);
-                        continue;
-                    case 'U': // \U123456
-                        if (ofs + 6 > src_n ||
-                            !IS_HEX_DIGIT(src_a[ofs]) ||
-                            !IS_HEX_DIGIT(src_a[ofs + 1]) ||
-                            !IS_HEX_DIGIT(src_a[ofs + 2]) ||
-                            !IS_HEX_DIGIT(src_a[ofs + 3]) ||
-                            !IS_HEX_DIGIT(src_a[ofs + 4]) ||
-                            !IS_HEX_DIGIT(src_a[ofs + 5]))
-                            break;
-                        ch = (ALPHANUM_TO_DIGIT(src_a[ofs]) << 20)
-                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 1]) << 16)
-                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 2]) << 12)
-                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 3]) << 8)
-                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 4]) << 4)
-                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 5]));
-                        if (ch >= 0x110000) break;
-                        str_n += utf8_codepoint_length(ch);
-                        ofs += 6;
-                        continue;
-                    }
-                    CE(O71_CE_PARSE_BAD_STRING_ESCAPE);
-                }
+            case O71_TT_SQUARE_BRACKET_OPEN:
+            case O71_TT_PAREN_OPEN:
+            case O71_TT_DOT:
+                os = O71_TODO;
+                break;
+            case O71_TT_EQUAL:
+            case O71_TT_PLUS_EQUAL:
+            case O71_TT_MINUS_EQUAL:
+            case O71_TT_STAR_EQUAL:
+            case O71_TT_SLASH_EQUAL:
+            case O71_TT_PERCENT_EQUAL:
+            case O71_TT_AMPERSAND_EQUAL:
+            case O71_TT_PIPE_EQUAL:
+            case O71_TT_CARET_EQUAL:
+            case O71_TT_STAR_STAR_EQUAL:
+            case O71_TT_LESS_LESS_EQUAL:
+            case O71_TT_GREATER_EQUAL:
+            case O71_TT_AMPERSAND_AMPERSAND_EQUAL:
+            case O71_TT_CARET_CARET_EQUAL:
+            case O71_TT_PIPE_PIPE_EQUAL:
+                os = O71_TODO;
+                break;
+            default:
+                src_p->type = O71_TT_PREFIX_EXPR;
+                break;
             }
-            //M("str_n=%zu", str_n);
-            if (ce) break;
-            if (ofs == src_n || src_a[ofs] == '\n')
-                CE(O71_CE_PARSE_UNFINISHED_STRING);
-            A(src_a[ofs] == '"');
-            ALLOC(os, code_p->allocator_p, str_token_p);
-            if (os) return os;
-            token_p = &str_token_p->base;
-            token_p->type = token_p->base_type = O71_TT_STRING;
-            str_token_p->n = 0;
-            os = redim(allocator_p, (void * *) &str_token_p->a,
-                       &str_token_p->n, str_n + 1, 1);
-            if (os)
+            break;
+
+        case O71_TT_PREFIX_EXPR:
+            src_p->type = O71_TT_EXP_EXPR;
+            break;
+
+        case O71_TT_EXP_EXPR:
+            switch (lookup_p->type)
             {
-                return os;
+            case O71_TT_LESS_LESS:
+            case O71_TT_GREATER_GREATER:
+            case O71_TT_STAR_STAR:
+                os = O71_TODO;
+                break;
+            default:
+                src_p->type = O71_TT_MUL_EXPR;
+                break;
             }
-            for (i = 0, ofs = src_ofs + 1; src_a[ofs] != '"'; )
+            break;
+
+        case O71_TT_MUL_EXPR:
+            switch (lookup_p->type)
             {
-                //M("ofs=%zX ch: %c", ofs, src_a[ofs]);
-                A(i < str_n);
-                if (src_a[ofs] != '\\') str_token_p->a[i++] = src_a[ofs++];
-                else
-                {
-                    ++ofs;
-                    switch (ch = src_a[ofs++])
-                    {
-                    case '0': str_token_p->a[i++] = 0; break;
-                    case 'n': str_token_p->a[i++] = '\n'; break;
-                    case 'r': str_token_p->a[i++] = '\r'; break;
-                    case 'v': str_token_p->a[i++] = '\v'; break;
-                    case 'e': str_token_p->a[i++] = '\x1B'; break;
-                    case 't': str_token_p->a[i++] = '\t'; break;
-                    case 'a': str_token_p->a[i++] = '\a'; break;
-                    case 'b': str_token_p->a[i++] = '\b'; break;
-                    case '\\': str_token_p->a[i++] = '\\'; break;
-                    case '\'': str_token_p->a[i++] = '\''; break;
-                    case '"': str_token_p->a[i++] = '\"'; break;
-                    case 'x': // \xAB
-                        str_token_p->a[i++]
-                            = (ALPHANUM_TO_DIGIT(src_a[ofs]) << 4)
-                            | ALPHANUM_TO_DIGIT(src_a[ofs + 1]);
-                        ofs += 2;
-                        break;
-                    case 'c': // \cAB
-                        ch = (ALPHANUM_TO_DIGIT(src_a[ofs]) << 4)
-                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 1]));
-                        ofs += 2;
-                        i += utf8_codepoint_encode(str_token_p->a + i, ch);
-                        break;
-                    case 'u': // \u1234
-                        ch = (ALPHANUM_TO_DIGIT(src_a[ofs]) << 12)
-                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 1]) << 8)
-                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 2]) << 4)
-                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 3]));
-                        ofs += 4;
-                        i += utf8_codepoint_encode(str_token_p->a + i, ch);
-                        break;
-                    case 'U': // \U123456
-                        ch = (ALPHANUM_TO_DIGIT(src_a[ofs]) << 20)
-                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 1]) << 16)
-                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 2]) << 12)
-                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 3]) << 8)
-                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 4]) << 4)
-                            | (ALPHANUM_TO_DIGIT(src_a[ofs + 5]));
-                        ofs += 6;
-                        i += utf8_codepoint_encode(str_token_p->a + i, ch);
-                        break;
-                    }
-                }
+            case O71_TT_STAR:
+            case O71_TT_SLASH:
+            case O71_TT_PERCENT:
+                os = O71_TODO;
+                break;
+            default:
+                src_p->type = O71_TT_AND_EXPR;
+                break;
             }
-            str_token_p->a[str_n] = 0;
-            M("i=%zu, str_n=%zu", i, str_n);
-            A(i == str_n);
-            A(src_a[ofs] == '"');
-            ++ofs;
-            //A(ofs == src_ofs + src_len);
-        }
-        else
-        {
-            ++ofs;
-            nch = ofs < src_n ? src_a[ofs] : 0;
-            switch (ch)
+            break;
+
+        case O71_TT_AND_EXPR:
+            switch (lookup_p->type)
             {
-            case '~': type = O71_TT_TILDE; break;
-            case '?': type = O71_TT_QUESTION; break;
-            case '(': type = O71_TT_PAREN_OPEN; break;
-            case ')': type = O71_TT_PAREN_CLOSE; break;
-            case '[': type = O71_TT_SQUARE_BRACKET_OPEN; break;
-            case ']': type = O71_TT_SQUARE_BRACKET_CLOSE; break;
-            case '{': type = O71_TT_CURLY_BRACKET_OPEN; break;
-            case '}': type = O71_TT_CURLY_BRACKET_CLOSE; break;
-            case '.': type = O71_TT_DOT; break;
-            case ',': type = O71_TT_COMMA; break;
-            case ';': type = O71_TT_SEMICOLON; break;
-            case ':': type = O71_TT_COLON; break;
-            case '!':
-                if (nch == '=') { ++ofs; type = O71_TT_EXCLAMATION_EQUAL; }
-                else type = O71_TT_EXCLAMATION;
+            case O71_TT_AMPERSAND:
+                os = O71_TODO;
                 break;
-            case '%':
-                if (nch == '=') { ++ofs; type = O71_TT_PERCENT_EQUAL; }
-                else type = O71_TT_PERCENT;
+            default:
+                src_p->type = O71_TT_XOR_EXPR;
                 break;
-            case '^':
-                switch (nch)
-                {
-                case '^':
-                    if (++ofs < src_n && src_a[ofs] == '=')
-                    {
-                        ++ofs;
-                        type = O71_TT_CARET_CARET_EQUAL;
-                        break;
-                    }
-                    else type = O71_TT_CARET_CARET;
-                    break;
-                case '=': ++ofs; type = O71_TT_CARET_EQUAL; break;
-                default:
-                    type = O71_TT_CARET;
-                }
+            }
+            break;
+
+        case O71_TT_XOR_EXPR:
+            switch (lookup_p->type)
+            {
+            case O71_TT_CARET:
+                os = O71_TODO;
                 break;
-            case '&':
-                switch (nch)
-                {
-                case '&':
-                    if (++ofs < src_n && src_a[ofs] == '=')
-                    {
-                        ++ofs;
-                        type = O71_TT_AMPERSAND_AMPERSAND_EQUAL;
-                        break;
-                    }
-                    else type = O71_TT_AMPERSAND_AMPERSAND;
-                    break;
-                case '=': ++ofs; type = O71_TT_AMPERSAND_EQUAL; break;
-                default:
-                    type = O71_TT_AMPERSAND;
-                }
+            default:
+                src_p->type = O71_TT_OR_EXPR;
                 break;
-            case '|':
-                switch (nch)
-                {
-                case '&':
-                    if (++ofs < src_n && src_a[ofs] == '=')
-                    {
-                        ++ofs;
-                        type = O71_TT_PIPE_PIPE_EQUAL;
-                        break;
-                    }
-                    else type = O71_TT_PIPE_PIPE;
-                    break;
-                case '=': ++ofs; type = O71_TT_PIPE_EQUAL; break;
-                default:
-                    type = O71_TT_PIPE;
-                }
+            }
+            break;
+
+        case O71_TT_OR_EXPR:
+            switch (lookup_p->type)
+            {
+            case O71_TT_PIPE:
+                os = O71_TODO;
                 break;
-            case '+':
-                switch (nch)
-                {
-                case '+': ++ofs; type = O71_TT_PLUS_PLUS; break;
-                case '=': ++ofs; type = O71_TT_PLUS_EQUAL; break;
-                default: type = O71_TT_PLUS;
-                }
+            default:
+                src_p->type = O71_TT_ADD_EXPR;
                 break;
-            case '-':
-                switch (nch)
-                {
-                case '-': ++ofs; type = O71_TT_MINUS_MINUS; break;
-                case '=': ++ofs; type = O71_TT_MINUS_EQUAL; break;
-                default: type = O71_TT_MINUS;
-                }
+            }
+            break;
+
+        case O71_TT_ADD_EXPR:
+            switch (lookup_p->type)
+            {
+            case O71_TT_PLUS:
+            case O71_TT_MINUS:
+                os = O71_TODO;
+                break;
+            default:
+                src_p->type = O71_TT_CMP_EXPR;
+                break;
+            }
+            break;
+
+        case O71_TT_CMP_EXPR:
+            switch (lookup_p->type)
+            {
+            case O71_TT_LESS:
+            case O71_TT_LESS_EQUAL:
+            case O71_TT_GREATER:
+            case O71_TT_GREATER_EQUAL:
+                os = O71_TODO;
+                break;
+            default:
+                src_p->type = O71_TT_EQU_EXPR;
+                break;
+            }
+            break;
+
+        case O71_TT_EQU_EXPR:
+            switch (lookup_p->type)
+            {
+            case O71_TT_EQUAL_EQUAL:
+            case O71_TT_EXCLAMATION_EQUAL:
+                os = O71_TODO;
                 break;
-            case '*':
-                switch (nch)
-                {
-                case '*':
-                    if (++ofs < src_n && src_a[ofs] == '=')
-                    {
-                        ++ofs;
-                        type = O71_TT_STAR_STAR_EQUAL;
-                    }
-                    else type = O71_TT_STAR_STAR;
-                    break;
-                case '=': ++ofs; type = O71_TT_STAR_EQUAL; break;
-                default: type = O71_TT_STAR;
-                }
+            default:
+                src_p->type = O71_TT_LOGIC_AND_EXPR;
                 break;
-            case '/':
-                if (nch == '=') { ++ofs; type = O71_TT_SLASH_EQUAL; }
-                else type = O71_TT_SLASH;
+            }
+            break;
+
+        case O71_TT_LOGIC_AND_EXPR:
+            switch (lookup_p->type)
+            {
+            case O71_TT_AMPERSAND_AMPERSAND:
+                os = O71_TODO;
                 break;
-            case '=':
-                if (nch == '=') { ++ofs; type = O71_TT_EQUAL_EQUAL; }
-                else type = O71_TT_EQUAL;
+            default:
+                src_p->type = O71_TT_LOGIC_XOR_EXPR;
                 break;
-            case '<':
-                switch (nch)
-                {
-                case '<':
-                    if (++ofs < src_n && src_a[ofs] == '=')
-                    {
-                        ++ofs;
-                        type = O71_TT_LESS_LESS_EQUAL;
-                    }
-                    else type = O71_TT_LESS_LESS;
-                    break;
-                case '=':
-                    ++ofs;
-                    type = O71_TT_LESS_EQUAL;
-                    break;
-                default:
-                    type = O71_TT_LESS;
-                }
+            }
+            break;
+
+        case O71_TT_LOGIC_XOR_EXPR:
+            switch (lookup_p->type)
+            {
+            case O71_TT_CARET_CARET:
+                os = O71_TODO;
                 break;
-            case '>':
-                switch (nch)
-                {
-                case '>':
-                    if (++ofs < src_n && src_a[ofs] == '=')
-                    {
-                        ++ofs;
-                        type = O71_TT_GREATER_GREATER_EQUAL;
-                    }
-                    else type = O71_TT_GREATER_GREATER;
-                    break;
-                case '=':
-                    ++ofs;
-                    type = O71_TT_GREATER_EQUAL;
-                    break;
-                default:
-                    type = O71_TT_GREATER;
-                }
+            default:
+                src_p->type = O71_TT_LOGIC_OR_EXPR;
                 break;
-            case '"':
+            }
+            break;
+
+        case O71_TT_LOGIC_OR_EXPR:
+            switch (lookup_p->type)
+            {
+            case O71_TT_PIPE_PIPE:
+                os = O71_TODO;
+                break;
+            case O71_TT_QUESTION:
+                os = O71_TODO;
                 break;
             default:
-                CE(O71_CE_PARSE_BAD_CHAR);
+                src_p->type = O71_TT_COND_EXPR;
+                break;
             }
-            if (ce) break;
-            ALLOC(os, code_p->allocator_p, token_p);
-            if (os) return os;
-            token_p->type = token_p->base_type = type;
+            break;
+
+        case O71_TT_COND_EXPR:
+            src_p->type = O71_TT_EXPR;
+            break;
+
+        default:
+            os = O71_TODO;
+            break;
+        }
+        if (os)
+        {
+            /* nodes created so far are owned by the code arena */
+            M("failing match_expr with status %s", N(os));
+            return os;
         }
-        if (ce) break;
-        token_p->src_ofs = src_ofs;
-        token_p->src_row = row;
-        token_p->src_col = col;
-        col += (token_p->src_len = ofs - src_ofs);
-        token_p->next = NULL;
-        *code_p->token_tail = token_p;
-        code_p->token_tail = &token_p->next;
-        M("token type=%u: %s %.*s", token_p->type, ttname_a[token_p->type],
-          (int) token_p->src_len, src_a + token_p->src_ofs);
     }
+    while (src_p->type < expr_type);
+    *expr_pp = src_p;
+    *src_pp = src_p->next;
+    P("matched expr: ");
+    dump_token_list(src_p, 8); P(".\n");
 
-#undef CE
-    if (ce)
+    return O71_OK;
+}
+
+/* match_stmt ***************************************************************/
+static o71_status_t match_stmt
+(
+    o71_code_t * code_p,
+    o71_token_t * * stmt_pp,
+    o71_token_t * src_p,
+    o71_token_t * * src_pp
+)
+{
+    o71_status_t os;
+    o71_token_t * expr_p;
+
+    P("match_stmt: "); dump_token_list(src_p, 8); P(".\n");
+    switch (src_p->type)
     {
-        code_p->ce_code = ce;
-        code_p->ce_row = row;
-        code_p->ce_col = col;
-        code_p->ce_ofs = ofs;
-        return O71_COMPILE_ERROR;
-    }
+    case O71_TT_RETURN:
+    case O71_TT_BREAK:
+    case O71_TT_GOTO:
+    case O71_TT_IF:
+    case O71_TT_WHILE:
+    case O71_TT_DO:
+    case O71_TT_FOR:
+    case O71_TT_SWITCH:
+    case O71_TT_CASE:
+        return O71_TODO;
+    default:
+        os = match_expr(code_p, O71_TT_EXPR, &expr_p, src_p, &src_p);
+        if (os) { M("ouch: %s", N(os)); return os; }
+        switch (src_p->type)
+        {
+        case O71_TT_SEMICOLON:
+            *src_pp = src_p->next;
+            expr_p->base_type = expr_p->type;
+            expr_p->type = O71_TT_EXPR_STMT;
+            *stmt_pp = expr_p;
+            return O71_OK;
 
-    ALLOC(os, code_p->allocator_p, token_p);
-    if (os) return os;
-    token_p->src_ofs = src_n;
-    token_p->src_len = 0;
-    token_p->src_row = row;
-    token_p->src_col = col;
-    token_p->type = token_p->base_type = O71_TT_END;
-    token_p->next = NULL;
-    *code_p->token_tail = token_p;
-    code_p->token_tail = &token_p->next;
-    M("tokenization done!");
-    return O71_OK;
+        case O71_TT_IDENTIFIER:
+            /* either function declaration, either variable declaration */
+            return O71_TODO;
+
+        default:
+            code_p->ce_code = O71_CE_EXP_SEMICOLON_AFTER_EXPR;
+            code_p->ce_ofs = src_p->src_ofs;
+            code_p->ce_row = src_p->src_row;
+            code_p->ce_col = src_p->src_col;
+            return O71_COMPILE_ERROR;
+        }
+    }
 }
 
-#if _DEBUG
-static void dump_token_list
+/* match_stmt_seq ***********************************************************/
+static o71_status_t match_stmt_seq
 (
-    o71_token_t * token_p,
-    size_t n
+    o71_code_t * code_p,
+    o71_block_stmt_token_t * block_stmt_p,
+    o71_token_t * src_p,
+    o71_token_t * * src_pp,
+    o71_token_type_t end_type
 )
 {
-    for (; token_p && n; token_p = token_p->next, --n)
-        printf("%s%*s", ttname_a[token_p->type], (int) !!n, "");
+    o71_status_t os;
+    o71_token_t * stmt_p;
+
+    P("match_stmt_seq: "); dump_token_list(src_p, 8); P(".\n");
+
+    while (src_p->type != end_type)
+    {
+        os = match_stmt(code_p, &stmt_p, src_p, &src_p);
+        if (os) return os;
+        *block_stmt_p->stmt_tail_pp = stmt_p;
+        block_stmt_p->stmt_tail_pp = &stmt_p->next;
+    }
+    *src_pp = src_p;
+    return O71_OK;
 }
 
-#endif
+/* O71_MAIN *****************************************************************/
+#if O71_MAIN
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
 
-/* kv_nop_free **************************************************************/
-static o71_status_t kv_nop_free (o71_world_t * world_p, o71_kv_t * kv_p)
+#define ERR_NONE 0
+#define ERR_RUN 1
+#define ERR_RES 2
+#define ERR_INVOKE 3
+#define ERR_BUG 4
+
+/* mem_realloc **************************************************************/
+static o71_status_t mem_realloc
+(
+    void * * data_pp,
+    size_t old_size,
+    size_t new_size,
+    void * realloc_context
+)
 {
+    void * new_data;
+    if (old_size == 0)
+    {
+        if (new_size == 0) { *data_pp = NULL; return O71_OK; }
+        *data_pp = malloc(new_size);
+        return *data_pp ? O71_OK : O71_NO_MEM;
+    }
+    if (new_size == 0)
+    {
+        free(*data_pp);
+        return O71_OK;
+    }
+    new_data = realloc(*data_pp, new_size);
+    if (!new_data) return O71_NO_MEM;
+    *data_pp = new_data;
     return O71_OK;
 }
 
-/* kv_free_key_deref ********************************************************/
-static o71_status_t kv_free_key_deref (o71_world_t * world_p, o71_kv_t * kv_p)
+/* help *********************************************************************/
+static void help ()
 {
-    o71_status_t os;
-    os = o71_deref(world_p, kv_p->key_r);
-    return os;
+    printf("ostropel scripting tool - ver 0.00 - by Costin Ionescu\n"
+           "usage: o71 [OPTIONS] SCRIPT ARGS\n"
+           "options:\n"
+           "  -h --help     help\n"
+           "  -t --test     run self tests\n"
+           "  -b --bench    run benchmarks\n");
 }
 
-/* deref_key_and_value ******************************************************/
-static o71_status_t deref_key_and_value (o71_world_t * world_p, o71_kv_t * kv_p)
+#define TE(...) { \
+    fprintf(stderr, "test error (line %u): ", __LINE__); \
+    fprintf(stderr, __VA_ARGS__); fprintf(stderr, "\n"); \
+    rc = ERR_RUN; \
+    break; }
+
+#define TS(_expr) \
+    if (!(os = (_expr))) ; \
+    else TE("expr (%s) failed with status %s", #_expr, N(os))
+
+#define ORC(_w, _r) (((o71_mem_obj_t *) o71_obj_ptr(_w, _r))->ref_n)
+
+/* reg_obj_field_test *******************************************************/
+static int reg_obj_field_test (o71_world_t * world_p)
 {
+    o71_ref_t aa_isr, bb_isr, cc_isr;
+    o71_ref_t sf_r, obj_r;
+    o71_ref_t ra[4];
+    o71_script_function_t * sf_p;
+    o71_ref_t class_r;
+    uint32_t * arg_vxa;
     o71_status_t os;
-    os = o71_deref(world_p, kv_p->key_r);
-    AOS(os);
-    os = o71_deref(world_p, kv_p->value_r);
-    AOS(os);
-    return os;
-}
+    int rc = 0;
+    do
+    {
+        TS(o71_ics(world_p, &aa_isr, "aa"));
+        TS(o71_ics(world_p, &bb_isr, "bb"));
+        TS(o71_ics(world_p, &cc_isr, "cc"));
+        ra[0] = cc_isr;
+        ra[1] = aa_isr;
+        TS(o71_reg_class_create(world_p, ra, 2, &class_r));
+        TS(o71_sfunc_create(world_p, &sf_r, 1));
+        sf_p = o71_obj_ptr(world_p, sf_r);
+        TS(o71_sfunc_append_init(world_p, sf_p, 2, aa_isr));
+        TS(o71_sfunc_append_init(world_p, sf_p, 1, O71_SINT_TO_REF(1)));
+        TS(o71_sfunc_append_set_field(world_p, sf_p, 1, 0, 2));
+        TS(o71_sfunc_append_init(world_p, sf_p, 2, bb_isr));
+        TS(o71_sfunc_append_init(world_p, sf_p, 1, O71_SINT_TO_REF(2)));
+        TS(o71_sfunc_append_set_field(world_p, sf_p, 1, 0, 2));
+        TS(o71_sfunc_append_init(world_p, sf_p, 2, cc_isr));
+        TS(o71_sfunc_append_init(world_p, sf_p, 1, O71_SINT_TO_REF(3)));
+        TS(o71_sfunc_append_set_field(world_p, sf_p, 1, 0, 2));
+        TS(o71_sfunc_append_init(world_p, sf_p, 2, aa_isr));
+        TS(o71_sfunc_append_get_field(world_p, sf_p, 3, 0, 2));
+        TS(o71_sfunc_append_init(world_p, sf_p, 2, bb_isr));
+        TS(o71_sfunc_append_get_field(world_p, sf_p, 4, 0, 2));
+        TS(o71_sfunc_append_init(world_p, sf_p, 2, cc_isr));
+        TS(o71_sfunc_append_get_field(world_p, sf_p, 5, 0, 2));
+        TS(o71_sfunc_append_init(world_p, sf_p, 6, O71R_INT_ADD_FUNC));
+        TS(o71_sfunc_append_call(world_p, sf_p, 1, 6, 2, &arg_vxa));
+        arg_vxa[0] = 3;
+        arg_vxa[1] = 4;
+        TS(o71_sfunc_append_call(world_p, sf_p, 1, 6, 2, &arg_vxa));
+        arg_vxa[0] = 1;
+        arg_vxa[1] = 5;
+        TS(o71_sfunc_append_ret(world_p, sf_p, 1));
 
-/* init_empty_block_stmt ****************************************************/
-static void init_empty_block_stmt
-(
-    o71_block_stmt_token_t * block_stmt_p,
-    o71_block_stmt_token_t * parent_block_stmt_p
-)
-{
-    block_stmt_p->base.next = NULL;
-    block_stmt_p->base.src_ofs = 0;
-    block_stmt_p->base.src_len = 0;
-    block_stmt_p->base.src_row = 0;
-    block_stmt_p->base.src_col = 0;
-    block_stmt_p->base.type = O71_TT_BLOCK_STMT;
-    block_stmt_p->base.base_type = O71_TT_BLOCK_STMT;
-    block_stmt_p->parent_block_stmt_p = parent_block_stmt_p;
-    block_stmt_p->stmt_list_p = NULL;
-    block_stmt_p->stmt_tail_pp = &block_stmt_p->stmt_list_p;
-    block_stmt_p->var_list_p = NULL;
-    block_stmt_p->var_tail_pp = &block_stmt_p->var_list_p;
+        TS(o71_reg_obj_create(world_p, class_r, &ra[0]));
+        M("dyn obj to test: obref_%lX", (long) ra[0]);
+        os = o71_prep_call(&world_p->root_flow, sf_r, ra, 1);
+        if (os != O71_PENDING) TE("prep_call failed: %s", N(os));
+        TS(o71_run(&world_p->root_flow, 0, O71_STEPS_MAX));
+        if (world_p->root_flow.value_r != O71_SINT_TO_REF(1 + 2 + 3))
+            TE("got obref_%lX, expecting obref_%lX",
+               (long) world_p->root_flow.value_r,
+               (long) O71_SINT_TO_REF(1 + 2 + 3));
+        TS(o71_deref(world_p, sf_r));
+    }
+    while (0);
+    printf("reg_obj_field_test: %u\n", rc);
+    return rc;
 }
 
-/* match_expr ***************************************************************/
-static o71_status_t match_expr
-(
-    o71_code_t * code_p,
-    o71_token_type_t expr_type,
-    o71_token_t * * expr_pp,
-    o71_token_t * src_p,
-    o71_token_t * * src_pp
-)
+/* obj_table_test ***********************************************************/
+static int obj_table_test (o71_world_t * world_p)
 {
-    o71_token_t * expr_p;
-    o71_token_t * lookup_p;
-    o71_unary_expr_token_t * unary_expr_p;
-    o71_status_t os = O71_OK;
+    size_t n = 3 * O71_OBJ_PAGE_SIZE, i, obj_n, obj_n0;
+    o71_ref_count_t class_ref_n;
+    o71_ref_t * ra;
+    o71_status_t os;
+    int rc = 0;
 
-    P("match_expr(%s): ", ttname_a[expr_type]); 
-    dump_token_list(src_p, 8); P(".\n");
+    obj_n0 = world_p->obj_n;
+
+    ra = malloc(n * sizeof(o71_ref_t));
+    if (!ra) return ERR_RUN;
+    for (i = 0; i < n; ++i) ra[i] = O71R_NULL;
     do
     {
-        P("loop match_expr(%s): ", ttname_a[expr_type]); 
-        dump_token_list(src_p, 8); 
-        lookup_p = src_p->next;
-        P(". lookup: %s.\n", ttname_a[lookup_p->type]);
-        switch (src_p->type)
+        for (i = 0; i < n; ++i)
         {
-        case O71_TT_IDENTIFIER:
-        case O71_TT_STRING:
-        case O71_TT_INTEGER:
-            ALLOC(os, code_p->allocator_p, unary_expr_p);
-            if (os) { M("ouch: %s", N(os)); break; }
-            unary_expr_p->base.next = src_p->next;
-            unary_expr_p->sub_expr_p = src_p;
-            src_p = &unary_expr_p->base;
-            src_p->type = src_p->base_type = O71_TT_ATOM_EXPR;
-            break;
-            
-        case O71_TT_PAREN_OPEN:
-            os = match_expr(code_p, O71_TT_EXPR, &expr_p, src_p->next, &src_p);
-            if (os) { M("ouch: %s", N(os)); break; }
-            if (src_p->type != O71_TT_PAREN_CLOSE)
-            {
-                code_p->ce_code = O71_CE_EXP_PAREN_CLOSE_AFTER_EXPR;
-                code_p->ce_ofs = src_p->src_ofs;
-                code_p->ce_row = src_p->src_row;
-                code_p->ce_col = src_p->src_col;
-                os = O71_COMPILE_ERROR;
-                break;
-            }
-            expr_p->next = src_p->next;
-            src_p = expr_p;
-            break;
-
-        case O71_TT_ATOM_EXPR:
-            src_p->type = O71_TT_POSTFIX_EXPR;
-            break;
-            
-        case O71_TT_POSTFIX_EXPR:
-            switch (lookup_p->type)
-            {
-            case O71_TT_SQUARE_BRACKET_OPEN:
-            case O71_TT_PAREN_OPEN:
-            case O71_TT_DOT:
-                os = O71_TODO;
-                break;
-            case O71_TT_EQUAL:
-            case O71_TT_PLUS_EQUAL:
-            case O71_TT_MINUS_EQUAL:
-            case O71_TT_STAR_EQUAL:
-            case O71_TT_SLASH_EQUAL:
-            case O71_TT_PERCENT_EQUAL:
-            case O71_TT_AMPERSAND_EQUAL:
-            case O71_TT_PIPE_EQUAL:
-            case O71_TT_CARET_EQUAL:
-            case O71_TT_STAR_STAR_EQUAL:
-            case O71_TT_LESS_LESS_EQUAL:
-            case O71_TT_GREATER_EQUAL:
-            case O71_TT_AMPERSAND_AMPERSAND_EQUAL:
-            case O71_TT_CARET_CARET_EQUAL:
-            case O71_TT_PIPE_PIPE_EQUAL:
-                os = O71_TODO;
-                break;
-            default:
-                src_p->type = O71_TT_PREFIX_EXPR;
-                break;
-            }
-            break;
-
-        case O71_TT_PREFIX_EXPR:
-            src_p->type = O71_TT_EXP_EXPR;
-            break;
+            TS(o71_reg_obj_create(world_p, O71R_REG_OBJ_CLASS, &ra[i]));
+            if (!(o71_model(world_p, ra[i]) & O71M_MEM_OBJ))
+                TE("bad model for object %zu", i);
+        }
+        if (rc) break;
+        if (world_p->obj_n < n)
+            TE("object table too small: %zu", world_p->obj_n);
+        for (i = 0; i < n; ++i)
+            if (o71_check_mem_obj_ref(world_p, ra[i]))
+                TE("object %zu (obref_%lX) lost", i, (long) ra[i]);
+        if (rc) break;
+        obj_n = world_p->obj_n;
+        for (i = 0; i < n; ++i)
+        {
+            TS(o71_deref(world_p, ra[i]));
+            ra[i] = O71R_NULL;
+        }
+        if (rc) break;
+        TS(o71_world_trim(world_p));
+        if (world_p->obj_n != obj_n0)
+            TE("trim left %zu slots instead of %zu", world_p->obj_n, obj_n0);
+        for (i = 0; i < n; ++i)
+        {
+            TS(o71_reg_obj_create(world_p, O71R_REG_OBJ_CLASS, &ra[i]));
+            if (i && ra[i] < ra[i - 1])
+                TE("free slots not taken in ascending order");
+        }
+        if (rc) break;
+        if (world_p->obj_n != obj_n)
+            TE("object table grew from %zu to %zu slots reusing free slots",
+               obj_n, world_p->obj_n);
+        for (i = 0; i < n; ++i)
+        {
+            TS(o71_deref(world_p, ra[i]));
+            ra[i] = O71R_NULL;
+        }
+        if (rc) break;
+        class_ref_n = ORC(world_p, O71R_REG_OBJ_CLASS);
+        TS(o71_reg_obj_create_n(world_p, O71R_REG_OBJ_CLASS, n, ra));
+        if (ORC(world_p, O71R_REG_OBJ_CLASS) != class_ref_n)
+            TE("ref count changed for immortal builtin class");
+        for (i = 0; i < n; ++i)
+        {
+            if (o71_check_mem_obj_ref(world_p, ra[i]) || ORC(world_p, ra[i]) != 1
+                || ((o71_mem_obj_t *) o71_obj_ptr(world_p, ra[i]))->class_r
+                != O71R_REG_OBJ_CLASS)
+                TE("batch object %zu (obref_%lX) is bad", i, (long) ra[i]);
+            if (i && ra[i] <= ra[i - 1])
+                TE("batch slots not taken in ascending order");
+        }
+        if (world_p->obj_n != obj_n)
+            TE("batch allocation grew the object table");
+    }
+    while (0);
+    for (i = 0; i < n; ++i) o71_deref(world_p, ra[i]);
+    free(ra);
+    printf("obj_table_test: %u\n", rc);
+    return rc;
+}
 
-        case O71_TT_EXP_EXPR:
-            switch (lookup_p->type)
-            {
-            case O71_TT_LESS_LESS:
-            case O71_TT_GREATER_GREATER:
-            case O71_TT_STAR_STAR:
-                os = O71_TODO;
-                break;
-            default:
-                src_p->type = O71_TT_MUL_EXPR;
-                break;
-            }
-            break;
+/* cleanup_step_test ********************************************************/
+static int cleanup_step_test (o71_world_t * world_p)
+{
+    size_t n = 100, i, freed_n;
+    o71_ref_t ra[100];
+    o71_ref_t sf_r, arg_r;
+    o71_script_function_t * sf_p;
+    o71_status_t os, ros;
+    int rc = 0;
 
-        case O71_TT_MUL_EXPR:
-            switch (lookup_p->type)
-            {
-            case O71_TT_STAR:
-            case O71_TT_SLASH:
-            case O71_TT_PERCENT:
-                os = O71_TODO;
-                break;
-            default:
-                src_p->type = O71_TT_AND_EXPR;
-                break;
-            }
-            break;
+    do
+    {
+        TS(o71_sfunc_create(world_p, &sf_r, 1));
+        sf_p = o71_obj_ptr(world_p, sf_r);
+        TS(o71_sfunc_append_ret(world_p, sf_p, 0));
+        arg_r = O71_SINT_TO_REF(7);
+        os = o71_prep_call(&world_p->root_flow, sf_r, &arg_r, 1);
+        if (os != O71_PENDING) TE("prep_call failed: %s", N(os));
 
-        case O71_TT_AND_EXPR:
-            switch (lookup_p->type)
-            {
-            case O71_TT_AMPERSAND:
-                os = O71_TODO;
-                break;
-            default:
-                src_p->type = O71_TT_XOR_EXPR;
-                break;
-            }
-            break;
+        TS(o71_reg_obj_create_n(world_p, O71R_REG_OBJ_CLASS, n, ra));
+        world_p->destroy_budget = 0;
+        for (i = 0; i < n; ++i) TS(o71_deref(world_p, ra[i]));
+        if (rc) break;
+        for (i = 0; i < n; ++i)
+            if (o71_check_mem_obj_ref(world_p, ra[i]))
+                TE("object %zu destroyed with a zero budget", i);
+        if (rc) break;
+
+        os = o71_cleanup_step(world_p, 10);
+        if (os != O71_PENDING) TE("cleanup_step: %s", N(os));
+        for (freed_n = 0; freed_n < n; ++freed_n)
+            if (!o71_check_mem_obj_ref(world_p, ra[freed_n])) break;
+        if (freed_n != 10) TE("cleanup_step destroyed %zu objects", freed_n);
+
+        ros = o71_run(&world_p->root_flow, 0, 8);
+        for (freed_n = 0; freed_n < n; ++freed_n)
+            if (!o71_check_mem_obj_ref(world_p, ra[freed_n])) break;
+        if (freed_n != 18) TE("run slice destroyed %zu objects", freed_n - 10);
+
+        TS(o71_cleanup(world_p));
+        for (i = 0; i < n; ++i)
+            if (!o71_check_mem_obj_ref(world_p, ra[i]))
+                TE("object %zu not destroyed", i);
+        if (rc) break;
+        world_p->destroy_budget = SIZE_MAX;
+        if (ros == O71_PENDING)
+        {
+            TS(o71_run(&world_p->root_flow, 0, O71_STEPS_MAX));
+        }
+        if (world_p->root_flow.value_r != arg_r)
+            TE("got obref_%lX, expecting obref_%lX",
+               (long) world_p->root_flow.value_r, (long) arg_r);
+        TS(o71_deref(world_p, sf_r));
+    }
+    while (0);
+    world_p->destroy_budget = SIZE_MAX;
+    printf("cleanup_step_test: %u\n", rc);
+    return rc;
+}
 
-        case O71_TT_XOR_EXPR:
-            switch (lookup_p->type)
-            {
-            case O71_TT_CARET:
-                os = O71_TODO;
-                break;
-            default:
-                src_p->type = O71_TT_OR_EXPR;
-                break;
-            }
-            break;
+/* gc_test ******************************************************************/
+static int gc_test (o71_world_t * world_p)
+{
+    o71_ref_t aa_isr, class_r, a_r, b_r, c_r, e_r, v_r;
+    o71_ref_t ra[2];
+    o71_gc_stats_t st;
+    o71_status_t os;
+    int rc = 0;
 
-        case O71_TT_OR_EXPR:
-            switch (lookup_p->type)
-            {
-            case O71_TT_PIPE:
-                os = O71_TODO;
-                break;
-            default:
-                src_p->type = O71_TT_ADD_EXPR;
-                break;
-            }
-            break;
+    do
+    {
+        TS(o71_ics(world_p, &aa_isr, "aa"));
+        TS(o71_reg_class_create(world_p, &aa_isr, 1, &class_r));
+        TS(o71_reg_obj_create_n(world_p, class_r, 2, ra));
+        a_r = ra[0];
+        b_r = ra[1];
+        TS(o71_reg_obj_create(world_p, O71R_REG_OBJ_CLASS, &c_r));
+        TS(o71_reg_obj_create(world_p, class_r, &e_r));
+        if (ORC(world_p, class_r) != 4)
+            TE("class ref count not raised for each instance");
+        /* a <-> b through fixed fields, c -> c through a dynamic field,
+         * e -> e but still held by us */
+        TS(o71_reg_obj_set_field(world_p, a_r, aa_isr, b_r));
+        TS(o71_reg_obj_set_field(world_p, b_r, aa_isr, a_r));
+        TS(o71_reg_obj_set_field(world_p, c_r, aa_isr, c_r));
+        TS(o71_reg_obj_set_field(world_p, e_r, aa_isr, e_r));
+        TS(o71_deref(world_p, a_r));
+        TS(o71_deref(world_p, b_r));
+        TS(o71_deref(world_p, c_r));
+        if (o71_check_mem_obj_ref(world_p, a_r)
+            || o71_check_mem_obj_ref(world_p, b_r)
+            || o71_check_mem_obj_ref(world_p, c_r))
+            TE("cycle destroyed by ref counting");
+
+        TS(o71_gc(world_p, &st));
+        if (st.obj_n != 3) TE("collected %zu objects instead of 3", st.obj_n);
+        if (!o71_check_mem_obj_ref(world_p, a_r)
+            || !o71_check_mem_obj_ref(world_p, b_r)
+            || !o71_check_mem_obj_ref(world_p, c_r))
+            TE("unreachable cycle survived");
+        TS(o71_reg_obj_get_field(world_p, e_r, aa_isr, &v_r));
+        if (v_r != e_r) TE("live cycle damaged");
+        if (ORC(world_p, e_r) != 2) TE("bad ref count for live object");
+
+        TS(o71_deref(world_p, e_r));
+        TS(o71_gc(world_p, &st));
+        if (st.obj_n != 1) TE("collected %zu objects instead of 1", st.obj_n);
+        if (world_p->gc_stats.obj_n < 4) TE("bad gc totals");
+
+        /* immortal self-referencing object: neither deref nor gc touch it */
+        TS(o71_reg_obj_create(world_p, class_r, &e_r));
+        TS(o71_reg_obj_set_field(world_p, e_r, aa_isr, e_r));
+        TS(o71_make_immortal(world_p, e_r));
+        TS(o71_ref(world_p, e_r));
+        TS(o71_deref(world_p, e_r));
+        TS(o71_deref(world_p, e_r));
+        TS(o71_deref(world_p, e_r));
+        TS(o71_gc(world_p, &st));
+        if (st.obj_n) TE("collected %zu objects instead of 0", st.obj_n);
+        if (o71_check_mem_obj_ref(world_p, e_r)
+            || ORC(world_p, e_r) != O71_IMMORTAL_REF_N)
+            TE("immortal object damaged");
+        TS(o71_deref(world_p, class_r));
+        TS(o71_deref(world_p, aa_isr));
+    }
+    while (0);
+    printf("gc_test: %u\n", rc);
+    return rc;
+}
 
-        case O71_TT_ADD_EXPR:
-            switch (lookup_p->type)
-            {
-            case O71_TT_PLUS:
-            case O71_TT_MINUS:
-                os = O71_TODO;
-                break;
-            default:
-                src_p->type = O71_TT_CMP_EXPR;
-                break;
-            }
-            break;
+/* str_cmp_test *************************************************************/
+static int str_cmp_test (o71_world_t * world_p)
+{
+    static size_t (* const kernel_a[])
+        (uint8_t const * a, uint8_t const * b, size_t n) =
+    {
+        bytes_mismatch_scalar,
+#if O71_SIMD
+        bytes_mismatch_sse2,
+        bytes_mismatch_avx2,
+#endif
+    };
+    uint8_t a[80], b[80];
+    size_t kernel_n, k, n, d, x;
+    o71_ref_t s1_r, s2_r, s3_r, i1_r, i2_r;
+    o71_status_t os;
+    int rc = 0;
 
-        case O71_TT_CMP_EXPR:
-            switch (lookup_p->type)
+    kernel_n = ITEM_COUNT(kernel_a);
+#if O71_SIMD
+    if (!cpu_has_avx2()) kernel_n -= 1;
+#endif
+    for (x = 0; x < sizeof(a); ++x) a[x] = b[x] = (uint8_t) (x * 7 + 1);
+    for (k = 0; k < kernel_n && !rc; ++k)
+        for (n = 0; n < sizeof(a) && !rc; ++n)
+            for (d = 0; d <= n && !rc; ++d)
             {
-            case O71_TT_LESS:
-            case O71_TT_LESS_EQUAL:
-            case O71_TT_GREATER:
-            case O71_TT_GREATER_EQUAL:
-                os = O71_TODO;
-                break;
-            default:
-                src_p->type = O71_TT_EQU_EXPR;
-                break;
+                /* d == n: no difference in the first n bytes */
+                if (d < n) b[d] ^= 0x80;
+                x = kernel_a[k](a, b, n);
+                if (d < n) b[d] ^= 0x80;
+                if (x != d)
+                    TE("kernel %zu: mismatch at %zu instead of %zu for n=%zu",
+                       k, x, d, n);
             }
-            break;
+    if (rc) return rc;
 
-        case O71_TT_EQU_EXPR:
-            switch (lookup_p->type)
-            {
-            case O71_TT_EQUAL_EQUAL:
-            case O71_TT_EXCLAMATION_EQUAL:
-                os = O71_TODO;
-                break;
-            default:
-                src_p->type = O71_TT_LOGIC_AND_EXPR;
-                break;
-            }
-            break;
+    do
+    {
+        TS(o71_cstring(world_p, &s1_r, "the quick brown fox jumps over it"));
+        TS(o71_rocs(world_p, &s2_r, "the quick brown fox jumps over it"));
+        TS(o71_rocs(world_p, &s3_r, "the quick brown fox jumps over"));
+        if (!o71_str_eq(world_p, s1_r, s2_r)) TE("equal strings differ");
+        if (o71_str_eq(world_p, s2_r, s3_r)) TE("different strings match");
+        if (o71_str_eq(world_p, s1_r, O71_SINT_TO_REF(1)))
+            TE("string equals an int");
+        if (o71_str_cmp(world_p, s1_r, s2_r) != O71_EQUAL)
+            TE("equal strings do not compare equal");
+        if (o71_str_cmp(world_p, s3_r, s2_r) != O71_LESS
+            || o71_str_cmp(world_p, s2_r, s3_r) != O71_MORE)
+            TE("prefix not ordered first");
+        if (o71_str_cmp(world_p, s1_r, O71R_NULL) != O71_BAD_STRING_REF)
+            TE("compared string with null");
+        TS(o71_str_freeze(world_p, s1_r));
+        TS(o71_str_intern(world_p, s1_r, &i1_r));
+        TS(o71_ics(world_p, &i2_r, "the quick brown fox jumps over"));
+        if (!o71_str_eq(world_p, i1_r, s2_r) || o71_str_eq(world_p, i1_r, i2_r)
+            || o71_str_cmp(world_p, i2_r, i1_r) != O71_LESS)
+            TE("bad intern string comparison");
+        TS(o71_deref(world_p, s1_r));
+        TS(o71_deref(world_p, s2_r));
+        TS(o71_deref(world_p, s3_r));
+    }
+    while (0);
+    printf("str_cmp_test: %u\n", rc);
+    return rc;
+}
 
-        case O71_TT_LOGIC_AND_EXPR:
-            switch (lookup_p->type)
-            {
-            case O71_TT_AMPERSAND_AMPERSAND:
-                os = O71_TODO;
-                break;
-            default:
-                src_p->type = O71_TT_LOGIC_XOR_EXPR;
-                break;
-            }
-            break;
+/* str_builder_test *********************************************************/
+static int str_builder_test (o71_world_t * world_p)
+{
+    static uint8_t const expected[] =
+        "n=-9223372036854775808,0,42;\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80"
+        "\xF4\x8F\xBF\xBF";
+    o71_ref_t sb_r, dup_r, i_r;
+    o71_string_t * str_p;
+    uint8_t * a;
+    o71_status_t os;
+    int rc = 0;
+    size_t i;
 
-        case O71_TT_LOGIC_XOR_EXPR:
-            switch (lookup_p->type)
-            {
-            case O71_TT_CARET_CARET:
-                os = O71_TODO;
-                break;
-            default:
-                src_p->type = O71_TT_LOGIC_OR_EXPR;
-                break;
-            }
-            break;
+    do
+    {
+        /* short content lives in the object, longer moves out */
+        TS(o71_cstring(world_p, &dup_r, "0123456789abcdef"));
+        str_p = o71_obj_ptr(world_p, dup_r);
+        if (str_p->a != str_p->inl.sa || str_p->n != O71_STR_INLINE_SIZE)
+            TE("short string not stored inline");
+        TS(o71_str_append_cp(world_p, dup_r, 'g'));
+        if (str_p->a == str_p->inl.sa || str_p->n != O71_STR_INLINE_SIZE + 1
+            || !bytes_eq(str_p->a, (uint8_t const *) "0123456789abcdefg",
+                         str_p->n))
+            TE("bad content after leaving inline storage");
+        TS(o71_deref(world_p, dup_r));
+
+        TS(o71_str_create(world_p, &sb_r, 0));
+        TS(o71_str_append(world_p, sb_r, "n=", 2));
+        TS(o71_str_append_int(world_p, sb_r, INT64_MIN));
+        TS(o71_str_append_cp(world_p, sb_r, ','));
+        TS(o71_str_append_int(world_p, sb_r, 0));
+        TS(o71_str_append_cp(world_p, sb_r, ','));
+        TS(o71_str_append_int(world_p, sb_r, 42));
+        TS(o71_str_append(world_p, sb_r, ";", 1));
+        TS(o71_str_append_cp(world_p, sb_r, 0xE9));
+        TS(o71_str_append_cp(world_p, sb_r, 0x20AC));
+        TS(o71_str_append_cp(world_p, sb_r, 0x1F600));
+        TS(o71_str_append_cp(world_p, sb_r, 0x10FFFF));
+        if (o71_str_append_cp(world_p, sb_r, 0xD800) != O71_BAD_CODE_POINT
+            || o71_str_append_cp(world_p, sb_r, 0x110000)
+               != O71_BAD_CODE_POINT)
+            TE("invalid code point accepted");
+        str_p = o71_obj_ptr(world_p, sb_r);
+        if (str_p->n != sizeof(expected) - 1
+            || !bytes_eq(str_p->a, expected, str_p->n))
+            TE("bad built string '%.*s'", (int) str_p->n, str_p->a);
+        if (str_p->m & (str_p->m - 1)) TE("capacity not a power of 2");
+
+        /* growing one byte at a time reallocates only when full */
+        TS(o71_str_reserve(world_p, sb_r, 0x100));
+        a = str_p->a;
+        for (i = 0; i < 0x100; ++i)
+            TS(o71_str_append_cp(world_p, sb_r, '.'));
+        if (str_p->a != a) TE("buffer moved after reserve");
+
+        /* freezing and interning keep the buffer */
+        TS(o71_str_freeze(world_p, sb_r));
+        if (str_p->a != a) TE("freeze copied the buffer");
+        if (o71_str_append(world_p, sb_r, "x", 1) != O71_BAD_RO_STRING_REF)
+            TE("appended to a read-only string");
+        TS(o71_str_intern(world_p, sb_r, &i_r));
+        if (i_r != sb_r || str_p->a != a) TE("intern copied the string");
+
+        /* a modifiable string with the same content interns to the first */
+        TS(o71_str_create(world_p, &dup_r, 0));
+        TS(o71_str_append(world_p, dup_r, a, str_p->n));
+        TS(o71_str_intern(world_p, dup_r, &i_r));
+        if (i_r != sb_r) TE("same content interned twice");
+        TS(o71_deref(world_p, dup_r));
+        TS(o71_str_create(world_p, &dup_r, 4));
+        TS(o71_str_append(world_p, dup_r, "sb-1", 4));
+        TS(o71_str_intern(world_p, dup_r, &i_r));
+        if (i_r != dup_r || o71_istr_check(world_p, dup_r))
+            TE("modifiable string not interned in place");
+        TS(o71_deref(world_p, dup_r));
+        TS(o71_deref(world_p, sb_r));
+    }
+    while (0);
+    printf("str_builder_test: %u\n", rc);
+    return rc;
+}
 
-        case O71_TT_LOGIC_OR_EXPR:
-            switch (lookup_p->type)
-            {
-            case O71_TT_PIPE_PIPE:
-                os = O71_TODO;
-                break;
-            case O71_TT_QUESTION:
-                os = O71_TODO;
-                break;
-            default:
-                src_p->type = O71_TT_COND_EXPR;
-                break;
-            }
-            break;
+/* str_slice_test ***********************************************************/
+static int str_slice_test (o71_world_t * world_p)
+{
+    o71_ref_t p_r, s1_r, s2_r, s3_r, i_r;
+    o71_string_t * p_p;
+    o71_string_t * s_p;
+    o71_status_t os;
+    int rc = 0;
+    size_t i;
 
-        case O71_TT_COND_EXPR:
-            src_p->type = O71_TT_EXPR;
-            break;
+    do
+    {
+        TS(o71_str_create(world_p, &p_r, 200));
+        for (i = 0; i < 200; ++i)
+            TS(o71_str_append_cp(world_p, p_r, 'a' + i % 26));
+        if (o71_str_slice(world_p, p_r, 0, 1, &s1_r) != O71_BAD_RO_STRING_REF)
+            TE("sliced modifiable string");
+        TS(o71_str_freeze(world_p, p_r));
+        p_p = o71_obj_ptr(world_p, p_r);
+        if (o71_str_slice(world_p, p_r, 150, 51, &s1_r) != O71_ARRAY_LIMIT
+            || o71_str_slice(world_p, p_r, 201, 0, &s1_r) != O71_ARRAY_LIMIT)
+            TE("slice outside the parent accepted");
+
+        /* short slices are copied right away */
+        TS(o71_str_slice(world_p, p_r, 3, 5, &s1_r));
+        s_p = o71_obj_ptr(world_p, s1_r);
+        if (s_p->slice || s_p->a != s_p->inl.sa || ORC(world_p, p_r) != 1
+            || !bytes_eq(s_p->a, (uint8_t const *) "defgh", 5))
+            TE("bad short slice");
+        TS(o71_deref(world_p, s1_r));
+
+        /* slices of slices share the buffer of the first parent */
+        TS(o71_str_slice(world_p, p_r, 10, 100, &s1_r));
+        TS(o71_str_slice(world_p, s1_r, 16, 20, &s2_r));
+        s_p = o71_obj_ptr(world_p, s2_r);
+        if (!s_p->slice || s_p->inl.parent_r != p_r || s_p->a != p_p->a + 26
+            || ORC(world_p, p_r) != 3 || ORC(world_p, s1_r) != 1)
+            TE("bad nested slice");
+        if (s_p->hash != str_hash(p_p->a + 26, 20)) TE("bad slice hash");
+
+        /* freezing keeps a large slice shared, copies a small one */
+        TS(o71_str_freeze(world_p, s1_r));
+        if (!((o71_string_t *) o71_obj_ptr(world_p, s1_r))->slice)
+            TE("large slice copied");
+        TS(o71_str_freeze(world_p, s2_r));
+        if (s_p->slice || s_p->a == p_p->a + 26 || ORC(world_p, p_r) != 2
+            || !bytes_eq(s_p->a, p_p->a + 26, 20))
+            TE("small slice not copied on freeze");
+
+        /* interning a small slice drops the parent */
+        TS(o71_str_slice(world_p, s1_r, 30, 40, &s3_r));
+        TS(o71_str_intern(world_p, s3_r, &i_r));
+        s_p = o71_obj_ptr(world_p, s3_r);
+        if (i_r != s3_r || s_p->mode != O71_SM_INTERN || s_p->slice
+            || ORC(world_p, p_r) != 2 || !bytes_eq(s_p->a, p_p->a + 40, 40))
+            TE("bad interned slice");
+        TS(o71_deref(world_p, s1_r));
+        TS(o71_deref(world_p, s2_r));
+        if (ORC(world_p, p_r) != 1) TE("slices still hold the parent");
+        TS(o71_deref(world_p, p_r));
+    }
+    while (0);
+    printf("str_slice_test: %u\n", rc);
+    return rc;
+}
 
-        default:
-            os = O71_TODO;
-            break;
-        }
-        if (os)
+/* ics_many_test ************************************************************/
+static int ics_many_test (o71_world_t * world_p)
+{
+    static char const * const name_a[] =
+    {
+        "get_x", "set_x", "get_y", "get_x", "add", "set_y", "get_y",
+    };
+    static char name_buf[300][8];
+    static char const * many_a[300];
+    o71_ref_t r_a[ITEM_COUNT(name_a)];
+    o71_ref_t many_ra[300];
+    o71_ref_t add_r, gx_r;
+    o71_status_t os;
+    size_t i, istr_m, istr_n;
+    int rc = 0;
+
+    do
+    {
+        istr_n = world_p->istr_n;
+        TS(o71_ics_many(world_p, name_a, ITEM_COUNT(name_a), r_a));
+        if (world_p->istr_n != istr_n + 4) TE("batch duplicates not merged");
+        if (r_a[0] != r_a[3] || r_a[2] != r_a[6] || r_a[0] == r_a[1])
+            TE("bad batch dedup");
+        TS(o71_ics(world_p, &add_r, "add"));
+        TS(o71_ics(world_p, &gx_r, "get_x"));
+        if (add_r != r_a[4] || gx_r != r_a[0])
+            TE("batch strings differ from o71_ics() ones");
+        for (i = 0; i < ITEM_COUNT(name_a); ++i)
+            if (!o71_str_eq(world_p, r_a[i], r_a[i]) || ORC(world_p, r_a[i])
+                != O71_IMMORTAL_REF_N)
+                TE("bad batch string %zu", i);
+
+        /* a large batch resizes the table once, to the size it needs */
+        for (i = 0; i < ITEM_COUNT(many_a); ++i)
         {
-            o71_status_t osf;
-            // free src_p if needed
-            M("failing match_expr with status %s", N(os));
-            osf = free_token(code_p, src_p, O71_TT__COMPLEX);
-            if (osf) return osf;
-            return os;
+            sprintf(name_buf[i], "m%zu", i);
+            many_a[i] = name_buf[i];
         }
+        istr_m = world_p->istr_m;
+        TS(o71_ics_many(world_p, many_a, ITEM_COUNT(many_a), many_ra));
+        if (world_p->istr_m > istr_m
+            && world_p->istr_m / 2 * 3 >= world_p->istr_n * 4)
+            TE("table grew more than needed: %zu", world_p->istr_m);
+        TS(o71_ics(world_p, &gx_r, "m299"));
+        if (gx_r != many_ra[299]) TE("large batch string not found");
     }
-    while (src_p->type < expr_type);
-    *expr_pp = src_p;
-    *src_pp = src_p->next;
-    P("matched expr: ");
-    dump_token_list(src_p, 8); P(".\n");
-
-    return O71_OK;
+    while (0);
+    printf("ics_many_test: %u\n", rc);
+    return rc;
 }
 
-/* match_stmt ***************************************************************/
-static o71_status_t match_stmt
-(
-    o71_code_t * code_p,
-    o71_token_t * * stmt_pp,
-    o71_token_t * src_p,
-    o71_token_t * * src_pp
-)
+/* builtin_str_test *********************************************************/
+static int builtin_str_test (o71_world_t * world_p)
 {
+    o71_ref_t str_r;
     o71_status_t os;
-    o71_token_t * expr_p;
+    size_t i;
+    int rc = 0;
 
-    P("match_stmt: "); dump_token_list(src_p, 8); P(".\n");
-    switch (src_p->type)
+    do
     {
-    case O71_TT_RETURN:
-    case O71_TT_BREAK:
-    case O71_TT_GOTO:
-    case O71_TT_IF:
-    case O71_TT_WHILE:
-    case O71_TT_DO:
-    case O71_TT_FOR:
-    case O71_TT_SWITCH:
-    case O71_TT_CASE:
-        return O71_TODO;
-    default:
-        os = match_expr(code_p, O71_TT_EXPR, &expr_p, src_p, &src_p);
-        if (os) { M("ouch: %s", N(os)); return os; }
-        switch (src_p->type)
+        for (i = 0; i < O71_BUILTIN_STR_N; ++i)
         {
-        case O71_TT_SEMICOLON:
-            *src_pp = src_p->next;
-            expr_p->base_type = expr_p->type;
-            expr_p->type = O71_TT_EXPR_STMT;
-            *stmt_pp = expr_p;
-            return O71_OK;
+            if (builtin_str_a[i].hash != str_hash(
+                    (uint8_t const *) builtin_str_a[i].a, builtin_str_a[i].n))
+                TE("stale hash for builtin string '%s'", builtin_str_a[i].a);
+            if (i && o71_str_cmp(world_p,
+                                 O71_MOX_TO_REF(O71X__STR_FIRST + i - 1),
+                                 O71_MOX_TO_REF(O71X__STR_FIRST + i))
+                     != O71_LESS)
+                TE("builtin string '%s' out of order", builtin_str_a[i].a);
+            TS(o71_ics(world_p, &str_r, builtin_str_a[i].a));
+            if (str_r != O71_MOX_TO_REF(O71X__STR_FIRST + i))
+                TE("builtin string '%s' not interned", builtin_str_a[i].a);
+        }
+    }
+    while (0);
+    printf("builtin_str_test: %u\n", rc);
+    return rc;
+}
 
-        case O71_TT_IDENTIFIER:
-            /* either function declaration, either variable declaration */
-            return O71_TODO;
+/* tokenize_test ************************************************************/
+static int tokenize_test (o71_world_t * world_p)
+{
+    static struct
+    {
+        char const * src;
+        int ce;
+        size_t ofs;
+    } const bad_a[] =
+    {
+        { "a\x01", O71_CE_PARSE_BAD_CONTROL_CHAR, 1 },
+        { "# ...........................................\xC3\x28",
+            O71_CE_PARSE_BAD_UTF8_CONTINUATION, 45 },
+        { "#\xC0\x80", O71_CE_PARSE_OVERLY_LONG_ENCODED_UTF8_CHAR, 1 },
+        { "#\xF4\x90\x80\x80", O71_CE_PARSE_BAD_UTF8_START_BYTE, 1 },
+        { "#\x80", O71_CE_PARSE_BAD_UTF8_START_BYTE, 1 },
+        { "x = \"\xED\xA0\x80\"", O71_CE_PARSE_SURROGATE_CODEPOINT, 5 },
+        { "x = \"\xE2\x82", O71_CE_PARSE_TRUNCATED_UTF8_CHAR, 5 },
+        { "x = \"a\tb\"", O71_CE_PARSE_BAD_CONTROL_CHAR, 6 },
+        { "x = \"ab\r\n\"", O71_CE_PARSE_UNFINISHED_STRING, 7 },
+        { "x = \xC3\xA9", O71_CE_PARSE_BAD_CHAR, 5 },
+        { "x = \xC3", O71_CE_PARSE_TRUNCATED_UTF8_CHAR, 4 },
+    };
+    static uint8_t const good[] =
+        "a_1 = 0x1F +  \"caf\xC3\xA9 \xF0\x9F\x98\x80\"; "
+        "# comment long enough for the wide kernels \xE2\x82\xAC...\r\n"
+        "b0 ;\n";
+    static unsigned int const good_type_a[] =
+    {
+        O71_TT_IDENTIFIER, O71_TT_EQUAL, O71_TT_INTEGER, O71_TT_PLUS,
+        O71_TT_STRING, O71_TT_SEMICOLON, O71_TT_IDENTIFIER,
+        O71_TT_SEMICOLON, O71_TT_END
+    };
+    static size_t (* const kernel_a[]) (uint8_t const * a, size_t n) =
+    {
+        ascii_span_scalar,
+#if O71_SIMD
+        ascii_span_sse2,
+        ascii_span_avx2,
+#endif
+    };
+    uint8_t buf[80];
+    o71_code_t code;
+    o71_token_t * token_p;
+    o71_status_t os, tos;
+    size_t i, n, k, kernel_n, x;
+    int rc = 0;
 
-        default:
-            code_p->ce_code = O71_CE_EXP_SEMICOLON_AFTER_EXPR;
-            code_p->ce_ofs = src_p->src_ofs;
-            code_p->ce_row = src_p->src_row;
-            code_p->ce_col = src_p->src_col;
-            return O71_COMPILE_ERROR;
-        }
+    kernel_n = ITEM_COUNT(kernel_a);
+#if O71_SIMD
+    if (!cpu_has_avx2()) kernel_n -= 1;
+#endif
+    for (i = 0; i < sizeof(buf); ++i) buf[i] = (uint8_t) (0x20 + i);
+    for (k = 0; k < kernel_n && !rc; ++k)
+        for (n = 0; n <= sizeof(buf) && !rc; ++n)
+            for (i = 0; i <= n && !rc; ++i)
+            {
+                /* i == n: the whole buffer is printable */
+                if (i < n) buf[i] = (uint8_t) (i & 1 ? 0x80 + i : 0x1F);
+                x = kernel_a[k](buf, n);
+                if (i < n) buf[i] = (uint8_t) (0x20 + i);
+                if (x != i)
+                    TE("kernel %zu: span %zu instead of %zu for n=%zu",
+                       k, x, i, n);
+            }
+    if (rc) return rc;
+
+    for (i = 0; i < ITEM_COUNT(bad_a) && !rc; ++i)
+    {
+        code.allocator_p = world_p->allocator_p;
+        code.src_a = (uint8_t const *) bad_a[i].src;
+        for (n = 0; bad_a[i].src[n]; ++n);
+        code.src_n = n;
+        code.token_list = NULL;
+        code.token_tail = &code.token_list;
+        arena_init(&code.arena, world_p->allocator_p);
+        tos = tokenize_source(&code);
+        TS(o71_code_free(&code));
+        if (tos != O71_COMPILE_ERROR || (int) code.ce_code != bad_a[i].ce
+            || code.ce_ofs != bad_a[i].ofs)
+            TE("bad source %zu: os=%s ce=%u ofs=%zu", i, N(tos),
+               code.ce_code, code.ce_ofs);
+    }
+    if (rc) return rc;
+
+    do
+    {
+        code.allocator_p = world_p->allocator_p;
+        code.src_a = good;
+        code.src_n = sizeof(good) - 1;
+        code.token_list = NULL;
+        code.token_tail = &code.token_list;
+        arena_init(&code.arena, world_p->allocator_p);
+        TS(tokenize_source(&code));
+        for (i = 0, token_p = code.token_list;
+             i < ITEM_COUNT(good_type_a) && token_p;
+             ++i, token_p = token_p->next)
+            if (token_p->type != good_type_a[i])
+                TE("token %zu: type %u instead of %u",
+                   i, token_p->type, good_type_a[i]);
+        if (rc) break;
+        if (i != ITEM_COUNT(good_type_a) || token_p)
+            TE("bad token count");
+        token_p = code.token_list->next->next;
+        if (((o71_int_token_t *) token_p)->val != 0x1F) TE("bad int");
+        token_p = token_p->next->next;
+        if (((o71_str_token_t *) token_p)->n != 11
+            || !bytes_eq(((o71_str_token_t *) token_p)->a,
+                         (uint8_t const *) "caf\xC3\xA9 \xF0\x9F\x98\x80", 11)
+            || token_p->src_col != 15)
+            TE("bad string token");
+        token_p = token_p->next->next;
+        if (token_p->src_row != 2 || token_p->src_col != 1
+            || token_p->src_len != 2)
+            TE("bad token after comment: %u:%u",
+               token_p->src_row, token_p->src_col);
     }
+    while (0);
+    if (o71_code_free(&code) && !rc) rc = ERR_RUN;
+    printf("tokenize_test: %u\n", rc);
+    return rc;
 }
 
-/* match_stmt_seq ***********************************************************/
-static o71_status_t match_stmt_seq
+/* kvbag_btree_check ********************************************************/
+/**
+ *  Checks B-tree invariants: node fill, same depth for all leaves and
+ *  increasing small int keys.
+ *  @returns number of items in the subtree or -1 on broken invariants
+ */
+static long kvbag_btree_check
 (
-    o71_code_t * code_p,
-    o71_block_stmt_token_t * block_stmt_p,
-    o71_token_t * src_p,
-    o71_token_t * * src_pp,
-    o71_token_type_t end_type
+    o71_kvbtnode_t * node_p,
+    unsigned int depth,
+    unsigned int * leaf_depth_p,
+    long * last_key_p
 )
 {
-    o71_status_t os;
-    o71_token_t * stmt_p;
-
-    P("match_stmt_seq: "); dump_token_list(src_p, 8); P(".\n");
+    long n, cn;
+    unsigned int i;
 
-    while (src_p->type != end_type)
+    if (node_p->n > O71_BTREE_KV_MAX
+        || (depth && node_p->n < O71_BTREE_KV_MIN)) return -1;
+    if (node_p->leaf)
     {
-        os = match_stmt(code_p, &stmt_p, src_p, &src_p);
-        if (os) return os;
-        *block_stmt_p->stmt_tail_pp = stmt_p;
-        block_stmt_p->stmt_tail_pp = &stmt_p->next;
+        if (*leaf_depth_p == UINT_MAX) *leaf_depth_p = depth;
+        else if (*leaf_depth_p != depth) return -1;
     }
-    *src_pp = src_p;
-    return O71_OK;
+    for (i = 0, n = node_p->n; i <= node_p->n; ++i)
+    {
+        if (!node_p->leaf)
+        {
+            cn = kvbag_btree_check(node_p->child_a[i], depth + 1,
+                                   leaf_depth_p, last_key_p);
+            if (cn < 0) return -1;
+            n += cn;
+        }
+        if (i == node_p->n) break;
+        if ((long) O71_REF_TO_SINT(node_p->kv_a[i].key_r) <= *last_key_p)
+            return -1;
+        *last_key_p = (long) O71_REF_TO_SINT(node_p->kv_a[i].key_r);
+    }
+    return n;
+}
+
+/* kvbag_rbtree_check *******************************************************/
+/**
+ *  Checks red/black tree invariants: no red node with a red child, same
+ *  number of black nodes on all paths and increasing small int keys.
+ *  @returns number of items in the subtree or -1 on broken invariants
+ */
+static long kvbag_rbtree_check
+(
+    o71_kvnode_t * node_p,
+    unsigned int black_n,
+    unsigned int * leaf_black_n_p,
+    long * last_key_p
+)
+{
+    long n, cn;
+    if (!node_p)
+    {
+        if (*leaf_black_n_p == UINT_MAX) *leaf_black_n_p = black_n;
+        return *leaf_black_n_p == black_n ? 0 : -1;
+    }
+    if (IS_RED(node_p)
+        && (IS_RED(GET_CHILD(node_p, 0)) || IS_RED(GET_CHILD(node_p, 1))))
+        return -1;
+    black_n += !IS_RED(node_p);
+    n = kvbag_rbtree_check(GET_CHILD(node_p, 0), black_n, leaf_black_n_p,
+                           last_key_p);
+    if (n < 0) return -1;
+    if ((long) O71_REF_TO_SINT(node_p->kv.key_r) <= *last_key_p) return -1;
+    *last_key_p = (long) O71_REF_TO_SINT(node_p->kv.key_r);
+    cn = kvbag_rbtree_check(GET_CHILD(node_p, 1), black_n, leaf_black_n_p,
+                            last_key_p);
+    return cn < 0 ? -1 : n + 1 + cn;
 }
 
-/* O71_MAIN *****************************************************************/
-#if O71_MAIN
-#include <string.h>
-#include <stdio.h>
-#include <stdlib.h>
+/* kvbag_hash_check *********************************************************/
+/**
+ *  Checks that each run of used slots is ordered by home slot and that the
+ *  item count is right.
+ *  @returns number of items or -1 on broken invariants
+ */
+static long kvbag_hash_check
+(
+    o71_kvhash_t * hash_p
+)
+{
+    size_t mask = hash_p->mask;
+    size_t x, y, d, n;
+    o71_ref_t k, pk;
 
-#define ERR_NONE 0
-#define ERR_RUN 1
-#define ERR_RES 2
-#define ERR_INVOKE 3
-#define ERR_BUG 4
+    for (x = 0, n = 0; x <= mask; ++x)
+    {
+        pk = k = hash_p->kv_a[x].key_r;
+        d = 0;
+        if (k != O71_KVHASH_FREE_KEY)
+        {
+            ++n;
+            d = ((x - KVHASH_HOME(k, mask)) & mask) + 1;
+        }
+        y = (x + 1) & mask;
+        k = hash_p->kv_a[y].key_r;
+        if (k == O71_KVHASH_FREE_KEY) continue;
+        if (((y - KVHASH_HOME(k, mask)) & mask) > d) return -1;
+        /* same home: keys ascending */
+        if (d && ((y - KVHASH_HOME(k, mask)) & mask) == d && k < pk)
+            return -1;
+    }
+    return n == hash_p->n ? (long) n : -1;
+}
 
-/* mem_realloc **************************************************************/
-static o71_status_t mem_realloc
+/* kvbag_count_checked ******************************************************/
+/**
+ *  Returns the number of items in a large mode bag after checking its
+ *  invariants, or -1 if they are broken.
+ */
+static long kvbag_count_checked
 (
-    void * * data_pp,
-    size_t old_size,
-    size_t new_size,
-    void * realloc_context
+    o71_kvbag_t * kvbag_p
 )
 {
-    void * new_data;
-    if (old_size == 0)
+    unsigned int leaf_depth = UINT_MAX;
+    long last_key = -1;
+    if (kvbag_p->mode == O71_BAG_HASH) return kvbag_hash_check(kvbag_p->hash_p);
+    if (kvbag_p->mode == O71_BAG_BTREE)
+        return kvbag_btree_check(kvbag_p->btree_p, 0, &leaf_depth, &last_key);
+    if (kvbag_p->mode == O71_BAG_RBTREE)
     {
-        if (new_size == 0) { *data_pp = NULL; return O71_OK; }
-        *data_pp = malloc(new_size);
-        return *data_pp ? O71_OK : O71_NO_MEM;
+        if (IS_RED(kvbag_p->tree_p)) return -1;
+        return kvbag_rbtree_check(kvbag_p->tree_p, 0, &leaf_depth, &last_key);
     }
-    if (new_size == 0)
+    return -2; // not checked
+}
+
+/* kvbag_bulk_test **********************************************************/
+static int kvbag_bulk_test (o71_world_t * world_p)
+{
+    static uint8_t const mode_a[] = { O71_BAG_LARGE_MODE, O71_BAG_HASH };
+    static size_t const n_a[] =
+        { 0, 1, 7, 15, 16, 17, 100, 255, 256, 257, 1000, 4095, 4096, 5000 };
+    enum { KV_N = 0x2000, NEW_VALUE = 0x4000, ODD_VALUE = 0x8000 };
+    o71_kv_t * kv_a = NULL;
+    o71_kvbag_t bag;
+    o71_ref_t value_r;
+    o71_status_t os;
+    size_t kv_m = 0, mx, nx, n, i, k;
+    long cn;
+    int rc = 0;
+
+    os = redim(world_p->allocator_p, (void * *) &kv_a, &kv_m, KV_N,
+               sizeof(o71_kv_t));
+    if (os)
     {
-        free(*data_pp);
-        return O71_OK;
+        fprintf(stderr, "test error: alloc failed: %s\n", N(os));
+        return ERR_RUN;
     }
-    new_data = realloc(*data_pp, new_size);
-    if (!new_data) return O71_NO_MEM;
-    *data_pp = new_data;
-    return O71_OK;
+    for (mx = 0; mx < ITEM_COUNT(mode_a) && !rc; ++mx)
+        for (nx = 0; nx < ITEM_COUNT(n_a) && !rc; ++nx)
+        {
+            n = n_a[nx];
+            /* load even keys */
+            for (i = 0; i < n; ++i)
+            {
+                kv_a[i].key_r = O71_SINT_TO_REF(i * 2);
+                kv_a[i].value_r = O71_SINT_TO_REF(i);
+            }
+            kvbag_init(&bag, 0x10, mode_a[mx]);
+            do
+            {
+                TS(o71_kvbag_load(world_p, &bag, kv_a, n, NULL, NULL));
+                cn = kvbag_count_checked(&bag);
+                if (bag.mode == O71_BAG_ARRAY ? bag.n != n : cn != (long) n)
+                    TE("mode %u: loaded %u items, counted %ld",
+                       bag.mode, (int) n, cn);
+                /* merge the odd keys below n * 2 and new values for every
+                 * 4th even key */
+                for (i = k = 0; i < n; ++i)
+                {
+                    if ((i & 3) == 0)
+                    {
+                        kv_a[k].key_r = O71_SINT_TO_REF(i * 2);
+                        kv_a[k++].value_r = O71_SINT_TO_REF(i + NEW_VALUE);
+                    }
+                    kv_a[k].key_r = O71_SINT_TO_REF(i * 2 + 1);
+                    kv_a[k++].value_r = O71_SINT_TO_REF(i + ODD_VALUE);
+                }
+                TS(o71_kvbag_merge(world_p, &bag, kv_a, k, NULL, NULL));
+                cn = kvbag_count_checked(&bag);
+                if (bag.mode != O71_BAG_ARRAY && cn != (long) (n * 2))
+                    TE("mode %u: %u items after merge, counted %ld",
+                       bag.mode, (int) (n * 2), cn);
+                for (i = 0; i < n * 2 && !rc; ++i)
+                {
+                    k = i / 2;
+                    TS(kvbag_get(world_p, &bag, O71_SINT_TO_REF(i), ref_cmp,
+                                 NULL, &value_r));
+                    if (i & 1) k += ODD_VALUE;
+                    else if ((k & 3) == 0) k += NEW_VALUE;
+                    if (value_r != O71_SINT_TO_REF(k))
+                        TE("n=%u: bad value for %u", (int) n, (int) i);
+                }
+                if (rc) break;
+                /* a small batch on a big bag is put item by item */
+                kv_a[0].key_r = O71_SINT_TO_REF(n * 2 + 1);
+                kv_a[0].value_r = O71_SINT_TO_REF(7);
+                TS(o71_kvbag_merge(world_p, &bag, kv_a, 1, NULL, NULL));
+                TS(kvbag_get(world_p, &bag, O71_SINT_TO_REF(n * 2 + 1),
+                             ref_cmp, NULL, &value_r));
+                if (value_r != O71_SINT_TO_REF(7))
+                    TE("n=%u: bad value after small merge", (int) n);
+            }
+            while (0);
+            os = kvbag_free(world_p, &bag, kv_nop_free);
+            if (rc) break;
+            TS(os);
+        }
+    os = redim(world_p->allocator_p, (void * *) &kv_a, &kv_m, 0,
+               sizeof(o71_kv_t));
+    if (os && !rc) rc = ERR_RUN;
+    printf("kvbag_bulk_test: %u\n", rc);
+    return rc;
 }
 
-/* help *********************************************************************/
-static void help ()
+/* kvbag_cursor_test ********************************************************/
+static int kvbag_cursor_test (o71_world_t * world_p)
 {
-    printf("ostropel scripting tool - ver 0.00 - by Costin Ionescu\n"
-           "usage: o71 [OPTIONS] SCRIPT ARGS\n"
-           "options:\n"
-           "  -h --help     help\n"
-           "  -t --test     run self tests\n");
-}
+    static uint8_t const mode_a[] = { O71_BAG_LARGE_MODE, O71_BAG_HASH };
+    static size_t const n_a[] = { 0, 1, 4, 5, 16, 17, 300 };
+    enum { KEY_N = 300 };
+    uint8_t seen_a[KEY_N * 2];
+    o71_ref_t order_a[KEY_N];
+    o71_kvbag_cursor_t cursor;
+    o71_kvbag_t bag;
+    o71_kvbag_loc_t loc;
+    o71_kv_t kv;
+    o71_status_t os;
+    size_t mx, nx, n, i, k, item_n;
+    long last;
+    int rc = 0;
 
-#define TE(...) { \
-    fprintf(stderr, "test error (line %u): ", __LINE__); \
-    fprintf(stderr, __VA_ARGS__); fprintf(stderr, "\n"); \
-    rc = ERR_RUN; \
-    break; }
+    for (mx = 0; mx < ITEM_COUNT(mode_a) && !rc; ++mx)
+        for (nx = 0; nx < ITEM_COUNT(n_a) && !rc; ++nx)
+        {
+            n = n_a[nx];
+            kvbag_init(&bag, 4, mode_a[mx]);
+            do
+            {
+                /* even keys, put out of order */
+                for (i = 0; i < n; ++i)
+                {
+                    k = (i * 7) % n;
+                    TS(kvbag_put(world_p, &bag, O71_SINT_TO_REF(k * 2),
+                                 O71_SINT_TO_REF(k), ref_cmp, NULL));
+                }
+                if (rc) break;
+                memset(seen_a, 0, sizeof(seen_a));
+                last = -1;
+                o71_kvbag_cursor_init(&cursor);
+                for (i = 0; (os = o71_kvbag_cursor_next(world_p, &bag, &cursor,
+                                                         NULL, NULL, &kv))
+                     == O71_OK; ++i)
+                {
+                    k = (size_t) O71_REF_TO_SINT(kv.key_r);
+                    if (k >= n * 2 || (k & 1) || seen_a[k]
+                        || kv.value_r != O71_SINT_TO_REF(k / 2))
+                        TE("mode %u: bad item %u", bag.mode, (int) k);
+                    seen_a[k] = 1;
+                    order_a[i] = kv.key_r;
+                    if (bag.mode != O71_BAG_HASH && (long) k <= last)
+                        TE("key %u out of order", (int) k);
+                    last = (long) k;
+                }
+                if (rc) break;
+                if (os != O71_MISSING || i != n)
+                    TE("mode %u: iterated %u of %u items (%s)",
+                       bag.mode, (int) i, (int) n, N(os));
+                if (n < 2) break;
+
+                /* resume after a key in the bag and after a missing one */
+                TS(o71_kvbag_cursor_seek(world_p, &bag, &cursor, order_a[0],
+                                         ref_cmp, NULL));
+                TS(o71_kvbag_cursor_next(world_p, &bag, &cursor, ref_cmp, NULL,
+                                         &kv));
+                if (kv.key_r != order_a[1]) TE("bad key after seek");
+                TS(o71_kvbag_cursor_seek(world_p, &bag, &cursor,
+                                         O71_SINT_TO_REF(3), ref_cmp, NULL));
+                TS(o71_kvbag_cursor_next(world_p, &bag, &cursor, ref_cmp, NULL,
+                                         &kv));
+                if (bag.mode != O71_BAG_HASH && kv.key_r != O71_SINT_TO_REF(4))
+                    TE("bad key after seek 3");
+
+                /* change the bag in the middle of the iteration: delete the
+                 * last key returned and add the odd keys, which switches
+                 * small ordered bags from array to tree mode; hash tables
+                 * only get the odd keys that fit without growing */
+                memset(seen_a, 0, sizeof(seen_a));
+                o71_kvbag_cursor_init(&cursor);
+                for (i = 0; i < 2 && !rc; ++i)
+                {
+                    TS(o71_kvbag_cursor_next(world_p, &bag, &cursor, NULL,
+                                             NULL, &kv));
+                    seen_a[O71_REF_TO_SINT(kv.key_r)] = 1;
+                }
+                if (rc) break;
+                TS(kvbag_search(world_p, &bag, kv.key_r, ref_cmp, NULL, &loc));
+                TS(kvbag_delete(world_p, &bag, &loc));
+                for (i = 0, item_n = n - 1; i < n; ++i, ++item_n)
+                {
+                    if (bag.large_mode == O71_BAG_HASH
+                        && (bag.mode != O71_BAG_HASH
+                            || !KVHASH_FITS(bag.hash_p->n + 1,
+                                            bag.hash_p->mask + 1))) break;
+                    TS(kvbag_put(world_p, &bag, O71_SINT_TO_REF(i * 2 + 1),
+                                 O71_SINT_TO_REF(i), ref_cmp, NULL));
+                }
+                if (rc) break;
+                if (bag.large_mode != O71_BAG_HASH
+                    && bag.mode == O71_BAG_ARRAY)
+                    TE("bag still in array mode");
+                for (k = 3; (os = o71_kvbag_cursor_next(world_p, &bag, &cursor,
+                                                         NULL, NULL, &kv))
+                     == O71_OK; ++k)
+                {
+                    i = (size_t) O71_REF_TO_SINT(kv.key_r);
+                    if (seen_a[i]) TE("key %u returned again", (int) i);
+                    seen_a[i] = 1;
+                    if (bag.large_mode != O71_BAG_HASH && i != k)
+                        TE("expecting key %u after changes", (int) k);
+                }
+                if (rc) break;
+                if (os != O71_MISSING) TE("iteration failed: %s", N(os));
+                for (i = 0; i < n; ++i)
+                    if (!seen_a[i * 2]) TE("key %u skipped", (int) i * 2);
+                if (rc) break;
+
+                /* delete each item as it is returned */
+                o71_kvbag_cursor_init(&cursor);
+                for (i = 0, last = -1;
+                     (os = o71_kvbag_cursor_next(world_p, &bag, &cursor,
+                                                 NULL, NULL, &kv)) == O71_OK;
+                     ++i)
+                {
+                    k = (size_t) O71_REF_TO_SINT(kv.key_r);
+                    if (bag.mode != O71_BAG_HASH && (long) k <= last)
+                        TE("key %u out of order", (int) k);
+                    last = (long) k;
+                    TS(kvbag_search(world_p, &bag, kv.key_r, ref_cmp, NULL,
+                                    &loc));
+                    TS(kvbag_delete(world_p, &bag, &loc));
+                }
+                if (rc) break;
+                if (os != O71_MISSING || i != item_n)
+                    TE("deleted %u of %u items", (int) i, (int) item_n);
+            }
+            while (0);
+            os = kvbag_free(world_p, &bag, kv_nop_free);
+            if (rc) break;
+            TS(os);
+        }
 
-#define TS(_expr) \
-    if (!(os = (_expr))) ; \
-    else TE("expr (%s) failed with status %s", #_expr, N(os))
+    /* keys sharing the last home slot of a 4 slot table wrap around its
+     * end; they come in key order after the other slots */
+    kvbag_init(&bag, 1, O71_BAG_HASH);
+    do
+    {
+        if (rc) break;
+        for (i = k = 0; k < 3 && !rc; ++i)
+        {
+            if (KVHASH_HOME(O71_SINT_TO_REF(i), 3) != 3) continue;
+            TS(kvbag_put(world_p, &bag, O71_SINT_TO_REF(i),
+                         O71_SINT_TO_REF(k), ref_cmp, NULL));
+            order_a[k++] = O71_SINT_TO_REF(i);
+        }
+        if (rc) break;
+        if (bag.mode != O71_BAG_HASH || bag.hash_p->mask != 3
+            || bag.hash_p->kv_a[1].key_r != order_a[2])
+            TE("keys did not wrap around the table end");
+        /* deleting each returned item pulls the next one back across the
+         * end of the table */
+        o71_kvbag_cursor_init(&cursor);
+        for (i = 0; (os = o71_kvbag_cursor_next(world_p, &bag, &cursor, NULL,
+                                                 NULL, &kv)) == O71_OK; ++i)
+        {
+            if (i >= 3 || kv.key_r != order_a[i])
+                TE("bad item %u in wrapped run", (int) i);
+            TS(kvbag_search(world_p, &bag, kv.key_r, ref_cmp, NULL, &loc));
+            TS(kvbag_delete(world_p, &bag, &loc));
+        }
+        if (rc) break;
+        if (os != O71_MISSING || i != 3)
+            TE("iterated %u of 3 wrapped items (%s)", (int) i, N(os));
+    }
+    while (0);
+    os = kvbag_free(world_p, &bag, kv_nop_free);
+    if (!rc && os) rc = ERR_RUN;
 
-#define ORC(_w, _r) (((o71_mem_obj_t *) o71_obj_ptr(_w, _r))->ref_n)
+    /* a cursor kept across 0x10000 changes of the bag, or across freeing
+     * the bag and filling it again with as many items as before, must not
+     * use its old tree path: the nodes on it were freed */
+    for (mx = 0; mx < 2 && !rc; ++mx)
+    {
+        kvbag_init(&bag, 4, O71_BAG_LARGE_MODE);
+        do
+        {
+            for (i = 0; i < 200; ++i)
+                TS(kvbag_put(world_p, &bag, O71_SINT_TO_REF(i * 2),
+                             O71_SINT_TO_REF(i), ref_cmp, NULL));
+            if (rc) break;
+            o71_kvbag_cursor_init(&cursor);
+            TS(o71_kvbag_cursor_next(world_p, &bag, &cursor, NULL, NULL, &kv));
+            if (mx)
+            {
+                TS(kvbag_free(world_p, &bag, kv_nop_free));
+                kvbag_init(&bag, 4, O71_BAG_LARGE_MODE);
+            }
+            else
+                for (i = 0; i < 200; ++i)
+                {
+                    TS(kvbag_search(world_p, &bag, O71_SINT_TO_REF(i * 2),
+                                    ref_cmp, NULL, &loc));
+                    TS(kvbag_delete(world_p, &bag, &loc));
+                }
+            if (rc) break;
+            for (i = 0; i < 200; ++i)
+                TS(kvbag_put(world_p, &bag, O71_SINT_TO_REF(i * 2 + 1),
+                             O71_SINT_TO_REF(i), ref_cmp, NULL));
+            if (rc) break;
+            /* pad to 0x10000 changes with deletes and puts of one key */
+            for (k = mx ? 0x10000 : 400; k < 0x10000 && !rc; k += 2)
+            {
+                TS(kvbag_search(world_p, &bag, O71_SINT_TO_REF(399), ref_cmp,
+                                NULL, &loc));
+                TS(kvbag_delete(world_p, &bag, &loc));
+                TS(kvbag_put(world_p, &bag, O71_SINT_TO_REF(399),
+                             O71_SINT_TO_REF(199), ref_cmp, NULL));
+            }
+            if (rc) break;
+            TS(o71_kvbag_cursor_next(world_p, &bag, &cursor, NULL, NULL, &kv));
+            if (kv.key_r != O71_SINT_TO_REF(1))
+                TE("stale cursor path used after %s",
+                   mx ? "reinit" : "0x10000 changes");
+        }
+        while (0);
+        os = kvbag_free(world_p, &bag, kv_nop_free);
+        if (rc) break;
+        TS(os);
+    }
+    printf("kvbag_cursor_test: %u\n", rc);
+    return rc;
+}
 
-/* reg_obj_field_test *******************************************************/
-static int reg_obj_field_test (o71_world_t * world_p)
+/* kvbag_test ***************************************************************/
+static int kvbag_test (o71_world_t * world_p)
 {
-    o71_ref_t aa_isr, bb_isr, cc_isr;
-    o71_ref_t sf_r, obj_r;
-    o71_ref_t ra[4];
-    o71_script_function_t * sf_p;
-    o71_ref_t class_r;
-    uint32_t * arg_vxa;
+    static uint8_t const mode_a[] = { O71_BAG_LARGE_MODE, O71_BAG_HASH };
+    static char name_a[0x28][4]; // o71_ics() keeps pointers to these
+    o71_kvbag_t bag;
+    o71_kvbag_loc_t loc;
+    o71_ref_t name_ra[ITEM_COUNT(name_a)];
+    o71_ref_t class_r, obj_r, value_r;
     o71_status_t os;
+    unsigned int i, k, mx;
+    long n;
     int rc = 0;
-    do
+    enum { KEY_N = 0x800 };
+
+    // keys are visited in the order (i * 7919) % KEY_N
+    for (mx = 0; mx < ITEM_COUNT(mode_a) && !rc; ++mx)
     {
-        TS(o71_ics(world_p, &aa_isr, "aa"));
-        TS(o71_ics(world_p, &bb_isr, "bb"));
-        TS(o71_ics(world_p, &cc_isr, "cc"));
-        ra[0] = cc_isr;
-        ra[1] = aa_isr;
-        TS(o71_reg_class_create(world_p, ra, 2, &class_r));
-        TS(o71_sfunc_create(world_p, &sf_r, 1));
-        sf_p = o71_obj_ptr(world_p, sf_r);
-        TS(o71_sfunc_append_init(world_p, sf_p, 2, aa_isr));
-        TS(o71_sfunc_append_init(world_p, sf_p, 1, O71_SINT_TO_REF(1)));
-        TS(o71_sfunc_append_set_field(world_p, sf_p, 1, 0, 2));
-        TS(o71_sfunc_append_init(world_p, sf_p, 2, bb_isr));
-        TS(o71_sfunc_append_init(world_p, sf_p, 1, O71_SINT_TO_REF(2)));
-        TS(o71_sfunc_append_set_field(world_p, sf_p, 1, 0, 2));
-        TS(o71_sfunc_append_init(world_p, sf_p, 2, cc_isr));
-        TS(o71_sfunc_append_init(world_p, sf_p, 1, O71_SINT_TO_REF(3)));
-        TS(o71_sfunc_append_set_field(world_p, sf_p, 1, 0, 2));
-        TS(o71_sfunc_append_init(world_p, sf_p, 2, aa_isr));
-        TS(o71_sfunc_append_get_field(world_p, sf_p, 3, 0, 2));
-        TS(o71_sfunc_append_init(world_p, sf_p, 2, bb_isr));
-        TS(o71_sfunc_append_get_field(world_p, sf_p, 4, 0, 2));
-        TS(o71_sfunc_append_init(world_p, sf_p, 2, cc_isr));
-        TS(o71_sfunc_append_get_field(world_p, sf_p, 5, 0, 2));
-        TS(o71_sfunc_append_init(world_p, sf_p, 6, O71R_INT_ADD_FUNC));
-        TS(o71_sfunc_append_call(world_p, sf_p, 1, 6, 2, &arg_vxa));
-        arg_vxa[0] = 3;
-        arg_vxa[1] = 4;
-        TS(o71_sfunc_append_call(world_p, sf_p, 1, 6, 2, &arg_vxa));
-        arg_vxa[0] = 1;
-        arg_vxa[1] = 5;
-        TS(o71_sfunc_append_ret(world_p, sf_p, 1));
+        kvbag_init(&bag, 4, mode_a[mx]);
+        do
+        {
+            for (i = 0; i < KEY_N; ++i)
+            {
+                k = (i * 7919) % KEY_N;
+                TS(kvbag_put(world_p, &bag, O71_SINT_TO_REF(k),
+                             O71_SINT_TO_REF(k * 3), ref_cmp, NULL));
+                TS(kvbag_get(world_p, &bag, O71_SINT_TO_REF(k), ref_cmp, NULL,
+                             &value_r));
+                if (value_r != O71_SINT_TO_REF(k * 3))
+                    TE("key %u: bad value from get", k);
+            }
+            if (rc) break;
+            if (bag.mode != mode_a[mx])
+                TE("bag did not switch from array (mode %u)", bag.mode);
+            n = kvbag_count_checked(&bag);
+            if (n == -2) break;
+            if (n != KEY_N) TE("mode %u: broken bag after inserts", bag.mode);
+            TS(kvbag_put(world_p, &bag, O71_SINT_TO_REF(5),
+                         O71_SINT_TO_REF(55), ref_cmp, NULL));
+            for (k = 0; k < KEY_N; ++k)
+            {
+                os = kvbag_search(world_p, &bag, O71_SINT_TO_REF(k), ref_cmp,
+                                  NULL, &loc);
+                if (os) TE("key %u: search failed: %s", k, N(os));
+                if (kvbag_get_loc_value(world_p, &bag, &loc)
+                    != O71_SINT_TO_REF(k == 5 ? 55 : k * 3))
+                    TE("key %u: bad value", k);
+            }
+            if (rc) break;
+            os = kvbag_search(world_p, &bag, O71_SINT_TO_REF(KEY_N), ref_cmp,
+                              NULL, &loc);
+            if (os != O71_MISSING) TE("found key past the end: %s", N(os));
 
-        TS(o71_reg_obj_create(world_p, class_r, &ra[0]));
-        M("dyn obj to test: obref_%lX", (long) ra[0]);
-        os = o71_prep_call(&world_p->root_flow, sf_r, ra, 1);
-        if (os != O71_PENDING) TE("prep_call failed: %s", N(os));
-        TS(o71_run(&world_p->root_flow, 0, O71_STEPS_MAX));
-        if (world_p->root_flow.value_r != O71_SINT_TO_REF(1 + 2 + 3))
-            TE("got obref_%lX, expecting obref_%lX",
-               (long) world_p->root_flow.value_r,
-               (long) O71_SINT_TO_REF(1 + 2 + 3));
+            // delete every other key in insertion order, then the rest
+            for (i = 0; i < KEY_N * 2; i += 2)
+            {
+                k = ((i % KEY_N + i / KEY_N) * 7919) % KEY_N;
+                os = kvbag_search(world_p, &bag, O71_SINT_TO_REF(k), ref_cmp,
+                                  NULL, &loc);
+                if (os) TE("key %u: search before delete failed: %s",
+                           k, N(os));
+                TS(kvbag_delete(world_p, &bag, &loc));
+                if (kvbag_count_checked(&bag) != (long) (KEY_N - 1 - i / 2))
+                    TE("mode %u: broken bag after deleting key %u",
+                       bag.mode, k);
+                if (i + 2 == KEY_N)
+                {
+                    for (k = 0; k < KEY_N; ++k)
+                    {
+                        os = kvbag_search(world_p, &bag, O71_SINT_TO_REF(k),
+                                          ref_cmp, NULL, &loc);
+                        if (os != ((k & 1) ? O71_OK : O71_MISSING))
+                            TE("key %u: unexpected search result %s",
+                               k, N(os));
+                        os = kvbag_get(world_p, &bag, O71_SINT_TO_REF(k),
+                                       ref_cmp, NULL, &value_r);
+                        if (os != ((k & 1) ? O71_OK : O71_MISSING))
+                            TE("key %u: unexpected get result %s", k, N(os));
+                    }
+                    if (rc) break;
+                }
+            }
+            if (rc) break;
+            if (bag.mode == O71_BAG_BTREE
+                && (!bag.btree_p->leaf || bag.btree_p->n))
+                TE("tree not empty after deleting everything");
+        }
+        while (0);
+        os = kvbag_free(world_p, &bag, kv_nop_free);
+        if (os && !rc)
+        {
+            fprintf(stderr, "test error: kvbag free failed: %s\n", N(os));
+            rc = ERR_RUN;
+        }
     }
-    while (0);
-    printf("reg_obj_field_test: %u\n", rc);
+
+    // dynamic fields of a reg obj go in a hash bag past the array limit
+    while (!rc)
+    {
+        for (i = 0; i < ITEM_COUNT(name_ra); ++i)
+        {
+            sprintf(name_a[i], "f%u", i);
+            TS(o71_ics(world_p, &name_ra[i], name_a[i]));
+        }
+        if (rc) break;
+        TS(o71_reg_class_create(world_p, NULL, 0, &class_r));
+        TS(o71_reg_obj_create(world_p, class_r, &obj_r));
+        for (i = 0; i < ITEM_COUNT(name_ra); ++i)
+            TS(o71_reg_obj_set_field(world_p, obj_r, name_ra[i],
+                                     O71_SINT_TO_REF(i)));
+        if (rc) break;
+        if (((o71_reg_obj_t *) o71_obj_ptr(world_p, obj_r))->dyn_field_bag.mode
+            != O71_BAG_HASH) TE("dyn field bag not in hash mode");
+        for (i = 0; i < ITEM_COUNT(name_ra); ++i)
+        {
+            TS(o71_reg_obj_get_field(world_p, obj_r, name_ra[i], &value_r));
+            if (value_r != O71_SINT_TO_REF(i)) TE("bad value for field %u", i);
+        }
+        if (rc) break;
+        TS(o71_deref(world_p, obj_r));
+        TS(o71_deref(world_p, class_r));
+
+        // string keyed bag: goes through the generic comparator paths
+        kvbag_init(&bag, 4, O71_BAG_LARGE_MODE);
+        for (i = 0; i < ITEM_COUNT(name_ra); ++i)
+            TS(kvbag_put(world_p, &bag, name_ra[i], O71_SINT_TO_REF(i),
+                         str_intern_cmp, NULL));
+        for (i = 0; i < ITEM_COUNT(name_ra) && !rc; ++i)
+        {
+            TS(kvbag_search(world_p, &bag, name_ra[i], str_intern_cmp, NULL,
+                            &loc));
+            value_r = kvbag_get_loc_value(world_p, &bag, &loc);
+            if (value_r != O71_SINT_TO_REF(i))
+                TE("string bag: bad value for key %u", i);
+            TS(kvbag_get(world_p, &bag, name_ra[i], str_intern_cmp, NULL,
+                         &value_r));
+            if (value_r != O71_SINT_TO_REF(i))
+                TE("string bag: bad value from get for key %u", i);
+        }
+        os = kvbag_free(world_p, &bag, kv_nop_free);
+        if (rc) break;
+        TS(os);
+        break;
+    }
+    printf("kvbag_test: %u\n", rc);
     return rc;
 }
 
@@ -6118,6 +11975,8 @@ static int test ()
     o71_status_t os;
     int rc = 0, i;
     o71_ref_t r, add3_r, g1_r, g2_r, g3_r, gi_r, add_istr_r, dyn_r;
+    o71_string_t * g1_p;
+    size_t n;
     o71_ref_t ra[10];
     o71_script_function_t * add3_p;
     uint32_t * arg_vxa;
@@ -6185,7 +12044,6 @@ static int test ()
             if (os) TE("error (line %u): status: %s", __LINE__, N(os));
 #endif
         }
-#if 0
         os = o71_cstring(&world, &r, "first string");
         if (os) TE("error: failed to create first string object: %s",
                    o71_status_name(os));
@@ -6222,8 +12080,8 @@ static int test ()
         if (g1_r != gi_r)
             TE("received different string for intern form for 'gargara': %s",
                o71_status_name(os));
-        if (ORC(&world, gi_r) != 2)
-            TE("bad ref count for newly intern'ed 'gargara'");
+        if (ORC(&world, gi_r) != O71_IMMORTAL_REF_N)
+            TE("newly intern'ed 'gargara' is not immortal");
         os = o71_ics(&world, &g2_r, "zbenghi");
         if (os) TE("failed to create intern string 'zbenghi': %s",
                    o71_status_name(os));
@@ -6255,6 +12113,24 @@ static int test ()
         }
         if (i < 26 * 26) break;
 
+        /* all lookups must hit now without adding to the intern table */
+        n = world.istr_n;
+        for (i = 0; i < 26 * 26; ++i)
+        {
+            sb[0] = 'a' + i % 26;
+            sb[1] = 'a' + i / 26;
+            sb[2] = 0;
+            os = o71_ics(&world, &g1_r, sb);
+            if (os) TE("failed to look up intern string '%s': %s",
+                       sb, o71_status_name(os));
+            g1_p = o71_obj_ptr(&world, g1_r);
+            if (g1_p->a == (uint8_t *) sb || g1_p->n != 2
+                || g1_p->a[0] != sb[0] || g1_p->a[1] != sb[1])
+                TE("bad intern string for '%s'", sb);
+        }
+        if (i < 26 * 26) break;
+        if (world.istr_n != n) TE("intern table grew on lookups");
+
         os = o71_reg_obj_create(&world, O71R_REG_OBJ_CLASS, &dyn_r);
         if (os) TE("reg_obj_create failed: %s", o71_status_name(os));
 
@@ -6323,6 +12199,7 @@ static int test ()
 
         eha[0].exc_type_r = O71R_EXCEPTION_CLASS;
         eha[0].insn_x = add3_p->insn_n - 2;
+        eha[0].exc_var_x = 0;
 
         os = o71_set_exc_chain(&world, add3_p, iac_ix, add3_p->insn_n - 2, ecx);
         if (os) TE("add3: set exc chain failed: %s", o71_status_name(os));
@@ -6354,8 +12231,36 @@ static int test ()
             TE("add3(2, 3, 4) returned wrong value ref %lX",
                (long) world.root_flow.value_r);
 
+        /* validation moved the last uses of args and temporaries and
+         * skipped releasing vars still null; v0 receives the exception */
+        arg_vxa = &add3_p->opnd_a[add3_p->insn_a[iac_ix].opnd_x + 3];
+        if (add3_p->insn_a[0].opcode != O71O_INIT_NULL
+            || add3_p->insn_a[iac_ix].opcode != O71O_CALL_MOVE
+            || arg_vxa[0] != (0 | O71_VX_MOVE)
+            || arg_vxa[1] != (1 | O71_VX_MOVE)
+            || add3_p->insn_a[iac_ix + 1].opcode != O71O_INIT_NULL
+            || add3_p->insn_a[iac_ix + 3].opcode != O71O_CALL_MOVE
+            || add3_p->insn_a[add3_p->insn_n - 2].opcode != O71O_INIT)
+            TE("add3: unexpected code after liveness pass");
+        os = o71_sfunc_validate(&world, add3_p);
+        if (os || arg_vxa[0] != (0 | O71_VX_MOVE))
+            TE("add3: revalidation failed: %s", o71_status_name(os));
+        os = o71_deref(&world, add3_r);
+        if (os) TE("add3: deref failed: %s", o71_status_name(os));
+
         if ((rc = reg_obj_field_test(&world))) break;
-#endif
+        if ((rc = obj_table_test(&world))) break;
+        if ((rc = cleanup_step_test(&world))) break;
+        if ((rc = gc_test(&world))) break;
+        if ((rc = str_cmp_test(&world))) break;
+        if ((rc = str_builder_test(&world))) break;
+        if ((rc = str_slice_test(&world))) break;
+        if ((rc = ics_many_test(&world))) break;
+        if ((rc = builtin_str_test(&world))) break;
+        if ((rc = tokenize_test(&world))) break;
+        if ((rc = kvbag_test(&world))) break;
+        if ((rc = kvbag_bulk_test(&world))) break;
+        if ((rc = kvbag_cursor_test(&world))) break;
     }
     while (0);
 
@@ -6366,11 +12271,90 @@ static int test ()
                 o71_status_name(os));
         return ERR_RUN;
     }
+    if (allocator.mem_usage)
+    {
+        fprintf(stderr, "error: leaked %zu bytes\n", allocator.mem_usage);
+        if (!rc) rc = ERR_RUN;
+    }
     o71_allocator_finish(&allocator);
     printf("self test %s!\n", rc ? "FAILED" : "passed");
     return rc;
 }
 
+/* bag_bench ****************************************************************/
+/**
+ *  Times kvbag_get() on small identity bags kept in array mode (binary
+ *  search) and in hash mode.
+ */
+static int bag_bench (o71_world_t * world_p)
+{
+    static uint8_t const limit_a[] = { 0x80, 1 };
+    static char const * const mode_name_a[] = { "array", "hash" };
+    enum { LOOKUP_N = 1 << 24 };
+    o71_kvbag_t bag;
+    o71_ref_t value_r;
+    o71_status_t os;
+    clock_t t;
+    unsigned int mx, n, i, k;
+    int rc = 0;
+
+    for (n = 2; n <= 0x40 && !rc; n <<= 1)
+    {
+        printf("%3u items:", n);
+        for (mx = 0; mx < ITEM_COUNT(limit_a) && !rc; ++mx)
+        {
+            kvbag_init(&bag, limit_a[mx], O71_BAG_HASH);
+            for (i = 0; i < n; ++i)
+                TS(kvbag_put(world_p, &bag, O71_SINT_TO_REF(i * 3),
+                             O71_SINT_TO_REF(i), ref_cmp, NULL));
+            t = clock();
+            for (i = 0, k = 0; i < LOOKUP_N && !rc; ++i)
+            {
+                TS(kvbag_get(world_p, &bag, O71_SINT_TO_REF(k * 3), ref_cmp,
+                             NULL, &value_r));
+                if (value_r != O71_SINT_TO_REF(k)) TE("bad value for %u", k);
+                k = k + 7 < n ? k + 7 : (k + 7) % n;
+            }
+            t = clock() - t;
+            os = kvbag_free(world_p, &bag, kv_nop_free);
+            if (rc) break;
+            TS(os);
+            printf("  %s %6.2f ns", mode_name_a[mx],
+                   (double) t * 1e9 / CLOCKS_PER_SEC / LOOKUP_N);
+        }
+        printf("\n");
+    }
+    return rc;
+}
+
+/* bench ********************************************************************/
+static int bench ()
+{
+    o71_allocator_t allocator;
+    o71_world_t world;
+    o71_status_t os;
+    int rc;
+
+    o71_allocator_init(&allocator, mem_realloc, NULL, SIZE_MAX);
+    os = o71_world_init(&world, &allocator);
+    if (os)
+    {
+        fprintf(stderr, "error: failed initializing scripting instance: %s\n",
+                o71_status_name(os));
+        return ERR_RUN;
+    }
+    rc = bag_bench(&world);
+    os = o71_world_finish(&world);
+    if (os)
+    {
+        fprintf(stderr, "error: failed finishing scripting instance: %s\n",
+                o71_status_name(os));
+        rc = ERR_BUG;
+    }
+    o71_allocator_finish(&allocator);
+    return rc;
+}
+
 /* compile_error_msg ********************************************************/
 static int compile_error_msg (o71_code_t const * code_p, char * buf, size_t len)
 {
@@ -6412,6 +12396,7 @@ static int compile_error_msg (o71_code_t const * code_p, char * buf, size_t len)
 
     case O71_CE_BAD_ATOM:
         snprintf(buf, len, "expecting identifier, string, or integer");
+        break;
     default:
         snprintf(buf, len, "compile error code: %u", code_p->ce_code);
     }
@@ -6485,6 +12470,7 @@ static int run_script (int ac, char const * const * av)
 #define RUN_SCRIPT 0
 #define RUN_HELP 1
 #define RUN_TEST 2
+#define RUN_BENCH 3
 
 /* main *********************************************************************/
 int main (int argc, char const * const * argv)
@@ -6517,6 +12503,11 @@ int main (int argc, char const * const * argv)
                     run = RUN_TEST;
                     continue;
                 }
+                if (!strcmp(argv[i] + 2, "bench"))
+                {
+                    run = RUN_BENCH;
+                    continue;
+                }
                 if (!strcmp(argv[i] + 2, "help"))
                 {
                     run = RUN_HELP;
@@ -6534,6 +12525,9 @@ int main (int argc, char const * const * argv)
                 case 't':
                     run = RUN_TEST;
                     break;
+                case 'b':
+                    run = RUN_BENCH;
+                    break;
                 case 'h':
                     run = RUN_HELP;
                     break;
@@ -6553,11 +12547,14 @@ int main (int argc, char const * const * argv)
     {
     case RUN_SCRIPT:
         if (n) return run_script(n, a);
+        /* fall through */
     case RUN_HELP:
         help();
         return 0;
     case RUN_TEST:
         return test();
+    case RUN_BENCH:
+        return bench();
     default:
         fprintf(stderr, "bug: unhandled run mode %u\n", run);
         return ERR_BUG;
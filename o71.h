@@ -45,6 +45,20 @@
 
 #define O71_STEPS_MAX INT32_MAX
 #define O71_VAR_LIMIT 0x10000000
+/* set by o71_sfunc_validate() on CALL_MOVE arg operands whose variable is
+ * not used afterwards; the reference is moved to the callee */
+#define O71_VX_MOVE 0x80000000u
+
+/* the object table is split in pages of 2^O71_OBJ_PAGE_BITS slots */
+#define O71_OBJ_PAGE_BITS 10
+#define O71_OBJ_PAGE_SIZE ((size_t) 1 << O71_OBJ_PAGE_BITS)
+#define O71_OBJ_PAGE_MASK (O71_OBJ_PAGE_SIZE - 1)
+/* each page is followed by a bitmap of its free slots (bit set = free) */
+#define O71_OBJ_PAGE_BMP_N \
+    (O71_OBJ_PAGE_SIZE / (sizeof(uintptr_t) * CHAR_BIT))
+#define O71_OBJ_SLOT(_world_p, _x) \
+    ((_world_p)->obj_page_pa[(_x) >> O71_OBJ_PAGE_BITS] \
+        [(_x) & O71_OBJ_PAGE_MASK])
 
 #define O71_IS_REF_TO_SINT(_ref) (((_ref) & 1))
 #define O71_IS_REF_TO_MO(_ref) (!((_ref) & 1))
@@ -53,6 +67,15 @@
 #define O71_SINT_TO_REF(_val) (((_val) << 1) | 1)
 #define O71_REF_TO_SINT(_ref) ((_ref) >> 1)
 
+/* ref counts of at least 2^(bits - 2) (the upper three quarters of the
+ * unsigned range) mark immortal objects; o71_ref()/o71_deref() skip them
+ * with a single unsigned compare; negative counts (objects in the destroy
+ * chain) fall in the same range */
+#define O71_IMMORTAL_REF_N \
+    ((o71_ref_count_t) ((uintptr_t) INTPTR_MAX >> 1) + 1)
+#define O71_IS_IMMORTAL_REF_N(_n) \
+    ((uintptr_t) (_n) >= (uintptr_t) O71_IMMORTAL_REF_N)
+
 #define O71R_NULL (O71_MOX_TO_REF(O71X_NULL))
 #define O71R_OBJECT_CLASS (O71_MOX_TO_REF(O71X_OBJECT_CLASS))
 #define O71R_NULL_CLASS (O71_MOX_TO_REF(O71X_NULL_CLASS))
@@ -68,9 +91,34 @@
 #define O71R_TYPE_EXC_CLASS (O71_MOX_TO_REF(O71X_TYPE_EXC_CLASS))
 #define O71R_ARITY_EXC_CLASS (O71_MOX_TO_REF(O71X_ARITY_EXC_CLASS))
 #define O71R_INT_ADD_FUNC (O71_MOX_TO_REF(O71X_INT_ADD_FUNC))
+#define O71R_STR_ADD (O71_MOX_TO_REF(O71X_STR_ADD))
+#define O71R_STR_EXE_CTX (O71_MOX_TO_REF(O71X_STR_EXE_CTX))
 
 #define O71_BAG_ARRAY 0
 #define O71_BAG_RBTREE 1
+#define O71_BAG_BTREE 2
+#define O71_BAG_HASH 3
+/* no object can have this index so it marks free slots in hash bags */
+#define O71_KVHASH_FREE_KEY (~(o71_ref_t) 1)
+
+/* kvbag cursor states */
+#define O71_KVBAG_CURSOR_START 0 // nothing returned yet
+#define O71_KVBAG_CURSOR_AFTER 1 // positioned after key_r
+
+/* b-tree bags: max key-values in a node (odd, so a split gives halves of
+ * equal size) and max tree depth */
+#define O71_BTREE_KV_MAX 15
+#define O71_BTREE_KV_MIN (O71_BTREE_KV_MAX / 2)
+#define O71_BTREE_DEPTH_MAX 0x10
+
+/* object bodies up to O71_SLAB_CLASS_N * O71_SLAB_GRAIN bytes are carved
+ * from slabs of about O71_SLAB_SIZE bytes */
+#define O71_SLAB_GRAIN 0x10
+#define O71_SLAB_CLASS_N 0x10
+#define O71_SLAB_SIZE 0x2000
+
+/* default size of the chunks used by o71_arena_t */
+#define O71_ARENA_CHUNK_SIZE 0x4000
 
 enum o71_status_e
 {
@@ -105,6 +153,7 @@ enum o71_status_e
     O71_BAD_STRING_REF,
     O71_BAD_RO_STRING_REF,
     O71_BAD_INTERN_STRING_REF,
+    O71_BAD_CODE_POINT,
 
     O71_COMPILE_ERROR,
     O71_NO_MATCH,
@@ -132,21 +181,30 @@ enum o71_builtin_obj_index_e
     O71X_ARITY_EXC_CLASS,
     O71X_INT_ADD_FUNC,
 
+    /* builtin intern strings; keep sorted by content */
+    O71X_STR_ADD,
+    O71X_STR_EXE_CTX,
+
     O71X__COUNT
 };
 
+#define O71X__STR_FIRST O71X_STR_ADD
+#define O71_BUILTIN_STR_N (O71X__COUNT - O71X__STR_FIRST)
+
 enum o71_opcode_e
 {
     // vx - local var index
     // cx - const index
     O71O_NOP,
     O71O_INIT, // init dest_vx, src_cx - moves a constant to a local variable
+    O71O_INIT_NULL, // init into a var known to be null (set by validate)
     O71O_GET_METHOD, // get_method dest_vx, obj_vx, name_istr_vx
     O71O_GET_FIELD, // get_field dest_vx, obj_vx, name_istr_vx
     O71O_SET_FIELD, // set_field src_vx, obj_vx, name_istr_vx
 
     O71O__CHFLOW, // following are opcodes that can change the flow
     O71O_CALL = O71O__CHFLOW, // call dest_vx, func_vx, arg_n, arg0_vx, ... arg<arg_n - 1>_vx
+    O71O_CALL_MOVE, // call with some args marked with O71_VX_MOVE (set by validate)
     O71O__NO_FALL,
     O71O_RETURN = O71O__NO_FALL, // ret value_vx
     O71O_JUMP,
@@ -179,6 +237,8 @@ enum o71_sec_mode_e
 #define O71MI_SCRIPT_FUNCTION   (O71M_SCRIPT_FUNCTION | O71MI_FUNCTION)
 
 typedef struct o71_allocator_s o71_allocator_t;
+typedef struct o71_arena_s o71_arena_t;
+typedef struct o71_arena_chunk_s o71_arena_chunk_t;
 typedef struct o71_class_s o71_class_t;
 typedef struct o71_code_s o71_code_t;
 typedef struct o71_reg_obj_s o71_reg_obj_t;
@@ -193,7 +253,10 @@ typedef struct o71_insn_s o71_insn_t;
 typedef struct o71_kv_s o71_kv_t;
 typedef struct o71_kvbag_s o71_kvbag_t;
 typedef struct o71_kvnode_s o71_kvnode_t;
+typedef struct o71_kvbtnode_s o71_kvbtnode_t;
+typedef struct o71_kvhash_s o71_kvhash_t;
 typedef struct o71_kvbag_loc_s o71_kvbag_loc_t;
+typedef struct o71_kvbag_cursor_s o71_kvbag_cursor_t;
 typedef struct o71_mem_obj_s o71_mem_obj_t;
 typedef uintptr_t o71_obj_index_t;
 typedef intptr_t o71_ref_count_t;
@@ -201,6 +264,7 @@ typedef struct o71_script_exe_ctx_s o71_script_exe_ctx_t;
 typedef struct o71_script_function_s o71_script_function_t;
 typedef enum o71_status_e o71_status_t;
 typedef struct o71_string_s o71_string_t;
+typedef struct o71_istr_slot_s o71_istr_slot_t;
 typedef struct o71_token_s o71_token_t;
 typedef struct o71_str_token_s o71_str_token_t;
 typedef struct o71_id_token_s o71_id_token_t;
@@ -214,6 +278,9 @@ typedef struct o71_expr_list_token_s o71_expr_list_token_t;
 typedef struct o71_func_token_s o71_func_token_t;
 typedef struct o71_block_stmt_token_s o71_block_stmt_token_t;
 typedef struct o71_alloc_header_s o71_alloc_header_t;
+typedef struct o71_slab_s o71_slab_t;
+typedef struct o71_slab_pool_s o71_slab_pool_t;
+typedef struct o71_gc_stats_s o71_gc_stats_t;
 typedef enum o71_token_type_e o71_token_type_t;
 
 /* o71_ref_t ****************************************************************/
@@ -243,9 +310,38 @@ typedef o71_status_t (* o71_finish_f)
         o71_ref_t obj_r
     );
 
+/* o71_ref_visit_f **********************************************************/
+/**
+ *  Callback invoked for each reference slot owned by an object.
+ *  The callback may replace the reference stored in the slot.
+ */
+typedef o71_status_t (* o71_ref_visit_f)
+    (
+        o71_world_t * world_p,
+        o71_ref_t * ref_p,
+        void * ctx
+    );
+
+/* o71_visit_refs_f *********************************************************/
+/**
+ *  Calls @a visit for every slot of the object that holds a counted
+ *  reference (the reference to the object's class excluded).
+ *  Slots holding borrowed references must not be visited.
+ *  This is what the cycle collector uses to learn the object graph.
+ */
+typedef o71_status_t (* o71_visit_refs_f)
+    (
+        o71_world_t * world_p,
+        o71_ref_t obj_r,
+        o71_ref_visit_f visit,
+        void * ctx
+    );
+
 /* o71_get_field_f **********************************************************/
 /**
  *  Get field function pointer.
+ *  The value is returned as a borrowed reference; the caller increments
+ *  its reference count if it keeps it.
  */
 typedef o71_status_t (* o71_get_field_f)
     (
@@ -258,9 +354,8 @@ typedef o71_status_t (* o71_get_field_f)
 /* o71_set_field_f **********************************************************/
 /**
  *  Set field function pointer.
- *  @warning The value is supposed to have already its reference count
- *      incremented
- *  because this function "borrows" the reference from its caller.
+ *  The object takes its own reference to the value it stores; the caller
+ *  keeps its reference.
  */
 typedef o71_status_t (* o71_set_field_f)
     (
@@ -339,6 +434,16 @@ struct o71_kvnode_s
     o71_kv_t kv;
 };
 
+/* b-tree node; leaves are allocated without child_a */
+struct o71_kvbtnode_s
+{
+    uint8_t n; // used entries in kv_a
+    uint8_t leaf;
+    o71_kv_t kv_a[O71_BTREE_KV_MAX]; // sorted by key
+    o71_kvbtnode_t * child_a[O71_BTREE_KV_MAX + 1]; // keys in child_a[i] sort
+                                                   // before kv_a[i]
+};
+
 struct o71_kvbag_loc_s
 {
     union
@@ -353,6 +458,17 @@ struct o71_kvbag_loc_s
             uint8_t side_a[0x40];
             unsigned int last_x;
         } rbtree;
+        struct
+        {
+            o71_kvbtnode_t * node_a[O71_BTREE_DEPTH_MAX];
+            uint8_t index_a[O71_BTREE_DEPTH_MAX]; // child index in internal
+                // nodes above last_x; kv index (or insert position) at last_x
+            unsigned int last_x;
+        } btree;
+        struct
+        {
+            size_t index; // matching slot or insert position
+        } hash;
     };
     o71_status_t cmp_error;
 #if O71_CHECKED
@@ -360,6 +476,39 @@ struct o71_kvbag_loc_s
 #endif
 };
 
+/* o71_kvbag_cursor_t *******************************************************/
+/**
+ *  Position of an iteration over a kvbag; see o71_kvbag_cursor_next().
+ *  The path down the tree is kept here, so iterating needs neither
+ *  recursion nor allocation.
+ */
+struct o71_kvbag_cursor_s
+{
+    union
+    {
+        struct
+        {
+            size_t index; // next item of a sorted array or next slot of
+                // a hash table; past the last slot it counts the slots
+                // again, for the items that wrapped around the end
+        } array;
+        struct
+        {
+            o71_kvnode_t * node_a[0x40]; // nodes with items still to come;
+                // the top one holds the next item
+        } rbtree;
+        struct
+        {
+            o71_kvbtnode_t * node_a[O71_BTREE_DEPTH_MAX];
+            uint8_t index_a[O71_BTREE_DEPTH_MAX]; // next item in each node
+        } btree;
+    };
+    o71_ref_t key_r; // last returned key or the key passed to seek
+    unsigned int depth; // used entries in the tree paths; 0 at the end
+    size_t version; // bag version the position was computed for
+    uint8_t state; // O71_KVBAG_CURSOR_xxx
+};
+
 struct o71_kvbag_s
 {
     union
@@ -371,11 +520,34 @@ struct o71_kvbag_s
          *   passed to all kvbag functions */
         o71_kvnode_t * tree_p;
         /**< when n > (1 << aexp) this holds the root of the red/black tree */
+        o71_kvbtnode_t * btree_p;
+        /**< root of the b-tree in O71_BAG_BTREE mode; never NULL */
+        o71_kvhash_t * hash_p;
+        /**< slot table in O71_BAG_HASH mode; never NULL */
     };
     uint8_t n; // number of used entries in kv_a
     uint8_t m; // allocated size of array of key-values (must be power of two)
     uint8_t l; // limit size for array mode (must be a power of two)
-    uint8_t mode; // 0 - array; 1 - red/black tree
+    uint8_t mode; // O71_BAG_xxx
+    uint8_t large_mode; // mode to switch to when the array reaches l items
+    size_t version; // set from the world kvbag_version by inserts and
+                    // deletes; checked by cursors
+};
+
+/* o71_kvhash_t *************************************************************/
+/**
+ *  Open addressing table for bags keyed by ref identity.
+ *  Collisions are resolved with linear probing kept in robin-hood order:
+ *  within a run of used slots the items are sorted by their home slot and
+ *  then by key, so a lookup stops at the first item that sits closer to
+ *  its home than the probe is to the key's home, or that has the same home
+ *  and a greater key.
+ */
+struct o71_kvhash_s
+{
+    size_t n; // number of items
+    size_t mask; // number of slots - 1; the slot count is a power of two
+    o71_kv_t kv_a[]; // free slots have the key O71_KVHASH_FREE_KEY
 };
 
 struct o71_class_s
@@ -386,6 +558,7 @@ struct o71_class_s
     o71_finish_f finish;
     o71_get_field_f get_field;
     o71_set_field_f set_field;
+    o71_visit_refs_f visit_refs; // enumerates refs owned by instances
     o71_kvbag_t method_bag; // instance method bag
     size_t super_n;
     size_t object_size; // instance size
@@ -403,13 +576,31 @@ struct o71_class_s
 #define O71_SM_READ_ONLY 1
 #define O71_SM_INTERN 2
 
+/* modifiable strings up to this many bytes keep their content inside the
+ * string object */
+#define O71_STR_INLINE_SIZE 0x10
+
 struct o71_string_s
 {
     o71_mem_obj_t hdr;
     uint8_t * a;
     size_t n;
     size_t m;
+    uint32_t hash; // computed when the string becomes read-only
     uint8_t mode;
+    uint8_t slice; // non-zero: a points inside the buffer of inl.parent_r
+    union
+    {
+        uint8_t sa[O71_STR_INLINE_SIZE]; // content of small strings; a == sa
+        o71_ref_t parent_r; // string whose buffer a slice points into
+    } inl;
+};
+
+/* slot in the intern string hash table; str_r is O71R_NULL for free slots */
+struct o71_istr_slot_s
+{
+    o71_ref_t str_r;
+    uint32_t hash;
 };
 
 struct o71_field_desc_s
@@ -540,6 +731,44 @@ struct o71_alloc_header_s
     uint32_t tag;
 };
 
+/* o71_slab_t ***************************************************************/
+/**
+ *  Header of a block of equally sized chunks used for object bodies.
+ *  Each chunk starts with a pointer to its slab followed by the body.
+ */
+struct o71_slab_s
+{
+    o71_slab_pool_t * pool_p;
+    o71_slab_t * next_p; // next slab with free chunks
+    o71_slab_t * prev_p; // previous slab with free chunks
+    void * free_chunk_p; // released chunks chained through their body
+    uint32_t used_n; // chunks handed out
+    uint32_t fresh_x; // index of the first chunk never handed out
+};
+
+/* o71_slab_pool_t **********************************************************/
+/**
+ *  Per size class list of slabs.
+ */
+struct o71_slab_pool_s
+{
+    o71_slab_t * partial_p; // slabs with free chunks
+    o71_slab_t * empty_p; // one cached empty slab
+    size_t chunk_size;
+    uint32_t chunk_n; // chunks per slab
+};
+
+/* o71_gc_stats_t ***********************************************************/
+/**
+ *  Cycle collector statistics.
+ */
+struct o71_gc_stats_s
+{
+    size_t run_n; // collections done
+    size_t obj_n; // objects reclaimed
+    size_t byte_n; // object body bytes reclaimed
+};
+
 struct o71_allocator_s
 {
     /*  realloc  */
@@ -556,6 +785,7 @@ struct o71_allocator_s
     size_t mem_usage;
     size_t mem_limit;
     size_t mem_peak;
+    o71_slab_pool_t slab_pool_a[O71_SLAB_CLASS_N];
 #if O71_CHECKED
     o71_alloc_header_t list;
 #endif
@@ -563,19 +793,33 @@ struct o71_allocator_s
 
 struct o71_world_s
 {
-    union
-    {
-        o71_mem_obj_t * * mem_obj_pa;
-        void * * obj_pa;
-        uintptr_t * enc_next_free_xa; // values are (index * 2 + 1) to be distinguished from used entries (pointers to object - aligned to at least 4)
-    };
-    size_t obj_n;
-    o71_obj_index_t free_list_head_ex; // encoded index ~x
-    o71_obj_index_t * free_list_tail_xp;
-    o71_obj_index_t destroy_list_head_x; // chained using ~obj_p->ref_n
+    /* object table: pages of O71_OBJ_PAGE_SIZE slots followed by
+     * O71_OBJ_PAGE_BMP_N bitmap words; a slot holds either the pointer to
+     * the object or, for free slots, an odd value */
+    void * * * obj_page_pa;
+    size_t obj_page_m; // allocated entries in obj_page_pa
+    size_t obj_n; // slots in all pages
+    size_t free_scan_x; // lowest bitmap word that may have free slots
+    o71_obj_index_t destroy_list_head_ex; // encoded index ~x
+    o71_obj_index_t * destroy_list_tail_xp; // chained using destroy_next_ex
+    size_t destroy_budget; // max objects destroyed by one o71_deref();
+                           // the rest is left to o71_run()
+    /* cycle collector scratch arrays, one item per object table slot */
+    o71_ref_count_t * gc_na; // trial ref counts
+    size_t gc_na_m;
+    o71_obj_index_t * gc_stack_xa; // objects left to scan when marking
+    size_t gc_stack_m;
+    size_t gc_stack_n;
+    size_t gc_alloc_n; // objects allocated since the last collection
+    size_t gc_threshold; // collect from o71_run() after this many
+                         // allocations; 0 disables automatic collection
+    o71_gc_stats_t gc_stats; // totals since world init
     o71_allocator_t * allocator_p;
 
-    o71_kvbag_t istr_bag;
+    o71_istr_slot_t * istr_a; // intern strings; open addressing with
+                              // linear probing
+    size_t istr_m; // slot count: 0 or a power of 2
+    size_t istr_n; // used slots
     o71_flow_t root_flow;
 
     o71_mem_obj_t null_object;
@@ -591,7 +835,11 @@ struct o71_world_s
     o71_class_t type_exc_class;
     o71_class_t arity_exc_class;
     o71_function_t int_add_func;
+    o71_string_t builtin_str_a[O71_BUILTIN_STR_N];
 
+    size_t kvbag_version; // last version given to a changed kvbag; unique
+                          // across bags so a cursor never matches a bag
+                          // that was freed and initialized again
     unsigned int flow_id_seed;
     uint8_t cleaning;
 };
@@ -808,6 +1056,28 @@ struct o71_block_stmt_token_s
     o71_var_spec_t * * var_tail_pp;
 };
 
+/* o71_arena_chunk_t ********************************************************/
+/**
+ *  Memory block owned by an arena; the data follows the header.
+ */
+struct o71_arena_chunk_s
+{
+    o71_arena_chunk_t * prev_p;
+    size_t size; // size of data in bytes
+};
+
+/* o71_arena_t **************************************************************/
+/**
+ *  Bump-pointer allocator; memory is released only all at once.
+ */
+struct o71_arena_s
+{
+    o71_allocator_t * allocator_p;
+    o71_arena_chunk_t * chunk_p; // last chunk; older ones chained by prev_p
+    uint8_t * crt_p; // next free byte in chunk_p
+    size_t free_n; // bytes available after crt_p
+};
+
 struct o71_code_s
 {
     char const * src_name;
@@ -815,6 +1085,7 @@ struct o71_code_s
     o71_token_t * token_list;
     o71_token_t * * token_tail;
     o71_allocator_t * allocator_p;
+    o71_arena_t arena; // owns all tokens and expression nodes
     o71_block_stmt_token_t body;
     size_t src_n;
     unsigned int ce_code;
@@ -864,6 +1135,49 @@ O71_API o71_status_t o71_world_init
     o71_allocator_t * allocator_p
 );
 
+/* o71_world_trim ***********************************************************/
+/**
+ *  Releases the trailing pages of the object table that hold no objects
+ *  and the empty slabs cached by the allocator.
+ *  New objects always take the lowest free index so after a spike the live
+ *  objects gather at the start of the table.
+ *  @retval O71_OK
+ *  @retval O71_MEM_CORRUPTED
+ *  @retval O71_BUG
+ *  @retval O71_TODO
+ */
+O71_API o71_status_t o71_world_trim
+(
+    o71_world_t * world_p
+);
+
+/* o71_gc *******************************************************************/
+/**
+ *  Collects unreachable cycles of objects.
+ *  Uses trial deletion: the references owned by objects (as enumerated by
+ *  their class visit_refs() callback) are subtracted from the reference
+ *  counts; objects left with references are held from outside the object
+ *  graph (host, flows, builtins) and everything reachable from them is live.
+ *  The remaining objects have their owned references cleared and are then
+ *  destroyed through the destroy chain.
+ *  o71_run() calls this at safe points once world_p->gc_threshold objects
+ *  have been allocated since the last collection.
+ *  @param stats_p [out]
+ *      if not NULL, receives the statistics for this collection
+ *  @retval O71_OK
+ *  @retval O71_NO_MEM
+ *  @retval O71_MEM_LIMIT
+ *  @retval O71_MEM_CORRUPTED
+ *  @retval O71_BUG
+ *  @retval other
+ *      error returned by some finish or visit_refs callback
+ */
+O71_API o71_status_t o71_gc
+(
+    o71_world_t * world_p,
+    o71_gc_stats_t * stats_p
+);
+
 /* o71_world_finish *********************************************************/
 /**
  *  @retval O71_OK
@@ -913,14 +1227,140 @@ O71_API o71_status_t o71_rocs
     char const * cstr_a
 );
 
+/* o71_str_create ***********************************************************/
+/**
+ *  Creates an empty modifiable string to be filled in with the
+ *  o71_str_append*() functions.
+ *  @param reserve_n [in]
+ *      number of bytes to allocate upfront
+ *  @retval O71_OK
+ *  @retval O71_NO_MEM
+ *  @retval O71_MEM_LIMIT
+ *  @retval O71_ARRAY_LIMIT too many objects
+ */
+O71_API o71_status_t o71_str_create
+(
+    o71_world_t * world_p,
+    o71_ref_t * str_rp,
+    size_t reserve_n
+);
+
+/* o71_str_reserve **********************************************************/
+/**
+ *  Makes room in a modifiable string for extra_n more bytes.
+ *  The buffer grows to the next power of 2 so that appending byte by byte
+ *  takes amortized constant time.
+ *  @retval O71_OK
+ *  @retval O71_BAD_STRING_REF not a string
+ *  @retval O71_BAD_RO_STRING_REF string is read-only or intern
+ *  @retval O71_ARRAY_LIMIT size overflow
+ *  @retval O71_NO_MEM
+ *  @retval O71_MEM_LIMIT
+ */
+O71_API o71_status_t o71_str_reserve
+(
+    o71_world_t * world_p,
+    o71_ref_t str_r,
+    size_t extra_n
+);
+
+/* o71_str_append ***********************************************************/
+/**
+ *  Appends n bytes to a modifiable string.
+ *  @retval O71_OK
+ *  @retval O71_BAD_STRING_REF not a string
+ *  @retval O71_BAD_RO_STRING_REF string is read-only or intern
+ *  @retval O71_ARRAY_LIMIT size overflow
+ *  @retval O71_NO_MEM
+ *  @retval O71_MEM_LIMIT
+ */
+O71_API o71_status_t o71_str_append
+(
+    o71_world_t * world_p,
+    o71_ref_t str_r,
+    void const * data,
+    size_t n
+);
+
+/* o71_str_append_cp ********************************************************/
+/**
+ *  Appends the UTF-8 encoding of a code point to a modifiable string.
+ *  @retval O71_OK
+ *  @retval O71_BAD_CODE_POINT
+ *      code point above 0x10FFFF or in the surrogate range
+ *  @retval other
+ *      see o71_str_append()
+ */
+O71_API o71_status_t o71_str_append_cp
+(
+    o71_world_t * world_p,
+    o71_ref_t str_r,
+    uint32_t cp
+);
+
+/* o71_str_append_int *******************************************************/
+/**
+ *  Appends the decimal representation of an integer to a modifiable
+ *  string.
+ *  @retval see o71_str_append()
+ */
+O71_API o71_status_t o71_str_append_int
+(
+    o71_world_t * world_p,
+    o71_ref_t str_r,
+    intmax_t value
+);
+
 /* o71_str_freeze ***********************************************************/
+/**
+ *  Makes a string read-only in place; the buffer is kept as it is.
+ *  A slice small compared to its parent gets its own copy of the content.
+ *  @retval O71_OK
+ *  @retval O71_BAD_STRING_REF not a string
+ *  @retval O71_NO_MEM
+ *  @retval O71_MEM_LIMIT
+ */
 O71_API o71_status_t o71_str_freeze
 (
     o71_world_t * world_p,
     o71_ref_t str_r
 );
 
+/* o71_str_slice ************************************************************/
+/**
+ *  Creates a read-only string with n bytes of the given read-only or intern
+ *  string, starting at offset start.
+ *  Unless the range fits in O71_STR_INLINE_SIZE bytes no copy is made: the
+ *  slice points inside the buffer of the parent and holds a reference to it.
+ *  Freezing or interning a slice that is small compared to its parent
+ *  copies its content so that the parent can be released.
+ *  @retval O71_OK
+ *  @retval O71_BAD_STRING_REF not a string
+ *  @retval O71_BAD_RO_STRING_REF string is modifiable
+ *  @retval O71_ARRAY_LIMIT range outside the string
+ *  @retval O71_NO_MEM
+ *  @retval O71_MEM_LIMIT
+ */
+O71_API o71_status_t o71_str_slice
+(
+    o71_world_t * world_p,
+    o71_ref_t str_r,
+    size_t start,
+    size_t n,
+    o71_ref_t * slice_rp
+);
+
 /* o71_str_intern ***********************************************************/
+/**
+ *  Gets the intern string with the same content as the given string.
+ *  If there is none the given string becomes the intern string, in place;
+ *  a modifiable string is frozen first.
+ *  @retval O71_OK
+ *      *intern_str_rp holds a reference to the intern string
+ *  @retval O71_BAD_STRING_REF not a string
+ *  @retval O71_NO_MEM
+ *  @retval O71_MEM_LIMIT
+ */
 O71_API o71_status_t o71_str_intern
 (
     o71_world_t * world_p,
@@ -939,6 +1379,57 @@ O71_API o71_status_t o71_ics
     char const * cstr_a
 );
 
+/* o71_ics_many *************************************************************/
+/**
+ *  Produces intern strings for an array of static constant C strings.
+ *  The intern table is resized once for the whole batch; repeated names
+ *  get the same string.
+ *  Intern strings are immortal so on error the entries already filled in
+ *  str_ra need no release.
+ *  @retval O71_OK
+ *  @retval O71_ARRAY_LIMIT
+ *  @retval O71_NO_MEM
+ *  @retval O71_MEM_LIMIT
+ */
+O71_API o71_status_t o71_ics_many
+(
+    o71_world_t * world_p,
+    char const * const * cstr_a,
+    size_t n,
+    o71_ref_t * str_ra
+);
+
+/* o71_str_cmp **************************************************************/
+/**
+ *  Compares the contents of two strings byte by byte; a string that is
+ *  a prefix of the other one is smaller.
+ *  @retval O71_LESS
+ *  @retval O71_EQUAL
+ *  @retval O71_MORE
+ *  @retval O71_BAD_STRING_REF
+ *      one of the refs is not a string
+ */
+O71_API o71_status_t o71_str_cmp
+(
+    o71_world_t * world_p,
+    o71_ref_t a_r,
+    o71_ref_t b_r
+);
+
+/* o71_str_eq ***************************************************************/
+/**
+ *  Checks if two strings have the same content.
+ *  Intern strings are compared by ref and read-only strings check the
+ *  cached hashes before looking at the bytes.
+ *  @returns non-zero if both refs are strings with the same content
+ */
+O71_API int o71_str_eq
+(
+    o71_world_t * world_p,
+    o71_ref_t a_r,
+    o71_ref_t b_r
+);
+
 /* o71_sfunc_create *********************************************************/
 /**
  *  Creates an empty scripting function.
@@ -953,6 +1444,10 @@ O71_API o71_status_t o71_sfunc_create
 /* o71_sfunc_validate *******************************************************/
 /**
  *  Validates a scripting function to mark it as ready for execution.
+ *  Once the code is found valid, a liveness pass rewrites calls that use
+ *  arguments for the last time to O71O_CALL_MOVE (moving the references
+ *  into the callee instead of ref/deref pairs) and inits into vars known
+ *  to be null to O71O_INIT_NULL.
  *  @param world_p [in]
  *      the world sfunc lives in
  *  @param sfunc_p [in, out]
@@ -970,6 +1465,7 @@ O71_API o71_status_t o71_sfunc_create
  *      encountered an instruction with an invalid var index
  *  @retval O71_BAD_INSN_INDEX
  *      encountered an instruction with an invalid insn index
+ *      or an exception handler pointing outside the code
  */
 O71_API o71_status_t o71_sfunc_validate
 (
@@ -1129,7 +1625,7 @@ O71_INLINE void * o71_obj_ptr
     o71_ref_t mem_obj_r
 )
 {
-    return world_p->obj_pa[O71_REF_TO_MOX(mem_obj_r)];
+    return O71_OBJ_SLOT(world_p, O71_REF_TO_MOX(mem_obj_r));
 }
 
 /* o71_class ****************************************************************/
@@ -1167,9 +1663,30 @@ O71_API o71_status_t o71_cleanup
     o71_world_t * world_p
 );
 
+/* o71_cleanup_step *********************************************************/
+/**
+ *  Destroys at most @a budget objects from the destroy chain.
+ *  This allows draining the chain in slices, for instance when the host is
+ *  idle; objects appended to the chain while finishing others are
+ *  processed in the same slice if the budget allows it.
+ *  @retval O71_OK
+ *      the destroy chain is empty
+ *  @retval O71_PENDING
+ *      there are objects left in the destroy chain
+ *  @retval other
+ *      the error returned by some object finalizer callback or by the
+ *      allocator
+ */
+O71_API o71_status_t o71_cleanup_step
+(
+    o71_world_t * world_p,
+    size_t budget
+);
+
 /* o71_ref ******************************************************************/
 /**
  *  Increments the ref count of an object.
+ *  Immortal objects (see o71_make_immortal()) are left untouched.
  *  @note on release this always returns O71_OK
  *  @retval O71_OK
  *      ref count incremented
@@ -1191,10 +1708,36 @@ O71_API o71_status_t o71_ref
     o71_ref_t obj_r
 );
 
+/* o71_make_immortal ********************************************************/
+/**
+ *  Marks an object as immortal: its ref count is no longer tracked and
+ *  o71_ref()/o71_deref() return right away for it.
+ *  The object is destroyed only by o71_world_finish().
+ *  Builtin objects and interned strings are immortal from creation; this is
+ *  meant for frozen constants shared by many objects.
+ *  @retval O71_OK
+ *      object is immortal; refs to small ints are accepted as-is
+ *  @retval O71_OBJ_DESTRUCTING
+ *      object is in the destroy chain;
+ *      this code can be returned only in checked or debug builds
+ *  @retval O71_UNUSED_MEM_OBJ_SLOT
+ *      bad reference to unused memory object slot;
+ *      this code can be returned only in checked or debug builds
+ */
+O71_API o71_status_t o71_make_immortal
+(
+    o71_world_t * world_p,
+    o71_ref_t obj_r
+);
+
 /* o71_deref ****************************************************************/
 /**
   * Decrements the ref count of an object and if no refs are left then it
   * adds the object to the destroy chain then cleans up the destroy chain.
+  * Immortal objects (see o71_make_immortal()) are left untouched.
+  * At most world_p->destroy_budget objects are destroyed by one call; the
+  * rest of the chain is destroyed by o71_run() using its step budget or
+  * by o71_cleanup_step() / o71_cleanup().
   * During the call to finish an object, the objects referenced by the finishing
   * object will lose a reference thus they may become part of the destroy chain.
   * @retval O71_OK
@@ -1217,6 +1760,98 @@ O71_API o71_status_t o71_deref
     o71_ref_t obj_r
 );
 
+/* o71_class_fast ***********************************************************/
+/**
+ *  Inline version of o71_class().
+ */
+O71_INLINE o71_class_t * o71_class_fast
+(
+    o71_world_t * world_p,
+    o71_ref_t obj_r
+)
+{
+    o71_obj_index_t obj_x;
+    o71_mem_obj_t * obj_p;
+    if (O71_IS_REF_TO_SINT(obj_r)) return &world_p->small_int_class;
+    obj_x = O71_REF_TO_MOX(obj_r);
+    if (obj_x >= world_p->obj_n) return NULL;
+    obj_p = (o71_mem_obj_t *) O71_OBJ_SLOT(world_p, obj_x);
+    if ((uintptr_t) obj_p & 1) return NULL; /* unused slot */
+    return (o71_class_t *) o71_obj_ptr(world_p, obj_p->class_r);
+}
+
+/* o71_model_fast ***********************************************************/
+/**
+ *  Inline version of o71_model().
+ */
+O71_INLINE uint32_t o71_model_fast
+(
+    o71_world_t * world_p,
+    o71_ref_t obj_r
+)
+{
+    o71_class_t * class_p;
+    if (O71_IS_REF_TO_SINT(obj_r)) return O71M_SMALL_INT;
+    class_p = o71_class_fast(world_p, obj_r);
+    return class_p ? class_p->model : O71M_INVALID;
+}
+
+/* o71_ref_fast *************************************************************/
+/**
+ *  Inline version of o71_ref(); checked builds always take the out of line
+ *  path which validates the reference.
+ */
+O71_INLINE o71_status_t o71_ref_fast
+(
+    o71_world_t * world_p,
+    o71_ref_t obj_r
+)
+{
+#if O71_CHECKED
+    return (o71_ref)(world_p, obj_r);
+#else
+    o71_mem_obj_t * obj_p;
+    if (O71_IS_REF_TO_SINT(obj_r)) return O71_OK;
+    obj_p = (o71_mem_obj_t *) o71_obj_ptr(world_p, obj_r);
+    if (!O71_IS_IMMORTAL_REF_N(obj_p->ref_n)) obj_p->ref_n += 1;
+    return O71_OK;
+#endif
+}
+
+/* o71_deref_fast ***********************************************************/
+/**
+ *  Inline version of o71_deref(); only dropping a reference that is not the
+ *  last one is handled inline, the rest goes to o71_deref().
+ */
+O71_INLINE o71_status_t o71_deref_fast
+(
+    o71_world_t * world_p,
+    o71_ref_t obj_r
+)
+{
+#if !O71_CHECKED
+    o71_mem_obj_t * obj_p;
+    if (O71_IS_REF_TO_SINT(obj_r)) return O71_OK;
+    obj_p = (o71_mem_obj_t *) o71_obj_ptr(world_p, obj_r);
+    /* 2 <= ref_n < O71_IMMORTAL_REF_N */
+    if ((uintptr_t) obj_p->ref_n - 2 < (uintptr_t) O71_IMMORTAL_REF_N - 2)
+    {
+        obj_p->ref_n -= 1;
+        return O71_OK;
+    }
+#endif
+    return (o71_deref)(world_p, obj_r);
+}
+
+/* the exported functions stay available for binding through pointers or
+ * by taking their name in parentheses: (o71_ref)(world_p, obj_r) */
+#if !O71_NO_FAST_PATH
+#define o71_class(_world_p, _obj_r) (o71_class_fast((_world_p), (_obj_r)))
+#define o71_model(_world_p, _obj_r) (o71_model_fast((_world_p), (_obj_r)))
+#define o71_ref(_world_p, _obj_r) (o71_ref_fast((_world_p), (_obj_r)))
+#define o71_deref(_world_p, _obj_r) (o71_deref_fast((_world_p), (_obj_r)))
+#endif
+
 /* o71_prep_call ************************************************************/
 /**
  *  Calls a function object.
@@ -1258,6 +1893,8 @@ O71_API o71_status_t o71_prep_call
  *      minimum number of steps that need to be executed before returning
  *      (unless the execution depth criteria is met);
  *      this value must be at most O71_STEPS_MAX;
+ *      destroying an object left in the destroy chain by o71_deref() counts
+ *      as one step
  */
 O71_API o71_status_t o71_run
 (
@@ -1337,6 +1974,125 @@ O71_API o71_status_t o71_kvbag_get
     o71_ref_t * value_rp
 );
 
+/* o71_kvbag_load ***********************************************************/
+/**
+ *  Fills an empty bag with items sorted by key, in linear time.
+ *  Keys get their ref count incremented; the bag takes over the references
+ *  to the values, as o71_kvbag_put() does.
+ *  @param kv_a [in]
+ *      items with strictly increasing keys
+ *  @param cmp [in]
+ *      comparator the bag is ordered by; NULL for bags keyed by ref
+ *      identity
+ *  @param ctx [in]
+ *      context passed to @a cmp
+ *  @retval O71_OK
+ *  @retval O71_NO_MEM
+ *  @retval O71_MEM_LIMIT
+ *  @note on error the bag stays empty
+ */
+O71_API o71_status_t o71_kvbag_load
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kv_t const * kv_a,
+    size_t kv_n,
+    o71_cmp_f cmp,
+    void * ctx
+);
+
+/* o71_kvbag_merge **********************************************************/
+/**
+ *  Puts a batch of items sorted by key into the bag, rebuilding it from a
+ *  linear merge when the batch is not small compared to the bag; hash mode
+ *  bags grow at most once.
+ *  Ref counts change as if o71_kvbag_put() was called for each item.
+ *  @param kv_a [in]
+ *      items with strictly increasing keys
+ *  @param cmp [in]
+ *      comparator the bag is ordered by; NULL for bags keyed by ref
+ *      identity
+ *  @param ctx [in]
+ *      context passed to @a cmp
+ *  @retval O71_OK
+ *  @retval O71_NO_MEM
+ *  @retval O71_MEM_LIMIT
+ *  @retval anything returned by @a cmp
+ */
+O71_API o71_status_t o71_kvbag_merge
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kv_t const * kv_a,
+    size_t kv_n,
+    o71_cmp_f cmp,
+    void * ctx
+);
+
+/* o71_kvbag_cursor_init ****************************************************/
+/**
+ *  Prepares a cursor for iterating a bag from its first item.
+ */
+O71_API void o71_kvbag_cursor_init
+(
+    o71_kvbag_cursor_t * cursor_p
+);
+
+/* o71_kvbag_cursor_seek ****************************************************/
+/**
+ *  Positions the cursor after the given key, to resume an iteration; the
+ *  key does not have to be in the bag.
+ *  @param cmp [in]
+ *      comparator the bag is ordered by; NULL for bags keyed by ref
+ *      identity
+ *  @param ctx [in]
+ *      context passed to @a cmp
+ *  @retval O71_OK
+ *  @retval anything returned by @a cmp
+ */
+O71_API o71_status_t o71_kvbag_cursor_seek
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kvbag_cursor_t * cursor_p,
+    o71_ref_t key_r,
+    o71_cmp_f cmp,
+    void * ctx
+);
+
+/* o71_kvbag_cursor_next ****************************************************/
+/**
+ *  Gets the next item of the bag, in key order; bags keyed by ref identity
+ *  are in ref order while in array mode and in table order in hash mode.
+ *  If the bag changed since the last call, the iteration continues with
+ *  the first key greater than the last one returned or, in hash mode, with
+ *  the slot after that key, probed for from its home slot, or the slot it
+ *  would be inserted in if it was deleted. Deleting or putting items does
+ *  not make the iteration skip or repeat other items, except when a bag
+ *  keyed by ref identity switches to hash mode or its table grows, as that
+ *  changes the order.
+ *  Ref counts are not affected; the returned refs are borrowed from the bag.
+ *  @param cmp [in]
+ *      comparator the bag is ordered by; NULL for bags keyed by ref
+ *      identity; only called to find the position again after the bag
+ *      changed
+ *  @param ctx [in]
+ *      context passed to @a cmp
+ *  @retval O71_OK
+ *  @retval O71_MISSING
+ *      no more items
+ *  @retval anything returned by @a cmp
+ */
+O71_API o71_status_t o71_kvbag_cursor_next
+(
+    o71_world_t * world_p,
+    o71_kvbag_t * kvbag_p,
+    o71_kvbag_cursor_t * cursor_p,
+    o71_cmp_f cmp,
+    void * ctx,
+    o71_kv_t * kv_p
+);
+
 /* o71_superclass_search ****************************************************/
 /**
  *  Returns the position in the array of superclasses or -1.
@@ -1366,6 +2122,34 @@ O71_API o71_status_t o71_reg_obj_create
     o71_ref_t * reg_obj_rp
 );
 
+/* o71_reg_obj_create_n *****************************************************/
+/**
+ *  Creates several dynamic objects of the same class.
+ *  This is faster than calling o71_reg_obj_create() @a n times: object table
+ *  slots are reserved in one pass, bodies are allocated from adjacent memory
+ *  and the class reference count is updated once.
+ *  @param world_p [in]
+ *      the scripting world
+ *  @param class_r [in]
+ *      class derived from reg_obj
+ *  @param n [in]
+ *      number of objects to create
+ *  @param reg_obj_ra [out]
+ *      array of @a n items receiving the objects created; on failure
+ *      its content is undefined and no object is created
+ *  @retval O71_OK
+ *  @retval O71_NO_MEM
+ *  @retval O71_MEM_LIMIT
+ *  @retval O71_ARRAY_LIMIT
+ */
+O71_API o71_status_t o71_reg_obj_create_n
+(
+    o71_world_t * world_p,
+    o71_ref_t class_r,
+    size_t n,
+    o71_ref_t * reg_obj_ra
+);
+
 /* o71_reg_obj_get_field **********************************************************/
 O71_API o71_status_t o71_reg_obj_get_field
 (
@@ -1383,6 +2167,7 @@ O71_API o71_status_t o71_reg_obj_get_field
  *  @param field_istr_r [in]
  *      intern string representing field name
  *  @param value_r [in]
+ *      value to store; the object takes its own reference to it
  *  @retval O71_OK success
  *  @warning
  *      @a field_istr_r must be an intern string otherwise an assertion will